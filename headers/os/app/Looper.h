@@ -146,6 +146,8 @@ private:
 								bigtime_t timeout = B_INFINITE_TIMEOUT);
 			BMessage*		ReadMessageFromPort(
 								bigtime_t timeout = B_INFINITE_TIMEOUT);
+			void			_ReadMessagesFromPort(
+								bigtime_t timeout = B_INFINITE_TIMEOUT);
 	virtual	BMessage*		ConvertToMessage(void* raw, int32 code);
 	virtual	void			task_looper();
 			void			_QuitRequested(BMessage* msg);
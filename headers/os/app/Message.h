@@ -528,6 +528,7 @@ public:
 	class Private;
 	struct message_header;
 	struct field_header;
+	struct field_index;
 
 private:
 	friend class Private;
@@ -546,8 +547,16 @@ private:
 
 			void				_UpdateOffsets(uint32 offset, int32 change);
 			status_t			_ResizeData(uint32 offset, int32 change);
+			status_t			_MoveFieldToEnd(field_header* field);
+			status_t			_CompactData();
+			void				_CopyCompactedData(field_header* fields,
+									uint8* data) const;
 
 			uint32				_HashName(const char* name) const;
+			status_t			_BuildFieldIndex();
+			void				_UpdateFieldIndex();
+			void				_IndexField(uint32 index);
+			void				_DeleteFieldIndex();
 			status_t			_FindField(const char* name, type_code type,
 									field_header** _result) const;
 			status_t			_AddField(const char* name, type_code type,
@@ -597,7 +606,12 @@ private:
 
 			void*				fArchivingPointer;
 
-			uint32				fReserved[8];
+			field_index*		fFieldIndex;
+				// open addressed index of the fields of large messages
+			uint32				fDataGarbage;
+				// bytes in fData no longer used by any field
+
+			uint32				fReserved[7 - sizeof(void*) / sizeof(uint32)];
 
 			enum				{ sNumReplyPorts = 3 };
 	static	port_id				sReplyPorts[sNumReplyPorts];
@@ -11,6 +11,11 @@
 	// For convenience
 
 
+namespace BPrivate {
+	class BDirectMessageTarget;
+}
+
+
 class BMessageQueue {
 public:
 								BMessageQueue();
@@ -46,12 +51,22 @@ private:
 				// be dropped as soon as possible
 
 private:
-			BMessage*			fHead;
-			BMessage*			fTail;
-			int32				fMessageCount;
+	friend class BPrivate::BDirectMessageTarget;
+
+			bool				_AddMessage(BMessage* message);
+			void				_MergeIncoming() const;
+
+private:
+	mutable	BMessage*			fHead;
+	mutable	BMessage*			fTail;
+	mutable	int32				fMessageCount;
 	mutable	BLocker				fLock;
 
-			uint32				_reserved[3];
+			BMessage*			fIncoming;
+				// messages added without the lock, newest first
+			int32				fIncomingCount;
+
+			uint32				_reserved[1];
 };
 
 
@@ -176,6 +176,20 @@ extern status_t		_get_port_message_info_etc(port_id port,
 #define get_port_message_info_etc(port, info, flags, timeout) \
 	_get_port_message_info_etc((port), (info), sizeof(*(info)), flags, timeout)
 
+typedef struct port_message_entry {
+	int32		code;
+	size_t		size;
+	void		*buffer;
+} port_message_entry;
+
+/* read/write several messages at once, only waiting for the first one */
+extern ssize_t		read_port_vector_etc(port_id port, void *buffer,
+						size_t bufferSize, port_message_entry *entries,
+						size_t entryCount, uint32 flags, bigtime_t timeout);
+extern ssize_t		write_port_vector_etc(port_id port,
+						const port_message_entry *entries, size_t entryCount,
+						uint32 flags, bigtime_t timeout);
+
 
 /* Semaphores */
 
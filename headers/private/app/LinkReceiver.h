@@ -49,6 +49,12 @@ class LinkReceiver {
 		virtual status_t AdjustReplyBuffer(bigtime_t timeout);
 		void ResetBuffer();
 
+	private:
+		bool _NextPortMessage();
+
+	protected:
+		enum { kMaxPortMessages = 16 };
+
 		port_id fReceivePort;
 
 		char*	fRecvBuffer;
@@ -60,6 +66,11 @@ class LinkReceiver {
 		int32	fReplySize;	//size of current reply message
 
 		status_t fReadError;	//Read failed for current message
+
+		port_message_entry fPortMessages[kMaxPortMessages];
+				//port messages in recv buffer
+		int32	fPortMessageCount;
+		int32	fPortMessageIndex;	//next port message to use
 };
 
 }	// namespace BPrivate
@@ -18,6 +18,7 @@
 #define MESSAGE_BODY_HASH_TABLE_SIZE	5
 #define MAX_DATA_PREALLOCATION			B_PAGE_SIZE * 10
 #define MAX_FIELD_PREALLOCATION			50
+#define MIN_INDEXED_FIELD_COUNT			8
 
 
 static const int32 kPortMessageCode = 'pjpp';
@@ -89,6 +89,8 @@ extern fssh_status_t	fssh_block_cache_get_etc(void *_cache,
 							fssh_off_t length, const void **_block);
 extern const void *		fssh_block_cache_get(void *_cache,
 							fssh_off_t blockNumber);
+extern fssh_status_t	fssh_block_cache_prefetch(void *_cache,
+							fssh_off_t blockNumber, fssh_size_t *_numBlocks);
 extern fssh_status_t	fssh_block_cache_set_dirty(void *_cache,
 							fssh_off_t blockNumber, bool isDirty,
 							int32_t transaction);
@@ -79,6 +79,9 @@ typedef struct CACHE_LINE_ALIGN cpu_ent {
 	int				topology_id[CPU_TOPOLOGY_LEVELS];
 	int				cache_id[CPU_MAX_CACHE_LEVEL];
 
+	// memory (NUMA) node the CPU belongs to
+	int32			node;
+
 	// IRQs assigned to this CPU
 	struct list		irqs;
 	spinlock		irqs_lock;
@@ -16,6 +16,7 @@
 
 #define CACHE_CLEAR			1	// takes no parameters
 #define CACHE_SET_MODULE	2	// gets the module name as parameter
+#define CACHE_GET_STATS		3	// gets a file_cache_stats_args as parameter
 
 #define CACHE_MODULES_NAME	"file_cache"
 
@@ -23,6 +24,19 @@
 #define FILE_CACHE_LOADED_COMPLETELY	0x02
 #define FILE_CACHE_NO_IO				0x04
 
+struct file_cache_stats {
+	uint64	hits;				// pages read that were found in the cache
+	uint64	misses;				// pages that had to be read from the file
+	uint64	readahead_pages;	// pages read ahead asynchronously
+	uint32	readahead_window;	// the largest current readahead window
+	uint32	streams;			// number of detected sequential streams
+};
+
+struct file_cache_stats_args {
+	int						fd;		// an open file descriptor of the file
+	struct file_cache_stats	stats;
+};
+
 struct cache_module_info {
 	module_info	info;
 
@@ -81,6 +81,11 @@ void scheduler_new_thread_entry(Thread* thread);
 
 void scheduler_set_cpu_enabled(int32 cpu, bool enabled);
 
+/*!	Updates the memory node of the CPU packages from cpu_ent::node. Called
+	once the NUMA topology of the system is known.
+*/
+void scheduler_update_memory_nodes(void);
+
 void scheduler_add_listener(struct SchedulerListener* listener);
 void scheduler_remove_listener(struct SchedulerListener* listener);
 
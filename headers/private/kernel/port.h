@@ -45,6 +45,11 @@ status_t deselect_port(int32 object, struct select_info *info, bool kernel);
 status_t writev_port_etc(port_id id, int32 msgCode, const iovec *msgVecs,
 				size_t vecCount, size_t bufferSize, uint32 flags,
 				bigtime_t timeout);
+ssize_t read_port_vector_etc(port_id id, void *buffer, size_t bufferSize,
+				port_message_entry *entries, size_t entryCount, uint32 flags,
+				bigtime_t timeout);
+ssize_t write_port_vector_etc(port_id id, const port_message_entry *entries,
+				size_t entryCount, uint32 flags, bigtime_t timeout);
 
 // user syscalls
 port_id		_user_create_port(int32 queueLength, const char *name);
@@ -67,6 +72,12 @@ status_t	_user_write_port_etc(port_id port, int32 msgCode,
 status_t	_user_writev_port_etc(port_id id, int32 msgCode,
 				const iovec *msgVecs, size_t vecCount,
 				size_t bufferSize, uint32 flags, bigtime_t timeout);
+ssize_t		_user_read_port_vector_etc(port_id port, void *buffer,
+				size_t bufferSize, port_message_entry *entries,
+				size_t entryCount, uint32 flags, bigtime_t timeout);
+ssize_t		_user_write_port_vector_etc(port_id port,
+				const port_message_entry *entries, size_t entryCount,
+				uint32 flags, bigtime_t timeout);
 status_t	_user_get_port_message_info_etc(port_id port,
 				port_message_info *info, size_t infoSize, uint32 flags,
 				bigtime_t timeout);
@@ -12,9 +12,9 @@
 
 
 struct DepotMagazine;
+struct object_cache_stats;
 
 typedef struct object_depot {
-	rw_lock					outer_lock;
 	spinlock				inner_lock;
 	DepotMagazine*			full;
 	DepotMagazine*			empty;
@@ -22,7 +22,13 @@ typedef struct object_depot {
 	size_t					empty_count;
 	size_t					max_count;
 	size_t					magazine_capacity;
+	size_t					initial_capacity;
+	uint32					exchange_count;
+	uint32					contention_count;
+	uint64					total_exchanges;
+	uint64					total_contentions;
 	struct depot_cpu_store*	stores;
+	void*					stores_allocation;
 	void*					cookie;
 
 	void (*return_object)(struct object_depot* depot, void* cookie,
@@ -45,6 +51,9 @@ void object_depot_store(object_depot* depot, void* object, uint32 flags);
 
 void object_depot_make_empty(object_depot* depot, uint32 flags);
 
+void object_depot_get_stats(object_depot* depot,
+	struct object_cache_stats* stats);
+
 #if PARANOID_KERNEL_FREE
 bool object_depot_contains_object(object_depot* depot, void* object);
 #endif
@@ -33,6 +33,8 @@ enum {
 struct ObjectCache;
 typedef struct ObjectCache object_cache;
 
+struct object_cache_stats;
+
 typedef status_t (*object_cache_constructor)(void* cookie, void* object);
 typedef void (*object_cache_destructor)(void* cookie, void* object);
 typedef void (*object_cache_reclaimer)(void* cookie, int32 level);
@@ -64,6 +66,9 @@ status_t object_cache_reserve(object_cache* cache, size_t object_count,
 
 void object_cache_get_usage(object_cache* cache, size_t* _allocatedMemory);
 
+status_t _user_get_next_object_cache_stats(int32* _cookie,
+	struct object_cache_stats* stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,33 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _KERNEL_UTIL_LZ4_H
+#define _KERNEL_UTIL_LZ4_H
+
+
+#include <SupportDefs.h>
+
+
+// A compressor and decompressor for the LZ4 block format. Only inputs of up
+// to LZ4_MAX_INPUT_SIZE bytes can be compressed.
+
+#define LZ4_MAX_INPUT_SIZE		65535
+#define LZ4_WORK_MEMORY_SIZE	(4096 * sizeof(uint16))
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+ssize_t lz4_compress(const void* source, size_t sourceSize, void* dest,
+	size_t destSize, void* workMemory);
+ssize_t lz4_decompress(const void* source, size_t sourceSize, void* dest,
+	size_t destSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif	// _KERNEL_UTIL_LZ4_H
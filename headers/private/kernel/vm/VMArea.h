@@ -123,6 +123,14 @@ public:
 	struct VMArea*			cache_next;
 	struct VMArea*			cache_prev;
 
+	int32					large_page_faults;
+	int32					large_page_fallbacks;
+		// statistics for B_LARGE_PAGE_AREA areas
+
+	uint8					memory_node_policy;
+	uint8					memory_node;
+		// where the pages of the area are allocated, see B_AREA_NODE_*
+
 			addr_t				Base() const	{ return fBase; }
 			size_t				Size() const	{ return fSize; }
 
@@ -42,6 +42,14 @@ public:
 	virtual	status_t			DebugMarkRangePresent(addr_t start, addr_t end,
 									bool markPresent);
 
+	// large pages
+	virtual	size_t				LargePageSize() const;
+	virtual	status_t			MapLargePage(addr_t virtualAddress,
+									phys_addr_t physicalAddress,
+									uint32 attributes, uint32 memoryType,
+									vm_page_reservation* reservation);
+	virtual	size_t				CountLargePages(addr_t start, addr_t end);
+
 	// map not locked
 	virtual	status_t			UnmapPage(VMArea* area, addr_t address,
 									bool updatePageQueue) = 0;
@@ -121,6 +121,8 @@ status_t vm_delete_area(team_id teamID, area_id areaID, bool kernel);
 status_t vm_create_vnode_cache(struct vnode *vnode, struct VMCache **_cache);
 status_t vm_set_area_memory_type(area_id id, phys_addr_t physicalBase,
 			uint32 type);
+status_t vm_set_area_memory_node_policy(team_id team, area_id areaID,
+			uint32 policy, int32 node, bool kernel);
 status_t vm_set_area_protection(team_id team, area_id areaID,
 			uint32 newProtection, bool kernel);
 status_t vm_get_page_mapping(team_id team, addr_t vaddr, phys_addr_t *paddr);
@@ -181,6 +183,10 @@ status_t _user_munlock(const void* address, size_t size);
 area_id _user_area_for(void *address);
 area_id _user_find_area(const char *name);
 status_t _user_get_area_info(area_id area, area_info *info);
+status_t _user_get_area_large_page_info(area_id area,
+			struct area_large_page_info* info);
+status_t _user_set_area_memory_node_policy(area_id area, uint32 policy,
+			int32 node);
 status_t _user_get_next_area_info(team_id team, ssize_t *cookie, area_info *info);
 status_t _user_resize_area(area_id area, size_t newSize);
 area_id _user_transfer_area(area_id area, void **_address, uint32 addressSpec,
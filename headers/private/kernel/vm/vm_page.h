@@ -66,6 +66,10 @@ struct vm_page *vm_page_allocate_page(vm_page_reservation* reservation,
 struct vm_page *vm_page_allocate_page_run(uint32 flags, page_num_t length,
 	const physical_address_restrictions* restrictions, int priority);
 struct vm_page *vm_page_at_index(int32 index);
+
+status_t vm_page_set_memory_nodes(const struct vm_memory_node_range* ranges,
+	uint32 rangeCount, uint32 nodeCount, const uint8* distances);
+uint32 vm_page_memory_node_count(void);
 struct vm_page *vm_lookup_page(page_num_t pageNumber);
 bool vm_page_is_dummy(struct vm_page *page);
 
@@ -154,6 +154,8 @@ public:
 	uint8					unused : 1;
 
 	uint8					usage_count;
+	uint8					node;
+		// the memory node the page belongs to
 
 	inline void Init(page_num_t pageNumber);
 
@@ -199,6 +201,24 @@ enum {
 #define VM_PAGE_ALLOC_STATE	0x00000007
 #define VM_PAGE_ALLOC_CLEAR	0x00000010
 #define VM_PAGE_ALLOC_BUSY	0x00000020
+#define VM_PAGE_ALLOC_DONT_WAIT	0x00000040
+	// vm_page_allocate_page_run() only: fail instead of waiting for pages
+#define VM_PAGE_ALLOC_NODE_SET	0x00000080
+	// vm_page_allocate_page() only: prefer the node given via
+	// VM_PAGE_ALLOC_NODE() instead of the one of the current CPU
+#define VM_PAGE_ALLOC_NODE_SHIFT	8
+#define VM_PAGE_ALLOC_NODE_MASK		0x0000ff00
+#define VM_PAGE_ALLOC_NODE(node) \
+	(VM_PAGE_ALLOC_NODE_SET | ((uint32)(node) << VM_PAGE_ALLOC_NODE_SHIFT))
+
+#define VM_MAX_MEMORY_NODES	8
+
+
+struct vm_memory_node_range {
+	phys_addr_t	start;
+	phys_size_t	size;
+	uint32		node;
+};
 
 
 inline void
@@ -209,6 +229,7 @@ vm_page::Init(page_num_t pageNumber)
 	new(&mappings) vm_page_mappings();
 	fWiredCount = 0;
 	usage_count = 0;
+	node = 0;
 	busy_writing = false;
 	SetCacheRef(NULL);
 	#if DEBUG_PAGE_QUEUE
@@ -68,6 +68,7 @@ typedef GenericCompressionAlgorithmOwner<BDecompressionParameters>
 class PackageFileHeapAccessorBase : public BAbstractBufferedDataReader {
 public:
 			class OffsetArray;
+			class ChunkCache;
 
 public:
 								PackageFileHeapAccessorBase(
@@ -92,10 +93,18 @@ public:
 			void				SetFile(BPositionIO* file)
 									{ fFile = file; }
 
+			void				SetChunkCache(ChunkCache* cache)
+									{ fChunkCache = cache; }
+									// only used by reads that ask for it
+
 	// BAbstractBufferedDataReader
 	virtual	status_t			ReadDataToOutput(off_t offset,
 									size_t size, BDataIO* output);
 
+			status_t			ReadDataToOutput(off_t offset,
+									size_t size, BDataIO* output,
+									bool useChunkCache);
+
 public:
 	static	const size_t		kChunkSize = 64 * 1024;
 #if defined(_KERNEL_MODE)
@@ -126,6 +135,31 @@ protected:
 			uint64				fCompressedHeapSize;
 			uint64				fUncompressedHeapSize;
 			DecompressionAlgorithmOwner* fDecompressionAlgorithm;
+			ChunkCache*			fChunkCache;
+};
+
+
+/*!	Interface of a cache for decompressed chunks, that can be shared between
+	heap readers. Chunks are identified by the heap and their index in it.
+	AcquireChunk() returns a cookie for a cached chunk, and its data, which
+	stay valid until the cookie is passed to ReleaseChunk(). When a heap is
+	deleted, it removes all of its chunks via RemoveChunks().
+ */
+class PackageFileHeapAccessorBase::ChunkCache {
+public:
+	virtual						~ChunkCache();
+
+	virtual	void*				AcquireChunk(
+									const PackageFileHeapAccessorBase* heap,
+									size_t chunkIndex, const void*& _data) = 0;
+	virtual	void				ReleaseChunk(void* cookie) = 0;
+	virtual	void				InsertChunk(
+									const PackageFileHeapAccessorBase* heap,
+									size_t chunkIndex, const void* data,
+									size_t size) = 0;
+	virtual	void				RemoveChunks(
+									const PackageFileHeapAccessorBase* heap)
+									= 0;
 };
 
 
@@ -63,13 +63,19 @@ private:
 			struct Chunk;
 			struct ChunkSegment;
 			struct ChunkBuffer;
+			struct CompressionJob;
+			struct CompressionPipeline;
 
 			friend struct ChunkBuffer;
 
 private:
 			void				_Uninit();
 
+			void				_InitCompressionPipeline();
+			status_t			_QueuePendingData();
 			status_t			_FlushPendingData();
+			status_t			_WriteCompressionJob();
+			status_t			_WriteCompressionJobs();
 			status_t			_WriteChunk(const void* data, size_t size,
 									bool mayCompress);
 			status_t			_WriteDataCompressed(const void* data,
@@ -87,6 +93,8 @@ private:
 			size_t				fPendingDataSize;
 			Array<uint64>		fOffsets;
 			CompressionAlgorithmOwner* fCompressionAlgorithm;
+			CompressionPipeline* fCompressionPipeline;
+			bool				fSynchronousWrites;
 };
 
 
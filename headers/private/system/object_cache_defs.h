@@ -0,0 +1,33 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_OBJECT_CACHE_DEFS_H
+#define _SYSTEM_OBJECT_CACHE_DEFS_H
+
+#include <OS.h>
+
+
+#define B_OBJECT_CACHE_NAME_LENGTH	32
+
+
+typedef struct object_cache_stats {
+	char		name[B_OBJECT_CACHE_NAME_LENGTH];
+	size_t		object_size;
+	size_t		usage;				/* bytes allocated for slabs */
+	size_t		used_objects;
+	size_t		total_objects;
+	uint32		flags;
+
+	/* object depot, all zero if the cache doesn't use one */
+	uint32		magazine_capacity;
+	uint32		initial_magazine_capacity;
+	uint32		full_magazines;
+	uint64		depot_hits;			/* served by a per-CPU magazine */
+	uint64		depot_misses;		/* had to go to the depot or the slabs */
+	uint64		exchanges;			/* magazine exchanges with the depot */
+	uint64		contentions;		/* depot lock acquisitions that had to wait */
+} object_cache_stats;
+
+
+#endif	/* _SYSTEM_OBJECT_CACHE_DEFS_H */
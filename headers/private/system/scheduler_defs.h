@@ -10,6 +10,25 @@
 
 struct scheduling_analysis_thread_wait_object;
 
+
+// Distances of thread migrations, from the cheapest to the most expensive one
+enum {
+	SCHEDULER_MIGRATION_SMT = 0,
+		// to another logical processor of the same core
+	SCHEDULER_MIGRATION_SHARED_CACHE,
+		// to another core sharing the last level cache
+	SCHEDULER_MIGRATION_PACKAGE,
+		// to another core of the same package
+	SCHEDULER_MIGRATION_REMOTE,
+		// to another package
+
+	SCHEDULER_MIGRATION_DISTANCES
+};
+
+// Bucket i of the latency histograms counts latencies of less than 2^i us,
+// the last one all longer latencies.
+#define SCHEDULING_ANALYSIS_HISTOGRAM_BUCKETS	20
+
 struct scheduling_analysis_thread {
 	thread_id	id;
 	char		name[B_OS_NAME_LENGTH];
@@ -33,6 +52,9 @@ struct scheduling_analysis_thread {
 
 	int64		preemptions;
 
+	int64		migrations[SCHEDULER_MIGRATION_DISTANCES];
+	int64		latency_histogram[SCHEDULING_ANALYSIS_HISTOGRAM_BUCKETS];
+
 	scheduling_analysis_thread_wait_object* wait_objects;
 };
 
@@ -59,6 +81,9 @@ struct scheduling_analysis {
 	scheduling_analysis_thread**	threads;
 	uint64							wait_object_count;
 	uint64							thread_wait_object_count;
+	int64							migrations[SCHEDULER_MIGRATION_DISTANCES];
+	int64							latency_histogram[
+										SCHEDULING_ANALYSIS_HISTOGRAM_BUCKETS];
 };
 
 
@@ -21,6 +21,7 @@
 extern "C" {
 #endif
 
+struct area_large_page_info;
 struct attr_info;
 struct dirent;
 struct event_wait_info;
@@ -30,6 +31,7 @@ struct fs_info;
 struct iovec;
 struct msqid_ds;
 struct net_stat;
+struct object_cache_stats;
 struct pollfd;
 struct rlimit;
 struct scheduling_analysis;
@@ -461,6 +463,12 @@ extern status_t		_kern_memory_advice(void *address, size_t size,
 
 extern status_t		_kern_get_memory_properties(team_id teamID,
 						const void *address, uint32* _protected, uint32* _lock);
+extern status_t		_kern_get_area_large_page_info(area_id area,
+						struct area_large_page_info* info);
+extern status_t		_kern_set_area_memory_node_policy(area_id area,
+						uint32 policy, int32 node);
+extern status_t		_kern_get_next_object_cache_stats(int32* cookie,
+						struct object_cache_stats* stats);
 
 extern status_t		_kern_mlock(const void* address, size_t size);
 extern status_t		_kern_munlock(const void* address, size_t size);
@@ -486,6 +494,12 @@ extern status_t		_kern_write_port_etc(port_id port, int32 msgCode,
 extern status_t		_kern_writev_port_etc(port_id id, int32 msgCode,
 						const struct iovec *msgVecs, size_t vecCount,
 						size_t bufferSize, uint32 flags, bigtime_t timeout);
+extern ssize_t		_kern_read_port_vector_etc(port_id port, void *buffer,
+						size_t bufferSize, port_message_entry *entries,
+						size_t entryCount, uint32 flags, bigtime_t timeout);
+extern ssize_t		_kern_write_port_vector_etc(port_id port,
+						const port_message_entry *entries, size_t entryCount,
+						uint32 flags, bigtime_t timeout);
 extern status_t		_kern_get_port_message_info_etc(port_id port,
 						port_message_info *info, size_t infoSize, uint32 flags,
 						bigtime_t timeout);
@@ -26,9 +26,13 @@
 #define B_KERNEL_AREA			(1 << 14)
 	// Usable from userland according to its protection flags, but the area
 	// itself is not deletable, resizable, etc from userland.
+#define B_LARGE_PAGE_AREA		(1 << 15)
+	// Map the area using large pages where possible. Only honored for
+	// B_NO_LOCK areas, which are committed upfront then.
 
 #define B_USER_AREA_FLAGS		\
-	(B_USER_PROTECTION | B_OVERCOMMITTING_AREA | B_CLONEABLE_AREA)
+	(B_USER_PROTECTION | B_OVERCOMMITTING_AREA | B_CLONEABLE_AREA \
+	| B_LARGE_PAGE_AREA)
 #define B_KERNEL_AREA_FLAGS \
 	(B_KERNEL_PROTECTION | B_SHARED_AREA)
 
@@ -46,5 +50,24 @@ enum {
 
 #define MEMORY_TYPE_SHIFT		28
 
+// memory node policies of an area, see _kern_set_area_memory_node_policy()
+enum {
+	B_AREA_NODE_LOCAL		= 0,
+		// allocate pages on the memory node of the CPU touching them first
+	B_AREA_NODE_PREFERRED,
+		// allocate pages on the given node, if it has free pages
+	B_AREA_NODE_INTERLEAVE
+		// spread the pages round-robin over all memory nodes
+};
+
+
+// large page statistics of an area, see _kern_get_area_large_page_info()
+typedef struct area_large_page_info {
+	size_t		page_size;		// 0, if large pages are not supported
+	size_t		mapped_pages;	// large pages currently mapped
+	uint32		faults;			// faults resolved with a large page
+	uint32		fallbacks;		// failed attempts to allocate a large page
+} area_large_page_info;
+
 
 #endif	/* _SYSTEM_VM_DEFS_H */
@@ -20,6 +20,14 @@ public:
 				port_id			owner_port;
 				port_id			client_port;
 				int32			size;
+				area_id			ring_area;
+					// < 0, if only the port protocol shall be used
+			};
+
+			struct Statistics {
+				int64			ring_messages;
+				int64			port_messages;
+				int64			doorbells;
 			};
 
 public:
@@ -40,17 +48,53 @@ public:
 			void				Unreserve(int32 endOffset);
 			int32				ReservedSize() const { return fReservedSize; }
 
+			bool				UsesRing() const;
+
+			status_t			AllocateSharedData(int32 size, int32 align,
+									void** _data, int32* _offset);
+			void				UnreserveSharedData(int32 endOffset);
+			int32				SharedDataReservedSize() const
+									{ return fSharedDataReservedSize; }
+			void*				GetPeerSharedData(int32 offset,
+									int32 size) const;
+
 			status_t			Send(const void* message, int32 size);
 			status_t			Receive(void** _message, size_t* _size,
 									bigtime_t timeout = -1);
 
+			const Statistics&	GetStatistics() const	{ return fStatistics; }
+
 private:
+			struct RingChannel;
+			struct RingHeader;
+
 			friend class ::KernelDebug;
 
+			status_t			_InitRing();
+			status_t			_AttachRing(area_id area);
+			RingChannel*		_SendChannel() const;
+			RingChannel*		_ReceiveChannel() const;
+			uint8*				_ChannelBuffer(int32 channel) const;
+
+			status_t			_SendToRing(const void* message, int32 size);
+			status_t			_ReceiveFromRing(void** _message,
+									size_t* _size);
+			bool				_RingHasMessage() const;
+			status_t			_ReceiveFromPort(port_id port, ssize_t size,
+									void** _message, size_t* _size);
+
 			Info				fInfo;
 			uint8*				fBuffer;
 			int32				fCapacity;
 			int32				fReservedSize;
+			area_id				fRingArea;
+			RingHeader*			fRing;
+			int32				fRingSize;
+			uint8*				fSharedData;
+			uint8*				fPeerSharedData;
+			int32				fSharedDataSize;
+			int32				fSharedDataReservedSize;
+			Statistics			fStatistics;
 			status_t			fInitStatus;
 			bool				fOwner;
 };
@@ -11,6 +11,12 @@ enum {
 	ADDRESS_IS_STRING	= 0x02,
 };
 
+// special area ID: the data live in the sender's shared data region of the
+// port (cf. Port::AllocateSharedData())
+enum {
+	SHARED_DATA_AREA	= -2,
+};
+
 namespace UserlandFSUtil {
 
 class RequestAllocator;
@@ -51,7 +51,8 @@ private:
 			struct DeferredInitInfo {
 				Address*	target;
 				uint8*		data;		// only if in port buffer
-				area_id		area;		// only if in area, otherwise -1
+				area_id		area;		// only if in area or shared data,
+										// otherwise -1
 				int32		offset;
 				int32		size;
 				bool		inPortBuffer;
@@ -62,6 +63,7 @@ private:
 			Request*			fRequest;
 			int32				fRequestSize;
 			int32				fPortReservedOffset;
+			int32				fSharedDataReservedOffset;
 			int32				fRequestOffset;
 			area_id				fAllocatedAreas[MAX_REQUEST_ADDRESS_COUNT];
 			int32				fAllocatedAreaCount;
@@ -260,6 +260,8 @@ enum {
 
 namespace UserlandFSUtil {
 
+class Port;
+
 // ReplyRequest
 class ReplyRequest : public Request {
 public:
@@ -2399,7 +2401,7 @@ status_t get_request_address_infos(Request* request, AddressInfo* infos,
 	int32* count);
 status_t check_request(Request* request);
 status_t relocate_request(Request* request, int32 requestBufferSize,
-	area_id* areas, int32* count);
+	area_id* areas, int32* count, const Port* port = NULL);
 
 }	// namespace UserlandFSUtil
 
@@ -337,6 +337,21 @@ BFSPartitionHandle::Repair(bool checkOnly)
 	//printf("\tpartial block runs\t%" B_PRIu64 "\n",
 	//	result.stats.partial_block_runs);
 
+	printf("\n\tdata streams\t\t\t%" B_PRIu64 " (%" B_PRIu64 " fragmented)\n",
+		result.stats.data_streams, result.stats.fragmented_streams);
+	printf("\textents per stream\t\t%.2f (at most %" B_PRIu64 ", inode %"
+		B_PRIdINO ")\n", result.stats.data_streams > 0
+			? 1.0 * result.stats.data_extents / result.stats.data_streams : 0.0,
+		result.stats.max_stream_extents,
+		result.stats.most_fragmented_inode);
+	printf("\tfree extents\t\t\t%" B_PRIu64 " (largest %s)\n",
+		result.stats.free_extents, size_string(1.0
+			* result.stats.largest_free_extent
+			* result.stats.block_size).String());
+
+	if ((result.errors & BFS_INDEX_NOT_REBUILT) != 0)
+		printf("\nSome indices could not be rebuilt, and may be incomplete!\n");
+
 	if (result.status == B_ENTRY_NOT_FOUND)
 		result.status = B_OK;
 
@@ -42,6 +42,7 @@
 #define VIRTIO_BLK_F_FLUSH	0x0200	/* Flush command supported */
 #define VIRTIO_BLK_F_TOPOLOGY	0x0400	/* Topology information is available */
 #define VIRTIO_BLK_F_CONFIG_WCE 0x0800	/* Writeback mode available in config */
+#define VIRTIO_BLK_F_MQ		0x1000	/* Support more than one vq */
 
 #define VIRTIO_BLK_ID_BYTES	20	/* ID string length */
 
@@ -72,6 +73,10 @@ struct virtio_blk_config {
 
 	/* Writeback mode (if VIRTIO_BLK_F_CONFIG_WCE) */
 	uint8_t writeback;
+	uint8_t unused0;
+
+	/* Number of request queues (if VIRTIO_BLK_F_MQ) */
+	uint16_t num_queues;
 
 } __packed;
 
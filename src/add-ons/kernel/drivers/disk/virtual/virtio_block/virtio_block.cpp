@@ -47,12 +47,32 @@ static const uint8 kDriveIcon[] = {
 #define VIRTIO_BLOCK_DEVICE_MODULE_NAME "drivers/disk/virtual/virtio_block/device_v1"
 #define VIRTIO_BLOCK_DEVICE_ID_GENERATOR	"virtio_block/device_id"
 
+#define VIRTIO_BLOCK_MAX_QUEUES		VIRTIO_VIRTQUEUES_MAX_COUNT
+#define VIRTIO_BLOCK_COMMAND_SIZE	64
+	// per queue space in the command buffer, for the header and status byte
+
+
+typedef struct {
+	virtio_device_interface*	virtio;
+	::virtio_queue			virtio_queue;
+
+	addr_t					bufferAddr;
+	phys_addr_t				bufferPhysAddr;
+
+	mutex					lock;
+	int32					currentRequest;
+	ConditionVariable		interruptCondition;
+	ConditionVariableEntry 	interruptConditionEntry;
+} virtio_block_queue;
+
 
 typedef struct {
 	device_node*			node;
 	::virtio_device			virtio_device;
 	virtio_device_interface*	virtio;
-	::virtio_queue			virtio_queue;
+	virtio_block_queue		queues[VIRTIO_BLOCK_MAX_QUEUES];
+	uint32					queue_count;
+	int32					id;
 	IOScheduler*			io_scheduler;
 	DMAResource*			dma_resource;
 
@@ -67,11 +87,6 @@ typedef struct {
 	uint32					block_size;
 	uint32					physical_block_size;
 	status_t				media_status;
-
-	mutex					lock;
-	int32					currentRequest;
-	ConditionVariable		interruptCondition;
-	ConditionVariableEntry 	interruptConditionEntry;
 } virtio_block_driver_info;
 
 
@@ -88,7 +103,7 @@ typedef struct {
 
 #include "dma_resources.h"
 #include "IORequest.h"
-#include "IOSchedulerSimple.h"
+#include "IOSchedulerRoster.h"
 
 
 //#define TRACE_VIRTIO_BLOCK
@@ -131,6 +146,8 @@ get_feature_name(uint64 feature)
 			return "topology";
 		case VIRTIO_BLK_F_CONFIG_WCE:
 			return "config wce";
+		case VIRTIO_BLK_F_MQ:
+			return "multiple queues";
 	}
 	return NULL;
 }
@@ -177,35 +194,37 @@ virtio_block_config_callback(void* driverCookie)
 static void
 virtio_block_callback(void* driverCookie, void* _cookie)
 {
-	virtio_block_driver_info* info = (virtio_block_driver_info*)_cookie;
+	virtio_block_queue* queue = (virtio_block_queue*)_cookie;
 
 	void* cookie = NULL;
-	while (info->virtio->queue_dequeue(info->virtio_queue, &cookie, NULL)) {
-		if ((int32)(addr_t)cookie == atomic_get(&info->currentRequest))
-			info->interruptCondition.NotifyAll();
+	while (queue->virtio->queue_dequeue(queue->virtio_queue, &cookie, NULL)) {
+		if ((int32)(addr_t)cookie == atomic_get(&queue->currentRequest))
+			queue->interruptCondition.NotifyAll();
 	}
 }
 
 
 static status_t
-do_io(void* cookie, IOOperation* operation)
+do_io(void* cookie, uint32 queueIndex, IOOperation* operation)
 {
 	virtio_block_driver_info* info = (virtio_block_driver_info*)cookie;
+	virtio_block_queue* queue = &info->queues[queueIndex % info->queue_count];
 
-	if (mutex_trylock(&info->lock) != B_OK)
+	if (mutex_trylock(&queue->lock) != B_OK)
 		return B_BUSY;
 
 	BStackOrHeapArray<physical_entry, 16> entries(operation->VecCount() + 2);
 
-	struct virtio_blk_outhdr *header = (struct virtio_blk_outhdr*)info->bufferAddr;
+	struct virtio_blk_outhdr *header
+		= (struct virtio_blk_outhdr*)queue->bufferAddr;
 	header->type = operation->IsWrite() ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
 	header->sector = operation->Offset() / 512;
 	header->ioprio = 1;
 
-	uint8* ack = (uint8*)info->bufferAddr + sizeof(struct virtio_blk_outhdr);
+	uint8* ack = (uint8*)queue->bufferAddr + sizeof(struct virtio_blk_outhdr);
 	*ack = 0xff;
 
-	entries[0].address = info->bufferPhysAddr;
+	entries[0].address = queue->bufferPhysAddr;
 	entries[0].size = sizeof(struct virtio_blk_outhdr);
 	entries[operation->VecCount() + 1].address = entries[0].address
 		+ sizeof(struct virtio_blk_outhdr);
@@ -214,15 +233,15 @@ do_io(void* cookie, IOOperation* operation)
 	memcpy(entries + 1, operation->Vecs(), operation->VecCount()
 		* sizeof(physical_entry));
 
-	atomic_add(&info->currentRequest, 1);
-	info->interruptCondition.Add(&info->interruptConditionEntry);
+	atomic_add(&queue->currentRequest, 1);
+	queue->interruptCondition.Add(&queue->interruptConditionEntry);
 
-	info->virtio->queue_request_v(info->virtio_queue, entries,
+	info->virtio->queue_request_v(queue->virtio_queue, entries,
 		1 + (operation->IsWrite() ? operation->VecCount() : 0 ),
 		1 + (operation->IsWrite() ? 0 : operation->VecCount()),
-		(void *)(addr_t)info->currentRequest);
+		(void *)(addr_t)queue->currentRequest);
 
-	status_t result = info->interruptConditionEntry.Wait(B_RELATIVE_TIMEOUT,
+	status_t result = queue->interruptConditionEntry.Wait(B_RELATIVE_TIMEOUT,
 		10 * 1000 * 1000);
 
 	size_t bytesTransferred = 0;
@@ -246,7 +265,7 @@ do_io(void* cookie, IOOperation* operation)
 
 	info->io_scheduler->OperationCompleted(operation, status,
 		bytesTransferred);
-	mutex_unlock(&info->lock);
+	mutex_unlock(&queue->lock);
 	return status;
 }
 
@@ -270,7 +289,7 @@ virtio_block_init_device(void* _info, void** _cookie)
 			| VIRTIO_BLK_F_SEG_MAX | VIRTIO_BLK_F_GEOMETRY
 			| VIRTIO_BLK_F_RO | VIRTIO_BLK_F_BLK_SIZE
 			| VIRTIO_BLK_F_FLUSH | VIRTIO_BLK_F_TOPOLOGY
-			| VIRTIO_FEATURE_RING_INDIRECT_DESC,
+			| VIRTIO_BLK_F_MQ | VIRTIO_FEATURE_RING_INDIRECT_DESC,
 		&info->features, &get_feature_name);
 
 	status_t status = info->virtio->read_device_config(
@@ -279,13 +298,29 @@ virtio_block_init_device(void* _info, void** _cookie)
 	if (status != B_OK)
 		return status;
 
+	// use one request queue per CPU, as far as the device supports it
+	info->queue_count = 1;
+	if ((info->features & VIRTIO_BLK_F_MQ) != 0
+		&& info->config.num_queues > 1) {
+		info->queue_count = min_c(info->config.num_queues,
+			VIRTIO_BLOCK_MAX_QUEUES);
+
+		system_info sysinfo;
+		if (get_system_info(&sysinfo) == B_OK
+			&& info->queue_count > sysinfo.cpu_count) {
+			info->queue_count = sysinfo.cpu_count;
+		}
+	}
+
 	virtio_block_set_capacity(info);
 
-	TRACE("virtio_block: capacity: %" B_PRIu64 ", block_size %" B_PRIu32 "\n",
-		info->capacity, info->block_size);
+	TRACE("virtio_block: capacity: %" B_PRIu64 ", block_size %" B_PRIu32
+		", %" B_PRIu32 " queues\n", info->capacity, info->block_size,
+		info->queue_count);
 
-	status = info->virtio->alloc_queues(info->virtio_device, 1,
-		&info->virtio_queue);
+	::virtio_queue virtioQueues[VIRTIO_BLOCK_MAX_QUEUES];
+	status = info->virtio->alloc_queues(info->virtio_device, info->queue_count,
+		virtioQueues);
 	if (status != B_OK) {
 		ERROR("queue allocation failed (%s)\n", strerror(status));
 		return status;
@@ -293,9 +328,13 @@ virtio_block_init_device(void* _info, void** _cookie)
 	status = info->virtio->setup_interrupt(info->virtio_device,
 		virtio_block_config_callback, info);
 
-	if (status == B_OK) {
-		status = info->virtio->queue_setup_interrupt(info->virtio_queue,
-			virtio_block_callback, info);
+	for (uint32 i = 0; i < info->queue_count && status == B_OK; i++) {
+		virtio_block_queue* queue = &info->queues[i];
+		queue->virtio = info->virtio;
+		queue->virtio_queue = virtioQueues[i];
+
+		status = info->virtio->queue_setup_interrupt(queue->virtio_queue,
+			virtio_block_callback, queue);
 	}
 
 	*_cookie = info;
@@ -473,17 +512,15 @@ virtio_block_set_capacity(virtio_block_driver_info* info)
 	if (status != B_OK)
 		panic("initializing DMAResource failed: %s", strerror(status));
 
-	info->io_scheduler = new(std::nothrow) IOSchedulerSimple(
-		info->dma_resource);
-	if (info->io_scheduler == NULL)
-		panic("allocating IOScheduler failed.");
+	char name[64];
+	snprintf(name, sizeof(name), "virtio_block/%" B_PRId32, info->id);
 
-	// TODO: use whole device name here
-	status = info->io_scheduler->Init("virtio");
+	status = IOSchedulerRoster::Default()->CreateScheduler(name,
+		info->dma_resource, info->queue_count, info->io_scheduler);
 	if (status != B_OK)
 		panic("initializing IOScheduler failed: %s", strerror(status));
 
-	info->io_scheduler->SetCallback(do_io, info);
+	info->io_scheduler->SetQueueCallback(do_io, info);
 
 	info->block_size = blockSize;
 	info->physical_block_size = physicalBlockSize;
@@ -574,9 +611,16 @@ virtio_block_init_driver(device_node *node, void **cookie)
 	}
 
 	info->bufferPhysAddr = entry.address;
-	info->interruptCondition.Init(info, "virtio block transfer");
-	info->currentRequest = 0;
-	mutex_init(&info->lock, "virtio block request");
+
+	for (uint32 i = 0; i < VIRTIO_BLOCK_MAX_QUEUES; i++) {
+		virtio_block_queue* queue = &info->queues[i];
+		queue->bufferAddr = info->bufferAddr + i * VIRTIO_BLOCK_COMMAND_SIZE;
+		queue->bufferPhysAddr
+			= info->bufferPhysAddr + i * VIRTIO_BLOCK_COMMAND_SIZE;
+		queue->interruptCondition.Init(queue, "virtio block transfer");
+		queue->currentRequest = 0;
+		mutex_init(&queue->lock, "virtio block request");
+	}
 
 	info->node = node;
 
@@ -590,7 +634,8 @@ virtio_block_uninit_driver(void *_cookie)
 {
 	CALLED();
 	virtio_block_driver_info* info = (virtio_block_driver_info*)_cookie;
-	mutex_destroy(&info->lock);
+	for (uint32 i = 0; i < VIRTIO_BLOCK_MAX_QUEUES; i++)
+		mutex_destroy(&info->queues[i].lock);
 	delete_area(info->bufferArea);
 	free(info);
 }
@@ -607,6 +652,8 @@ virtio_block_register_child_devices(void* _cookie)
 	if (id < 0)
 		return id;
 
+	info->id = id;
+
 	char name[64];
 	snprintf(name, sizeof(name), "disk/virtual/virtio_block/%" B_PRId32 "/raw",
 		id);
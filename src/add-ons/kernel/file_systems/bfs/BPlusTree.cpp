@@ -31,6 +31,16 @@ namespace BFS {
 #endif
 
 
+#if !_BOOT_MODE
+static const uint32 kMaxBulkLoadChanges = 1024;
+	// number of keys BulkLoad() adds to a node level per transaction
+static const int32 kReadAheadNodes = 32;
+	// size of the stream range a TreeIterator reads ahead
+static const uint32 kMinSequentialNodes = 2;
+	// number of nearby sibling nodes to visit before reading ahead
+#endif
+
+
 /*!	Simple array used for the duplicate handling in the B+Tree. This is an
 	on disk structure.
 */
@@ -1004,6 +1014,41 @@ BPlusTree::_RemoveIterator(TreeIterator* iterator)
 	MutexLocker _(fIteratorLock);
 	fIterators.Remove(iterator);
 }
+
+
+/*!	Asks the block cache to read the blocks of the given stream range in the
+	background, if they are not cached yet. This is only a hint; it stops at
+	the first block that is already in the cache.
+	You need to have the inode read or write locked.
+*/
+void
+BPlusTree::_ReadAhead(off_t offset, off_t size)
+{
+	Volume* volume = fStream->GetVolume();
+	off_t end = min_c(offset + size, fHeader.MaximumSize());
+
+	while (offset < end) {
+		block_run run;
+		off_t fileOffset;
+		if (fStream->FindBlockRun(offset, run, fileOffset) != B_OK)
+			return;
+
+		off_t blockOffset = (offset - fileOffset) >> volume->BlockShift();
+		off_t runEnd = fileOffset
+			+ ((off_t)run.Length() << volume->BlockShift());
+		size_t numBlocks = ((min_c(end, runEnd) - fileOffset
+				+ volume->BlockSize() - 1) >> volume->BlockShift())
+			- blockOffset;
+
+		size_t count = numBlocks;
+		if (block_cache_prefetch(volume->BlockCache(),
+				volume->ToBlock(run) + blockOffset, &count) != B_OK
+			|| count < numBlocks)
+			return;
+
+		offset = runEnd;
+	}
+}
 #endif // !_BOOT_MODE
 
 
@@ -1361,6 +1406,19 @@ BPlusTree::_InsertDuplicate(Transaction& transaction, CachedNode& cached,
 }
 
 
+/*!	Returns whether or not \a node has enough space left for another key of
+	the given length, and its value.
+*/
+bool
+BPlusTree::_HasRoomFor(const bplustree_node* node, uint16 keyLength) const
+{
+	return int32(key_align(sizeof(bplustree_node) + node->AllKeyLength()
+			+ keyLength)
+		+ (node->NumKeys() + 1) * (sizeof(uint16) + sizeof(off_t)))
+		< fNodeSize;
+}
+
+
 void
 BPlusTree::_InsertKey(bplustree_node* node, uint16 index, uint8* key,
 	uint16 keyLength, off_t value)
@@ -1728,10 +1786,7 @@ BPlusTree::Insert(Transaction& transaction, const uint8* key, uint16 keyLength,
 			return B_IO_ERROR;
 
 		// is the node big enough to hold the pair?
-		if (int32(key_align(sizeof(bplustree_node)
-				+ writableNode->AllKeyLength() + keyLength)
-				+ (writableNode->NumKeys() + 1) * (sizeof(uint16)
-				+ sizeof(off_t))) < fNodeSize) {
+		if (_HasRoomFor(writableNode, keyLength)) {
 			_InsertKey(writableNode, nodeAndKey.keyIndex,
 				keyBuffer, keyLength, value);
 			_UpdateIterators(nodeAndKey.nodeOffset, BPLUSTREE_NULL,
@@ -2259,6 +2314,385 @@ BPlusTree::Replace(Transaction& transaction, const uint8* key, uint16 keyLength,
 	}
 	RETURN_ERROR(B_ERROR);
 }
+
+
+//	#pragma mark - bulk loading
+
+
+/*!	Fills an empty tree with the keys delivered by \a source, which must come
+	in the tree's sort order. Duplicates are only accepted if the tree allows
+	them.
+	Instead of inserting the keys one by one, the leaves are packed from left
+	to right, and the inner levels are built bottom-up on top of them. This
+	only needs a fraction of the node accesses of Insert(), and results in a
+	compact tree; if it had been emptied with MakeEmpty() before, its leaves
+	are also laid out in key order in the stream, which helps the iterator's
+	read ahead.
+
+	The tree is built over several transactions, and the journal is locked
+	during the whole operation, so that nobody else can change the volume in
+	the meantime. The new nodes only become reachable in the last of them; if
+	anything goes wrong before, they are just left unused in the stream until
+	the tree is emptied again.
+	You must not call this method with a running transaction.
+*/
+status_t
+BPlusTree::BulkLoad(BulkLoadSource& source)
+{
+	if (fStream == NULL)
+		RETURN_ERROR(B_NO_INIT);
+
+	Journal* journal = fStream->GetVolume()->GetJournal(0);
+	status_t status = journal->Lock(NULL, true);
+	if (status != B_OK)
+		return status;
+
+	status = _BulkLoad(source);
+
+	journal->Unlock(NULL, true);
+	return status;
+}
+
+
+status_t
+BPlusTree::_BulkLoad(BulkLoadSource& source)
+{
+	Transaction transaction;
+	status_t status = _RestartTransaction(transaction);
+	if (status != B_OK)
+		return status;
+
+	// Only an empty tree can be bulk loaded
+	off_t oldRoot = fHeader.RootNode();
+	CachedNode cached(this);
+	const bplustree_node* root = cached.SetTo(oldRoot);
+	if (root == NULL)
+		return B_IO_ERROR;
+	if (!root->IsLeaf() || root->NumKeys() != 0)
+		RETURN_ERROR(B_NOT_ALLOWED);
+
+	cached.Unset();
+
+	off_t rootOffset;
+	uint32 count;
+	status = _BulkLoadLeaves(transaction, source, rootOffset, count);
+	if (status != B_OK)
+		return status;
+	if (count == 0)
+		return transaction.Done();
+
+	uint32 levels = 1;
+	while (count > 1) {
+		status = _BulkLoadLevel(transaction, rootOffset, rootOffset, count);
+		if (status != B_OK)
+			return status;
+
+		levels++;
+	}
+
+	// Publish the new tree, and free the old root node
+
+	bplustree_header* header = cached.SetToWritableHeader(transaction);
+	if (header == NULL)
+		return B_IO_ERROR;
+
+	header->root_node_pointer = HOST_ENDIAN_TO_BFS_INT64(rootOffset);
+	header->max_number_of_levels = HOST_ENDIAN_TO_BFS_INT32(levels);
+	cached.Unset();
+
+	if (cached.SetToWritable(transaction, oldRoot, false) == NULL)
+		return B_IO_ERROR;
+
+	status = cached.Free(transaction, oldRoot);
+	if (status != B_OK)
+		return status;
+
+	cached.Unset();
+
+	{
+		// Iterators that were positioned in the empty tree start over
+		MutexLocker _(fIteratorLock);
+
+		SinglyLinkedList<TreeIterator>::Iterator iterator
+			= fIterators.GetIterator();
+		while (iterator.HasNext()) {
+			TreeIterator* treeIterator = iterator.Next();
+			if (treeIterator->fCurrentNodeOffset == oldRoot)
+				treeIterator->fCurrentNodeOffset = BPLUSTREE_NULL;
+		}
+	}
+
+	return transaction.Done();
+}
+
+
+/*!	Creates the leaf level of the tree from the keys of \a source, and
+	returns the offset of its first node in \a _firstOffset, and the number
+	of its nodes in \a _count.
+*/
+status_t
+BPlusTree::_BulkLoadLeaves(Transaction& transaction, BulkLoadSource& source,
+	off_t& _firstOffset, uint32& _count)
+{
+	uint8 lastKey[BPLUSTREE_MAX_KEY_LENGTH];
+	uint16 lastKeyLength = 0;
+	uint32 changes = 0;
+
+	CachedNode cached(this);
+	bplustree_node* leaf = NULL;
+	off_t leafOffset = BPLUSTREE_NULL;
+
+	_firstOffset = BPLUSTREE_NULL;
+	_count = 0;
+
+	while (true) {
+		const uint8* key;
+		uint16 keyLength;
+		off_t value;
+		status_t status = source.GetNext(&key, &keyLength, &value);
+		if (status == B_ENTRY_NOT_FOUND)
+			return B_OK;
+		if (status != B_OK)
+			return status;
+
+		if (keyLength < BPLUSTREE_MIN_KEY_LENGTH
+			|| keyLength > BPLUSTREE_MAX_KEY_LENGTH)
+			RETURN_ERROR(B_BAD_VALUE);
+
+		if (leaf != NULL && ++changes % kMaxBulkLoadChanges == 0) {
+			// Keep the transaction small enough for the log
+			cached.Unset();
+
+			status = _RestartTransaction(transaction);
+			if (status != B_OK)
+				return status;
+
+			leaf = cached.SetToWritable(transaction, leafOffset, false);
+			if (leaf == NULL)
+				return B_IO_ERROR;
+		}
+
+		if (leaf != NULL) {
+			int32 compare = _CompareKeys(key, keyLength, lastKey,
+				lastKeyLength);
+			if (compare < 0)
+				RETURN_ERROR(B_BAD_VALUE);
+
+			if (compare == 0) {
+				if (!fAllowDuplicates)
+					return B_NAME_IN_USE;
+
+				status = _InsertDuplicate(transaction, cached, leaf,
+					leaf->NumKeys() - 1, value);
+				if (status != B_OK)
+					RETURN_ERROR(status);
+				continue;
+			}
+		}
+
+		if (leaf == NULL || !_HasRoomFor(leaf, keyLength)) {
+			status = _AppendNode(transaction, cached, &leaf, leafOffset);
+			if (status != B_OK)
+				return status;
+
+			if (_count++ == 0)
+				_firstOffset = leafOffset;
+		}
+
+		_InsertKey(leaf, leaf->NumKeys(), (uint8*)key, keyLength, value);
+
+		memcpy(lastKey, key, keyLength);
+		lastKeyLength = keyLength;
+	}
+}
+
+
+/*!	Creates the parent level for the level that starts with the node at
+	\a firstChild. Like the leaves, the nodes are packed from left to right;
+	the last child of every node goes into its overflow link.
+*/
+status_t
+BPlusTree::_BulkLoadLevel(Transaction& transaction, off_t firstChild,
+	off_t& _firstOffset, uint32& _count)
+{
+	uint8 pendingKey[BPLUSTREE_MAX_KEY_LENGTH];
+	uint16 pendingKeyLength = 0;
+	off_t pendingOffset = BPLUSTREE_NULL;
+		// the previous child, which is not yet part of a node
+	uint32 changes = 0;
+
+	CachedNode cached(this);
+	bplustree_node* node = NULL;
+	off_t nodeOffset = BPLUSTREE_NULL;
+
+	_firstOffset = BPLUSTREE_NULL;
+	_count = 0;
+
+	off_t childOffset = firstChild;
+	while (childOffset != BPLUSTREE_NULL) {
+		off_t nextChild;
+		{
+			CachedNode cachedChild(this);
+			const bplustree_node* child = cachedChild.SetTo(childOffset);
+			if (child == NULL)
+				RETURN_ERROR(B_IO_ERROR);
+
+			nextChild = child->RightLink();
+		}
+
+		if (node != NULL && ++changes % kMaxBulkLoadChanges == 0) {
+			cached.Unset();
+
+			status_t status = _RestartTransaction(transaction);
+			if (status != B_OK)
+				return status;
+
+			node = cached.SetToWritable(transaction, nodeOffset, false);
+			if (node == NULL)
+				return B_IO_ERROR;
+		}
+
+		if (node == NULL || (pendingOffset != BPLUSTREE_NULL
+				&& !_HasRoomFor(node, pendingKeyLength))) {
+			// The pending child closes the current node, if there is one
+			if (node != NULL) {
+				node->overflow_link = HOST_ENDIAN_TO_BFS_INT64(pendingOffset);
+				pendingOffset = BPLUSTREE_NULL;
+			}
+
+			status_t status = _AppendNode(transaction, cached, &node,
+				nodeOffset);
+			if (status != B_OK)
+				return status;
+
+			if (_count++ == 0)
+				_firstOffset = nodeOffset;
+		}
+
+		if (pendingOffset != BPLUSTREE_NULL) {
+			_InsertKey(node, node->NumKeys(), pendingKey, pendingKeyLength,
+				pendingOffset);
+		}
+
+		status_t status = _LargestKey(childOffset, pendingKey,
+			pendingKeyLength);
+		if (status != B_OK)
+			return status;
+
+		pendingOffset = childOffset;
+		childOffset = nextChild;
+	}
+
+	if (node == NULL)
+		RETURN_ERROR(B_BAD_VALUE);
+
+	node->overflow_link = HOST_ENDIAN_TO_BFS_INT64(pendingOffset);
+
+	if (node->NumKeys() == 0 && node->LeftLink() != BPLUSTREE_NULL) {
+		// The last node only got a single child; move over the last child of
+		// its left sibling, so that it has at least one key.
+		CachedNode cachedPrevious(this);
+		bplustree_node* previous = cachedPrevious.SetToWritable(transaction,
+			node->LeftLink(), false);
+		if (previous == NULL)
+			return B_IO_ERROR;
+
+		off_t movedOffset = previous->OverflowLink();
+		_RemoveKey(previous, previous->NumKeys());
+			// this turns the last key's child into the overflow link
+
+		status_t status = _LargestKey(movedOffset, pendingKey,
+			pendingKeyLength);
+		if (status != B_OK)
+			return status;
+
+		_InsertKey(node, 0, pendingKey, pendingKeyLength, movedOffset);
+	}
+
+	return B_OK;
+}
+
+
+/*!	Allocates a new node, and appends it to the level that currently ends
+	with the node at \a _offset, or starts a new level, if that is
+	BPLUSTREE_NULL. On return, \a cached holds the new node.
+*/
+status_t
+BPlusTree::_AppendNode(Transaction& transaction, CachedNode& cached,
+	bplustree_node** _node, off_t& _offset)
+{
+	off_t previousOffset = _offset;
+	status_t status = cached.Allocate(transaction, _node, &_offset);
+	if (status != B_OK)
+		RETURN_ERROR(status);
+
+	if (previousOffset == BPLUSTREE_NULL)
+		return B_OK;
+
+	(*_node)->left_link = HOST_ENDIAN_TO_BFS_INT64(previousOffset);
+
+	CachedNode cachedPrevious(this);
+	bplustree_node* previous = cachedPrevious.SetToWritable(transaction,
+		previousOffset, false);
+	if (previous == NULL)
+		return B_IO_ERROR;
+
+	previous->right_link = HOST_ENDIAN_TO_BFS_INT64(_offset);
+	return B_OK;
+}
+
+
+/*!	Copies the largest key of the subtree at \a offset into \a key. */
+status_t
+BPlusTree::_LargestKey(off_t offset, uint8* key, uint16& _keyLength)
+{
+	CachedNode cached(this);
+
+	while (true) {
+		const bplustree_node* node = cached.SetTo(offset);
+		if (node == NULL)
+			RETURN_ERROR(B_IO_ERROR);
+
+		if (!node->IsLeaf()) {
+			offset = node->OverflowLink();
+			continue;
+		}
+
+		if (node->NumKeys() == 0)
+			RETURN_ERROR(B_BAD_DATA);
+
+		uint16 length;
+		const uint8* lastKey = node->KeyAt(node->NumKeys() - 1, &length);
+		if (length > BPLUSTREE_MAX_KEY_LENGTH)
+			RETURN_ERROR(B_BAD_DATA);
+
+		memcpy(key, lastKey, length);
+		_keyLength = length;
+		return B_OK;
+	}
+}
+
+
+/*!	Commits the current transaction, if any, and starts a new one that has
+	the tree's stream locked.
+*/
+status_t
+BPlusTree::_RestartTransaction(Transaction& transaction)
+{
+	status_t status;
+	if (transaction.IsStarted()) {
+		status = transaction.Done();
+		if (status != B_OK)
+			return status;
+	}
+
+	status = transaction.Start(fStream->GetVolume(), fStream->BlockNumber());
+	if (status != B_OK)
+		return status;
+
+	fStream->WriteLockInTransaction(transaction);
+	return B_OK;
+}
 #endif // !_BOOT_MODE
 
 
@@ -2327,6 +2761,209 @@ BPlusTree::Find(const uint8* key, uint16 keyLength, off_t* _value)
 
 
 #if !_BOOT_MODE
+//	#pragma mark - statistics
+
+
+/*!	Estimates the number of keys, and the number of values (that is, including
+	all duplicates) in the tree.
+	This follows the path from the root to a leaf in the middle of the tree,
+	and assumes that the nodes on it have a fan-out that is representative for
+	their level. Only a few nodes have to be read for this, but the result
+	can be quite a bit off for trees with a very uneven fill level.
+*/
+status_t
+BPlusTree::EstimateEntries(off_t& _keys, off_t& _values)
+{
+	InodeReadLocker locker(fStream);
+
+	off_t nodeOffset = fHeader.RootNode();
+	off_t nodes = 1;
+	uint32 levels = 0;
+
+	CachedNode cached(this);
+	const bplustree_node* node;
+	while ((node = cached.SetTo(nodeOffset)) != NULL) {
+		if (++levels > fHeader.MaxNumberOfLevels())
+			RETURN_ERROR(B_BAD_DATA);
+
+		Unaligned<off_t>* values = node->Values();
+		uint16 keyCount = node->NumKeys();
+
+		if (node->OverflowLink() == BPLUSTREE_NULL) {
+			off_t valueCount = 0;
+			for (int32 i = 0; i < keyCount; i++) {
+				off_t value = BFS_ENDIAN_TO_HOST_INT64(values[i]);
+				if (fAllowDuplicates && bplustree_node::IsDuplicate(value))
+					valueCount += _EstimateDuplicates(value);
+				else
+					valueCount++;
+			}
+
+			_keys = nodes * keyCount;
+			_values = nodes * valueCount;
+			return B_OK;
+		}
+
+		// inner nodes have one more child than they have keys
+		nodes *= keyCount + 1;
+
+		off_t nextOffset = keyCount > 0
+			? BFS_ENDIAN_TO_HOST_INT64(values[keyCount / 2])
+			: node->OverflowLink();
+		if (nextOffset == nodeOffset)
+			RETURN_ERROR(B_BAD_DATA);
+
+		nodeOffset = nextOffset;
+	}
+
+	RETURN_ERROR(B_IO_ERROR);
+}
+
+
+/*!	Estimates the position of the key in the tree, scaled to a value between
+	0 (before the first key) and kPositionScale (after the last key).
+	The inner nodes are used as an equi-depth histogram of the key space, that
+	is, every child of a node is assumed to contain the same number of keys.
+	The key does not need to exist in the tree.
+*/
+status_t
+BPlusTree::EstimatePosition(const uint8* key, uint16 keyLength,
+	uint32& _position)
+{
+	if (key == NULL || keyLength < BPLUSTREE_MIN_KEY_LENGTH
+		|| keyLength > BPLUSTREE_MAX_KEY_LENGTH)
+		RETURN_ERROR(B_BAD_VALUE);
+
+	InodeReadLocker locker(fStream);
+
+	// the fraction is computed with 32 additional bits of precision, so that
+	// deep trees don't lose it all on the way down
+	uint64 position = 0;
+	uint64 range = (uint64)kPositionScale << 32;
+	off_t nodeOffset = fHeader.RootNode();
+	uint32 levels = 0;
+
+	CachedNode cached(this);
+	const bplustree_node* node;
+	while ((node = cached.SetTo(nodeOffset)) != NULL) {
+		if (++levels > fHeader.MaxNumberOfLevels())
+			RETURN_ERROR(B_BAD_DATA);
+
+		uint16 index = 0;
+		off_t nextOffset;
+		status_t status = _FindKey(node, key, keyLength, &index, &nextOffset);
+		if (status != B_OK && status != B_ENTRY_NOT_FOUND)
+			return status;
+
+		if (node->OverflowLink() == BPLUSTREE_NULL) {
+			if (node->NumKeys() > 0)
+				position += range / node->NumKeys() * index;
+
+			_position = position >> 32;
+			return B_OK;
+		}
+
+		uint32 children = node->NumKeys() + 1;
+		position += range / children * index;
+		range /= children;
+
+		if (nextOffset == nodeOffset)
+			RETURN_ERROR(B_BAD_DATA);
+
+		nodeOffset = nextOffset;
+	}
+
+	RETURN_ERROR(B_IO_ERROR);
+}
+
+
+/*!	Returns the number of values stored under the given key, that is, 0 if
+	the key does not exist, and the number of its duplicates otherwise.
+	For very long duplicate chains, only a lower bound is returned.
+*/
+status_t
+BPlusTree::EstimateValues(const uint8* key, uint16 keyLength, off_t& _values)
+{
+	if (key == NULL || keyLength < BPLUSTREE_MIN_KEY_LENGTH
+		|| keyLength > BPLUSTREE_MAX_KEY_LENGTH)
+		RETURN_ERROR(B_BAD_VALUE);
+
+	InodeReadLocker locker(fStream);
+
+	off_t nodeOffset = fHeader.RootNode();
+	uint32 levels = 0;
+
+	CachedNode cached(this);
+	const bplustree_node* node;
+	while ((node = cached.SetTo(nodeOffset)) != NULL) {
+		if (++levels > fHeader.MaxNumberOfLevels())
+			RETURN_ERROR(B_BAD_DATA);
+
+		uint16 index = 0;
+		off_t nextOffset;
+		status_t status = _FindKey(node, key, keyLength, &index, &nextOffset);
+
+		if (node->OverflowLink() == BPLUSTREE_NULL) {
+			if (status == B_ENTRY_NOT_FOUND) {
+				_values = 0;
+				return B_OK;
+			}
+			if (status != B_OK)
+				return status;
+
+			if (fAllowDuplicates && bplustree_node::IsDuplicate(nextOffset))
+				_values = _EstimateDuplicates(nextOffset);
+			else
+				_values = 1;
+			return B_OK;
+		}
+		if (status != B_OK && status != B_ENTRY_NOT_FOUND)
+			return status;
+		if (nextOffset == nodeOffset)
+			RETURN_ERROR(B_BAD_DATA);
+
+		nodeOffset = nextOffset;
+	}
+
+	RETURN_ERROR(B_IO_ERROR);
+}
+
+
+/*!	Counts the duplicates behind the given duplicate link. Only the first few
+	nodes of a duplicate node chain are looked at, so the result is a lower
+	bound for very common keys - but that's enough to know that they are.
+*/
+off_t
+BPlusTree::_EstimateDuplicates(off_t link)
+{
+	const int32 kMaxDuplicateNodes = 16;
+
+	bool isFragment = bplustree_node::LinkType(link)
+		== BPLUSTREE_DUPLICATE_FRAGMENT;
+	off_t offset = bplustree_node::FragmentOffset(link);
+
+	CachedNode cached(this);
+	const bplustree_node* node = cached.SetTo(offset, false);
+	if (node == NULL)
+		return 1;
+
+	if (isFragment)
+		return node->CountDuplicates(link, true);
+
+	off_t count = 0;
+	for (int32 i = 0; i < kMaxDuplicateNodes; i++) {
+		count += node->CountDuplicates(offset, false);
+
+		offset = node->RightLink();
+		if (offset == BPLUSTREE_NULL
+			|| (node = cached.SetTo(offset, false)) == NULL)
+			break;
+	}
+
+	return count;
+}
+
+
 status_t
 BPlusTree::_ValidateChildren(TreeCheck& check, uint32 level, off_t offset,
 	const uint8* largestKey, uint16 largestKeyLength,
@@ -2562,6 +3199,9 @@ TreeIterator::TreeIterator(BPlusTree* tree)
 	fCurrentNodeOffset(BPLUSTREE_NULL)
 {
 #if !_BOOT_MODE
+	fReadAheadStart = fReadAheadEnd = 0;
+	fSequentialNodes = 0;
+
 	tree->_AddIterator(this);
 #endif
 }
@@ -2709,10 +3349,16 @@ TreeIterator::Traverse(int8 direction, void* key, uint16* keyLength,
 	// is the current key in the current node?
 	while ((forward && fCurrentKey >= node->NumKeys())
 			|| (!forward && fCurrentKey < 0)) {
+#if !_BOOT_MODE
+		off_t previousOffset = fCurrentNodeOffset;
+#endif
 		fCurrentNodeOffset = forward ? node->RightLink() : node->LeftLink();
 
 		// are there any more nodes?
 		if (fCurrentNodeOffset != BPLUSTREE_NULL) {
+#if !_BOOT_MODE
+			_ReadAhead(previousOffset, forward);
+#endif
 			node = cached.SetTo(fCurrentNodeOffset);
 			if (!node)
 				RETURN_ERROR(B_ERROR);
@@ -2883,6 +3529,60 @@ TreeIterator::Stop()
 }
 
 
+#if !_BOOT_MODE
+/*!	Is called when the iterator moves on from the node at \a previousOffset
+	to its sibling. As long as the siblings are close to each other in the
+	stream, as in a bulk loaded tree, the nodes following in the scan
+	direction are read ahead asynchronously, so that long scans like
+	directory listings or queries do not have to wait for every single node.
+*/
+void
+TreeIterator::_ReadAhead(off_t previousOffset, bool forward)
+{
+	off_t nodeSize = fTree->fNodeSize;
+	off_t window = kReadAheadNodes * nodeSize;
+	off_t offset = fCurrentNodeOffset;
+
+	off_t distance = offset - previousOffset;
+	if (distance < -window || distance > window) {
+		fSequentialNodes = 0;
+		return;
+	}
+	if (++fSequentialNodes < kMinSequentialNodes)
+		return;
+
+	bool inWindow = offset >= fReadAheadStart && offset < fReadAheadEnd;
+	off_t start;
+	off_t end;
+	if (forward) {
+		start = offset;
+		if (inWindow) {
+			// only read on once half of the window has been used up
+			if (fReadAheadEnd - offset > window / 2)
+				return;
+			start = fReadAheadEnd;
+		}
+		end = start + window;
+	} else {
+		end = offset + nodeSize;
+		if (inWindow) {
+			if (end - fReadAheadStart > window / 2)
+				return;
+			end = fReadAheadStart;
+		}
+		start = max_c(end - window, nodeSize);
+		if (start >= end)
+			return;
+	}
+
+	fTree->_ReadAhead(start, end - start);
+
+	fReadAheadStart = forward ? offset : start;
+	fReadAheadEnd = forward ? end : offset + nodeSize;
+}
+#endif // !_BOOT_MODE
+
+
 #ifdef DEBUG
 void
 TreeIterator::Dump()
@@ -248,6 +248,20 @@ protected:
 };
 
 
+#if !_BOOT_MODE
+/*!	Delivers the keys for BPlusTree::BulkLoad() in ascending order.
+	GetNext() returns B_ENTRY_NOT_FOUND when there are no keys left.
+*/
+class BulkLoadSource {
+public:
+	virtual						~BulkLoadSource() {}
+
+	virtual	status_t			GetNext(const uint8** _key,
+									uint16* _keyLength, off_t* _value) = 0;
+};
+#endif // !_BOOT_MODE
+
+
 class BPlusTree : public TransactionListener {
 public:
 #if !_BOOT_MODE
@@ -302,12 +316,29 @@ public:
 			status_t			Replace(Transaction& transaction,
 									const uint8* key, uint16 keyLength,
 									off_t value);
+
+			status_t			BulkLoad(BulkLoadSource& source);
+
+			int32				CompareKeys(const void* key1, int keyLength1,
+									const void* key2, int keyLength2)
+									{ return _CompareKeys(key1, keyLength1,
+										key2, keyLength2); }
 #endif // !_BOOT_MODE
 
 			status_t			Find(const uint8* key, uint16 keyLength,
 									off_t* value);
 
 #if !_BOOT_MODE
+			// statistics for the query planner
+			status_t			EstimateEntries(off_t& _keys,
+									off_t& _values);
+			status_t			EstimatePosition(const uint8* key,
+									uint16 keyLength, uint32& _position);
+			status_t			EstimateValues(const uint8* key,
+									uint16 keyLength, off_t& _values);
+
+	static	const uint32		kPositionScale = 1 << 20;
+
 	static	int32				TypeCodeToKeyType(type_code code);
 	static	int32				ModeToKeyType(mode_t mode);
 
@@ -352,6 +383,25 @@ private:
 									CachedNode& cached, uint16 keyIndex,
 									off_t value);
 			void				_RemoveKey(bplustree_node* node, uint16 index);
+			bool				_HasRoomFor(const bplustree_node* node,
+									uint16 keyLength) const;
+
+			status_t			_BulkLoad(BulkLoadSource& source);
+			status_t			_BulkLoadLeaves(Transaction& transaction,
+									BulkLoadSource& source,
+									off_t& _firstOffset, uint32& _count);
+			status_t			_BulkLoadLevel(Transaction& transaction,
+									off_t firstChild, off_t& _firstOffset,
+									uint32& _count);
+			status_t			_AppendNode(Transaction& transaction,
+									CachedNode& cached, bplustree_node** _node,
+									off_t& _offset);
+			status_t			_LargestKey(off_t offset, uint8* key,
+									uint16& _keyLength);
+			status_t			_RestartTransaction(
+									Transaction& transaction);
+
+			void				_ReadAhead(off_t offset, off_t size);
 
 			void				_UpdateIterators(off_t offset, off_t nextOffset,
 									uint16 keyIndex, uint16 splitAt,
@@ -359,6 +409,8 @@ private:
 			void				_AddIterator(TreeIterator* iterator);
 			void				_RemoveIterator(TreeIterator* iterator);
 
+			off_t				_EstimateDuplicates(off_t link);
+
 			status_t			_ValidateChildren(TreeCheck& check,
 									uint32 level, off_t offset,
 									const uint8* largestKey, uint16 keyLength,
@@ -427,6 +479,11 @@ private:
 									int8 change);
 			void				Stop();
 
+#if !_BOOT_MODE
+			void				_ReadAhead(off_t previousOffset,
+									bool forward);
+#endif
+
 private:
 			BPlusTree*			fTree;
 			off_t				fCurrentNodeOffset;
@@ -436,6 +493,12 @@ private:
 			uint16				fDuplicate;
 			uint16				fNumDuplicates;
 			bool				fIsFragment;
+#if !_BOOT_MODE
+			off_t				fReadAheadStart;
+			off_t				fReadAheadEnd;
+									// stream range that has been read ahead
+			uint32				fSequentialNodes;
+#endif
 };
 
 
@@ -970,9 +970,13 @@ BlockAllocator::Allocate(Transaction& transaction, Inode* inode,
 	// last one)
 	if (inode->Size() > 0) {
 		const data_stream& data = inode->Node().data;
-		// TODO: we currently don't care for when the data stream
-		// is already grown into the indirect ranges
-		if (data.max_double_indirect_range == 0
+		if (!inode->AllocationHint().IsZero()) {
+			// continue directly after the run we allocated last for this
+			// inode, also when the stream has grown into the indirect ranges
+			const block_run& hint = inode->AllocationHint();
+			group = hint.AllocationGroup();
+			start = hint.Start() + hint.Length();
+		} else if (data.max_double_indirect_range == 0
 			&& data.max_indirect_range == 0) {
 			// Since size > 0, there must be a valid block run in this stream
 			int32 last = 0;
@@ -992,7 +996,12 @@ BlockAllocator::Allocate(Transaction& transaction, Inode* inode,
 		group = inode->BlockRun().AllocationGroup() + 1;
 	}
 
-	return AllocateBlocks(transaction, group, start, numBlocks, minimum, run);
+	status_t status = AllocateBlocks(transaction, group, start, numBlocks,
+		minimum, run);
+	if (status == B_OK)
+		inode->SetAllocationHint(run);
+
+	return status;
 }
 
 
@@ -16,23 +16,192 @@
 #include "Volume.h"
 
 
+static const size_t kKeyChunkSize = 256 * 1024;
+static const size_t kMaxCollectedKeysSize = 32 * 1024 * 1024;
+static const int32 kMaxInsertsPerTransaction = 1024;
+	// if an index has more keys than that, the rest is inserted one by one
+
+
+/*!	Collects the keys of an index during the index pass, so that its tree can
+	be bulk loaded with all of them at the end of the pass, instead of
+	inserting them one by one.
+*/
+class IndexKeyCollector : public BulkLoadSource {
+public:
+	IndexKeyCollector(BPlusTree* tree)
+		:
+		fTree(tree),
+		fChunks(NULL),
+		fEntries(NULL),
+		fCount(0),
+		fCapacity(0),
+		fNext(0),
+		fSize(0)
+	{
+	}
+
+	virtual ~IndexKeyCollector()
+	{
+		while (fChunks != NULL) {
+			key_chunk* next = fChunks->next;
+			free(fChunks);
+			fChunks = next;
+		}
+		free(fEntries);
+	}
+
+	status_t Add(const uint8* key, uint16 keyLength, off_t value)
+	{
+		size_t entrySize = (sizeof(key_entry) + keyLength + 7) & ~7;
+
+		if (fChunks == NULL || fChunks->used + entrySize > kKeyChunkSize) {
+			if (fSize + kKeyChunkSize > kMaxCollectedKeysSize)
+				return B_NO_MEMORY;
+
+			key_chunk* chunk = (key_chunk*)malloc(sizeof(key_chunk)
+				+ kKeyChunkSize);
+			if (chunk == NULL)
+				return B_NO_MEMORY;
+
+			chunk->next = fChunks;
+			chunk->used = 0;
+			fChunks = chunk;
+			fSize += kKeyChunkSize;
+		}
+
+		if (fCount == fCapacity) {
+			int32 capacity = max_c(2 * fCapacity, 1024);
+			key_entry** entries = (key_entry**)realloc(fEntries,
+				capacity * sizeof(key_entry*));
+			if (entries == NULL)
+				return B_NO_MEMORY;
+
+			fEntries = entries;
+			fCapacity = capacity;
+		}
+
+		key_entry* entry = (key_entry*)(fChunks->data + fChunks->used);
+		fChunks->used += entrySize;
+
+		entry->value = value;
+		entry->length = keyLength;
+		memcpy(entry->key, key, keyLength);
+
+		fEntries[fCount++] = entry;
+		return B_OK;
+	}
+
+	void Sort()
+	{
+		// Heap sort, since it doesn't need any extra memory
+		for (int32 i = fCount / 2; i-- > 0;)
+			_SiftDown(i, fCount);
+
+		for (int32 end = fCount; end-- > 1;) {
+			key_entry* entry = fEntries[0];
+			fEntries[0] = fEntries[end];
+			fEntries[end] = entry;
+
+			_SiftDown(0, end);
+		}
+
+		fNext = 0;
+	}
+
+	void Rewind()
+	{
+		fNext = 0;
+	}
+
+	virtual status_t GetNext(const uint8** _key, uint16* _keyLength,
+		off_t* _value)
+	{
+		if (fNext >= fCount)
+			return B_ENTRY_NOT_FOUND;
+
+		const key_entry* entry = fEntries[fNext++];
+		*_key = entry->key;
+		*_keyLength = entry->length;
+		*_value = entry->value;
+		return B_OK;
+	}
+
+private:
+	struct key_entry {
+		off_t		value;
+		uint16		length;
+		uint8		key[0];
+	};
+
+	struct key_chunk {
+		key_chunk*	next;
+		size_t		used;
+		uint8		data[0];
+	};
+
+	int32 _Compare(const key_entry* a, const key_entry* b)
+	{
+		return fTree->CompareKeys(a->key, a->length, b->key, b->length);
+	}
+
+	void _SiftDown(int32 root, int32 count)
+	{
+		while (true) {
+			int32 child = 2 * root + 1;
+			if (child >= count)
+				return;
+
+			if (child + 1 < count
+				&& _Compare(fEntries[child], fEntries[child + 1]) < 0)
+				child++;
+			if (_Compare(fEntries[root], fEntries[child]) >= 0)
+				return;
+
+			key_entry* entry = fEntries[root];
+			fEntries[root] = fEntries[child];
+			fEntries[child] = entry;
+			root = child;
+		}
+	}
+
+private:
+	BPlusTree*		fTree;
+	key_chunk*		fChunks;
+	key_entry**		fEntries;
+	int32			fCount;
+	int32			fCapacity;
+	int32			fNext;
+	size_t			fSize;
+};
+
+
 struct check_index {
 	check_index()
 		:
-		inode(NULL)
+		inode(NULL),
+		keys(NULL)
 	{
 	}
 
+	~check_index()
+	{
+		delete keys;
+	}
+
 	char				name[B_FILE_NAME_LENGTH];
 	block_run			run;
 	Inode*				inode;
+	IndexKeyCollector*	keys;
+		// NULL if the keys are inserted one by one
 };
 
 
 CheckVisitor::CheckVisitor(Volume* volume)
 	:
 	FileSystemVisitor(volume),
-	fCheckBitmap(NULL)
+	fCheckBitmap(NULL),
+	fStreamExtents(0),
+	fStreamNextBlock(0)
 {
 }
 
@@ -85,6 +254,8 @@ CheckVisitor::StartBitmapPass()
 status_t
 CheckVisitor::WriteBackCheckBitmap()
 {
+	_CountFreeExtents();
+
 	if (GetVolume()->IsReadOnly())
 		return B_OK;
 
@@ -179,6 +350,31 @@ CheckVisitor::StartIndexPass()
 }
 
 
+/*!	Bulk loads the indices whose keys have been collected during the index
+	pass. Is called once the pass has visited all inodes.
+*/
+status_t
+CheckVisitor::FinishIndexPass()
+{
+	status_t result = B_OK;
+
+	for (int32 i = 0; i < Indices().CountItems(); i++) {
+		check_index* index = Indices().Array()[i];
+		if (index->inode == NULL || index->keys == NULL)
+			continue;
+
+		status_t status = _BulkLoadIndex(index);
+		if (status != B_OK) {
+			FATAL(("check: Could not rebuild index \"%s\": %s\n", index->name,
+				strerror(status)));
+			result = status;
+		}
+	}
+
+	return result;
+}
+
+
 status_t
 CheckVisitor::StopChecking()
 {
@@ -297,6 +493,8 @@ CheckVisitor::VisitInode(Inode* inode, const char* treeName)
 			if (status != B_OK)
 				return status;
 
+			_AddStreamFragmentation(inode);
+
 			// Check the B+tree as well
 			if (inode->IsContainer()) {
 				bool repairErrors = (Control().flags & BFS_FIX_BPLUSTREES) != 0;
@@ -304,18 +502,20 @@ CheckVisitor::VisitInode(Inode* inode, const char* treeName)
 
 				status = inode->Tree()->Validate(repairErrors, errorsFound);
 
-				if (errorsFound) {
+				if (errorsFound)
 					Control().errors |= BFS_INVALID_BPLUSTREE;
-					if (inode->IsIndex() && treeName != NULL && repairErrors) {
-						// We completely rebuild corrupt indices
-						check_index* index = new(std::nothrow) check_index;
-						if (index == NULL)
-							return B_NO_MEMORY;
-
-						strlcpy(index->name, treeName, sizeof(index->name));
-						index->run = inode->BlockRun();
-						Indices().Push(index);
-					}
+
+				if (inode->IsIndex() && treeName != NULL
+					&& ((errorsFound && repairErrors)
+						|| (Control().flags & BFS_REBUILD_INDICES) != 0)) {
+					// We completely rebuild corrupt indices
+					check_index* index = new(std::nothrow) check_index;
+					if (index == NULL)
+						return B_NO_MEMORY;
+
+					strlcpy(index->name, treeName, sizeof(index->name));
+					index->run = inode->BlockRun();
+					Indices().Push(index);
 				}
 			}
 
@@ -467,6 +667,8 @@ CheckVisitor::_BitmapSize() const
 status_t
 CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 {
+	fStreamExtents = 0;
+
 	status_t status = _CheckAllocated(inode->BlockRun(), "inode");
 	if (status != B_OK)
 		return status;
@@ -492,6 +694,7 @@ CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 			if (status < B_OK)
 				return status;
 
+			_AddExtent(data->direct[i]);
 			Control().stats.direct_block_runs++;
 			Control().stats.blocks_in_direct
 				+= data->direct[i].Length();
@@ -525,6 +728,7 @@ CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 				if (status < B_OK)
 					return status;
 
+				_AddExtent(runs[index]);
 				Control().stats.indirect_block_runs++;
 				Control().stats.blocks_in_indirect
 					+= runs[index].Length();
@@ -588,6 +792,7 @@ CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 					if (status != B_OK)
 						return status;
 
+					_AddExtent(runs[index % runsPerBlock]);
 					Control().stats.double_indirect_block_runs++;
 					Control().stats.blocks_in_double_indirect
 						+= runs[index % runsPerBlock].Length();
@@ -602,6 +807,74 @@ CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 }
 
 
+/*!	Adds a data run of the stream currently checked by _CheckInodeBlocks()
+	to the fragmentation statistics. Runs that directly follow the previous
+	one on disk extend the current extent.
+*/
+void
+CheckVisitor::_AddExtent(block_run run)
+{
+	off_t start = GetVolume()->ToBlock(run);
+	if (fStreamExtents == 0 || start != fStreamNextBlock)
+		fStreamExtents++;
+
+	fStreamNextBlock = start + run.Length();
+}
+
+
+void
+CheckVisitor::_AddStreamFragmentation(Inode* inode)
+{
+	if (fStreamExtents == 0)
+		return;
+
+	Control().stats.data_streams++;
+	Control().stats.data_extents += fStreamExtents;
+	if (fStreamExtents > 1)
+		Control().stats.fragmented_streams++;
+	if (fStreamExtents > Control().stats.max_stream_extents) {
+		Control().stats.max_stream_extents = fStreamExtents;
+		Control().stats.most_fragmented_inode = inode->ID();
+	}
+}
+
+
+/*!	Computes the free space fragmentation from the check bitmap, ie. how
+	the disk would look like after the bitmap has been written back.
+*/
+void
+CheckVisitor::_CountFreeExtents()
+{
+	Volume* volume = GetVolume();
+	off_t numBlocks = volume->NumBlocks();
+	off_t blocksPerGroup
+		= (off_t)volume->SuperBlock().BlocksPerAllocationGroup()
+			<< (volume->BlockShift() + 3);
+
+	uint64 freeExtents = 0;
+	uint64 largestFreeExtent = 0;
+	uint64 currentLength = 0;
+
+	for (off_t block = 0; block < numBlocks; block++) {
+		bool used = _CheckBitmapIsUsedAt(block);
+
+		// free extents end at allocation group boundaries, as no block_run
+		// can span them
+		if (used || block % blocksPerGroup == 0) {
+			largestFreeExtent = max_c(largestFreeExtent, currentLength);
+			currentLength = 0;
+		}
+
+		if (!used && currentLength++ == 0)
+			freeExtents++;
+	}
+	largestFreeExtent = max_c(largestFreeExtent, currentLength);
+
+	Control().stats.free_extents = freeExtents;
+	Control().stats.largest_free_extent = largestFreeExtent;
+}
+
+
 status_t
 CheckVisitor::_CheckAllocated(block_run run, const char* type)
 {
@@ -695,9 +968,18 @@ CheckVisitor::_PrepareIndices()
 			continue;
 		}
 
-		status = tree->MakeEmpty();
-		if (status != B_OK)
-			return status;
+		if ((Control().flags & BFS_INSERT_INDEX_KEYS) == 0) {
+			index->keys = new(std::nothrow) IndexKeyCollector(tree);
+				// without it, the keys are just inserted one by one
+		}
+
+		if (index->keys == NULL) {
+			// The keys are inserted while the pass goes on; bulk loaded
+			// indices keep their old tree until their keys are complete
+			status = tree->MakeEmpty();
+			if (status != B_OK)
+				return status;
+		}
 
 		index->inode = inode;
 		vnode.Keep();
@@ -726,12 +1008,48 @@ CheckVisitor::_FreeIndices()
 status_t
 CheckVisitor::_AddInodeToIndex(Inode* inode)
 {
-	Transaction transaction(GetVolume(), inode->BlockNumber());
+	uint8 key[BPLUSTREE_MAX_KEY_LENGTH];
+	uint16 keyLength;
 
+	// Collect the keys of the indices that are bulk loaded later
 	for (int32 i = 0; i < Indices().CountItems(); i++) {
 		check_index* index = Indices().Array()[i];
-		if (index->inode == NULL)
+		if (index->inode == NULL || index->keys == NULL)
+			continue;
+
+		status_t status = _GetIndexKey(inode, index, key, keyLength);
+		if (status == B_ENTRY_NOT_FOUND)
 			continue;
+		if (status != B_OK)
+			return status;
+
+		if (index->keys->Add(key, keyLength, inode->ID()) != B_OK) {
+			// We can't keep all keys in memory; load the ones we have, and
+			// insert the remaining ones one by one
+			status = _BulkLoadIndex(index);
+			if (status != B_OK)
+				return status;
+		}
+	}
+
+	Transaction transaction;
+
+	for (int32 i = 0; i < Indices().CountItems(); i++) {
+		check_index* index = Indices().Array()[i];
+		if (index->inode == NULL || index->keys != NULL)
+			continue;
+
+		status_t status = _GetIndexKey(inode, index, key, keyLength);
+		if (status == B_ENTRY_NOT_FOUND)
+			continue;
+		if (status != B_OK)
+			return status;
+
+		if (!transaction.IsStarted()) {
+			status = transaction.Start(GetVolume(), inode->BlockNumber());
+			if (status != B_OK)
+				return status;
+		}
 
 		index->inode->WriteLockInTransaction(transaction);
 
@@ -739,36 +1057,132 @@ CheckVisitor::_AddInodeToIndex(Inode* inode)
 		if (tree == NULL)
 			return B_ERROR;
 
-		status_t status = B_OK;
+		status = tree->Insert(transaction, key, keyLength, inode->ID());
+		if (status != B_OK)
+			return status;
+	}
 
-		if (!strcmp(index->name, "name")) {
-			if (inode->InNameIndex()) {
-				char name[B_FILE_NAME_LENGTH];
-				if (inode->GetName(name, B_FILE_NAME_LENGTH) != B_OK)
-					return B_ERROR;
+	if (!transaction.IsStarted())
+		return B_OK;
 
-				status = tree->Insert(transaction, name, inode->ID());
-			}
-		} else if (!strcmp(index->name, "last_modified")) {
-			if (inode->InLastModifiedIndex()) {
-				status = tree->Insert(transaction, inode->OldLastModified(),
-					inode->ID());
-			}
-		} else if (!strcmp(index->name, "size")) {
-			if (inode->InSizeIndex())
-				status = tree->Insert(transaction, inode->Size(), inode->ID());
-		} else {
-			uint8 key[MAX_INDEX_KEY_LENGTH];
-			size_t keyLength = sizeof(key);
-			if (inode->ReadAttribute(index->name, B_ANY_TYPE, 0, key,
-					&keyLength) == B_OK) {
-				status = tree->Insert(transaction, key, keyLength, inode->ID());
-			}
+	return transaction.Done();
+}
+
+
+/*!	Retrieves the key \a inode has in the given index. Returns
+	B_ENTRY_NOT_FOUND if the inode is not part of the index.
+*/
+status_t
+CheckVisitor::_GetIndexKey(Inode* inode, check_index* index, uint8* key,
+	uint16& _keyLength)
+{
+	if (!strcmp(index->name, "name")) {
+		if (!inode->InNameIndex())
+			return B_ENTRY_NOT_FOUND;
+
+		if (inode->GetName((char*)key, B_FILE_NAME_LENGTH) != B_OK)
+			return B_ERROR;
+
+		_keyLength = strlen((char*)key);
+	} else if (!strcmp(index->name, "last_modified")) {
+		if (!inode->InLastModifiedIndex())
+			return B_ENTRY_NOT_FOUND;
+
+		int64 lastModified = inode->OldLastModified();
+		memcpy(key, &lastModified, sizeof(int64));
+		_keyLength = sizeof(int64);
+	} else if (!strcmp(index->name, "size")) {
+		if (!inode->InSizeIndex())
+			return B_ENTRY_NOT_FOUND;
+
+		int64 size = inode->Size();
+		memcpy(key, &size, sizeof(int64));
+		_keyLength = sizeof(int64);
+	} else {
+		size_t keyLength = MAX_INDEX_KEY_LENGTH;
+		if (inode->ReadAttribute(index->name, B_ANY_TYPE, 0, key,
+				&keyLength) != B_OK)
+			return B_ENTRY_NOT_FOUND;
+
+		_keyLength = keyLength;
+	}
+
+	// The tree would refuse these anyway
+	if (_keyLength < BPLUSTREE_MIN_KEY_LENGTH
+		|| _keyLength > BPLUSTREE_MAX_KEY_LENGTH)
+		return B_BAD_VALUE;
+
+	return B_OK;
+}
+
+
+/*!	Sorts the keys collected for \a index, and bulk loads its tree with
+	them. Any keys that are added to the index afterwards are inserted one
+	by one.
+	The old tree is only emptied right before, and if bulk loading fails,
+	the tree is still empty, and the keys are inserted one by one instead.
+*/
+status_t
+CheckVisitor::_BulkLoadIndex(check_index* index)
+{
+	IndexKeyCollector* keys = index->keys;
+	index->keys = NULL;
+
+	BPlusTree* tree = index->inode->Tree();
+	if (tree == NULL) {
+		delete keys;
+		return B_ERROR;
+	}
+
+	status_t status = tree->MakeEmpty();
+	if (status == B_OK) {
+		keys->Sort();
+		status = tree->BulkLoad(*keys);
+		if (status != B_OK) {
+			FATAL(("check: Bulk loading index \"%s\" failed: %s, inserting "
+				"its keys one by one\n", index->name, strerror(status)));
+
+			keys->Rewind();
+			status = _InsertIndexKeys(index, *keys);
+		}
+	}
+
+	delete keys;
+	return status;
+}
+
+
+/*!	Inserts the remaining keys of \a keys into the tree of \a index, using
+	as many transactions as needed.
+*/
+status_t
+CheckVisitor::_InsertIndexKeys(check_index* index, IndexKeyCollector& keys)
+{
+	BPlusTree* tree = index->inode->Tree();
+	if (tree == NULL)
+		return B_ERROR;
+
+	while (true) {
+		Transaction transaction(GetVolume(), index->inode->BlockNumber());
+		index->inode->WriteLockInTransaction(transaction);
+
+		for (int32 count = 0; count < kMaxInsertsPerTransaction; count++) {
+			const uint8* key;
+			uint16 keyLength;
+			off_t value;
+			status_t status = keys.GetNext(&key, &keyLength, &value);
+			if (status == B_ENTRY_NOT_FOUND)
+				return transaction.Done();
+			if (status != B_OK)
+				return status;
+
+			status = tree->Insert(transaction, key, keyLength, value);
+			if (status != B_OK)
+				return status;
 		}
 
+		status_t status = transaction.Done();
 		if (status != B_OK)
 			return status;
 	}
-
-	return transaction.Done();
 }
@@ -16,6 +16,7 @@
 
 class BlockAllocator;
 class BPlusTree;
+class IndexKeyCollector;
 struct check_index;
 
 typedef Stack<check_index*> IndexStack;
@@ -33,6 +34,7 @@ public:
 			status_t			StartBitmapPass();
 			status_t			WriteBackCheckBitmap();
 			status_t			StartIndexPass();
+			status_t			FinishIndexPass();
 			status_t			StopChecking();
 
 	virtual status_t			VisitDirectoryEntry(Inode* inode,
@@ -58,18 +60,30 @@ private:
 									const char* name);
 			status_t			_CheckAllocated(block_run run,
 									const char* type);
+			void				_AddExtent(block_run run);
+			void				_AddStreamFragmentation(Inode* inode);
+			void				_CountFreeExtents();
 
 			size_t				_BitmapSize() const;
 
 			status_t			_PrepareIndices();
 			void				_FreeIndices();
 			status_t			_AddInodeToIndex(Inode* inode);
+			status_t			_GetIndexKey(Inode* inode,
+									check_index* index, uint8* key,
+									uint16& _keyLength);
+			status_t			_BulkLoadIndex(check_index* index);
+			status_t			_InsertIndexKeys(check_index* index,
+									IndexKeyCollector& keys);
 
 private:
 			check_control		control;
 			IndexStack			indices;
 
 			uint32*				fCheckBitmap;
+
+			uint64				fStreamExtents;
+			off_t				fStreamNextBlock;
 };
 
 
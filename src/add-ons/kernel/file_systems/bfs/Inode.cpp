@@ -13,6 +13,10 @@
 #include "Index.h"
 
 
+static const off_t kMinPreallocationWindow = 64 * 1024;
+static const off_t kMaxPreallocationWindow = 16 * 1024 * 1024;
+
+
 #if BFS_TRACING && !defined(FS_SHELL) && !defined(_BOOT_MODE)
 namespace BFSInodeTracing {
 
@@ -344,13 +348,15 @@ Inode::Inode(Volume* volume, ino_t id)
 	fTree(NULL),
 	fAttributes(NULL),
 	fCache(NULL),
-	fMap(NULL)
+	fMap(NULL),
+	fPreallocationWindow(0)
 {
 	PRINT(("Inode::Inode(volume = %p, id = %" B_PRIdINO ") @ %p\n",
 		volume, id, this));
 
 	rw_lock_init(&fLock, "bfs inode");
 	recursive_lock_init(&fSmallDataLock, "bfs inode small data");
+	fAllocationHint.SetTo(0, 0, 0);
 
 	if (UpdateNodeFromDisk() != B_OK) {
 		// TODO: the error code gets eaten
@@ -378,13 +384,15 @@ Inode::Inode(Volume* volume, Transaction& transaction, ino_t id, mode_t mode,
 	fTree(NULL),
 	fAttributes(NULL),
 	fCache(NULL),
-	fMap(NULL)
+	fMap(NULL),
+	fPreallocationWindow(0)
 {
 	PRINT(("Inode::Inode(volume = %p, transaction = %p, id = %" B_PRIdINO
 		") @ %p\n", volume, &transaction, id, this));
 
 	rw_lock_init(&fLock, "bfs inode");
 	recursive_lock_init(&fSmallDataLock, "bfs inode small data");
+	fAllocationHint.SetTo(0, 0, 0);
 
 	NodeGetter node(volume);
 	status_t status = node.SetToWritable(transaction, this, true);
@@ -1715,6 +1723,26 @@ Inode::_AllocateBlockArray(Transaction& transaction, block_run& run,
 }
 
 
+/*!	Returns the number of blocks to preallocate for a file that is growing
+	again, and doubles the window for the next time, up to
+	\c kMaxPreallocationWindow, or a small part of the free space on the
+	volume. The window is reset when the stream is shrunk, and thus also when
+	its preallocation is trimmed on close.
+*/
+off_t
+Inode::_GrowPreallocationWindow()
+{
+	off_t minimum = kMinPreallocationWindow >> fVolume->BlockShift();
+	off_t maximum = min_c(kMaxPreallocationWindow >> fVolume->BlockShift(),
+		fVolume->FreeBlocks() / 64);
+
+	off_t window = max_c(fPreallocationWindow, minimum);
+	fPreallocationWindow = min_c(window * 2, maximum);
+
+	return min_c(window, maximum);
+}
+
+
 /*!	Grows the stream to \a size, and fills the direct/indirect/double indirect
 	ranges with the runs.
 	This method will also determine the size of the preallocation, if any.
@@ -1785,6 +1813,11 @@ Inode::_GrowStream(Transaction& transaction, off_t size)
 				// 64 MB for 1 GB)
 				roundTo = size >> (fVolume->BlockShift() + 4);
 			}
+
+			// A file that keeps growing gets an increasing preallocation
+			// window, so that its runs approach its final size even when
+			// other files are written to at the same time.
+			roundTo = max_c(roundTo, _GrowPreallocationWindow());
 		} else if (IsIndex()) {
 			// Always preallocate 64 KB for index directories
 			roundTo = 65536 >> fVolume->BlockShift();
@@ -2187,7 +2220,15 @@ Inode::_FreeStreamArray(Transaction& transaction, block_run* array,
 			// update maximum range
 			max = HOST_ENDIAN_TO_BFS_INT64(offset + ((off_t)array[i].Length()
 				<< fVolume->BlockShift()));
+
+			// this is the last run of the stream now
+			fAllocationHint = array[i];
 		} else {
+			if (i > 0 && offset <= size && !array[i - 1].IsZero()) {
+				// the previous run is the last one of the stream now
+				fAllocationHint = array[i - 1];
+			}
+
 			// free the whole block_run
 			array[i].SetTo(0, 0, 0);
 
@@ -2208,6 +2249,14 @@ Inode::_ShrinkStream(Transaction& transaction, off_t size)
 	data_stream* data = &Node().data;
 	status_t status;
 
+	// the stream is no longer being written sequentially
+	fPreallocationWindow = 0;
+
+	// The allocation hint may point behind blocks that are freed now; it is
+	// set again to the new last run if _FreeStreamArray() comes across it.
+	// Otherwise, the block allocator finds the end of the stream itself.
+	fAllocationHint.SetTo(0, 0, 0);
+
 	if (data->MaxDoubleIndirectRange() > size) {
 		off_t* maxDoubleIndirect = &data->max_double_indirect_range;
 			// gcc 4 work-around: "error: cannot bind packed field
@@ -156,6 +156,12 @@ public:
 			status_t			TrimPreallocation(Transaction& transaction);
 			bool				NeedsTrimming() const;
 
+			// allocation policy helpers
+			const block_run&	AllocationHint() const
+									{ return fAllocationHint; }
+			void				SetAllocationHint(const block_run& run)
+									{ fAllocationHint = run; }
+
 			status_t			Free(Transaction& transaction);
 			status_t			Sync();
 
@@ -253,6 +259,7 @@ private:
 									off_t size);
 			status_t			_ShrinkStream(Transaction& transaction,
 									off_t size);
+			off_t				_GrowPreallocationWindow();
 
 private:
 			rw_lock				fLock;
@@ -269,6 +276,11 @@ private:
 				// we need those values to ensure we will remove
 				// the correct keys from the indices
 
+			off_t				fPreallocationWindow;
+				// in blocks, grows while the stream is being extended
+			block_run			fAllocationHint;
+				// the run last allocated for this inode, if any
+
 			mutable recursive_lock fSmallDataLock;
 			SinglyLinkedList<AttributeIterator> fIterators;
 };
@@ -925,6 +925,9 @@ Journal::_WriteTransactionToLog()
 
 /*!	Flushes the current log entry to disk. If \a flushBlocks is \c true it will
 	also write back all dirty blocks for this volume.
+	Only writing the log entry needs the journal lock; the block cache can
+	write back the blocks of completed transactions while new ones are
+	already running, so the lock is released before that.
 */
 status_t
 Journal::_FlushLog(bool canWait, bool flushBlocks)
@@ -948,10 +951,11 @@ Journal::_FlushLog(bool canWait, bool flushBlocks)
 			FATAL(("writing current log entry failed: %s\n", strerror(status)));
 	}
 
+	recursive_lock_unlock(&fLock);
+
 	if (flushBlocks)
 		status = fVolume->FlushDevice();
 
-	recursive_lock_unlock(&fLock);
 	return status;
 }
 
@@ -70,11 +70,141 @@ union value {
 };
 
 
+// The unit of the planner's cost estimates is a single index entry that is
+// looked at; loading a node, and matching it against the query is much more
+// expensive than that.
+static const off_t kNodeCost = 16;
+
+// Equations that can't narrow down the index range to look at don't tell us
+// how many nodes they are going to match; we assume one out of this many.
+static const off_t kUnknownSelectivity = 10;
+
+// The maximum number of nodes collected from an index to be intersected with
+// the nodes of another one
+static const int32 kMaxIntersectionNodes = 8192;
+
+
+// The role of a term in a query plan
+enum plan_role {
+	PLAN_ROOT,
+	PLAN_SCAN,
+		// its index is iterated
+	PLAN_MATCH,
+		// it's only matched against the nodes found by another term
+	PLAN_INTERSECT
+		// its nodes are collected, and intersected with another term
+};
+
+
+class Equation;
+
+
+static const char*
+plan_role_name(int32 role)
+{
+	switch (role) {
+		case PLAN_SCAN: return "scan ";
+		case PLAN_MATCH: return "match ";
+		case PLAN_INTERSECT: return "intersect ";
+	}
+	return "";
+}
+
+
+static const char*
+operator_symbol(int8 op)
+{
+	switch (op) {
+		case OP_AND: return "&&";
+		case OP_OR: return "||";
+		case OP_EQUAL: return "==";
+		case OP_UNEQUAL: return "!=";
+		case OP_GREATER_THAN: return ">";
+		case OP_GREATER_THAN_OR_EQUAL: return ">=";
+		case OP_LESS_THAN: return "<";
+		case OP_LESS_THAN_OR_EQUAL: return "<=";
+	}
+	return "???";
+}
+
+
+/*!	Collects the text of a query plan into a buffer.
+*/
+class PlanWriter {
+public:
+								PlanWriter(char* buffer, size_t size,
+									bool queryNonIndexed)
+									:
+									fBuffer(buffer),
+									fSize(size),
+									fLength(0),
+									fQueryNonIndexed(queryNonIndexed)
+								{
+									if (size > 0)
+										buffer[0] = '\0';
+								}
+
+			char*				Position() const
+									{ return fBuffer + min_c(fLength, fSize); }
+			size_t				Left() const
+									{ return fLength < fSize
+										? fSize - fLength : 0; }
+			void				Wrote(int length)
+									{ if (length > 0) fLength += length; }
+			size_t				Length() const { return fLength; }
+
+			bool				QueryNonIndexed() const
+									{ return fQueryNonIndexed; }
+
+private:
+			char*				fBuffer;
+			size_t				fSize;
+			size_t				fLength;
+			bool				fQueryNonIndexed;
+};
+
+
+/*!	A set of node IDs that has been collected from the index of an equation.
+	It is used to filter the entries of another index before the nodes
+	behind them have to be loaded.
+*/
+class IntersectionSet {
+public:
+								IntersectionSet();
+								~IntersectionSet();
+
+			status_t			Init(int32 maxCount);
+
+			bool				Add(off_t id);
+			bool				Contains(off_t id) const;
+
+			int32				CountNodes() const { return fCount; }
+
+private:
+			uint32				_Hash(off_t id) const;
+
+private:
+			off_t*				fTable;
+				// 0 marks an empty slot, it is never a valid node ID
+			uint32				fMask;
+			int32				fCount;
+			int32				fMaxCount;
+};
+
+
 /*!	Abstract base class for the operator/equation classes.
 */
 class Term {
 public:
-								Term(int8 op) : fOp(op), fParent(NULL) {}
+								Term(int8 op)
+									:
+									fOp(op),
+									fParent(NULL),
+									fCost(0),
+									fRows(0),
+									fLoads(0)
+								{
+								}
 	virtual						~Term() {}
 
 			int8				Op() const { return fOp; }
@@ -88,8 +218,13 @@ public:
 									size_t size = 0) = 0;
 	virtual	void				Complement() = 0;
 
-	virtual	void				CalculateScore(Index& index) = 0;
-	virtual	int32				Score() const = 0;
+	virtual	void				Estimate(Index& index) = 0;
+			off_t				Cost() const { return fCost; }
+			off_t				Rows() const { return fRows; }
+			off_t				Loads() const { return fLoads; }
+
+	virtual	void				Explain(PlanWriter& writer, int32 level,
+									int32 role) = 0;
 
 	virtual	status_t			InitCheck() = 0;
 
@@ -100,6 +235,13 @@ public:
 protected:
 			int8				fOp;
 			Term*				fParent;
+
+			// estimated by the query planner
+			off_t				fCost;
+			off_t				fRows;
+				// the number of nodes that match
+			off_t				fLoads;
+				// the number of nodes that have to be loaded
 };
 
 
@@ -132,10 +274,18 @@ public:
 									bool queryNonIndexed);
 			status_t			GetNextMatching(Volume* volume,
 									TreeIterator* iterator,
+									const IntersectionSet* intersection,
 									struct dirent* dirent, size_t bufferSize);
+			status_t			CollectMatching(Volume* volume, Index& index,
+									IntersectionSet& set);
+
+	virtual	void				Estimate(Index& index);
+	virtual	void				Explain(PlanWriter& writer, int32 level,
+									int32 role);
 
-	virtual	void				CalculateScore(Index &index);
-	virtual	int32				Score() const { return fScore; }
+			bool				CanIntersect() const;
+			off_t				IndexCost() const { return fVisited; }
+			off_t				IndexEntries() const { return fEntries; }
 
 #ifdef DEBUG
 	virtual	void				PrintToStream();
@@ -153,6 +303,12 @@ private:
 			status_t			_ConvertValue(type_code type);
 			bool				_CompareTo(const uint8* value, uint16 size);
 			uint8*				_Value() const { return (uint8*)&fValue; }
+			uint16				_KeySize() const;
+
+			status_t			_EstimateIndexed(Index& index);
+			off_t				_EstimateRange(BPlusTree* tree,
+									const uint8* from, uint16 fromLength,
+									const uint8* to, uint16 toLength) const;
 
 private:
 			char*				fAttribute;
@@ -163,8 +319,14 @@ private:
 			bool				fIsPattern;
 			bool				fIsSpecialTime;
 
-			int32				fScore;
 			bool				fHasIndex;
+
+			// estimated by the query planner
+			bool				fUsesIndex;
+			off_t				fEntries;
+				// the number of entries in the index that is used
+			off_t				fVisited;
+				// the number of index entries that have to be looked at
 };
 
 
@@ -185,8 +347,13 @@ public:
 									size_t size = 0);
 	virtual	void				Complement();
 
-	virtual	void				CalculateScore(Index& index);
-	virtual	int32				Score() const;
+	virtual	void				Estimate(Index& index);
+	virtual	void				Explain(PlanWriter& writer, int32 level,
+									int32 role);
+
+			Term*				Driver() const { return fDriver; }
+			Equation*			Intersection() const
+									{ return fIntersection; }
 
 	virtual	status_t			InitCheck();
 
@@ -199,9 +366,16 @@ private:
 								Operator& operator=(const Operator& other);
 									// no implementation
 
+			void				_ConsiderIntersection(Term* term,
+									Term* driver);
+
 private:
 			Term*				fLeft;
 			Term*				fRight;
+
+			// chosen by the query planner for OP_AND
+			Term*				fDriver;
+			Equation*			fIntersection;
 };
 
 
@@ -214,7 +388,11 @@ Equation::Equation(char** _expression)
 	fAttribute(NULL),
 	fString(NULL),
 	fType(0),
-	fIsPattern(false)
+	fIsPattern(false),
+	fHasIndex(false),
+	fUsesIndex(false),
+	fEntries(0),
+	fVisited(0)
 {
 	char* string = *_expression;
 	char* start = string;
@@ -578,7 +756,8 @@ Equation::PrepareQuery(Volume* /*volume*/, Index& index,
 
 status_t
 Equation::GetNextMatching(Volume* volume, TreeIterator* iterator,
-	struct dirent* dirent, size_t bufferSize)
+	const IntersectionSet* intersection, struct dirent* dirent,
+	size_t bufferSize)
 {
 	while (true) {
 		union value indexValue;
@@ -609,6 +788,11 @@ Equation::GetNextMatching(Volume* volume, TreeIterator* iterator,
 			continue;
 		}
 
+		// nodes that are not part of the intersection can't match the rest
+		// of the expression, so we don't even need to load them
+		if (intersection != NULL && !intersection->Contains(offset))
+			continue;
+
 		Vnode vnode(volume, offset);
 		Inode* inode;
 		if ((status = vnode.Get(&inode)) != B_OK) {
@@ -684,37 +868,235 @@ Equation::GetNextMatching(Volume* volume, TreeIterator* iterator,
 }
 
 
+/*!	Adds the IDs of all nodes with an index entry that matches this equation
+	to the \a set, without loading any of them.
+	Fails if the equation cannot be decided by its index alone, or if there
+	are more nodes than fit into the set.
+*/
+status_t
+Equation::CollectMatching(Volume* volume, Index& index, IntersectionSet& set)
+{
+	TreeIterator* iterator = NULL;
+	status_t status = PrepareQuery(volume, index, &iterator, false);
+	ObjectDeleter<TreeIterator> iteratorDeleter(iterator);
+
+	if (status == B_ENTRY_NOT_FOUND && iterator != NULL && fOp == OP_EQUAL
+		&& !fIsPattern) {
+		// there is no node with this value
+		return B_OK;
+	}
+	if (status != B_OK)
+		return status;
+	if (!fHasIndex)
+		return B_BAD_VALUE;
+
+	while (true) {
+		union value indexValue;
+		uint16 keyLength;
+		uint16 duplicate;
+		off_t offset;
+
+		status = iterator->GetNextEntry(&indexValue, &keyLength,
+			(uint16)sizeof(indexValue), &offset, &duplicate);
+		if (status == B_ENTRY_NOT_FOUND)
+			return B_OK;
+		if (status != B_OK)
+			return status;
+
+		// see GetNextMatching()
+		if (duplicate < 2 && !_CompareTo((uint8*)&indexValue, keyLength)) {
+			if (fOp == OP_LESS_THAN
+				|| fOp == OP_LESS_THAN_OR_EQUAL
+				|| (fOp == OP_EQUAL && !fIsPattern))
+				return B_OK;
+
+			if (duplicate > 0)
+				iterator->SkipDuplicates();
+			continue;
+		}
+
+		if (!set.Add(offset))
+			return B_BUFFER_OVERFLOW;
+	}
+}
+
+
+/*!	Estimates how expensive it is to drive the query from this equation, and
+	how many nodes it will match.
+*/
 void
-Equation::CalculateScore(Index &index)
+Equation::Estimate(Index& index)
 {
-	// As always, these values could be tuned and refined.
-	// And the code could also need some real world testing :-)
+	fUsesIndex = false;
+	fEntries = 0;
+	fVisited = 0;
+	fRows = 0;
+
+	if (fOp != OP_UNEQUAL && index.SetTo(fAttribute) == B_OK
+		&& _EstimateIndexed(index) == B_OK) {
+		fUsesIndex = true;
+		fLoads = fRows;
+	} else {
+		// PrepareQuery() will have to go through the whole name index, and
+		// check every node
+		BPlusTree* tree;
+		off_t keys;
+		if (index.SetTo("name") != B_OK
+			|| (tree = index.Node()->Tree()) == NULL
+			|| tree->EstimateEntries(keys, fEntries) != B_OK)
+			fEntries = 0;
+
+		fVisited = fEntries;
+		fLoads = fEntries;
+		fRows = fOp == OP_UNEQUAL ? fEntries : fEntries / kUnknownSelectivity;
+	}
+
+	fCost = fVisited + fLoads * kNodeCost;
+}
+
+
+/*!	Estimates the number of entries in the index that have to be looked at
+	for this equation, using the statistics of its B+tree.
+*/
+status_t
+Equation::_EstimateIndexed(Index& index)
+{
+	BPlusTree* tree = index.Node()->Tree();
+	if (tree == NULL)
+		return B_ERROR;
+
+	off_t keys;
+	status_t status = tree->EstimateEntries(keys, fEntries);
+	if (status == B_OK)
+		status = _ConvertValue(index.Type());
+	if (status != B_OK)
+		return status;
+
+	if (fIsPattern) {
+		int32 prefixLength = getFirstPatternSymbol(fString);
+		if (prefixLength <= 0) {
+			// the whole index has to be scanned
+			fVisited = fEntries;
+			fRows = fEntries / kUnknownSelectivity;
+			return B_OK;
+		}
+
+		// only the keys that start with the prefix have to be looked at
+		uint8 end[MAX_INDEX_KEY_LENGTH];
+		memcpy(end, fValue.String, prefixLength);
+
+		if (end[prefixLength - 1] == 0xff) {
+			fVisited = _EstimateRange(tree, _Value(), prefixLength, NULL, 0);
+		} else {
+			end[prefixLength - 1]++;
+			fVisited = _EstimateRange(tree, _Value(), prefixLength, end,
+				prefixLength);
+		}
+		fRows = fVisited;
+		return B_OK;
+	}
+
+	const uint8* key = _Value();
+	uint16 keyLength = _KeySize();
+
+	int64 timeKey;
+	if (fIsSpecialTime) {
+		// the index contains shifted values, see PrepareQuery()
+		timeKey = fValue.Int64 << INODE_TIME_SHIFT;
+		key = (uint8*)&timeKey;
+		keyLength = sizeof(int64);
+	}
 
-	// do we have to operate on a "foreign" index?
-	if (fOp == OP_UNEQUAL || index.SetTo(fAttribute) < B_OK) {
-		fScore = 0;
+	switch (fOp) {
+		case OP_EQUAL:
+			if (fIsSpecialTime) {
+				int64 nextKey = (fValue.Int64 + 1) << INODE_TIME_SHIFT;
+				fVisited = _EstimateRange(tree, key, keyLength,
+					(uint8*)&nextKey, sizeof(int64));
+			} else {
+				status = tree->EstimateValues(key, keyLength, fVisited);
+				if (status != B_OK)
+					return status;
+			}
+			break;
+
+		case OP_LESS_THAN:
+		case OP_LESS_THAN_OR_EQUAL:
+			// the iterator starts at the beginning of the index
+			fVisited = _EstimateRange(tree, NULL, 0, key, keyLength);
+			break;
+
+		default:
+			fVisited = _EstimateRange(tree, key, keyLength, NULL, 0);
+			break;
+	}
+
+	fRows = fVisited;
+	return B_OK;
+}
+
+
+/*!	Estimates the number of index entries between the two keys; a NULL key
+	stands for the start, or the end of the index, respectively.
+*/
+off_t
+Equation::_EstimateRange(BPlusTree* tree, const uint8* from,
+	uint16 fromLength, const uint8* to, uint16 toLength) const
+{
+	uint32 start = 0;
+	uint32 end = BPlusTree::kPositionScale;
+
+	if ((from != NULL
+			&& tree->EstimatePosition(from, fromLength, start) != B_OK)
+		|| (to != NULL && tree->EstimatePosition(to, toLength, end) != B_OK))
+		return fEntries;
+
+	if (end <= start)
+		return min_c(fEntries, 1);
+
+	// positioning the iterator will always look at one entry
+	return max_c(fEntries * (end - start) / BPlusTree::kPositionScale, 1);
+}
+
+
+/*!	Returns whether or not the planner may use the nodes of this equation
+	to filter the nodes of another one.
+*/
+bool
+Equation::CanIntersect() const
+{
+	return fUsesIndex && fRows <= kMaxIntersectionNodes;
+}
+
+
+void
+Equation::Explain(PlanWriter& writer, int32 level, int32 role)
+{
+	writer.Wrote(snprintf(writer.Position(), writer.Left(),
+		"%*s%s\"%s\" %s \"%s\"", (int)level * 2, "", plan_role_name(role),
+		fAttribute, operator_symbol(fOp), fString));
+
+	if (role == PLAN_MATCH) {
+		writer.Wrote(snprintf(writer.Position(), writer.Left(), "\n"));
 		return;
 	}
 
-	// if we have a pattern, how much does it help our search?
-	if (fIsPattern)
-		fScore = getFirstPatternSymbol(fString) << 3;
-	else {
-		// Score by operator
-		if (fOp == OP_EQUAL)
-			// higher than pattern="255 chars+*"
-			fScore = 2048;
-		else
-			// the pattern search is regarded cheaper when you have at
-			// least one character to set your index to
-			fScore = 5;
+	writer.Wrote(snprintf(writer.Position(), writer.Left(), ": "));
+
+	if (fUsesIndex) {
+		writer.Wrote(snprintf(writer.Position(), writer.Left(),
+			"index \"%s\" (~%" B_PRIdOFF " entries), looks at ~%" B_PRIdOFF
+			", matches ~%" B_PRIdOFF, fAttribute, fEntries, fVisited, fRows));
+	} else {
+		writer.Wrote(snprintf(writer.Position(), writer.Left(),
+			"%s, scans index \"name\" (~%" B_PRIdOFF " entries)",
+			fOp == OP_UNEQUAL ? "unequal" : writer.QueryNonIndexed()
+				? "no index" : "no index, and B_QUERY_NON_INDEXED not set",
+			fEntries));
 	}
 
-	// take index size into account (1024 is the current node size
-	// in our B+trees)
-	// 2048 * 2048 == 4194304 is the maximum score (for an empty
-	// tree, since the header + 1 node are already 2048 bytes)
-	fScore = fScore * ((2048 * 1024LL) / index.Node()->Size());
+	writer.Wrote(snprintf(writer.Position(), writer.Left(),
+		", cost %" B_PRIdOFF "\n", fCost));
 }
 
 
@@ -845,6 +1227,20 @@ Equation::_ConvertValue(type_code type)
 }
 
 
+/*!	Returns the size of the value as a key in the index, see PrepareQuery().
+*/
+uint16
+Equation::_KeySize() const
+{
+	if (fType == B_STRING_TYPE) {
+		// the empty string is looked up with its terminating null byte
+		return max_c(strlen(fValue.String), 1);
+	}
+
+	return fSize;
+}
+
+
 /*!	Returns true when the key matches the equation. You have to
 	call ConvertValue() before this one.
 */
@@ -895,7 +1291,9 @@ Operator::Operator(Term* left, int8 op, Term* right)
 	:
 	Term(op),
 	fLeft(left),
-	fRight(right)
+	fRight(right),
+	fDriver(left),
+	fIntersection(NULL)
 {
 	if (left)
 		left->SetParent(this);
@@ -922,15 +1320,15 @@ Operator::Match(Inode* inode, const char* attribute, int32 type,
 
 		return fRight->Match(inode, attribute, type, key, size);
 	} else {
-		// choose the term with the better score for OP_OR
+		// check the term that is more likely to match first for OP_OR
 		Term* first;
 		Term* second;
-		if (fRight->Score() > fLeft->Score()) {
-			first = fLeft;
-			second = fRight;
-		} else {
+		if (fRight->Rows() > fLeft->Rows()) {
 			first = fRight;
 			second = fLeft;
+		} else {
+			first = fLeft;
+			second = fRight;
 		}
 
 		status_t status = first->Match(inode, attribute, type, key, size);
@@ -956,29 +1354,95 @@ Operator::Complement()
 
 
 void
-Operator::CalculateScore(Index &index)
+Operator::Estimate(Index& index)
 {
-	fLeft->CalculateScore(index);
-	fRight->CalculateScore(index);
+	fLeft->Estimate(index);
+	fRight->Estimate(index);
+
+	fIntersection = NULL;
+
+	if (fOp == OP_OR) {
+		// both sides have to be run through
+		fDriver = NULL;
+		fCost = fLeft->Cost() + fRight->Cost();
+		fRows = fLeft->Rows() + fRight->Rows();
+		fLoads = fLeft->Loads() + fRight->Loads();
+		return;
+	}
+
+	// For OP_AND, only the cheaper side is run through, and its nodes are
+	// matched against the other side
+	fDriver = fRight->Cost() < fLeft->Cost() ? fRight : fLeft;
+	fCost = fDriver->Cost();
+	fRows = min_c(fLeft->Rows(), fRight->Rows());
+	fLoads = fDriver->Loads();
+
+	_ConsiderIntersection(fLeft, fRight);
+	_ConsiderIntersection(fRight, fLeft);
 }
 
 
-int32
-Operator::Score() const
+/*!	Checks if collecting the nodes of \a term from its index, and only loading
+	those nodes of \a driver that are part of them is cheaper than the current
+	plan, and chooses it if so.
+*/
+void
+Operator::_ConsiderIntersection(Term* term, Term* driver)
 {
-	if (fOp == OP_AND) {
-		// return the one with the better score
-		if (fRight->Score() > fLeft->Score())
-			return fRight->Score();
+	if (term->Op() <= OP_EQUATION)
+		return;
+
+	Equation* equation = (Equation*)term;
+	if (!equation->CanIntersect())
+		return;
 
-		return fLeft->Score();
+	// assume that the nodes of both sides are independent of each other
+	off_t loads = 0;
+	if (equation->IndexEntries() > 0) {
+		loads = driver->Loads() * equation->Rows()
+			/ equation->IndexEntries();
 	}
 
-	// for OP_OR, be honest, and return the one with the worse score
-	if (fRight->Score() < fLeft->Score())
-		return fRight->Score();
+	off_t cost = equation->IndexCost() + driver->Cost()
+		- (driver->Loads() - loads) * kNodeCost;
+	if (cost >= fCost)
+		return;
 
-	return fLeft->Score();
+	fDriver = driver;
+	fIntersection = equation;
+	fCost = cost;
+	fLoads = loads;
+}
+
+
+void
+Operator::Explain(PlanWriter& writer, int32 level, int32 role)
+{
+	const char* name = fOp == OP_AND ? "AND" : "OR";
+
+	if (role == PLAN_MATCH) {
+		writer.Wrote(snprintf(writer.Position(), writer.Left(), "%*s%s%s\n",
+			(int)level * 2, "", plan_role_name(role), name));
+		fLeft->Explain(writer, level + 1, PLAN_MATCH);
+		fRight->Explain(writer, level + 1, PLAN_MATCH);
+		return;
+	}
+
+	writer.Wrote(snprintf(writer.Position(), writer.Left(),
+		"%*s%s%s: matches ~%" B_PRIdOFF ", loads ~%" B_PRIdOFF " nodes, cost %"
+		B_PRIdOFF "\n", (int)level * 2, "", plan_role_name(role), name, fRows,
+		fLoads, fCost));
+
+	if (fOp == OP_OR) {
+		fLeft->Explain(writer, level + 1, PLAN_SCAN);
+		fRight->Explain(writer, level + 1, PLAN_SCAN);
+		return;
+	}
+
+	Term* other = fDriver == fLeft ? fRight : fLeft;
+	fDriver->Explain(writer, level + 1, PLAN_SCAN);
+	other->Explain(writer, level + 1,
+		other == fIntersection ? PLAN_INTERSECT : PLAN_MATCH);
 }
 
 
@@ -1060,16 +1524,7 @@ Operator::PrintToStream()
 void
 Equation::PrintToStream()
 {
-	const char* symbol = "???";
-	switch (fOp) {
-		case OP_EQUAL: symbol = "=="; break;
-		case OP_UNEQUAL: symbol = "!="; break;
-		case OP_GREATER_THAN: symbol = ">"; break;
-		case OP_GREATER_THAN_OR_EQUAL: symbol = ">="; break;
-		case OP_LESS_THAN: symbol = "<"; break;
-		case OP_LESS_THAN_OR_EQUAL: symbol = "<="; break;
-	}
-	__out("[\"%s\" %s \"%s\"]", fAttribute, symbol, fString);
+	__out("[\"%s\" %s \"%s\"]", fAttribute, operator_symbol(fOp), fString);
 }
 
 #endif	// DEBUG
@@ -1228,12 +1683,92 @@ Expression::InitCheck()
 //	#pragma mark -
 
 
+IntersectionSet::IntersectionSet()
+	:
+	fTable(NULL),
+	fMask(0),
+	fCount(0),
+	fMaxCount(0)
+{
+}
+
+
+IntersectionSet::~IntersectionSet()
+{
+	free(fTable);
+}
+
+
+status_t
+IntersectionSet::Init(int32 maxCount)
+{
+	// keep the table at most half full
+	uint32 size = 16;
+	while (size < (uint32)maxCount * 2)
+		size <<= 1;
+
+	fTable = (off_t*)calloc(size, sizeof(off_t));
+	if (fTable == NULL)
+		return B_NO_MEMORY;
+
+	fMask = size - 1;
+	fMaxCount = maxCount;
+	return B_OK;
+}
+
+
+/*!	Adds the node ID to the set. Returns false if the set is already full.
+*/
+bool
+IntersectionSet::Add(off_t id)
+{
+	uint32 index = _Hash(id);
+	while (fTable[index] != 0) {
+		if (fTable[index] == id)
+			return true;
+		index = (index + 1) & fMask;
+	}
+
+	if (fCount >= fMaxCount)
+		return false;
+
+	fTable[index] = id;
+	fCount++;
+	return true;
+}
+
+
+bool
+IntersectionSet::Contains(off_t id) const
+{
+	uint32 index = _Hash(id);
+	while (fTable[index] != 0) {
+		if (fTable[index] == id)
+			return true;
+		index = (index + 1) & fMask;
+	}
+	return false;
+}
+
+
+uint32
+IntersectionSet::_Hash(off_t id) const
+{
+	// node IDs are block numbers, and often close to each other
+	return ((uint32)id ^ (uint32)(id >> 32)) * 0x9e3779b1 & fMask;
+}
+
+
+//	#pragma mark -
+
+
 Query::Query(Volume* volume, Expression* expression, uint32 flags)
 	:
 	fVolume(volume),
 	fExpression(expression),
 	fCurrent(NULL),
 	fIterator(NULL),
+	fIntersection(NULL),
 	fIndex(volume),
 	fFlags(flags),
 	fPort(-1)
@@ -1244,8 +1779,9 @@ Query::Query(Volume* volume, Expression* expression, uint32 flags)
 	if (volume == NULL || expression == NULL || expression->Root() == NULL)
 		return;
 
-	// create index on the stack and delete it afterwards
-	fExpression->Root()->CalculateScore(fIndex);
+	// let the planner estimate the cost of the terms, and choose how to run
+	// the query
+	fExpression->Root()->Estimate(fIndex);
 	fIndex.Unset();
 
 	Rewind();
@@ -1259,6 +1795,8 @@ Query::~Query()
 {
 	if ((fFlags & B_LIVE_QUERY) != 0)
 		fVolume->RemoveQuery(this);
+
+	delete fIntersection;
 }
 
 
@@ -1273,6 +1811,9 @@ Query::Rewind()
 	fIterator = NULL;
 	fCurrent = NULL;
 
+	delete fIntersection;
+	fIntersection = NULL;
+
 	// put the whole expression on the stack
 
 	Stack<Term*> stack;
@@ -1287,12 +1828,8 @@ Query::Rewind()
 				stack.Push(op->Left());
 				stack.Push(op->Right());
 			} else {
-				// For OP_AND, we can use the scoring system to decide which
-				// path to add
-				if (op->Right()->Score() > op->Left()->Score())
-					stack.Push(op->Right());
-				else
-					stack.Push(op->Left());
+				// For OP_AND, the planner has chosen the path to add
+				stack.Push(op->Driver());
 			}
 		} else if (term->Op() == OP_EQUATION
 			|| fStack.Push((Equation*)term) != B_OK)
@@ -1314,6 +1851,8 @@ Query::GetNextEntry(struct dirent* dirent, size_t size)
 				|| fCurrent == NULL)
 				return B_ENTRY_NOT_FOUND;
 
+			_PrepareIntersection();
+
 			status_t status = fCurrent->PrepareQuery(fVolume, fIndex,
 				&fIterator, fFlags & B_QUERY_NON_INDEXED);
 			if (status == B_ENTRY_NOT_FOUND) {
@@ -1327,8 +1866,8 @@ Query::GetNextEntry(struct dirent* dirent, size_t size)
 		if (fCurrent == NULL)
 			RETURN_ERROR(B_ERROR);
 
-		status_t status = fCurrent->GetNextMatching(fVolume, fIterator, dirent,
-			size);
+		status_t status = fCurrent->GetNextMatching(fVolume, fIterator,
+			fIntersection, dirent, size);
 		if (status != B_OK) {
 			delete fIterator;
 			fIterator = NULL;
@@ -1341,6 +1880,21 @@ Query::GetNextEntry(struct dirent* dirent, size_t size)
 }
 
 
+/*!	Returns a description of the plan chosen for the query, one term per
+	line. The returned length might exceed the size of the buffer.
+*/
+size_t
+Query::Explain(char* buffer, size_t size)
+{
+	PlanWriter writer(buffer, size, (fFlags & B_QUERY_NON_INDEXED) != 0);
+
+	if (fExpression != NULL && fExpression->Root() != NULL)
+		fExpression->Root()->Explain(writer, 0, PLAN_ROOT);
+
+	return writer.Length();
+}
+
+
 void
 Query::SetLiveMode(port_id port, int32 token)
 {
@@ -1445,3 +1999,38 @@ Query::LiveUpdateRenameMove(Inode* inode, ino_t oldDirectoryID,
 	notify_query_entry_created(fPort, fToken, fVolume->ID(),
 		newDirectoryID, newName, inode->ID());
 }
+
+
+/*!	If the planner chose to intersect the nodes of the current equation with
+	those of another one, this collects the nodes of the latter.
+*/
+void
+Query::_PrepareIntersection()
+{
+	delete fIntersection;
+	fIntersection = NULL;
+
+	// the closest intersection on the way up applies
+	Equation* equation = NULL;
+	for (Term* term = fCurrent; term->Parent() != NULL;
+			term = term->Parent()) {
+		Operator* parent = (Operator*)term->Parent();
+		if (parent->Op() == OP_AND && parent->Intersection() != NULL
+			&& parent->Intersection() != term) {
+			equation = parent->Intersection();
+			break;
+		}
+	}
+	if (equation == NULL)
+		return;
+
+	IntersectionSet* set = new(std::nothrow) IntersectionSet;
+	if (set == NULL || set->Init(kMaxIntersectionNodes) != B_OK
+		|| equation->CollectMatching(fVolume, fIndex, *set) != B_OK) {
+		// we can do without it
+		delete set;
+		return;
+	}
+
+	fIntersection = set;
+}
@@ -13,6 +13,7 @@
 class Volume;
 class Term;
 class Equation;
+class IntersectionSet;
 class TreeIterator;
 class Query;
 
@@ -51,6 +52,8 @@ public:
 			status_t		Rewind();
 			status_t		GetNextEntry(struct dirent* , size_t size);
 
+			size_t			Explain(char* buffer, size_t size);
+
 			void			SetLiveMode(port_id port, int32 token);
 			void			LiveUpdate(Inode* inode, const char* attribute,
 								int32 type, const uint8* oldKey,
@@ -63,11 +66,15 @@ public:
 
 			Expression*		GetExpression() const { return fExpression; }
 
+private:
+			void			_PrepareIntersection();
+
 private:
 			Volume*			fVolume;
 			Expression*		fExpression;
 			Equation*		fCurrent;
 			TreeIterator*	fIterator;
+			IntersectionSet* fIntersection;
 			Index			fIndex;
 			Stack<Equation*> fStack;
 
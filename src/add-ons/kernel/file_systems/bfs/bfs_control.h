@@ -66,6 +66,18 @@ struct check_control {
 		uint64	blocks_in_double_indirect;
 		uint64	partial_block_runs;
 		uint32	block_size;
+
+		/* fragmentation report, filled in by the bitmap pass */
+		uint64	data_streams;
+		uint64	data_extents;
+			/* physically contiguous ranges over all data streams */
+		uint64	fragmented_streams;
+			/* data streams that consist of more than one extent */
+		uint64	max_stream_extents;
+		ino_t	most_fragmented_inode;
+		uint64	free_extents;
+		uint64	largest_free_extent;
+			/* in blocks, free extents never span allocation groups */
 	} stats;
 	status_t	status;
 };
@@ -84,6 +96,14 @@ struct check_control {
 	 */
 #define BFS_FIX_NAME_MISMATCHES	8
 #define BFS_FIX_BPLUSTREES		16
+#define BFS_REBUILD_INDICES		32
+	/* rebuilds all indices in the index pass, not only the broken ones;
+	 * mostly useful for benchmarking.
+	 */
+#define BFS_INSERT_INDEX_KEYS	64
+	/* rebuilt indices get their keys inserted one by one, instead of being
+	 * bulk loaded; only useful to compare both.
+	 */
 
 /* values for the errors field */
 #define BFS_MISSING_BLOCKS		1
@@ -93,6 +113,10 @@ struct check_control {
 #define BFS_WRONG_TYPE			16
 #define BFS_NAMES_DONT_MATCH	32
 #define BFS_INVALID_BPLUSTREE	64
+#define BFS_INDEX_NOT_REBUILT	128
+	/* an index could not be rebuilt in the index pass, and may be
+	 * incomplete.
+	 */
 
 /* check control magic value */
 #define BFS_IOCTL_CHECK_MAGIC	'BChk'
@@ -103,5 +127,21 @@ struct check_control {
  */
 #define BFS_IOCTL_RESIZE		14205
 
+/* Describes the plan the query planner chooses for a query, as text, one
+ * term per line. The query string, and the plan buffer are both in the
+ * caller's address space; plan_length is set to the length of the complete
+ * plan, which may be larger than the buffer.
+ */
+#define BFS_IOCTL_EXPLAIN_QUERY	14206
+
+struct explain_query {
+	const char*	query;
+	uint32		flags;
+		/* the query flags, B_QUERY_NON_INDEXED changes the plan */
+	char*		plan;
+	uint32		plan_size;
+	uint32		plan_length;
+};
+
 
 #endif	/* BFS_CONTROL_H */
@@ -741,6 +741,15 @@ bfs_ioctl(fs_volume* _volume, fs_vnode* _node, void* _cookie, uint32 cmd,
 				if (checker->Pass() == BFS_CHECK_PASS_BITMAP) {
 					if (checker->WriteBackCheckBitmap() == B_OK)
 						status = checker->StartIndexPass();
+				} else if (checker->Pass() == BFS_CHECK_PASS_INDEX) {
+					status_t finishStatus = checker->FinishIndexPass();
+					if (finishStatus != B_OK) {
+						checker->Control().status = finishStatus;
+						checker->Control().errors |= BFS_INDEX_NOT_REBUILT;
+						user_memcpy(buffer, &checker->Control(),
+							sizeof(check_control));
+						return finishStatus;
+					}
 				}
 			}
 
@@ -786,6 +795,52 @@ bfs_ioctl(fs_volume* _volume, fs_vnode* _node, void* _cookie, uint32 cmd,
 			ResizeVisitor resizer(volume);
 			return resizer.Resize(size, -1);
 		}
+		case BFS_IOCTL_EXPLAIN_QUERY:
+		{
+			const size_t kMaxQueryLength = 16384;
+			const size_t kMaxPlanSize = 65536;
+
+			explain_query explain;
+			if (bufferLength != sizeof(explain_query))
+				return B_BAD_VALUE;
+			if (user_memcpy(&explain, buffer, sizeof(explain_query)) != B_OK)
+				return B_BAD_ADDRESS;
+			if (explain.query == NULL || explain.plan == NULL
+				|| explain.plan_size == 0)
+				return B_BAD_VALUE;
+
+			char* queryString = (char*)malloc(kMaxQueryLength);
+			MemoryDeleter queryDeleter(queryString);
+			size_t planSize = min_c(explain.plan_size, kMaxPlanSize);
+			char* plan = (char*)malloc(planSize);
+			MemoryDeleter planDeleter(plan);
+			if (queryString == NULL || plan == NULL)
+				return B_NO_MEMORY;
+
+			ssize_t length = user_strlcpy(queryString, explain.query,
+				kMaxQueryLength);
+			if (length < 0)
+				return B_BAD_ADDRESS;
+			if ((size_t)length >= kMaxQueryLength)
+				return B_NAME_TOO_LONG;
+
+			Expression expression(queryString);
+			if (expression.InitCheck() != B_OK)
+				return B_BAD_VALUE;
+
+			// the query is never run, only planned
+			Query query(volume, &expression,
+				explain.flags & ~B_LIVE_QUERY);
+			explain.plan_length = query.Explain(plan, planSize);
+
+			if (user_memcpy(explain.plan, plan,
+					min_c(explain.plan_length + 1, planSize)) != B_OK
+				|| user_memcpy(buffer, &explain, sizeof(explain_query))
+					!= B_OK) {
+				return B_BAD_ADDRESS;
+			}
+			return B_OK;
+		}
 
 #ifdef DEBUG_FRAGMENTER
 		case 56741:
@@ -159,6 +159,17 @@ CachedDataReader::ReadDataToOutput(off_t offset, size_t size,
 }
 
 
+/*!	Reads data without putting it into the cache; used when the cache can't
+	be filled, for example because there are no free pages.
+*/
+status_t
+CachedDataReader::ReadUncachedDataToOutput(off_t offset, size_t size,
+	BDataIO* output)
+{
+	return fReader->ReadDataToOutput(offset, size, output);
+}
+
+
 status_t
 CachedDataReader::_ReadCacheLine(off_t lineOffset, size_t lineSize,
 	off_t requestOffset, size_t requestLength, BDataIO* output)
@@ -227,7 +238,7 @@ CachedDataReader::_ReadCacheLine(off_t lineOffset, size_t lineSize,
 			_DiscardPages(pages, firstMissing - firstPageOffset, missingPages);
 
 			// fall back to uncached transfer
-			return fReader->ReadDataToOutput(requestOffset, requestLength,
+			return ReadUncachedDataToOutput(requestOffset, requestLength,
 				output);
 		}
 
@@ -275,7 +286,7 @@ CachedDataReader::_ReadCacheLine(off_t lineOffset, size_t lineSize,
 			_DiscardPages(pages, firstMissing - firstPageOffset, missingPages);
 
 			// Try again using an uncached transfer
-			return fReader->ReadDataToOutput(requestOffset, requestLength,
+			return ReadUncachedDataToOutput(requestOffset, requestLength,
 				output);
 		}
 	}
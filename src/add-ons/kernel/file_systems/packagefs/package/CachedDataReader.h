@@ -29,6 +29,10 @@ public:
 	virtual	status_t			ReadDataToOutput(off_t offset, size_t size,
 									BDataIO* output);
 
+protected:
+	virtual	status_t			ReadUncachedDataToOutput(off_t offset,
+									size_t size, BDataIO* output);
+
 private:
 			class CacheLineLocker
 				: public DoublyLinkedListLinkImpl<CacheLineLocker> {
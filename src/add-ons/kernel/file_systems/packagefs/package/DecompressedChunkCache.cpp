@@ -0,0 +1,321 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "DecompressedChunkCache.h"
+
+#include <new>
+#include <string.h>
+
+#include <KernelExport.h>
+
+#include <low_resource_manager.h>
+#include <slab/Slab.h>
+#include <util/AutoLock.h>
+
+#include "DebugSupport.h"
+
+
+static const size_t kDefaultMaxChunks = 16;
+	// 1 MiB of decompressed data; regular reads go through the page cache,
+	// only the uncached fallback reads use this cache
+
+static const size_t kChunkSize = PackageFileHeapAccessorBase::kChunkSize;
+
+
+DecompressedChunkCache* DecompressedChunkCache::sDefault = NULL;
+
+
+static int
+dump_chunk_cache(int argc, char** argv)
+{
+	if (DecompressedChunkCache::Default() != NULL)
+		DecompressedChunkCache::Default()->Dump();
+	return 0;
+}
+
+
+DecompressedChunkCache::DecompressedChunkCache(size_t maxChunks)
+	:
+	fBufferCache(NULL),
+	fChunkCount(0),
+	fMaxChunks(maxChunks),
+	fHits(0),
+	fMisses(0),
+	fInsertions(0),
+	fEvictions(0)
+{
+	mutex_init(&fLock, "packagefs chunk cache");
+}
+
+
+DecompressedChunkCache::~DecompressedChunkCache()
+{
+	unregister_low_resource_handler(&_LowMemoryHandler, this);
+
+	mutex_lock(&fLock);
+	_Evict(0);
+	mutex_destroy(&fLock);
+
+	if (fBufferCache != NULL)
+		delete_object_cache(fBufferCache);
+}
+
+
+status_t
+DecompressedChunkCache::Init()
+{
+	fBufferCache = create_object_cache("packagefs decompressed chunks",
+		kChunkSize, sizeof(void*), NULL, NULL, NULL);
+	if (fBufferCache == NULL)
+		return B_NO_MEMORY;
+
+	status_t error = fChunks.Init(fMaxChunks);
+	if (error != B_OK)
+		return error;
+
+	return register_low_resource_handler(&_LowMemoryHandler, this,
+		B_KERNEL_RESOURCE_PAGES | B_KERNEL_RESOURCE_MEMORY, 0);
+}
+
+
+/*static*/ status_t
+DecompressedChunkCache::GlobalInit()
+{
+	sDefault = new(std::nothrow) DecompressedChunkCache(kDefaultMaxChunks);
+	if (sDefault == NULL)
+		return B_NO_MEMORY;
+
+	status_t error = sDefault->Init();
+	if (error != B_OK) {
+		delete sDefault;
+		sDefault = NULL;
+		return error;
+	}
+
+	add_debugger_command_etc("packagefs_chunk_cache", &dump_chunk_cache,
+		"Dump the packagefs decompressed chunk cache statistics",
+		"\n"
+		"Prints the hit rate and size of the packagefs decompressed chunk\n"
+		"cache.\n", 0);
+
+	return B_OK;
+}
+
+
+/*static*/ void
+DecompressedChunkCache::GlobalUninit()
+{
+	if (sDefault == NULL)
+		return;
+
+	remove_debugger_command("packagefs_chunk_cache", &dump_chunk_cache);
+
+	delete sDefault;
+	sDefault = NULL;
+}
+
+
+void*
+DecompressedChunkCache::AcquireChunk(const PackageFileHeapAccessorBase* heap,
+	size_t chunkIndex, const void*& _data)
+{
+	Key key = { heap, chunkIndex };
+
+	MutexLocker locker(fLock);
+
+	Chunk* chunk = fChunks.Lookup(key);
+	if (chunk == NULL) {
+		fMisses++;
+		return NULL;
+	}
+
+	fHits++;
+	chunk->referenceCount++;
+
+	// move to the end of the LRU list
+	fChunkList.Remove(chunk);
+	fChunkList.Add(chunk);
+
+	_data = chunk->data;
+	return chunk;
+}
+
+
+void
+DecompressedChunkCache::ReleaseChunk(void* cookie)
+{
+	Chunk* chunk = (Chunk*)cookie;
+
+	MutexLocker locker(fLock);
+
+	if (--chunk->referenceCount > 0 || !chunk->removed)
+		return;
+
+	// the chunk has been evicted while it was in use
+	locker.Unlock();
+
+	object_cache_free(fBufferCache, chunk->data, 0);
+	delete chunk;
+}
+
+
+void
+DecompressedChunkCache::InsertChunk(const PackageFileHeapAccessorBase* heap,
+	size_t chunkIndex, const void* data, size_t size)
+{
+	// Don't compete with more important users of memory. The uncached reads
+	// mostly happen when pages are already short, so only give up when it
+	// gets serious.
+	if (low_resource_state(B_KERNEL_RESOURCE_PAGES | B_KERNEL_RESOURCE_MEMORY)
+			>= B_LOW_RESOURCE_WARNING) {
+		return;
+	}
+
+	Chunk* chunk = new(std::nothrow) Chunk;
+	if (chunk == NULL)
+		return;
+
+	chunk->data = object_cache_alloc(fBufferCache,
+		CACHE_DONT_WAIT_FOR_MEMORY);
+	if (chunk->data == NULL) {
+		delete chunk;
+		return;
+	}
+
+	memcpy(chunk->data, data, size);
+	chunk->key.heap = heap;
+	chunk->key.chunkIndex = chunkIndex;
+	chunk->referenceCount = 0;
+	chunk->removed = false;
+
+	MutexLocker locker(fLock);
+
+	if (fChunks.Lookup(chunk->key) != NULL) {
+		// someone else was faster
+		locker.Unlock();
+		object_cache_free(fBufferCache, chunk->data, 0);
+		delete chunk;
+		return;
+	}
+
+	fChunks.InsertUnchecked(chunk);
+	fChunkList.Add(chunk);
+	fChunkCount++;
+	fInsertions++;
+
+	if (fChunkCount > fMaxChunks)
+		_Evict(fMaxChunks);
+}
+
+
+void
+DecompressedChunkCache::RemoveChunks(const PackageFileHeapAccessorBase* heap)
+{
+	ChunkList chunksToFree;
+
+	MutexLocker locker(fLock);
+
+	ChunkList::Iterator iterator = fChunkList.GetIterator();
+	while (Chunk* chunk = iterator.Next()) {
+		if (chunk->key.heap == heap)
+			_RemoveChunk(chunk, chunksToFree);
+	}
+
+	locker.Unlock();
+
+	_FreeChunks(chunksToFree);
+}
+
+
+void
+DecompressedChunkCache::Dump()
+{
+	int64 lookups = fHits + fMisses;
+
+	kprintf("packagefs decompressed chunk cache %p\n", this);
+	kprintf("  chunks:     %" B_PRIuSIZE " of %" B_PRIuSIZE " (%" B_PRIuSIZE
+		" KiB)\n", fChunkCount, fMaxChunks, fChunkCount * kChunkSize / 1024);
+	kprintf("  hits:       %" B_PRId64 " (%" B_PRId64 "%%)\n", fHits,
+		lookups > 0 ? fHits * 100 / lookups : 0);
+	kprintf("  misses:     %" B_PRId64 "\n", fMisses);
+	kprintf("  insertions: %" B_PRId64 "\n", fInsertions);
+	kprintf("  evictions:  %" B_PRId64 "\n", fEvictions);
+}
+
+
+/*!	Removes \a chunk from the cache. If it is not in use, it is added to
+	\a chunksToFree, otherwise the last ReleaseChunk() will free it.
+	The cache must be locked.
+*/
+void
+DecompressedChunkCache::_RemoveChunk(Chunk* chunk, ChunkList& chunksToFree)
+{
+	fChunks.RemoveUnchecked(chunk);
+	fChunkList.Remove(chunk);
+	fChunkCount--;
+
+	if (chunk->referenceCount > 0)
+		chunk->removed = true;
+	else
+		chunksToFree.Add(chunk);
+}
+
+
+/*!	Evicts the least recently used chunks until at most \a maxChunks are left.
+	The cache must be locked; it will be unlocked while the evicted chunks are
+	freed, and is locked again on return.
+*/
+void
+DecompressedChunkCache::_Evict(size_t maxChunks)
+{
+	ChunkList chunksToFree;
+
+	while (fChunkCount > maxChunks) {
+		_RemoveChunk(fChunkList.Head(), chunksToFree);
+		fEvictions++;
+	}
+
+	mutex_unlock(&fLock);
+	_FreeChunks(chunksToFree);
+	mutex_lock(&fLock);
+}
+
+
+void
+DecompressedChunkCache::_FreeChunks(ChunkList& chunks)
+{
+	while (Chunk* chunk = chunks.RemoveHead()) {
+		object_cache_free(fBufferCache, chunk->data, 0);
+		delete chunk;
+	}
+}
+
+
+/*static*/ void
+DecompressedChunkCache::_LowMemoryHandler(void* data, uint32 resources,
+	int32 level)
+{
+	DecompressedChunkCache* cache = (DecompressedChunkCache*)data;
+
+	MutexLocker locker(cache->fLock);
+
+	switch (level) {
+		case B_NO_LOW_RESOURCE:
+			return;
+		case B_LOW_RESOURCE_NOTE:
+			cache->_Evict(cache->fChunkCount / 2);
+			break;
+		case B_LOW_RESOURCE_WARNING:
+			cache->_Evict(cache->fChunkCount / 4);
+			break;
+		case B_LOW_RESOURCE_CRITICAL:
+			cache->_Evict(0);
+			break;
+	}
+
+	PRINT("DecompressedChunkCache: low memory level %" B_PRId32 ", %"
+		B_PRIuSIZE " chunks left\n", level, cache->fChunkCount);
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef DECOMPRESSED_CHUNK_CACHE_H
+#define DECOMPRESSED_CHUNK_CACHE_H
+
+
+#include <package/hpkg/PackageFileHeapAccessorBase.h>
+
+#include <lock.h>
+#include <slab/Slab.h>
+#include <util/DoublyLinkedList.h>
+#include <util/OpenHashTable.h>
+
+
+using BPackageKit::BHPKG::BPrivate::PackageFileHeapAccessorBase;
+
+
+class DecompressedChunkCache : public PackageFileHeapAccessorBase::ChunkCache {
+public:
+								DecompressedChunkCache(size_t maxChunks);
+	virtual						~DecompressedChunkCache();
+
+			status_t			Init();
+
+	static	status_t			GlobalInit();
+	static	void				GlobalUninit();
+	static	DecompressedChunkCache* Default()
+									{ return sDefault; }
+
+	virtual	void*				AcquireChunk(
+									const PackageFileHeapAccessorBase* heap,
+									size_t chunkIndex, const void*& _data);
+	virtual	void				ReleaseChunk(void* cookie);
+	virtual	void				InsertChunk(
+									const PackageFileHeapAccessorBase* heap,
+									size_t chunkIndex, const void* data,
+									size_t size);
+	virtual	void				RemoveChunks(
+									const PackageFileHeapAccessorBase* heap);
+
+			void				Dump();
+
+private:
+			struct Key {
+				const PackageFileHeapAccessorBase*	heap;
+				size_t								chunkIndex;
+			};
+
+			struct Chunk : DoublyLinkedListLinkImpl<Chunk> {
+				Chunk*			hashNext;
+				Key				key;
+				void*			data;
+				int32			referenceCount;
+				bool			removed;
+			};
+
+			struct ChunkHashDefinition {
+				typedef Key		KeyType;
+				typedef	Chunk	ValueType;
+
+				size_t HashKey(const Key& key) const
+				{
+					return (size_t)key.heap / sizeof(void*) * 31
+						+ key.chunkIndex;
+				}
+
+				size_t Hash(const Chunk* value) const
+				{
+					return HashKey(value->key);
+				}
+
+				bool Compare(const Key& key, const Chunk* value) const
+				{
+					return value->key.heap == key.heap
+						&& value->key.chunkIndex == key.chunkIndex;
+				}
+
+				Chunk*& GetLink(Chunk* value) const
+				{
+					return value->hashNext;
+				}
+			};
+
+			typedef BOpenHashTable<ChunkHashDefinition> ChunkTable;
+			typedef DoublyLinkedList<Chunk> ChunkList;
+
+private:
+			void				_RemoveChunk(Chunk* chunk,
+									ChunkList& chunksToFree);
+			void				_Evict(size_t maxChunks);
+			void				_FreeChunks(ChunkList& chunks);
+
+	static	void				_LowMemoryHandler(void* data,
+									uint32 resources, int32 level);
+
+private:
+			mutex				fLock;
+			object_cache*		fBufferCache;
+			ChunkTable			fChunks;
+			ChunkList			fChunkList;
+				// least recently used first
+			size_t				fChunkCount;
+			size_t				fMaxChunks;
+
+			int64				fHits;
+			int64				fMisses;
+			int64				fInsertions;
+			int64				fEvictions;
+
+	static	DecompressedChunkCache* sDefault;
+};
+
+
+#endif	// DECOMPRESSED_CHUNK_CACHE_H
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/stat.h>
 
 #include <package/hpkg/ErrorOutput.h>
 #include <package/hpkg/PackageDataReader.h>
@@ -24,6 +25,7 @@
 #include <util/AutoLock.h>
 
 #include "CachedDataReader.h"
+#include "DecompressedChunkCache.h"
 #include "DebugSupport.h"
 #include "PackageDirectory.h"
 #include "PackageFile.h"
@@ -417,6 +419,14 @@ public:
 		fHeapReader->SetErrorOutput(this);
 		fHeapReader->SetFile(this);
 
+		// Uncompressed heaps can be read directly, caching their chunks would
+		// only waste memory. Reads that go through the page cache don't use
+		// it either, see ReadUncachedDataToOutput().
+		if ((uint64)fHeapReader->CompressedHeapSize()
+				!= fHeapReader->UncompressedHeapSize()) {
+			fHeapReader->SetChunkCache(DecompressedChunkCache::Default());
+		}
+
 		status_t error = CachedDataReader::Init(fHeapReader,
 			fHeapReader->UncompressedHeapSize());
 		if (error != B_OK)
@@ -437,6 +447,18 @@ public:
 			.CreatePackageDataReader(this, data.DataV2(), _reader);
 	}
 
+protected:
+	// CachedDataReader
+
+	virtual status_t ReadUncachedDataToOutput(off_t offset, size_t size,
+		BDataIO* output)
+	{
+		// Only the data that doesn't end up in the page cache is kept in the
+		// chunk cache, so that small uncached reads don't have to decompress
+		// the same chunk over and over again.
+		return fHeapReader->ReadDataToOutput(offset, size, output, true);
+	}
+
 private:
 	// BErrorOutput
 
@@ -528,7 +550,9 @@ Package::Package(::Volume* volume, PackagesDirectory* directory, dev_t deviceID,
 	fOpenCount(0),
 	fHeapReader(NULL),
 	fNodeID(nodeID),
-	fDeviceID(deviceID)
+	fDeviceID(deviceID),
+	fSnapshotRecord(NULL),
+	fOwnsSnapshotRecord(false)
 {
 	mutex_init(&fLock, "packagefs package");
 
@@ -538,6 +562,8 @@ Package::Package(::Volume* volume, PackagesDirectory* directory, dev_t deviceID,
 
 Package::~Package()
 {
+	UnsetSnapshotRecord();
+
 	delete fHeapReader;
 
 	while (PackageNode* node = fNodes.RemoveHead())
@@ -567,10 +593,16 @@ Package::Init(const char* fileName)
 }
 
 
+/*!	Loads the package's content. If a \a snapshot is given, the content is
+	replayed from it, if it has a record for the package, or otherwise
+	recorded while parsing the package, so that it can be added to the next
+	snapshot.
+*/
 status_t
-Package::Load(const PackageSettings& settings)
+Package::Load(const PackageSettings& settings,
+	const PackagesSnapshot* snapshot)
 {
-	status_t error = _Load(settings);
+	status_t error = _Load(settings, snapshot);
 	if (error != B_OK)
 		return error;
 
@@ -617,6 +649,17 @@ Package::ArchitectureName() const
 }
 
 
+void
+Package::UnsetSnapshotRecord()
+{
+	if (fOwnsSnapshotRecord)
+		PackagesSnapshot::DeleteRecord(fSnapshotRecord);
+
+	fSnapshotRecord = NULL;
+	fOwnsSnapshotRecord = false;
+}
+
+
 void
 Package::AddNode(PackageNode* node)
 {
@@ -713,7 +756,8 @@ Package::CreateDataReader(const PackageData& data,
 
 
 status_t
-Package::_Load(const PackageSettings& settings)
+Package::_Load(const PackageSettings& settings,
+	const PackagesSnapshot* snapshot)
 {
 	// open package file
 	int fd = Open();
@@ -736,9 +780,15 @@ Package::_Load(const PackageSettings& settings)
 			if (error != B_OK)
 				RETURN_ERROR(error);
 
-			error = packageReader.ParseContent(&handler);
-			if (error != B_OK)
-				RETURN_ERROR(error);
+			if (snapshot == NULL) {
+				error = packageReader.ParseContent(&handler);
+				if (error != B_OK)
+					RETURN_ERROR(error);
+			} else {
+				error = _LoadContent(packageReader, handler, fd, snapshot);
+				if (error != B_OK)
+					RETURN_ERROR(error);
+			}
 
 			// get the heap reader
 			fHeapReader = packageReader.DetachCachedHeapReader();
@@ -754,6 +804,41 @@ Package::_Load(const PackageSettings& settings)
 }
 
 
+status_t
+Package::_LoadContent(CachingPackageReader& packageReader,
+	LoaderContentHandler& handler, int fd, const PackagesSnapshot* snapshot)
+{
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+		RETURN_ERROR(errno);
+
+	const PackagesSnapshot::Record* record
+		= snapshot->FindPackage(fFileName, st);
+	if (record != NULL) {
+		status_t error = PackagesSnapshot::Replay(record, &handler);
+		if (error != B_OK)
+			RETURN_ERROR(error);
+
+		fSnapshotRecord = record;
+		fOwnsSnapshotRecord = false;
+		return B_OK;
+	}
+
+	PackageSnapshotRecorder recorder(&handler);
+	status_t error = recorder.Init(fFileName, st);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	error = packageReader.ParseContent(&recorder);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	fSnapshotRecord = recorder.DetachRecord();
+	fOwnsSnapshotRecord = fSnapshotRecord != NULL;
+	return B_OK;
+}
+
+
 bool
 Package::_InitVersionedName()
 {
@@ -20,6 +20,7 @@
 
 #include "Dependency.h"
 #include "PackageNode.h"
+#include "PackagesSnapshot.h"
 #include "Resolvable.h"
 #include "String.h"
 
@@ -44,7 +45,8 @@ public:
 								~Package();
 
 			status_t			Init(const char* fileName);
-			status_t			Load(const PackageSettings& settings);
+			status_t			Load(const PackageSettings& settings,
+									const PackagesSnapshot* snapshot = NULL);
 
 			::Volume*			Volume() const		{ return fVolume; }
 			const String&		FileName() const	{ return fFileName; }
@@ -107,6 +109,13 @@ public:
 			const DependencyList& Dependencies() const
 									{ return fDependencies; }
 
+			const PackagesSnapshot::Record* SnapshotRecord() const
+									{ return fSnapshotRecord; }
+			bool				LoadedFromSnapshot() const
+									{ return fSnapshotRecord != NULL
+										&& !fOwnsSnapshotRecord; }
+			void				UnsetSnapshotRecord();
+
 private:
 			struct LoaderErrorOutput;
 			struct LoaderContentHandler;
@@ -117,7 +126,12 @@ private:
 			struct CachingPackageReader;
 
 private:
-			status_t			_Load(const PackageSettings& settings);
+			status_t			_Load(const PackageSettings& settings,
+									const PackagesSnapshot* snapshot);
+			status_t			_LoadContent(
+									CachingPackageReader& packageReader,
+									LoaderContentHandler& handler, int fd,
+									const PackagesSnapshot* snapshot);
 			bool				_InitVersionedName();
 
 private:
@@ -141,6 +155,8 @@ private:
 			PackageNodeList		fNodes;
 			ResolvableList		fResolvables;
 			DependencyList		fDependencies;
+			const PackagesSnapshot::Record* fSnapshotRecord;
+			bool				fOwnsSnapshotRecord;
 };
 
 
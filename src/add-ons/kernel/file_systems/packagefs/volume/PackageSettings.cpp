@@ -18,6 +18,7 @@
 
 static const char* const kBlockedEntriesParameterName = "BlockedEntries";
 static const char* const kLegacyBlockedEntriesParameterName = "EntryBlacklist";
+static const char* const kNodeSnapshotParameterName = "NodeSnapshot";
 
 
 // #pragma mark - PackageSettingsItem
@@ -154,7 +155,8 @@ PackageSettingsItem::_AddBlockedEntries(const driver_parameter& parameter)
 
 PackageSettings::PackageSettings()
 	:
-	fPackageItems()
+	fPackageItems(),
+	fUseNodeSnapshot(false)
 {
 }
 
@@ -220,6 +222,9 @@ PackageSettings::Load(dev_t mountPointDeviceID, ino_t mountPointNodeID,
 	if (!settingsHandle.IsSet())
 		return B_ENTRY_NOT_FOUND;
 
+	fUseNodeSnapshot = get_driver_boolean_parameter(settingsHandle.Get(),
+		kNodeSnapshotParameterName, false, true);
+
 	const driver_settings* settings
 		= get_driver_settings(settingsHandle.Get());
 	for (int i = 0; i < settings->parameter_count; i++) {
@@ -197,6 +197,9 @@ public:
 
 			const PackageSettingsItem* PackageItemFor(const String& name) const;
 
+			bool				UseNodeSnapshot() const
+									{ return fUseNodeSnapshot; }
+
 private:
 			typedef BOpenHashTable<PackageSettingsItemHashDefinition>
 				PackageItemTable;
@@ -208,6 +211,7 @@ private:
 
 private:
 			PackageItemTable	fPackageItems;
+			bool				fUseNodeSnapshot;
 };
 
 
@@ -0,0 +1,979 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "PackagesSnapshot.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <new>
+
+#include <package/hpkg/PackageEntry.h>
+#include <package/hpkg/PackageEntryAttribute.h>
+
+#include <AutoDeleter.h>
+#include <syscalls.h>
+#include <util/StringHash.h>
+
+#include "DebugSupport.h"
+
+
+using namespace BPackageKit;
+
+
+static const uint32 kSnapshotMagic = 'pfsn';
+static const uint32 kSnapshotVersion = 1;
+
+// sanity limit for the snapshot file size
+static const size_t kMaxSnapshotSize = 64 * 1024 * 1024;
+
+static const uint64 kFNVOffsetBasis = 0xcbf29ce484222325ULL;
+static const uint64 kFNVPrime = 0x100000001b3ULL;
+
+static const uint16 kNullStringLength = 0xffff;
+
+
+enum {
+	RECORD_PACKAGE_ATTRIBUTE	= 1,
+	RECORD_ENTRY,
+	RECORD_ENTRY_ATTRIBUTE,
+	RECORD_ENTRY_DONE
+};
+
+
+struct snapshot_header {
+	uint32	magic;
+	uint32	version;
+	uint64	key;
+	uint64	checksum;
+		// of everything following the header
+	uint64	size;
+		// of the whole file
+	uint32	package_count;
+	uint32	reserved;
+};
+
+
+/*!	The recorded content of a package. The header is followed by the
+	null-terminated file name of the package, and then by the recorded
+	content handler calls. The size is a multiple of 8, so that the records
+	can directly follow each other in the snapshot file.
+*/
+struct PackagesSnapshot::Record {
+	uint64	size;
+		// including the header and the name
+	int64	nodeID;
+	int64	fileSize;
+	int64	modifiedTime;
+	int32	modifiedTimeNanos;
+	uint16	nameLength;
+	uint16	reserved;
+
+	const char* Name() const
+	{
+		return (const char*)(this + 1);
+	}
+
+	const uint8* Data() const
+	{
+		return (const uint8*)Name() + nameLength + 1;
+	}
+
+	const uint8* DataEnd() const
+	{
+		return (const uint8*)this + size;
+	}
+};
+
+
+struct PackagesSnapshot::RecordEntry {
+	const Record*	record;
+	RecordEntry*	hashNext;
+};
+
+
+struct PackagesSnapshot::RecordHashDefinition {
+	typedef const char*	KeyType;
+	typedef	RecordEntry	ValueType;
+
+	size_t HashKey(const char* key) const
+	{
+		return hash_hash_string(key);
+	}
+
+	size_t Hash(const RecordEntry* value) const
+	{
+		return HashKey(value->record->Name());
+	}
+
+	bool Compare(const char* key, const RecordEntry* value) const
+	{
+		return strcmp(value->record->Name(), key) == 0;
+	}
+
+	RecordEntry*& GetLink(RecordEntry* value) const
+	{
+		return value->hashNext;
+	}
+};
+
+
+// #pragma mark - SnapshotReader
+
+
+struct SnapshotReader {
+	SnapshotReader(const uint8* data, const uint8* end)
+		:
+		fData(data),
+		fEnd(end)
+	{
+	}
+
+	bool IsAtEnd() const
+	{
+		return fData == fEnd;
+	}
+
+	bool Read(void* buffer, size_t size)
+	{
+		if ((size_t)(fEnd - fData) < size)
+			return false;
+
+		memcpy(buffer, fData, size);
+		fData += size;
+		return true;
+	}
+
+	template<typename Type>
+	bool Read(Type& _value)
+	{
+		return Read(&_value, sizeof(_value));
+	}
+
+	bool ReadString(const char*& _string)
+	{
+		uint16 length;
+		if (!Read(length))
+			return false;
+
+		if (length == kNullStringLength) {
+			_string = NULL;
+			return true;
+		}
+
+		if ((size_t)(fEnd - fData) <= length || fData[length] != '\0')
+			return false;
+
+		_string = (const char*)fData;
+		fData += length + 1;
+		return true;
+	}
+
+	bool ReadData(BPackageData& data)
+	{
+		uint8 encodedInline;
+		uint64 size;
+		if (!Read(encodedInline) || !Read(size))
+			return false;
+
+		if (encodedInline != 0) {
+			if (size > BHPKG::B_HPKG_MAX_INLINE_DATA_SIZE
+				|| (size_t)(fEnd - fData) < size) {
+				return false;
+			}
+
+			data.SetData((uint8)size, fData);
+			fData += size;
+			return true;
+		}
+
+		uint64 offset;
+		if (!Read(offset))
+			return false;
+
+		data.SetData(size, offset);
+		return true;
+	}
+
+	bool ReadVersion(BPackageVersionData& version)
+	{
+		return ReadString(version.major) && ReadString(version.minor)
+			&& ReadString(version.micro) && ReadString(version.preRelease)
+			&& Read(version.revision);
+	}
+
+	bool ReadPackageAttribute(BPackageInfoAttributeValue& value)
+	{
+		uint8 id;
+		if (!Read(id))
+			return false;
+
+		value.attributeID = (BPackageInfoAttributeID)id;
+
+		switch (id) {
+			case B_PACKAGE_INFO_NAME:
+			case B_PACKAGE_INFO_INSTALL_PATH:
+				return ReadString(value.string);
+
+			case B_PACKAGE_INFO_VERSION:
+				return ReadVersion(value.version);
+
+			case B_PACKAGE_INFO_FLAGS:
+			case B_PACKAGE_INFO_ARCHITECTURE:
+				return Read(value.unsignedInt);
+
+			case B_PACKAGE_INFO_PROVIDES:
+			{
+				uint8 haveVersion;
+				uint8 haveCompatibleVersion;
+				if (!ReadString(value.resolvable.name) || !Read(haveVersion)
+					|| !Read(haveCompatibleVersion)) {
+					return false;
+				}
+
+				value.resolvable.haveVersion = haveVersion != 0;
+				value.resolvable.haveCompatibleVersion
+					= haveCompatibleVersion != 0;
+
+				return (haveVersion == 0
+						|| ReadVersion(value.resolvable.version))
+					&& (haveCompatibleVersion == 0
+						|| ReadVersion(value.resolvable.compatibleVersion));
+			}
+
+			case B_PACKAGE_INFO_REQUIRES:
+			{
+				uint8 haveOpAndVersion;
+				if (!ReadString(value.resolvableExpression.name)
+					|| !Read(haveOpAndVersion)) {
+					return false;
+				}
+
+				value.resolvableExpression.haveOpAndVersion
+					= haveOpAndVersion != 0;
+				if (haveOpAndVersion == 0)
+					return true;
+
+				uint32 op;
+				if (!Read(op))
+					return false;
+				value.resolvableExpression.op = (BPackageResolvableOperator)op;
+
+				return ReadVersion(value.resolvableExpression.version);
+			}
+
+			default:
+				return false;
+		}
+	}
+
+private:
+	const uint8*	fData;
+	const uint8*	fEnd;
+};
+
+
+// #pragma mark - helper functions
+
+
+static uint64
+fnv1a_hash(uint64 hash, const void* _data, size_t size)
+{
+	const uint8* data = (const uint8*)_data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= data[i];
+		hash *= kFNVPrime;
+	}
+
+	return hash;
+}
+
+
+static status_t
+write_fully(int fd, const void* _buffer, size_t size)
+{
+	const uint8* buffer = (const uint8*)_buffer;
+	while (size > 0) {
+		ssize_t bytesWritten = write(fd, buffer, size);
+		if (bytesWritten < 0)
+			return errno;
+		if (bytesWritten == 0)
+			return B_IO_ERROR;
+
+		buffer += bytesWritten;
+		size -= bytesWritten;
+	}
+
+	return B_OK;
+}
+
+
+// #pragma mark - PackagesSnapshot
+
+
+PackagesSnapshot::PackagesSnapshot()
+	:
+	fData(NULL),
+	fSize(0),
+	fRecordEntries(NULL),
+	fRecords(NULL),
+	fPackageCount(0)
+{
+}
+
+
+PackagesSnapshot::~PackagesSnapshot()
+{
+	_Unset();
+}
+
+
+/*!	Loads the snapshot file at \a path relative to \a directoryFD. If it
+	doesn't exist, or hasn't been written for the packages identified by
+	\a key, the snapshot remains empty.
+*/
+status_t
+PackagesSnapshot::Load(int directoryFD, const char* path, uint64 key)
+{
+	_Unset();
+
+	FileDescriptorCloser fd(openat(directoryFD, path, O_RDONLY));
+	if (!fd.IsSet())
+		return errno;
+
+	struct stat st;
+	if (fstat(fd.Get(), &st) != 0)
+		return errno;
+
+	if (st.st_size < (off_t)sizeof(snapshot_header)
+		|| st.st_size > (off_t)kMaxSnapshotSize) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	fData = (uint8*)malloc(st.st_size);
+	if (fData == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	fSize = st.st_size;
+
+	ssize_t bytesRead = read(fd.Get(), fData, fSize);
+	if (bytesRead < 0 || (size_t)bytesRead != fSize) {
+		_Unset();
+		RETURN_ERROR(bytesRead < 0 ? errno : B_IO_ERROR);
+	}
+
+	// check the header
+	const snapshot_header* header = (const snapshot_header*)fData;
+	if (header->magic != kSnapshotMagic || header->version != kSnapshotVersion
+		|| header->size != fSize) {
+		_Unset();
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	if (header->key != key) {
+		// written for a different set of packages
+		_Unset();
+		return B_MISMATCHED_VALUES;
+	}
+
+	if (fnv1a_hash(kFNVOffsetBasis, header + 1, fSize - sizeof(*header))
+			!= header->checksum) {
+		_Unset();
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	// index the package records
+	int32 packageCount = header->package_count;
+	if (packageCount > (int32)(fSize / sizeof(Record))) {
+		_Unset();
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	fRecordEntries = new(std::nothrow) RecordEntry[packageCount];
+	fRecords = new(std::nothrow) RecordTable;
+	if (fRecordEntries == NULL || fRecords == NULL
+		|| fRecords->Init(packageCount) != B_OK) {
+		_Unset();
+		RETURN_ERROR(B_NO_MEMORY);
+	}
+
+	size_t offset = sizeof(snapshot_header);
+	for (int32 i = 0; i < packageCount; i++) {
+		const Record* record = (const Record*)(fData + offset);
+		if (fSize - offset < sizeof(Record)
+			|| record->size % 8 != 0
+			|| record->size > fSize - offset
+			|| record->size <= sizeof(Record) + record->nameLength
+			|| record->Name()[record->nameLength] != '\0'
+			|| fRecords->Lookup(record->Name()) != NULL) {
+			_Unset();
+			RETURN_ERROR(B_BAD_DATA);
+		}
+
+		fRecordEntries[i].record = record;
+		fRecords->InsertUnchecked(&fRecordEntries[i]);
+		offset += record->size;
+	}
+
+	if (offset != fSize) {
+		_Unset();
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	fPackageCount = packageCount;
+	return B_OK;
+}
+
+
+/*!	Returns the record for the package file \a fileName, if the snapshot
+	has one and the file hasn't changed since, \c NULL otherwise.
+*/
+const PackagesSnapshot::Record*
+PackagesSnapshot::FindPackage(const char* fileName,
+	const struct stat& st) const
+{
+	if (fRecords == NULL)
+		return NULL;
+
+	RecordEntry* entry = fRecords->Lookup(fileName);
+	if (entry == NULL)
+		return NULL;
+
+	const Record* record = entry->record;
+	if (record->nodeID != st.st_ino || record->fileSize != st.st_size
+		|| record->modifiedTime != st.st_mtim.tv_sec
+		|| record->modifiedTimeNanos != st.st_mtim.tv_nsec) {
+		return NULL;
+	}
+
+	return record;
+}
+
+
+/*!	Replays the content handler calls recorded in \a record to \a handler.
+	Returns \c B_BAD_DATA, if the record is corrupt; the handler may have
+	been called for some of the package's content at that point already.
+*/
+/*static*/ status_t
+PackagesSnapshot::Replay(const Record* record, BPackageContentHandler* handler)
+{
+	// BPackageEntry doesn't have a default constructor, so we construct the
+	// entries of the current path in a raw buffer.
+	void* entryBuffer = malloc(kMaxEntryDepth * sizeof(BPackageEntry));
+	if (entryBuffer == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	MemoryDeleter entryBufferDeleter(entryBuffer);
+	BPackageEntry* entries = (BPackageEntry*)entryBuffer;
+
+	SnapshotReader reader(record->Data(), record->DataEnd());
+	int32 depth = 0;
+	status_t error = B_OK;
+
+	while (error == B_OK && !reader.IsAtEnd()) {
+		uint8 type;
+		if (!reader.Read(type)) {
+			error = B_BAD_DATA;
+			break;
+		}
+
+		if (type == 0) {
+			// padding -- the rest must be padding as well
+			while (reader.Read(type) && type == 0)
+				;
+			if (!reader.IsAtEnd())
+				error = B_BAD_DATA;
+			break;
+		}
+
+		switch (type) {
+			case RECORD_PACKAGE_ATTRIBUTE:
+			{
+				BPackageInfoAttributeValue value;
+				if (!reader.ReadPackageAttribute(value)) {
+					error = B_BAD_DATA;
+					break;
+				}
+
+				error = handler->HandlePackageAttribute(value);
+				break;
+			}
+
+			case RECORD_ENTRY:
+			{
+				const char* name;
+				uint32 mode;
+				uint32 modifiedTime;
+				uint32 modifiedTimeNanos;
+				if (depth == kMaxEntryDepth || !reader.ReadString(name)
+					|| name == NULL || !reader.Read(mode)
+					|| !reader.Read(modifiedTime)
+					|| !reader.Read(modifiedTimeNanos)) {
+					error = B_BAD_DATA;
+					break;
+				}
+
+				BPackageEntry* entry = new(&entries[depth]) BPackageEntry(
+					depth > 0 ? &entries[depth - 1] : NULL, name);
+				entry->SetType(mode);
+				entry->SetPermissions(mode);
+				entry->SetModifiedTime(modifiedTime);
+				entry->SetModifiedTimeNanos(modifiedTimeNanos);
+
+				if (!reader.ReadData(entry->Data())) {
+					error = B_BAD_DATA;
+					break;
+				}
+
+				if (S_ISLNK(mode)) {
+					const char* symlinkPath;
+					if (!reader.ReadString(symlinkPath)) {
+						error = B_BAD_DATA;
+						break;
+					}
+					entry->SetSymlinkPath(symlinkPath);
+				}
+
+				depth++;
+				error = handler->HandleEntry(entry);
+				break;
+			}
+
+			case RECORD_ENTRY_ATTRIBUTE:
+			{
+				const char* name;
+				uint32 attributeType;
+				if (depth == 0 || !reader.ReadString(name) || name == NULL
+					|| !reader.Read(attributeType)) {
+					error = B_BAD_DATA;
+					break;
+				}
+
+				BPackageEntryAttribute attribute(name);
+				attribute.SetType(attributeType);
+				if (!reader.ReadData(attribute.Data())) {
+					error = B_BAD_DATA;
+					break;
+				}
+
+				error = handler->HandleEntryAttribute(&entries[depth - 1],
+					&attribute);
+				break;
+			}
+
+			case RECORD_ENTRY_DONE:
+				if (depth == 0) {
+					error = B_BAD_DATA;
+					break;
+				}
+
+				depth--;
+				error = handler->HandleEntryDone(&entries[depth]);
+				break;
+
+			default:
+				error = B_BAD_DATA;
+				break;
+		}
+	}
+
+	if (error == B_OK && depth != 0)
+		error = B_BAD_DATA;
+
+	if (error != B_OK) {
+		handler->HandleErrorOccurred();
+		RETURN_ERROR(error);
+	}
+
+	return B_OK;
+}
+
+
+/*static*/ void
+PackagesSnapshot::DeleteRecord(const Record* record)
+{
+	free((void*)record);
+}
+
+
+/*!	Writes a snapshot with the given package records to \a path relative to
+	\a directoryFD. The file is written under a temporary name first and then
+	renamed, so that a crash cannot leave a partially written snapshot.
+*/
+/*static*/ status_t
+PackagesSnapshot::Write(int directoryFD, const char* path, uint64 key,
+	const Record* const* records, int32 count)
+{
+	snapshot_header header;
+	memset(&header, 0, sizeof(header));
+	header.magic = kSnapshotMagic;
+	header.version = kSnapshotVersion;
+	header.key = key;
+	header.checksum = kFNVOffsetBasis;
+	header.size = sizeof(header);
+	header.package_count = count;
+
+	for (int32 i = 0; i < count; i++) {
+		header.checksum = fnv1a_hash(header.checksum, records[i],
+			records[i]->size);
+		header.size += records[i]->size;
+	}
+
+	if (header.size > kMaxSnapshotSize)
+		RETURN_ERROR(B_FILE_TOO_LARGE);
+
+	char tempPath[B_PATH_NAME_LENGTH];
+	if (snprintf(tempPath, sizeof(tempPath), "%s.new", path)
+			>= (int)sizeof(tempPath)) {
+		RETURN_ERROR(B_NAME_TOO_LONG);
+	}
+
+	FileDescriptorCloser fd(openat(directoryFD, tempPath,
+		O_WRONLY | O_CREAT | O_TRUNC, 0644));
+	if (!fd.IsSet())
+		RETURN_ERROR(errno);
+
+	status_t error = write_fully(fd.Get(), &header, sizeof(header));
+	for (int32 i = 0; error == B_OK && i < count; i++)
+		error = write_fully(fd.Get(), records[i], records[i]->size);
+
+	if (error == B_OK && fsync(fd.Get()) != 0)
+		error = errno;
+
+	fd.Unset();
+
+	if (error == B_OK)
+		error = _kern_rename(directoryFD, tempPath, directoryFD, path);
+
+	if (error != B_OK) {
+		unlinkat(directoryFD, tempPath, 0);
+		RETURN_ERROR(error);
+	}
+
+	return B_OK;
+}
+
+
+/*!	Adds the package file name \a fileName to the snapshot key \a key. The
+	key of a set of packages is computed by starting with 0 and adding the
+	file names of all packages in order.
+*/
+/*static*/ uint64
+PackagesSnapshot::UpdateKey(uint64 key, const char* fileName)
+{
+	if (key == 0)
+		key = kFNVOffsetBasis;
+
+	return fnv1a_hash(key, fileName, strlen(fileName) + 1);
+}
+
+
+void
+PackagesSnapshot::_Unset()
+{
+	delete fRecords;
+	fRecords = NULL;
+
+	delete[] fRecordEntries;
+	fRecordEntries = NULL;
+
+	free(fData);
+	fData = NULL;
+	fSize = 0;
+	fPackageCount = 0;
+}
+
+
+// #pragma mark - PackageSnapshotRecorder
+
+
+PackageSnapshotRecorder::PackageSnapshotRecorder(
+	BPackageContentHandler* handler)
+	:
+	fHandler(handler),
+	fBuffer(NULL),
+	fSize(0),
+	fCapacity(0),
+	fDepth(0),
+	fFailed(false)
+{
+}
+
+
+PackageSnapshotRecorder::~PackageSnapshotRecorder()
+{
+	free(fBuffer);
+}
+
+
+status_t
+PackageSnapshotRecorder::Init(const char* fileName, const struct stat& st)
+{
+	size_t nameLength = strlen(fileName);
+	if (nameLength >= kNullStringLength)
+		RETURN_ERROR(B_NAME_TOO_LONG);
+
+	PackagesSnapshot::Record record;
+	memset(&record, 0, sizeof(record));
+	record.nodeID = st.st_ino;
+	record.fileSize = st.st_size;
+	record.modifiedTime = st.st_mtim.tv_sec;
+	record.modifiedTimeNanos = st.st_mtim.tv_nsec;
+	record.nameLength = nameLength;
+
+	_Write(&record, sizeof(record));
+	_Write(fileName, nameLength + 1);
+
+	return fFailed ? B_NO_MEMORY : B_OK;
+}
+
+
+/*!	Returns the complete record of the package, which must be deleted with
+	PackagesSnapshot::DeleteRecord(), or \c NULL, if something couldn't be
+	recorded.
+*/
+PackagesSnapshot::Record*
+PackageSnapshotRecorder::DetachRecord()
+{
+	if (fFailed || fDepth != 0 || fBuffer == NULL)
+		return NULL;
+
+	static const uint8 kPadding[8] = {};
+	_Write(kPadding, (8 - fSize % 8) % 8);
+	if (fFailed)
+		return NULL;
+
+	PackagesSnapshot::Record* record = (PackagesSnapshot::Record*)fBuffer;
+	record->size = fSize;
+
+	fBuffer = NULL;
+	fSize = 0;
+	fCapacity = 0;
+	return record;
+}
+
+
+status_t
+PackageSnapshotRecorder::HandleEntry(BPackageEntry* entry)
+{
+	if (!fFailed) {
+		if (fDepth == PackagesSnapshot::kMaxEntryDepth
+			|| entry->Parent() != (fDepth > 0 ? fEntries[fDepth - 1] : NULL)) {
+			fFailed = true;
+		} else {
+			_WriteUInt8(RECORD_ENTRY);
+			_WriteString(entry->Name());
+			_WriteUInt32(entry->Mode());
+			_WriteUInt32(entry->ModifiedTime().tv_sec);
+			_WriteUInt32(entry->ModifiedTime().tv_nsec);
+			_WriteData(entry->Data());
+			if (S_ISLNK(entry->Mode()))
+				_WriteString(entry->SymlinkPath());
+
+			fEntries[fDepth++] = entry;
+		}
+	}
+
+	return fHandler->HandleEntry(entry);
+}
+
+
+status_t
+PackageSnapshotRecorder::HandleEntryAttribute(BPackageEntry* entry,
+	BPackageEntryAttribute* attribute)
+{
+	if (!fFailed) {
+		if (fDepth == 0 || entry != fEntries[fDepth - 1]) {
+			fFailed = true;
+		} else {
+			_WriteUInt8(RECORD_ENTRY_ATTRIBUTE);
+			_WriteString(attribute->Name());
+			_WriteUInt32(attribute->Type());
+			_WriteData(attribute->Data());
+		}
+	}
+
+	return fHandler->HandleEntryAttribute(entry, attribute);
+}
+
+
+status_t
+PackageSnapshotRecorder::HandleEntryDone(BPackageEntry* entry)
+{
+	if (!fFailed) {
+		if (fDepth == 0 || entry != fEntries[fDepth - 1]) {
+			fFailed = true;
+		} else {
+			_WriteUInt8(RECORD_ENTRY_DONE);
+			fDepth--;
+		}
+	}
+
+	return fHandler->HandleEntryDone(entry);
+}
+
+
+status_t
+PackageSnapshotRecorder::HandlePackageAttribute(
+	const BPackageInfoAttributeValue& value)
+{
+	// Only record the attributes Package's content handler is interested in.
+	switch (value.attributeID) {
+		case B_PACKAGE_INFO_NAME:
+		case B_PACKAGE_INFO_INSTALL_PATH:
+			_WriteUInt8(RECORD_PACKAGE_ATTRIBUTE);
+			_WriteUInt8(value.attributeID);
+			_WriteString(value.string);
+			break;
+
+		case B_PACKAGE_INFO_VERSION:
+			_WriteUInt8(RECORD_PACKAGE_ATTRIBUTE);
+			_WriteUInt8(value.attributeID);
+			_WriteVersion(value.version);
+			break;
+
+		case B_PACKAGE_INFO_FLAGS:
+		case B_PACKAGE_INFO_ARCHITECTURE:
+			_WriteUInt8(RECORD_PACKAGE_ATTRIBUTE);
+			_WriteUInt8(value.attributeID);
+			_WriteUInt64(value.unsignedInt);
+			break;
+
+		case B_PACKAGE_INFO_PROVIDES:
+			_WriteUInt8(RECORD_PACKAGE_ATTRIBUTE);
+			_WriteUInt8(value.attributeID);
+			_WriteString(value.resolvable.name);
+			_WriteUInt8(value.resolvable.haveVersion);
+			_WriteUInt8(value.resolvable.haveCompatibleVersion);
+			if (value.resolvable.haveVersion)
+				_WriteVersion(value.resolvable.version);
+			if (value.resolvable.haveCompatibleVersion)
+				_WriteVersion(value.resolvable.compatibleVersion);
+			break;
+
+		case B_PACKAGE_INFO_REQUIRES:
+			_WriteUInt8(RECORD_PACKAGE_ATTRIBUTE);
+			_WriteUInt8(value.attributeID);
+			_WriteString(value.resolvableExpression.name);
+			_WriteUInt8(value.resolvableExpression.haveOpAndVersion);
+			if (value.resolvableExpression.haveOpAndVersion) {
+				_WriteUInt32(value.resolvableExpression.op);
+				_WriteVersion(value.resolvableExpression.version);
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	return fHandler->HandlePackageAttribute(value);
+}
+
+
+void
+PackageSnapshotRecorder::HandleErrorOccurred()
+{
+	fFailed = true;
+	fHandler->HandleErrorOccurred();
+}
+
+
+void
+PackageSnapshotRecorder::_Write(const void* data, size_t size)
+{
+	if (fFailed)
+		return;
+
+	if (fCapacity - fSize < size) {
+		size_t capacity = fCapacity > 0 ? fCapacity : 16 * 1024;
+		while (capacity - fSize < size)
+			capacity *= 2;
+
+		if (capacity > kMaxSnapshotSize) {
+			fFailed = true;
+			return;
+		}
+
+		uint8* buffer = (uint8*)realloc(fBuffer, capacity);
+		if (buffer == NULL) {
+			fFailed = true;
+			return;
+		}
+
+		fBuffer = buffer;
+		fCapacity = capacity;
+	}
+
+	memcpy(fBuffer + fSize, data, size);
+	fSize += size;
+}
+
+
+void
+PackageSnapshotRecorder::_WriteUInt8(uint8 value)
+{
+	_Write(&value, sizeof(value));
+}
+
+
+void
+PackageSnapshotRecorder::_WriteUInt32(uint32 value)
+{
+	_Write(&value, sizeof(value));
+}
+
+
+void
+PackageSnapshotRecorder::_WriteUInt64(uint64 value)
+{
+	_Write(&value, sizeof(value));
+}
+
+
+void
+PackageSnapshotRecorder::_WriteString(const char* string)
+{
+	if (string == NULL) {
+		uint16 length = kNullStringLength;
+		_Write(&length, sizeof(length));
+		return;
+	}
+
+	size_t length = strlen(string);
+	if (length >= kNullStringLength) {
+		fFailed = true;
+		return;
+	}
+
+	uint16 length16 = length;
+	_Write(&length16, sizeof(length16));
+	_Write(string, length + 1);
+}
+
+
+void
+PackageSnapshotRecorder::_WriteData(const BPackageData& data)
+{
+	_WriteUInt8(data.IsEncodedInline());
+	_WriteUInt64(data.Size());
+	if (data.IsEncodedInline())
+		_Write(data.InlineData(), data.Size());
+	else
+		_WriteUInt64(data.Offset());
+}
+
+
+void
+PackageSnapshotRecorder::_WriteVersion(const BPackageVersionData& version)
+{
+	_WriteString(version.major);
+	_WriteString(version.minor);
+	_WriteString(version.micro);
+	_WriteString(version.preRelease);
+	_WriteUInt32(version.revision);
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef PACKAGES_SNAPSHOT_H
+#define PACKAGES_SNAPSHOT_H
+
+
+#include <sys/stat.h>
+
+#include <package/hpkg/PackageContentHandler.h>
+#include <package/hpkg/PackageData.h>
+#include <package/hpkg/PackageInfoAttributeValue.h>
+
+#include <util/OpenHashTable.h>
+
+
+using BPackageKit::BHPKG::BPackageContentHandler;
+using BPackageKit::BHPKG::BPackageData;
+using BPackageKit::BHPKG::BPackageEntry;
+using BPackageKit::BHPKG::BPackageEntryAttribute;
+using BPackageKit::BHPKG::BPackageInfoAttributeValue;
+using BPackageKit::BHPKG::BPackageVersionData;
+
+
+/*!	A snapshot of the contents of the initial packages of a volume, as
+	delivered by the package reader to Package's content handler.
+
+	The snapshot is only valid for the set of packages it has been written
+	for, which is identified by a key computed from the package file names.
+	Each package in it is additionally identified by the node ID, size, and
+	modification time of its file. Loading a package from the snapshot means
+	replaying the recorded content handler calls, which saves reading,
+	decompressing, and parsing the package's TOC.
+*/
+class PackagesSnapshot {
+public:
+			struct Record;
+
+	static	const int32			kMaxEntryDepth = 64;
+
+public:
+								PackagesSnapshot();
+								~PackagesSnapshot();
+
+			status_t			Load(int directoryFD, const char* path,
+									uint64 key);
+			int32				CountPackages() const
+									{ return fPackageCount; }
+
+			const Record*		FindPackage(const char* fileName,
+									const struct stat& st) const;
+
+	static	status_t			Replay(const Record* record,
+									BPackageContentHandler* handler);
+	static	void				DeleteRecord(const Record* record);
+
+	static	status_t			Write(int directoryFD, const char* path,
+									uint64 key, const Record* const* records,
+									int32 count);
+
+	static	uint64				UpdateKey(uint64 key, const char* fileName);
+
+private:
+			struct RecordEntry;
+			struct RecordHashDefinition;
+
+			typedef BOpenHashTable<RecordHashDefinition> RecordTable;
+
+private:
+			void				_Unset();
+
+private:
+			uint8*				fData;
+			size_t				fSize;
+			RecordEntry*		fRecordEntries;
+			RecordTable*		fRecords;
+			int32				fPackageCount;
+};
+
+
+/*!	Forwards the content handler calls for a package to another handler and
+	records them for a snapshot.
+*/
+class PackageSnapshotRecorder : public BPackageContentHandler {
+public:
+								PackageSnapshotRecorder(
+									BPackageContentHandler* handler);
+	virtual						~PackageSnapshotRecorder();
+
+			status_t			Init(const char* fileName,
+									const struct stat& st);
+
+			PackagesSnapshot::Record* DetachRecord();
+									// NULL, if recording failed
+
+	virtual	status_t			HandleEntry(BPackageEntry* entry);
+	virtual	status_t			HandleEntryAttribute(BPackageEntry* entry,
+									BPackageEntryAttribute* attribute);
+	virtual	status_t			HandleEntryDone(BPackageEntry* entry);
+	virtual	status_t			HandlePackageAttribute(
+									const BPackageInfoAttributeValue& value);
+	virtual	void				HandleErrorOccurred();
+
+private:
+			void				_Write(const void* data, size_t size);
+			void				_WriteUInt8(uint8 value);
+			void				_WriteUInt32(uint32 value);
+			void				_WriteUInt64(uint64 value);
+			void				_WriteString(const char* string);
+			void				_WriteData(const BPackageData& data);
+			void				_WriteVersion(
+									const BPackageVersionData& version);
+
+private:
+			BPackageContentHandler* fHandler;
+			uint8*				fBuffer;
+			size_t				fSize;
+			size_t				fCapacity;
+			BPackageEntry*		fEntries[
+									PackagesSnapshot::kMaxEntryDepth];
+			int32				fDepth;
+			bool				fFailed;
+};
+
+
+#endif	// PACKAGES_SNAPSHOT_H
@@ -26,6 +26,8 @@
 #include <AutoDeleterDrivers.h>
 #include <PackagesDirectoryDefs.h>
 
+#include <smp.h>
+#include <util/Vector.h>
 #include <vfs.h>
 
 #include "AttributeIndex.h"
@@ -63,6 +65,9 @@ const size_t kMaxActivationRequestSize = 10 * 1024 * 1024;
 // sanity limit for activation file size
 const size_t kMaxActivationFileSize = 10 * 1024 * 1024;
 
+// maximum number of threads loading the initial packages
+static const int32 kMaxPackageLoaderThreads = 8;
+
 static const char* const kAdministrativeDirectoryName
 	= PACKAGES_DIRECTORY_ADMIN_DIRECTORY;
 static const char* const kActivationFileName
@@ -70,6 +75,8 @@ static const char* const kActivationFileName
 static const char* const kActivationFilePath
 	= PACKAGES_DIRECTORY_ADMIN_DIRECTORY "/"
 		PACKAGES_DIRECTORY_ACTIVATION_FILE;
+static const char* const kNodeSnapshotPath
+	= PACKAGES_DIRECTORY_ADMIN_DIRECTORY "/packagefs-node-snapshot";
 
 
 // #pragma mark - ShineThroughDirectory
@@ -161,6 +168,27 @@ private:
 };
 
 
+// #pragma mark - InitialPackage
+
+
+struct Volume::InitialPackage {
+	char				name[B_FILE_NAME_LENGTH];
+	Package*			package;
+	status_t			error;
+	bigtime_t			loadTime;
+};
+
+
+struct Volume::InitialPackageLoader {
+	Volume*				volume;
+	PackagesDirectory*	packagesDirectory;
+	const PackagesSnapshot* snapshot;
+	InitialPackage*		packages;
+	int32				count;
+	int32				nextIndex;
+};
+
+
 // #pragma mark - Volume
 
 
@@ -748,6 +776,8 @@ Volume::_AddInitialPackages()
 	PackagesDirectory* packagesDirectory = fPackagesDirectories.Last();
 	INFORM("Adding packages from \"%s\"\n", packagesDirectory->Path());
 
+	bigtime_t startTime = system_time();
+
 	// try reading the activation file of the oldest state
 	status_t error = _AddInitialPackagesFromActivationFile(packagesDirectory);
 	if (error != B_OK && packagesDirectory != fPackagesDirectory) {
@@ -788,6 +818,8 @@ Volume::_AddInitialPackages()
 	}
 
 	// add the packages to the node tree
+	bigtime_t mergeStartTime = system_time();
+
 	VolumeWriteLocker systemVolumeLocker(_SystemVolumeIfNotSelf());
 	VolumeWriteLocker volumeLocker(this);
 	for (PackageFileNameHashTable::Iterator it = fPackages.GetIterator();
@@ -803,6 +835,12 @@ Volume::_AddInitialPackages()
 		}
 	}
 
+	bigtime_t endTime = system_time();
+	INFORM("Added %" B_PRIu32 " packages in %" B_PRId64 " ms: %" B_PRId64
+		" ms loading, %" B_PRId64 " ms adding to the node tree\n",
+		(uint32)fPackages.CountElements(), (endTime - startTime) / 1000,
+		(mergeStartTime - startTime) / 1000, (endTime - mergeStartTime) / 1000);
+
 	return B_OK;
 }
 
@@ -854,7 +892,8 @@ Volume::_AddInitialPackagesFromActivationFile(
 	// null-terminate to simplify parsing
 	fileContent[st.st_size] = '\0';
 
-	// parse the file and add the respective packages
+	// parse the file and collect the respective packages
+	Vector<InitialPackage> packages;
 	const char* packageName = fileContent;
 	char* const fileContentEnd = fileContent + st.st_size;
 	while (packageName < fileContentEnd) {
@@ -874,15 +913,19 @@ Volume::_AddInitialPackagesFromActivationFile(
 			RETURN_ERROR(B_BAD_DATA);
 		}
 
-		status_t error = _LoadAndAddInitialPackage(packagesDirectory,
-			packageName);
-		if (error != B_OK)
-			RETURN_ERROR(error);
+		InitialPackage package;
+		strlcpy(package.name, packageName, sizeof(package.name));
+		if (packages.PushBack(package) != B_OK)
+			RETURN_ERROR(B_NO_MEMORY);
 
 		packageName = packageNameEnd + 1;
 	}
 
-	return B_OK;
+	if (packages.Count() == 0)
+		return B_OK;
+
+	return _LoadAndAddInitialPackages(packagesDirectory, &packages[0],
+		packages.Count(), false);
 }
 
 
@@ -903,6 +946,7 @@ Volume::_AddInitialPackagesFromDirectory()
 		RETURN_ERROR(errno);
 	}
 
+	Vector<InitialPackage> packages;
 	while (dirent* entry = readdir(dir.Get())) {
 		// skip "." and ".."
 		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
@@ -915,28 +959,204 @@ Volume::_AddInitialPackagesFromDirectory()
 			continue;
 		}
 
-		_LoadAndAddInitialPackage(fPackagesDirectory, entry->d_name);
+		InitialPackage package;
+		strlcpy(package.name, entry->d_name, sizeof(package.name));
+		if (packages.PushBack(package) != B_OK)
+			RETURN_ERROR(B_NO_MEMORY);
 	}
 
-	return B_OK;
+	if (packages.Count() == 0)
+		return B_OK;
+
+	// packages that fail to load are just ignored
+	return _LoadAndAddInitialPackages(fPackagesDirectory, &packages[0],
+		packages.Count(), true);
 }
 
 
+/*!	Loads the given packages, i.e. parses their TOC and builds their node
+	trees, on a number of threads in parallel, and then adds them to the
+	volume in the given order. If \a ignoreErrors is \c false, nothing is
+	added if any package fails to load.
+*/
 status_t
-Volume::_LoadAndAddInitialPackage(PackagesDirectory* packagesDirectory,
-	const char* name)
+Volume::_LoadAndAddInitialPackages(PackagesDirectory* packagesDirectory,
+	InitialPackage* packages, int32 count, bool ignoreErrors)
+{
+	bigtime_t startTime = system_time();
+
+	for (int32 i = 0; i < count; i++) {
+		packages[i].package = NULL;
+		packages[i].error = B_OK;
+		packages[i].loadTime = 0;
+	}
+
+	// If enabled, use the node snapshot for the packages it covers. It is
+	// keyed by the list of packages, so a snapshot written for a different
+	// list is ignored.
+	PackagesSnapshot* snapshot = NULL;
+	uint64 snapshotKey = 0;
+	if (fPackageSettings.UseNodeSnapshot()) {
+		for (int32 i = 0; i < count; i++) {
+			snapshotKey = PackagesSnapshot::UpdateKey(snapshotKey,
+				packages[i].name);
+		}
+
+		snapshot = new(std::nothrow) PackagesSnapshot;
+		if (snapshot != NULL) {
+			status_t error = snapshot->Load(fPackagesDirectory->DirectoryFD(),
+				kNodeSnapshotPath, snapshotKey);
+			if (error != B_OK)
+				INFORM("Not using the node snapshot: %s\n", strerror(error));
+		}
+	}
+	ObjectDeleter<PackagesSnapshot> snapshotDeleter(snapshot);
+
+	InitialPackageLoader loader;
+	loader.volume = this;
+	loader.packagesDirectory = packagesDirectory;
+	loader.snapshot = snapshot;
+	loader.packages = packages;
+	loader.count = count;
+	loader.nextIndex = 0;
+
+	// The calling thread loads packages, too, so we only need to start
+	// additional threads on SMP systems.
+	int32 threadCount = min_c(min_c((int32)smp_get_num_cpus(),
+		kMaxPackageLoaderThreads), count);
+	thread_id threads[kMaxPackageLoaderThreads];
+	int32 startedThreads = 0;
+	for (int32 i = 1; i < threadCount; i++) {
+		thread_id thread = spawn_kernel_thread(&_InitialPackageLoaderThread,
+			"packagefs package loader", B_NORMAL_PRIORITY, &loader);
+		if (thread < 0)
+			break;
+
+		resume_thread(thread);
+		threads[startedThreads++] = thread;
+	}
+
+	_InitialPackageLoaderThread(&loader);
+
+	for (int32 i = 0; i < startedThreads; i++)
+		wait_for_thread(threads[i], NULL);
+
+	bigtime_t loadEndTime = system_time();
+
+	// check the results
+	status_t error = B_OK;
+	bigtime_t totalLoadTime = 0;
+	int32 slowestIndex = 0;
+	int32 snapshotPackages = 0;
+	for (int32 i = 0; i < count; i++) {
+		InitialPackage& package = packages[i];
+		totalLoadTime += package.loadTime;
+		if (package.loadTime > packages[slowestIndex].loadTime)
+			slowestIndex = i;
+		if (package.package != NULL && package.package->LoadedFromSnapshot())
+			snapshotPackages++;
+
+		if (package.error != B_OK) {
+			ERROR("Failed to load package \"%s\": %s\n", package.name,
+				strerror(package.error));
+			if (error == B_OK && !ignoreErrors)
+				error = package.error;
+		}
+	}
+
+	INFORM("Loaded %" B_PRId32 " packages (%" B_PRId32 " from the node "
+		"snapshot) with %" B_PRId32 " threads in %" B_PRId64 " ms (%" B_PRId64
+		" ms total, slowest \"%s\" %" B_PRId64 " ms)\n", count,
+		snapshotPackages, startedThreads + 1, (loadEndTime - startTime) / 1000,
+		totalLoadTime / 1000, packages[slowestIndex].name,
+		packages[slowestIndex].loadTime / 1000);
+
+	if (snapshot != NULL) {
+		if (error == B_OK)
+			_UpdateSnapshot(snapshot, snapshotKey, packages, count);
+
+		// the records are no longer needed
+		for (int32 i = 0; i < count; i++) {
+			if (packages[i].package != NULL)
+				packages[i].package->UnsetSnapshotRecord();
+		}
+	}
+
+	// add the packages in their original order
+	if (error == B_OK) {
+		VolumeWriteLocker systemVolumeLocker(_SystemVolumeIfNotSelf());
+		VolumeWriteLocker volumeLocker(this);
+		for (int32 i = 0; i < count; i++) {
+			if (packages[i].package != NULL)
+				_AddPackage(packages[i].package);
+		}
+	}
+
+	for (int32 i = 0; i < count; i++) {
+		if (packages[i].package != NULL)
+			packages[i].package->ReleaseReference();
+	}
+
+	RETURN_ERROR(error);
+}
+
+
+/*!	Writes a new node snapshot for the given initial packages, unless
+	\a snapshot already covers exactly these packages.
+*/
+void
+Volume::_UpdateSnapshot(const PackagesSnapshot* snapshot, uint64 snapshotKey,
+	const InitialPackage* packages, int32 count)
 {
-	Package* package;
-	status_t error = _LoadPackage(packagesDirectory, name, package);
+	Vector<const PackagesSnapshot::Record*> records;
+	bool upToDate = true;
+	for (int32 i = 0; i < count; i++) {
+		Package* package = packages[i].package;
+		if (package == NULL || package->SnapshotRecord() == NULL)
+			continue;
+
+		if (!package->LoadedFromSnapshot())
+			upToDate = false;
+
+		if (records.PushBack(package->SnapshotRecord()) != B_OK)
+			return;
+	}
+
+	if (records.Count() == 0
+		|| (upToDate && records.Count() == snapshot->CountPackages())) {
+		return;
+	}
+
+	bigtime_t startTime = system_time();
+	status_t error = PackagesSnapshot::Write(fPackagesDirectory->DirectoryFD(),
+		kNodeSnapshotPath, snapshotKey, &records[0], records.Count());
 	if (error != B_OK) {
-		ERROR("Failed to load package \"%s\": %s\n", name, strerror(error));
-		RETURN_ERROR(error);
+		INFORM("Failed to write the node snapshot: %s\n", strerror(error));
+		return;
 	}
-	BReference<Package> packageReference(package, true);
 
-	VolumeWriteLocker systemVolumeLocker(_SystemVolumeIfNotSelf());
-	VolumeWriteLocker volumeLocker(this);
-	_AddPackage(package);
+	INFORM("Wrote the node snapshot for %" B_PRId32 " packages in %" B_PRId64
+		" ms\n", records.Count(), (system_time() - startTime) / 1000);
+}
+
+
+/*static*/ status_t
+Volume::_InitialPackageLoaderThread(void* data)
+{
+	InitialPackageLoader* loader = (InitialPackageLoader*)data;
+
+	int32 index;
+	while ((index = atomic_add(&loader->nextIndex, 1)) < loader->count) {
+		InitialPackage& package = loader->packages[index];
+
+		bigtime_t startTime = system_time();
+		package.error = loader->volume->_LoadPackage(
+			loader->packagesDirectory, package.name, loader->snapshot,
+			package.package);
+		if (package.error != B_OK)
+			package.package = NULL;
+		package.loadTime = system_time() - startTime;
+	}
 
 	return B_OK;
 }
@@ -1471,7 +1691,7 @@ Volume::_RemoveNodeAndVNode(Node* node)
 
 status_t
 Volume::_LoadPackage(PackagesDirectory* packagesDirectory, const char* name,
-	Package*& _package)
+	const PackagesSnapshot* snapshot, Package*& _package)
 {
 	// Find the package -- check the specified packages directory and iterate
 	// toward the newer states.
@@ -1501,9 +1721,14 @@ Volume::_LoadPackage(PackagesDirectory* packagesDirectory, const char* name,
 	if (error != B_OK)
 		return error;
 
-	error = package->Load(fPackageSettings);
-	if (error != B_OK)
+	error = package->Load(fPackageSettings, snapshot);
+	if (error != B_OK) {
+		// If the snapshot's record was corrupt, the package might still be
+		// fine.
+		if (snapshot != NULL)
+			return _LoadPackage(packagesDirectory, name, NULL, _package);
 		return error;
+	}
 
 	_package = packageReference.Detach();
 	return B_OK;
@@ -1591,7 +1816,8 @@ Volume::_ChangeActivation(ActivationChangeRequest& request)
 		}
 
 		Package* package;
-		status_t error = _LoadPackage(fPackagesDirectory, item->name, package);
+		status_t error = _LoadPackage(fPackagesDirectory, item->name, NULL,
+			package);
 		if (error != B_OK) {
 			ERROR("Volume::_ChangeActivation(): failed to load package "
 				"\"%s\"\n", item->name);
@@ -108,6 +108,8 @@ private:
 private:
 			struct ShineThroughDirectory;
 			struct ActivationChangeRequest;
+			struct InitialPackage;
+			struct InitialPackageLoader;
 
 private:
 			status_t			_LoadOldPackagesStates(
@@ -117,9 +119,11 @@ private:
 			status_t			_AddInitialPackagesFromActivationFile(
 									PackagesDirectory* packagesDirectory);
 			status_t			_AddInitialPackagesFromDirectory();
-			status_t			_LoadAndAddInitialPackage(
+			status_t			_LoadAndAddInitialPackages(
 									PackagesDirectory* packagesDirectory,
-									const char* name);
+									InitialPackage* packages, int32 count,
+									bool ignoreErrors);
+	static	status_t			_InitialPackageLoaderThread(void* data);
 
 	inline	void				_AddPackage(Package* package);
 	inline	void				_RemovePackage(Package* package);
@@ -154,7 +158,14 @@ private:
 
 			status_t			_LoadPackage(
 									PackagesDirectory* packagesDirectory,
-									const char* name, Package*& _package);
+									const char* name,
+									const PackagesSnapshot* snapshot,
+									Package*& _package);
+			void				_UpdateSnapshot(
+									const PackagesSnapshot* snapshot,
+									uint64 snapshotKey,
+									const InitialPackage* packages,
+									int32 count);
 
 			status_t			_ChangeActivation(
 									ActivationChangeRequest& request);
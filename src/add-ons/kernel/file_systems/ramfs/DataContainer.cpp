@@ -14,6 +14,7 @@
 
 #include "AllocationInfo.h"
 #include "DebugSupport.h"
+#include "IORequest.h"
 #include "Misc.h"
 #include "Volume.h"
 
@@ -105,8 +106,12 @@ DataContainer::Resize(off_t newSize)
 			if (error != B_OK)
 				return error;
 
+			// resizing also commits the memory (or swap space) for the new
+			// size, which may fail
 			AutoLocker<VMCache> _(fCache);
-			fCache->Resize(newSize, VM_PRIORITY_SYSTEM);
+			error = fCache->Resize(newSize, VM_PRIORITY_USER);
+			if (error != B_OK)
+				return error == B_NO_MEMORY ? B_DEVICE_FULL : error;
 
 			// pages will be added as they are written to; so nothing else
 			// needs to be done here.
@@ -248,8 +253,10 @@ DataContainer::_CountBlocks() const
 status_t
 DataContainer::_SwitchToCacheMode()
 {
+	// The cache is swappable, so that the file data can be paged out under
+	// memory pressure, just like anonymous memory.
 	status_t error = VMCacheFactory::CreateAnonymousCache(fCache, false, 0,
-		0, false, VM_PRIORITY_SYSTEM);
+		0, true, VM_PRIORITY_SYSTEM);
 	if (error != B_OK)
 		return error;
 
@@ -286,9 +293,12 @@ DataContainer::_DoCacheIO(const off_t offset, uint8* buffer, ssize_t length,
 		return B_NO_MEMORY;
 	ArrayDeleter<vm_page*> pagesDeleter(pages);
 
-	_GetPages(rounded_offset, rounded_len, isWrite, pages);
+	status_t error = _GetPages(rounded_offset, rounded_len, isWrite, pages);
+	if (error != B_OK) {
+		_PutPages(rounded_offset, rounded_len, pages, false);
+		return error;
+	}
 
-	status_t error = B_OK;
 	size_t index = 0;
 
 	while (length > 0) {
@@ -304,6 +314,18 @@ DataContainer::_DoCacheIO(const off_t offset, uint8* buffer, ssize_t length,
 		bytes = min(length, bytes);
 
 		if (isWrite) {
+			if (page->CacheRef() == NULL) {
+				// a newly allocated page -- clear the parts we don't write
+				const phys_addr_t pageAddress
+					= page->physical_page_number * B_PAGE_SIZE;
+				const size_t start = at - pageAddress;
+				if (start > 0)
+					vm_memset_physical(pageAddress, 0, start);
+				if (start + bytes < B_PAGE_SIZE) {
+					vm_memset_physical(at + bytes, 0,
+						B_PAGE_SIZE - start - bytes);
+				}
+			}
 			page->modified = true;
 			error = vm_memcpy_to_physical(at, buffer, bytes, user);
 		} else {
@@ -334,7 +356,7 @@ DataContainer::_DoCacheIO(const off_t offset, uint8* buffer, ssize_t length,
 }
 
 // _GetPages
-void
+status_t
 DataContainer::_GetPages(off_t offset, off_t length, bool isWrite,
 	vm_page** pages)
 {
@@ -358,6 +380,49 @@ DataContainer::_GetPages(off_t offset, off_t length, bool isWrite,
 
 			DEBUG_PAGE_ACCESS_START(page);
 			page->busy = true;
+		} else if (fCache->HasPage(offset)) {
+			// The page has been swapped out, read it back in. We insert it
+			// busy, so that others wait for it, just like the page fault
+			// handler does.
+			locker.Unlock();
+			vm_page_reservation reservation;
+			vm_page_reserve_pages(&reservation, 1, VM_PRIORITY_SYSTEM);
+			locker.Lock();
+
+			if (fCache->LookupPage(offset) != NULL
+				|| !fCache->HasPage(offset)) {
+				// someone else has been faster
+				vm_page_unreserve_pages(&reservation);
+				continue;
+			}
+
+			page = vm_page_allocate_page(&reservation,
+				PAGE_STATE_ACTIVE | VM_PAGE_ALLOC_BUSY);
+			vm_page_unreserve_pages(&reservation);
+			fCache->InsertPage(page, offset);
+
+			fCache->AcquireRefLocked();
+			locker.Unlock();
+
+			generic_io_vec vec;
+			vec.base = (phys_addr_t)page->physical_page_number * B_PAGE_SIZE;
+			generic_size_t bytesRead = vec.length = B_PAGE_SIZE;
+			status_t error = fCache->Read(offset, &vec, 1,
+				B_PHYSICAL_IO_REQUEST, &bytesRead);
+
+			locker.Lock();
+			fCache->ReleaseRefLocked();
+
+			if (error != B_OK) {
+				fCache->NotifyPageEvents(page, PAGE_EVENT_NOT_BUSY);
+				fCache->RemovePage(page);
+				vm_page_set_state(page, PAGE_STATE_FREE);
+
+				// the caller puts the pages we've already got
+				while (index < pageCount)
+					pages[index++] = NULL;
+				return error;
+			}
 		} else
 			missingPages++;
 
@@ -368,7 +433,8 @@ DataContainer::_GetPages(off_t offset, off_t length, bool isWrite,
 
 	locker.Unlock();
 
-	// For a write we need to reserve the missing pages.
+	// For a write we need to reserve the missing pages. They are not wired,
+	// so that the page daemon can write them to swap.
 	if (isWrite && missingPages > 0) {
 		vm_page_reservation reservation;
 		vm_page_reserve_pages(&reservation, missingPages,
@@ -379,7 +445,7 @@ DataContainer::_GetPages(off_t offset, off_t length, bool isWrite,
 				continue;
 
 			pages[i] = vm_page_allocate_page(&reservation,
-				PAGE_STATE_WIRED | VM_PAGE_ALLOC_BUSY);
+				PAGE_STATE_ACTIVE | VM_PAGE_ALLOC_BUSY);
 
 			if (--missingPages == 0)
 				break;
@@ -387,6 +453,8 @@ DataContainer::_GetPages(off_t offset, off_t length, bool isWrite,
 
 		vm_page_unreserve_pages(&reservation);
 	}
+
+	return B_OK;
 }
 
 void
@@ -39,7 +39,8 @@ private:
 	inline bool _RequiresCacheMode(size_t size);
 	inline bool _IsCacheMode() const;
 	status_t _SwitchToCacheMode();
-	void _GetPages(off_t offset, off_t length, bool isWrite, vm_page** pages);
+	status_t _GetPages(off_t offset, off_t length, bool isWrite,
+		vm_page** pages);
 	void _PutPages(off_t offset, off_t length, vm_page** pages, bool success);
 	status_t _DoCacheIO(const off_t offset, uint8* buffer, ssize_t length,
 		size_t* bytesProcessed, bool isWrite);
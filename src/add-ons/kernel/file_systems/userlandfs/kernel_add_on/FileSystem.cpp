@@ -176,6 +176,7 @@ FileSystem::FileSystem()
 	mutex_init(&fVolumeLock, "userlandfs volumes");
 	mutex_init(&fVNodeOpsLock, "userlandfs vnode ops");
 	mutex_init(&fNodeListenersLock, "userlandfs node listeners");
+	memset(fRequestStatistics, 0, sizeof(fRequestStatistics));
 }
 
 // destructor
@@ -607,6 +608,27 @@ FileSystem::IsUserlandServerThread() const
 	return (info.team == fUserlandServerTeam);
 }
 
+// AddRequestLatency
+void
+FileSystem::AddRequestLatency(uint32 requestType, bigtime_t latency)
+{
+	if (requestType >= NO_REQUEST)
+		return;
+
+	RequestStatistics& statistics = fRequestStatistics[requestType];
+	atomic_add64(&statistics.count, 1);
+	atomic_add64(&statistics.totalTime, latency);
+
+	int64 maxTime = atomic_get64(&statistics.maxTime);
+	while (latency > maxTime) {
+		int64 previous = atomic_test_and_set64(&statistics.maxTime, latency,
+			maxTime);
+		if (previous == maxTime)
+			break;
+		maxTime = previous;
+	}
+}
+
 
 // _InitVNodeOpsVector
 void
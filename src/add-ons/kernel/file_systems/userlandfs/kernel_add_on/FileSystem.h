@@ -107,12 +107,21 @@ public:
 
 			bool				IsUserlandServerThread() const;
 
+			void				AddRequestLatency(uint32 requestType,
+									bigtime_t latency);
+
 private:
 			struct SelectSyncMap;
 			struct NodeListenerKey;
 			struct NodeListenerProxy;
 			struct NodeListenerHashDefinition;
 
+			struct RequestStatistics {
+				int64			count;
+				int64			totalTime;
+				int64			maxTime;
+			};
+
 			friend class KernelDebug;
 			friend struct NodeListenerProxy;
 
@@ -147,6 +156,7 @@ private:
 			NodeListenerMap*	fNodeListeners;
 			Settings*			fSettings;
 			team_id				fUserlandServerTeam;
+			RequestStatistics	fRequestStatistics[NO_REQUEST];
 			bool				fInitialized;
 	volatile bool				fTerminating;
 };
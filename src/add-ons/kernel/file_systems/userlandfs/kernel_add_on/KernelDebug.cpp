@@ -80,6 +80,41 @@ KernelDebug::DebugPort(int argc, char** argv)
 	kprintf("  size:         %" B_PRId32 "\n", port->fPort.fInfo.size);
 	kprintf("  capacity:     %" B_PRId32 "\n", port->fPort.fCapacity);
 	kprintf("  buffer:       %p\n", port->fPort.fBuffer);
+	kprintf("  ring area:    %" B_PRId32 "\n", port->fPort.fRingArea);
+	if (port->fPort.fRing != NULL) {
+		kprintf("  ring:         %p, size: %" B_PRId32 ", in use: %d\n",
+			port->fPort.fRing, port->fPort.fRingSize, port->fPort.UsesRing());
+		kprintf("  shared data:  %p, size: %" B_PRId32 ", reserved: %"
+			B_PRId32 "\n", port->fPort.fSharedData,
+			port->fPort.fSharedDataSize, port->fPort.fSharedDataReservedSize);
+	}
+	const Port::Statistics& statistics = port->fPort.GetStatistics();
+	kprintf("  messages:     %" B_PRId64 " ring, %" B_PRId64 " port, %"
+		B_PRId64 " doorbells\n", statistics.ring_messages,
+		statistics.port_messages, statistics.doorbells);
+	return 0;
+}
+
+// DebugLatency
+int
+KernelDebug::DebugLatency(int argc, char** argv)
+{
+	if (argc < 2) {
+		kprintf("usage: ufs_latency <file system pointer>\n");
+		return 0;
+	}
+	FileSystem* fs = (FileSystem*)parse_expression(argv[1]);
+	kprintf("file system %p: %s\n", fs, fs->GetName());
+	kprintf("request      count   avg (us)   max (us)\n");
+	for (uint32 type = 0; type < NO_REQUEST; type++) {
+		const FileSystem::RequestStatistics& statistics
+			= fs->fRequestStatistics[type];
+		if (statistics.count == 0)
+			continue;
+		kprintf("%7" B_PRIu32 " %10" B_PRId64 " %10" B_PRId64 " %10" B_PRId64
+			"\n", type, statistics.count,
+			statistics.totalTime / statistics.count, statistics.maxTime);
+	}
 	return 0;
 }
 
@@ -99,6 +134,9 @@ KernelDebug::AddDebuggerCommands()
 		"userland FS port pool");
 	add_debugger_command("ufs_port", DebugPort,
 		"ufs_port <port pointer> - prints info about a userland FS port");
+	add_debugger_command("ufs_latency", DebugLatency,
+		"ufs_latency <file system pointer> - prints the request latencies of "
+		"a userland FS");
 }
 
 // RemoveDebuggerCommands
@@ -109,6 +147,7 @@ KernelDebug::RemoveDebuggerCommands()
 		return;
 	PRINT(("KernelDebug::RemoveDebuggerCommands(): removing debugger "
 		"commands\n"));
+	remove_debugger_command("ufs_latency", DebugLatency);
 	remove_debugger_command("ufs_port", DebugPort);
 	remove_debugger_command("ufs_portpool", DebugPortPool);
 	remove_debugger_command("ufs", DebugUFS);
@@ -12,6 +12,7 @@ private:
 	static	int					DebugUFS(int argc, char** argv);
 	static	int					DebugPortPool(int argc, char** argv);
 	static	int					DebugPort(int argc, char** argv);
+	static	int					DebugLatency(int argc, char** argv);
 };
 
 // no kernel debugger commands in userland
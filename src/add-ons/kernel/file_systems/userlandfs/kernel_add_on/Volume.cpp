@@ -4400,15 +4400,23 @@ Volume::_SendRequest(RequestPort* port, RequestAllocator* allocator,
 	request->user = geteuid();
 	request->group = getegid();
 
-	if (!fFileSystem->IsUserlandServerThread())
-		return port->SendRequest(allocator, handler, reply);
-	// Here it gets dangerous: a thread of the userland server team being here
-	// calls for trouble. We try receiving the request with a timeout, and
-	// close the port -- which will disconnect the whole FS.
-	status_t error = port->SendRequest(allocator, handler, reply,
-		kUserlandServerlandPortTimeout);
-	if (error == B_TIMED_OUT || error == B_WOULD_BLOCK)
-		port->Close();
+	uint32 requestType = request->GetType();
+	bigtime_t startTime = system_time();
+
+	status_t error;
+	if (!fFileSystem->IsUserlandServerThread()) {
+		error = port->SendRequest(allocator, handler, reply);
+	} else {
+		// Here it gets dangerous: a thread of the userland server team being
+		// here calls for trouble. We try receiving the request with a
+		// timeout, and close the port -- which will disconnect the whole FS.
+		error = port->SendRequest(allocator, handler, reply,
+			kUserlandServerlandPortTimeout);
+		if (error == B_TIMED_OUT || error == B_WOULD_BLOCK)
+			port->Close();
+	}
+
+	fFileSystem->AddRequestLatency(requestType, system_time() - startTime);
 	return error;
 }
 
@@ -4,8 +4,10 @@
  */
 
 #include <new>
+#include <string.h>
 
 #include <AutoDeleter.h>
+#include <KernelExport.h>
 
 #include "AreaSupport.h"
 #include "Compatibility.h"
@@ -18,6 +20,50 @@ using std::nothrow;
 static const int32 kMinPortSize = 1024;			// 1 kB
 static const int32 kMaxPortSize = 64 * 1024;	// 64 kB
 
+// The ring transport: In addition to the two ports the owner creates an area
+// that the client clones. It contains two single producer/single consumer
+// rings -- one for each direction -- and two shared data regions, one for
+// each side to allocate request data from (cf. AllocateSharedData()).
+// A message is put into the peer's ring and only if the peer has announced
+// that it is going to block on its port, a zero sized "doorbell" message is
+// written to the port to wake it up. Since a receiver spins a short while
+// before blocking, messages exchanged in quick succession (as request and
+// reply usually are) don't need any syscalls at all.
+// If the area cannot be created or cloned, or the client is of an older
+// version, the message contents are sent through the ports as before.
+
+static const uint32 kRingMagic = 'ufsr';
+static const int32 kMinRingSize = 1024;
+static const int32 kRingMessageHeaderSize = 8;
+static const int32 kRingWrapMarker = -1;
+static const int32 kSharedDataSize = 128 * 1024;	// per side
+static const bigtime_t kRingSpinTime = 20;
+static const bigtime_t kRingFullSnoozeTime = 100;
+
+enum {
+	OWNER_TO_CLIENT_CHANNEL	= 0,
+	CLIENT_TO_OWNER_CHANNEL	= 1,
+};
+
+// RingChannel
+struct Port::RingChannel {
+	int32			head;		// written by the receiver only
+	int32			tail;		// written by the sender only
+	int32			waiting;	// set by the receiver before it blocks
+	int32			reserved[13];
+		// keep the channels in separate cache lines
+};
+
+// RingHeader
+struct Port::RingHeader {
+	uint32			magic;
+	int32			ring_size;
+	int32			shared_data_size;
+	int32			client_attached;
+	int32			reserved[12];
+	RingChannel		channels[2];
+};
+
 
 // constructor
 Port::Port(int32 size)
@@ -25,9 +71,18 @@ Port::Port(int32 size)
 	fBuffer(NULL),
 	fCapacity(0),
 	fReservedSize(0),
+	fRingArea(-1),
+	fRing(NULL),
+	fRingSize(0),
+	fSharedData(NULL),
+	fPeerSharedData(NULL),
+	fSharedDataSize(0),
+	fSharedDataReservedSize(0),
 	fInitStatus(B_NO_INIT),
 	fOwner(true)
 {
+	memset(&fStatistics, 0, sizeof(fStatistics));
+	fInfo.ring_area = -1;
 	// adjust size to be within the sane bounds
 	if (size < kMinPortSize)
 		size = kMinPortSize;
@@ -53,6 +108,9 @@ Port::Port(int32 size)
 	}
 	fInfo.size = size;
 	fCapacity = size;
+	// create the ring area -- if that fails, we fall back to the port protocol
+	if (_InitRing() == B_OK)
+		fInfo.ring_area = fRingArea;
 	fInitStatus = B_OK;
 }
 
@@ -63,9 +121,18 @@ Port::Port(const Info* info)
 	fBuffer(NULL),
 	fCapacity(0),
 	fReservedSize(0),
+	fRingArea(-1),
+	fRing(NULL),
+	fRingSize(0),
+	fSharedData(NULL),
+	fPeerSharedData(NULL),
+	fSharedDataSize(0),
+	fSharedDataReservedSize(0),
 	fInitStatus(B_NO_INIT),
 	fOwner(false)
 {
+	memset(&fStatistics, 0, sizeof(fStatistics));
+	fInfo.ring_area = -1;
 	// check parameters
 	if (!info || info->owner_port < 0 || info->client_port < 0
 		|| info->size < kMinPortSize || info->size > kMaxPortSize) {
@@ -83,6 +150,9 @@ Port::Port(const Info* info)
 	fInfo.size = info->size;
 	// init the other members
 	fCapacity = info->size;
+	// attach to the ring area, if the owner has one
+	if (info->ring_area >= 0 && _AttachRing(info->ring_area) == B_OK)
+		fInfo.ring_area = info->ring_area;
 	fInitStatus = B_OK;
 }
 
@@ -91,6 +161,8 @@ Port::Port(const Info* info)
 Port::~Port()
 {
 	Close();
+	if (fRingArea >= 0)
+		delete_area(fRingArea);
 	delete[] fBuffer;
 }
 
@@ -148,6 +220,58 @@ Port::Unreserve(int32 endOffset)
 }
 
 
+// UsesRing
+bool
+Port::UsesRing() const
+{
+	// The owner must not use the ring before the client has attached to it.
+	return fRing != NULL
+		&& (!fOwner || atomic_get(&fRing->client_attached) != 0);
+}
+
+
+// AllocateSharedData
+status_t
+Port::AllocateSharedData(int32 size, int32 align, void** _data,
+	int32* _offset)
+{
+	if (!UsesRing())
+		return B_NOT_SUPPORTED;
+	if (size < 0 || align <= 0)
+		return B_BAD_VALUE;
+
+	int32 offset = (fSharedDataReservedSize + align - 1) / align * align;
+	if (offset > fSharedDataSize || size > fSharedDataSize - offset)
+		return B_NO_MEMORY;
+
+	fSharedDataReservedSize = offset + size;
+	*_data = fSharedData + offset;
+	*_offset = offset;
+	return B_OK;
+}
+
+
+// UnreserveSharedData
+void
+Port::UnreserveSharedData(int32 endOffset)
+{
+	if (endOffset < fSharedDataReservedSize)
+		fSharedDataReservedSize = endOffset;
+}
+
+
+// GetPeerSharedData
+void*
+Port::GetPeerSharedData(int32 offset, int32 size) const
+{
+	if (fPeerSharedData == NULL || offset < 0 || size < 0
+		|| offset > fSharedDataSize || size > fSharedDataSize - offset) {
+		return NULL;
+	}
+	return fPeerSharedData + offset;
+}
+
+
 // Send
 status_t
 Port::Send(const void* message, int32 size)
@@ -157,12 +281,18 @@ Port::Send(const void* message, int32 size)
 	if (size <= 0)
 		return B_BAD_VALUE;
 
+	if (UsesRing())
+		return _SendToRing(message, size);
+
 	port_id port = (fOwner ? fInfo.client_port : fInfo.owner_port);
 	status_t error;
 	do {
 		error = write_port(port, 0, message, size);
 	} while (error == B_INTERRUPTED);
 
+	if (error == B_OK)
+		fStatistics.port_messages++;
+
 	return (fInitStatus = error);
 }
 
@@ -187,23 +317,326 @@ Port::Receive(void** _message, size_t* _size, bigtime_t timeout)
 
 	port_id port = (fOwner ? fInfo.owner_port : fInfo.client_port);
 
-	// wait for the next message
-	status_t error = B_OK;
-	ssize_t bufferSize;
-	do {
-		// TODO: When compiling for userland, we might want to save this syscall
-		// by using read_port_etc() directly, using a sufficiently large
-		// on-stack buffer and copying onto the heap.
-		bufferSize = port_buffer_size_etc(port, timeoutFlags, timeout);
-		if (bufferSize < 0)
-			error = bufferSize;
-	} while (error == B_INTERRUPTED);
+	while (true) {
+		if (fRing != NULL) {
+			status_t error = _ReceiveFromRing(_message, _size);
+			if (error != B_WOULD_BLOCK)
+				return error;
+
+			// The reply to a message we have just sent usually arrives very
+			// soon, so spin a bit before going to sleep.
+			if (UsesRing()) {
+				bigtime_t spinUntil = system_time() + kRingSpinTime;
+				while (!_RingHasMessage() && system_time() < spinUntil)
+					;
+				if (_RingHasMessage())
+					continue;
+			}
+
+			// Announce that we are going to block, so that the peer rings the
+			// doorbell. Check the ring once more afterwards, since the peer
+			// might have added a message before seeing the flag. The flag is
+			// set with a full barrier, so that it can't become visible after
+			// the ring check; the sender publishes the tail and reads the flag
+			// in the opposite order. Otherwise both could miss each other.
+			RingChannel* channel = _ReceiveChannel();
+			atomic_get_and_set(&channel->waiting, 1);
+			if (_RingHasMessage()) {
+				atomic_set(&channel->waiting, 0);
+				continue;
+			}
+		}
+
+		// wait for the next message
+		status_t error = B_OK;
+		ssize_t bufferSize;
+		do {
+			// TODO: When compiling for userland, we might want to save this
+			// syscall by using read_port_etc() directly, using a sufficiently
+			// large on-stack buffer and copying onto the heap.
+			bufferSize = port_buffer_size_etc(port, timeoutFlags, timeout);
+			if (bufferSize < 0)
+				error = bufferSize;
+		} while (error == B_INTERRUPTED);
+
+		if (error == B_TIMED_OUT || error == B_WOULD_BLOCK)
+			return error;
+		if (error != B_OK)
+			return (fInitStatus = error);
+
+		if (bufferSize == 0 && fRing != NULL) {
+			// a doorbell -- the message is waiting in the ring
+			int32 code;
+			read_port_etc(port, &code, NULL, 0, B_RELATIVE_TIMEOUT, 0);
+			continue;
+		}
+
+		return _ReceiveFromPort(port, bufferSize, _message, _size);
+	}
+}
+
+
+// _InitRing
+status_t
+Port::_InitRing()
+{
+	// The ring must be able to hold two messages of maximal size (plus
+	// wrap-around waste). Its size is a power of two, so that the unmasked
+	// head and tail indices may wrap around.
+	int32 ringSize = kMinRingSize;
+	while (ringSize < 2 * (fCapacity + 2 * kRingMessageHeaderSize))
+		ringSize *= 2;
+
+	size_t areaSize = sizeof(RingHeader) + 2 * ringSize + 2 * kSharedDataSize;
+	areaSize = (areaSize + B_PAGE_SIZE - 1) / B_PAGE_SIZE * B_PAGE_SIZE;
+
+	void* address;
+	area_id area = create_area("port ring", &address,
+#ifdef _KERNEL_MODE
+		B_ANY_KERNEL_ADDRESS,
+#else
+		B_ANY_ADDRESS,
+#endif
+		areaSize, B_NO_LOCK,
+		B_READ_AREA | B_WRITE_AREA
+#ifdef _KERNEL_MODE
+			| B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA | B_CLONEABLE_AREA
+#endif
+		);
+	if (area < 0)
+		return area;
+
+	RingHeader* header = (RingHeader*)address;
+	memset(header, 0, sizeof(RingHeader));
+	header->magic = kRingMagic;
+	header->ring_size = ringSize;
+	header->shared_data_size = kSharedDataSize;
+
+	uint8* sharedData = (uint8*)address + sizeof(RingHeader) + 2 * ringSize;
+
+	fRingArea = area;
+	fRing = header;
+	fRingSize = ringSize;
+	fSharedDataSize = kSharedDataSize;
+	fSharedData = sharedData;
+	fPeerSharedData = sharedData + kSharedDataSize;
+	return B_OK;
+}
 
-	if (error == B_TIMED_OUT || error == B_WOULD_BLOCK)
+
+// _AttachRing
+status_t
+Port::_AttachRing(area_id area)
+{
+	void* address;
+	area_id clone = clone_area("port ring", &address,
+#ifdef _KERNEL_MODE
+		B_ANY_KERNEL_ADDRESS, B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA,
+#else
+		B_ANY_ADDRESS, B_READ_AREA | B_WRITE_AREA,
+#endif
+		area);
+	if (clone < 0)
+		return clone;
+
+	area_info areaInfo;
+	status_t error = get_area_info(clone, &areaInfo);
+	if (error != B_OK) {
+		delete_area(clone);
 		return error;
-	if (error != B_OK)
-		return (fInitStatus = error);
+	}
+
+	// Check the layout. We only read the header once and use our own copies of
+	// the values afterwards, since the area is writable by the owner.
+	RingHeader* header = (RingHeader*)address;
+	int32 ringSize = header->ring_size;
+	int32 sharedDataSize = header->shared_data_size;
+	if (areaInfo.size < sizeof(RingHeader) || header->magic != kRingMagic
+		|| ringSize < 2 * (fCapacity + 2 * kRingMessageHeaderSize)
+		|| ringSize > 64 * kMaxPortSize || (ringSize & (ringSize - 1)) != 0
+		|| sharedDataSize < 0 || sharedDataSize > 16 * kSharedDataSize
+		|| (areaInfo.size - sizeof(RingHeader)) / 2
+			< (size_t)ringSize + sharedDataSize) {
+		delete_area(clone);
+		return B_BAD_DATA;
+	}
+
+	uint8* sharedData = (uint8*)address + sizeof(RingHeader) + 2 * ringSize;
+
+	fRingArea = clone;
+	fRing = header;
+	fRingSize = ringSize;
+	fSharedDataSize = sharedDataSize;
+	fSharedData = sharedData + sharedDataSize;
+	fPeerSharedData = sharedData;
 
+	// let the owner know that it can use the ring, too
+	atomic_set(&header->client_attached, 1);
+	return B_OK;
+}
+
+
+// _SendChannel
+Port::RingChannel*
+Port::_SendChannel() const
+{
+	return &fRing->channels[
+		fOwner ? OWNER_TO_CLIENT_CHANNEL : CLIENT_TO_OWNER_CHANNEL];
+}
+
+
+// _ReceiveChannel
+Port::RingChannel*
+Port::_ReceiveChannel() const
+{
+	return &fRing->channels[
+		fOwner ? CLIENT_TO_OWNER_CHANNEL : OWNER_TO_CLIENT_CHANNEL];
+}
+
+
+// _ChannelBuffer
+uint8*
+Port::_ChannelBuffer(int32 channel) const
+{
+	return (uint8*)fRing + sizeof(RingHeader) + channel * fRingSize;
+}
+
+
+// _SendToRing
+status_t
+Port::_SendToRing(const void* message, int32 size)
+{
+	RingChannel* channel = _SendChannel();
+	uint8* buffer = _ChannelBuffer(
+		fOwner ? OWNER_TO_CLIENT_CHANNEL : CLIENT_TO_OWNER_CHANNEL);
+	port_id port = (fOwner ? fInfo.client_port : fInfo.owner_port);
+
+	int32 recordSize = kRingMessageHeaderSize + (size + 7) / 8 * 8;
+	if (recordSize > fRingSize / 2)
+		return B_BAD_VALUE;
+
+	// wait until there's enough room -- since requests and replies strictly
+	// alternate, this shouldn't happen in practice
+	uint32 tail = (uint32)atomic_get(&channel->tail);
+	uint32 position;
+	while (true) {
+		uint32 used = tail - (uint32)atomic_get(&channel->head);
+		if (used > (uint32)fRingSize || (tail & 7) != 0)
+			return (fInitStatus = B_BAD_DATA);
+
+		position = tail & (fRingSize - 1);
+		int32 needed = recordSize;
+		if ((int32)position + recordSize > fRingSize)
+			needed += fRingSize - position;
+		if (fRingSize - (int32)used >= needed)
+			break;
+
+		// make sure the peer is still alive
+		ssize_t count = port_count(port);
+		if (count < 0)
+			return (fInitStatus = count);
+		snooze(kRingFullSnoozeTime);
+	}
+
+	// if the message doesn't fit at the end of the ring, continue at the
+	// beginning
+	if ((int32)position + recordSize > fRingSize) {
+		*(int32*)(buffer + position) = kRingWrapMarker;
+		tail += fRingSize - position;
+		position = 0;
+	}
+
+	int32* messageHeader = (int32*)(buffer + position);
+	messageHeader[0] = size;
+	messageHeader[1] = 0;
+	memcpy(buffer + position + kRingMessageHeaderSize, message, size);
+
+	// publish the message and wake up the peer, if it is waiting
+	atomic_set(&channel->tail, (int32)(tail + recordSize));
+	fStatistics.ring_messages++;
+
+	if (atomic_get_and_set(&channel->waiting, 0) != 0) {
+		// If the port is full, there's already a doorbell pending.
+		status_t error = write_port_etc(port, 0, NULL, 0, B_RELATIVE_TIMEOUT,
+			0);
+		if (error == B_OK)
+			fStatistics.doorbells++;
+		else if (error != B_WOULD_BLOCK && error != B_TIMED_OUT
+			&& error != B_INTERRUPTED) {
+			return (fInitStatus = error);
+		}
+	}
+
+	return B_OK;
+}
+
+
+// _ReceiveFromRing
+status_t
+Port::_ReceiveFromRing(void** _message, size_t* _size)
+{
+	RingChannel* channel = _ReceiveChannel();
+	uint8* buffer = _ChannelBuffer(
+		fOwner ? CLIENT_TO_OWNER_CHANNEL : OWNER_TO_CLIENT_CHANNEL);
+
+	uint32 head = (uint32)atomic_get(&channel->head);
+	while (true) {
+		uint32 available = (uint32)atomic_get(&channel->tail) - head;
+		if (available == 0)
+			return B_WOULD_BLOCK;
+		if (available > (uint32)fRingSize || (head & 7) != 0)
+			return (fInitStatus = B_BAD_DATA);
+
+		// The ring is writable by the peer, so the size is read only once --
+		// the volatile access keeps the compiler from fetching it again
+		// after it has been checked -- and only that copy is used.
+		uint32 position = head & (fRingSize - 1);
+		int32 size = *(volatile int32*)(buffer + position);
+		if (size == kRingWrapMarker) {
+			uint32 skip = fRingSize - position;
+			if (skip > available)
+				return (fInitStatus = B_BAD_DATA);
+			head += skip;
+			atomic_set(&channel->head, (int32)head);
+			continue;
+		}
+
+		if (size <= 0
+			|| size > fRingSize - (int32)position - kRingMessageHeaderSize) {
+			return (fInitStatus = B_BAD_DATA);
+		}
+		uint32 recordSize = kRingMessageHeaderSize + (size + 7) / 8 * 8;
+		if (recordSize > available)
+			return (fInitStatus = B_BAD_DATA);
+
+		void* message = malloc(size);
+		if (message == NULL)
+			return (fInitStatus = B_NO_MEMORY);
+		memcpy(message, buffer + position + kRingMessageHeaderSize, size);
+
+		atomic_set(&channel->head, (int32)(head + recordSize));
+
+		*_message = message;
+		*_size = size;
+		return B_OK;
+	}
+}
+
+
+// _RingHasMessage
+bool
+Port::_RingHasMessage() const
+{
+	RingChannel* channel = _ReceiveChannel();
+	return atomic_get(&channel->tail) != atomic_get(&channel->head);
+}
+
+
+// _ReceiveFromPort
+status_t
+Port::_ReceiveFromPort(port_id port, ssize_t bufferSize, void** _message,
+	size_t* _size)
+{
 	// allocate memory for the message
 	void* message = malloc(bufferSize);
 	if (message == NULL)
@@ -23,6 +23,7 @@ RequestAllocator::RequestAllocator(Port* port)
 	fRequest(NULL),
 	fRequestSize(0),
 	fPortReservedOffset(0),
+	fSharedDataReservedOffset(0),
 	fAllocatedAreaCount(0),
 	fDeferredInitInfoCount(0),
 	fRequestInPortBuffer(false)
@@ -45,6 +46,7 @@ RequestAllocator::Init(Port* port)
 		fPort = port;
 		fError = fPort->InitCheck();
 		fPortReservedOffset = fPort->ReservedSize();
+		fSharedDataReservedOffset = fPort->SharedDataReservedSize();
 	}
 	return fError;
 }
@@ -58,6 +60,9 @@ RequestAllocator::Uninit()
 	else
 		free(fRequest);
 
+	if (fPort != NULL)
+		fPort->UnreserveSharedData(fSharedDataReservedOffset);
+
 	for (int32 i = 0; i < fAllocatedAreaCount; i++)
 		delete_area(fAllocatedAreas[i]);
 	fAllocatedAreaCount = 0;
@@ -73,6 +78,7 @@ RequestAllocator::Uninit()
 	fRequest = NULL;
 	fRequestSize = 0;
 	fPortReservedOffset = 0;
+	fSharedDataReservedOffset = 0;
 }
 
 // Error
@@ -155,7 +161,7 @@ RequestAllocator::ReadRequest(bigtime_t timeout)
 
 	// relocate the request
 	fError = relocate_request(fRequest, fRequestSize, fAllocatedAreas,
-		&fAllocatedAreaCount);
+		&fAllocatedAreaCount, fPort);
 	RETURN_ERROR(fError);
 }
 
@@ -230,6 +236,20 @@ RequestAllocator::AllocateAddress(Address& address, int32 size, int32 align,
 			*data = (uint8*)fRequest + offset;
 			address.SetTo(-1, offset, size);
 		}
+	} else if (fPort->AllocateSharedData(size, align, data, &offset) == B_OK) {
+		// not enough room in the port's buffer, but in the shared data region
+		if (deferredInit) {
+			DeferredInitInfo& info
+				= fDeferredInitInfos[fDeferredInitInfoCount];
+			info.data = NULL;
+			info.area = SHARED_DATA_AREA;
+			info.offset = offset;
+			info.size = size;
+			info.inPortBuffer = false;
+			info.target = &address;
+			fDeferredInitInfoCount++;
+		} else
+			address.SetTo(SHARED_DATA_AREA, offset, size);
 	} else {
 		// not enough room in the port's buffer: we need to allocate an area
 		if (fAllocatedAreaCount >= MAX_REQUEST_ADDRESS_COUNT)
@@ -3,6 +3,7 @@
 #include <limits.h>
 
 #include "Debug.h"
+#include "Port.h"
 #include "Requests.h"
 
 #define _ADD_ADDRESS(_address, _flags)				\
@@ -405,10 +406,12 @@ is_error_reply(ReplyRequest* request)
 
 // RequestRelocator
 struct RequestRelocator {
-	RequestRelocator(int32 requestBufferSize, area_id* areas, int32* count)
+	RequestRelocator(int32 requestBufferSize, area_id* areas, int32* count,
+		const Port* port)
 		: fRequestBufferSize(requestBufferSize),
 		  fAreas(areas),
-		  fAreaCount(count)
+		  fAreaCount(count),
+		  fPort(port)
 	{
 		*fAreaCount = 0;
 	}
@@ -451,7 +454,14 @@ struct RequestRelocator {
 				RETURN_ERROR(B_BAD_DATA);
 			// relocate
 			area_id area = address->GetArea();
-			if (area < 0) {
+			if (area == SHARED_DATA_AREA) {
+				// data in the peer's shared data region of the port
+				void* data = (fPort != NULL
+					? fPort->GetPeerSharedData(offset, size) : NULL);
+				if (data == NULL)
+					RETURN_ERROR(B_BAD_DATA);
+				address->SetRelocatedAddress(data);
+			} else if (area < 0) {
 				// data in the buffer itself
 				if (offset == 0 && size == 0) {
 //PRINT(("    -> relocated address: NULL\n"));
@@ -501,17 +511,18 @@ private:
 	int32		fRequestBufferSize;
 	area_id*	fAreas;
 	int32*		fAreaCount;
+	const Port*	fPort;
 	bool		fSuccess;
 };
 
 // relocate_request
 status_t
 UserlandFSUtil::relocate_request(Request* request, int32 requestBufferSize,
-	area_id* areas, int32* count)
+	area_id* areas, int32* count, const Port* port)
 {
 	if (!request || !areas || !count)
 		return B_BAD_VALUE;
-	RequestRelocator task(requestBufferSize, areas, count);
+	RequestRelocator task(requestBufferSize, areas, count, port);
 	return do_for_request(request, task);
 }
 
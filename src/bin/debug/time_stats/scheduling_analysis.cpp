@@ -127,6 +127,57 @@ wait_object_to_string(scheduling_analysis_wait_object* waitObject, char* buffer,
 }
 
 
+static void
+print_histogram(const char* indentation, const int64* histogram)
+{
+	int64 total = 0;
+	int32 last = -1;
+	for (int32 i = 0; i < SCHEDULING_ANALYSIS_HISTOGRAM_BUCKETS; i++) {
+		total += histogram[i];
+		if (histogram[i] != 0)
+			last = i;
+	}
+
+	int64 count = 0;
+	for (int32 i = 0; i <= last; i++) {
+		count += histogram[i];
+
+		char range[64];
+		if (i == 0)
+			strcpy(range, "< 1 us");
+		else if (i == SCHEDULING_ANALYSIS_HISTOGRAM_BUCKETS - 1)
+			sprintf(range, ">= %lld us", (long long)1 << (i - 1));
+		else {
+			sprintf(range, "%lld - %lld us", (long long)1 << (i - 1),
+				(long long)1 << i);
+		}
+
+		int32 width = histogram[i] * 40 / total;
+		char bar[41];
+		memset(bar, '#', width);
+		bar[width] = '\0';
+
+		printf("%s%18s: %9lld %6.2f%% %s\n", indentation, range, histogram[i],
+			count * 100.0 / total, bar);
+	}
+}
+
+
+static void
+print_migrations(const int64* migrations)
+{
+	printf("%lld (%lld smt, %lld shared cache, %lld package, %lld remote)\n",
+		migrations[SCHEDULER_MIGRATION_SMT]
+			+ migrations[SCHEDULER_MIGRATION_SHARED_CACHE]
+			+ migrations[SCHEDULER_MIGRATION_PACKAGE]
+			+ migrations[SCHEDULER_MIGRATION_REMOTE],
+		migrations[SCHEDULER_MIGRATION_SMT],
+		migrations[SCHEDULER_MIGRATION_SHARED_CACHE],
+		migrations[SCHEDULER_MIGRATION_PACKAGE],
+		migrations[SCHEDULER_MIGRATION_REMOTE]);
+}
+
+
 void
 do_scheduling_analysis(bigtime_t startTime, bigtime_t endTime,
 	size_t bufferSize)
@@ -232,6 +283,12 @@ do_scheduling_analysis(bigtime_t startTime, bigtime_t endTime,
 		printf("  preemptions: %lld us (%lld)\n", thread->total_rerun_time,
 			thread->reruns);
 		printf("  unspecified: %lld us\n", thread->unspecified_wait_time);
+		printf("  migrations:  ");
+		print_migrations(thread->migrations);
+		if (thread->latencies > 0) {
+			printf("  latency histogram:\n");
+			print_histogram("    ", thread->latency_histogram);
+		}
 
 		printf("  waited on:\n");
 		for (int32 i = 0; i < groupCount; i++) {
@@ -271,4 +328,10 @@ do_scheduling_analysis(bigtime_t startTime, bigtime_t endTime,
 			}
 		}
 	}
+
+	printf("\nall threads:\n");
+	printf("  migrations:  ");
+	print_migrations(analysis.migrations);
+	printf("  latency histogram:\n");
+	print_histogram("    ", analysis.latency_histogram);
 }
@@ -54,7 +54,8 @@ LinkReceiver::LinkReceiver(port_id port)
 	:
 	fReceivePort(port), fRecvBuffer(NULL), fRecvPosition(0), fRecvStart(0),
 	fRecvBufferSize(0), fDataSize(0),
-	fReplySize(0), fReadError(B_OK)
+	fReplySize(0), fReadError(B_OK),
+	fPortMessageCount(0), fPortMessageIndex(0)
 {
 }
 
@@ -83,11 +84,13 @@ LinkReceiver::GetNextMessage(int32 &code, bigtime_t timeout)
 	// find the position of the next message header in the buffer
 	message_header *header;
 	if (remaining <= 0) {
-		status_t err = ReadFromPort(timeout);
-		if (err < B_OK)
-			return err;
-		remaining = fDataSize;
-		header = (message_header *)fRecvBuffer;
+		if (!_NextPortMessage()) {
+			status_t err = ReadFromPort(timeout);
+			if (err < B_OK)
+				return err;
+		}
+		remaining = fDataSize - fRecvStart;
+		header = (message_header *)(fRecvBuffer + fRecvStart);
 	} else {
 		fRecvStart += fReplySize;	// start of the next message
 		fRecvPosition = fRecvStart;
@@ -123,6 +126,7 @@ bool
 LinkReceiver::HasMessages() const
 {
 	return fDataSize - (fRecvStart + fReplySize) > 0
+		|| fPortMessageIndex < fPortMessageCount
 		|| port_count(fReceivePort) > 0;
 }
 
@@ -191,8 +195,8 @@ LinkReceiver::AdjustReplyBuffer(bigtime_t timeout)
 
 		// make sure our receive buffer is large enough
 		if (bufferSize > fRecvBufferSize) {
-			if (bufferSize <= (ssize_t)kInitialBufferSize)
-				bufferSize = (ssize_t)kInitialBufferSize;
+			if (bufferSize <= (ssize_t)kReceiveBufferSize)
+				bufferSize = (ssize_t)kReceiveBufferSize;
 			else
 				bufferSize = (bufferSize + B_PAGE_SIZE - 1) & ~(B_PAGE_SIZE - 1);
 
@@ -219,45 +223,62 @@ LinkReceiver::ReadFromPort(bigtime_t timeout)
 {
 	// we are here so it means we finished reading the buffer contents
 	ResetBuffer();
-
-	status_t err = AdjustReplyBuffer(timeout);
-	if (err < B_OK)
-		return err;
-
-	int32 code;
-	ssize_t bytesRead;
+	fPortMessageCount = 0;
+	fPortMessageIndex = 0;
 
 	STRACE(("info: LinkReceiver reading port %ld.\n", fReceivePort));
 	while (true) {
-		if (timeout != B_INFINITE_TIMEOUT) {
-			do {
-				bytesRead = read_port_etc(fReceivePort, &code, fRecvBuffer,
-					fRecvBufferSize, B_TIMEOUT, timeout);
-			} while (bytesRead == B_INTERRUPTED);
-		} else {
-			do {
-				bytesRead = read_port(fReceivePort, &code, fRecvBuffer,
-					fRecvBufferSize);
-			} while (bytesRead == B_INTERRUPTED);
+		// read all messages that are waiting and fit into our buffer at once
+		ssize_t count;
+		do {
+			count = read_port_vector_etc(fReceivePort, fRecvBuffer,
+				fRecvBufferSize, fPortMessages, kMaxPortMessages,
+				timeout == B_INFINITE_TIMEOUT ? 0 : B_RELATIVE_TIMEOUT,
+				timeout);
+		} while (count == B_INTERRUPTED);
+
+		if (count == B_BUFFER_OVERFLOW) {
+			// the next message doesn't fit into our buffer
+			status_t err = AdjustReplyBuffer(timeout);
+			if (err < B_OK)
+				return err;
+			continue;
 		}
 
-		STRACE(("info: LinkReceiver read %ld bytes.\n", bytesRead));
-		if (bytesRead < B_OK)
-			return bytesRead;
+		STRACE(("info: LinkReceiver read %ld messages.\n", count));
+		if (count < B_OK)
+			return count;
+
+		fPortMessageCount = count;
 
 		// we just ignore incorrect messages, and don't bother our caller
+		if (_NextPortMessage())
+			return B_OK;
+	}
+}
+
 
-		if (code != kLinkCode) {
-			STRACE(("wrong port message %lx received.\n", code));
+/*!	Makes the next valid port message read by ReadFromPort() the current
+	one, if there is any left.
+*/
+bool
+LinkReceiver::_NextPortMessage()
+{
+	while (fPortMessageIndex < fPortMessageCount) {
+		const port_message_entry& entry = fPortMessages[fPortMessageIndex++];
+		if (entry.code != kLinkCode) {
+			STRACE(("wrong port message %lx received.\n", entry.code));
 			continue;
 		}
 
-		// port read seems to be valid
-		break;
+		fRecvStart = (char *)entry.buffer - fRecvBuffer;
+		fRecvPosition = fRecvStart;
+		fDataSize = fRecvStart + entry.size;
+		fReplySize = 0;
+		return true;
 	}
 
-	fDataSize = bytesRead;
-	return B_OK;
+	return false;
 }
 
 
@@ -55,6 +55,10 @@ static BLocker sDebugPrintLocker("BLooper debug print");
 #define FILTER_LIST_BLOCK_SIZE	5
 #define DATA_BLOCK_SIZE			5
 
+// messages are read from the port up to this many at a time
+static const int32 kPortBatchCount = 16;
+static const size_t kPortBatchBufferSize = 8192;
+
 
 using BPrivate::gDefaultTokens;
 using BPrivate::gLooperList;
@@ -1050,11 +1054,11 @@ BLooper::_InitData(const char* name, int32 priority, port_id port,
 void
 BLooper::AddMessage(BMessage* message)
 {
-	_AddMessagePriv(message);
+	bool wasEmpty;
+	fDirectTarget->AddMessage(message, &wasEmpty);
 
 	// wakeup looper when being called from other threads if necessary
-	if (find_thread(NULL) != Thread()
-		&& fDirectTarget->Queue()->IsNextMessage(message)
+	if (wasEmpty && find_thread(NULL) != Thread()
 		&& port_count(fMsgPort) <= 0) {
 		// there is currently no message waiting, and we need to wakeup the
 		// looper
@@ -1150,6 +1154,55 @@ BLooper::ReadMessageFromPort(bigtime_t timeout)
 }
 
 
+/*!	Waits up to \a timeout for a message to arrive at the port, and then
+	adds it to the message queue together with all other messages that are
+	already waiting in the port. The messages are read several at a time.
+*/
+void
+BLooper::_ReadMessagesFromPort(bigtime_t timeout)
+{
+	PRINT(("BLooper::_ReadMessagesFromPort()\n"));
+	uint64 buffer[kPortBatchBufferSize / sizeof(uint64)];
+	port_message_entry entries[kPortBatchCount];
+
+	// Don't read more than the port can hold at once, so that we get to
+	// dispatch messages even if someone keeps sending them
+	int32 messagesLeft = B_LOOPER_PORT_DEFAULT_CAPACITY;
+	uint32 flags = timeout == B_INFINITE_TIMEOUT ? 0 : B_RELATIVE_TIMEOUT;
+
+	while (messagesLeft > 0) {
+		ssize_t count = read_port_vector_etc(fMsgPort, buffer, sizeof(buffer),
+			entries, kPortBatchCount, flags, timeout);
+		if (count == B_INTERRUPTED)
+			continue;
+
+		// only wait for the first message
+		flags = B_RELATIVE_TIMEOUT;
+		timeout = 0;
+
+		if (count == B_BUFFER_OVERFLOW) {
+			// the next message is too large for our buffer
+			BMessage* message = MessageFromPort(0);
+			if (message != NULL)
+				_AddMessagePriv(message);
+			messagesLeft--;
+			continue;
+		}
+		if (count <= 0)
+			break;
+
+		for (ssize_t i = 0; i < count; i++) {
+			BMessage* message = ConvertToMessage(
+				entries[i].size > 0 ? entries[i].buffer : NULL,
+				entries[i].code);
+			if (message != NULL)
+				_AddMessagePriv(message);
+		}
+		messagesLeft -= count;
+	}
+}
+
+
 BMessage*
 BLooper::ConvertToMessage(void* buffer, int32 code)
 {
@@ -1186,24 +1239,10 @@ BLooper::task_looper()
 		PRINT(("LOOPER: outer loop\n"));
 		// TODO: timeout determination algo
 		//	Read from message port (how do we determine what the timeout is?)
-		PRINT(("LOOPER: MessageFromPort()...\n"));
-		BMessage* msg = MessageFromPort();
+		PRINT(("LOOPER: _ReadMessagesFromPort()...\n"));
+		_ReadMessagesFromPort();
 		PRINT(("LOOPER: ...done\n"));
 
-		//	Did we get a message?
-		if (msg)
-			_AddMessagePriv(msg);
-
-		// Get message count from port
-		int32 msgCount = port_count(fMsgPort);
-		for (int32 i = 0; i < msgCount; ++i) {
-			// Read 'count' messages from port (so we will not block)
-			// We use zero as our timeout since we know there is stuff there
-			msg = MessageFromPort(0);
-			if (msg)
-				_AddMessagePriv(msg);
-		}
-
 		// loop: As long as there are messages in the queue and the port is
 		//		 empty... and we are not terminating, of course.
 		bool dispatchNextMessage = true;
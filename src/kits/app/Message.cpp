@@ -77,6 +77,23 @@ extern "C" {
 }
 
 
+/*!	Open addressed hash table that maps field names to field indices. It is
+	only built for messages with many fields, small ones are served well
+	enough by the hash table in the message header. The full hash of every
+	name is kept, so that most mismatches don't need a string compare.
+*/
+struct BMessage::field_index {
+	struct slot {
+		uint32	hash;
+		int32	field;
+	};
+
+	uint32		mask;
+	uint32		count;
+	slot		slots[0];
+};
+
+
 BBlockCache* BMessage::sMsgCache = NULL;
 port_id BMessage::sReplyPorts[sNumReplyPorts];
 int32 BMessage::sReplyPortInUse[sNumReplyPorts];
@@ -238,7 +255,10 @@ BMessage::operator=(const BMessage& other)
 	fHeader->message_area = -1;
 	fFieldsAvailable = 0;
 	fDataAvailable = 0;
+	if (fData != NULL)
+		fDataGarbage = other.fDataGarbage;
 
+	_UpdateFieldIndex();
 	return *this;
 }
 
@@ -359,6 +379,9 @@ BMessage::_InitCommon(bool initHeader)
 
 	fArchivingPointer = NULL;
 
+	fFieldIndex = NULL;
+	fDataGarbage = 0;
+
 	if (initHeader)
 		return _InitHeader();
 
@@ -421,8 +444,10 @@ BMessage::_Clear()
 
 	fArchivingPointer = NULL;
 
+	_DeleteFieldIndex();
 	fFieldsAvailable = 0;
 	fDataAvailable = 0;
+	fDataGarbage = 0;
 
 	delete fOriginal;
 	fOriginal = NULL;
@@ -798,10 +823,9 @@ BMessage::Rename(const char* oldEntry, const char* newEntry)
 			field->next_field = -1;
 
 			hash = _HashName(newEntry) % fHeader->hash_table_size;
-			nextField = &fHeader->hash_table[hash];
-			while (*nextField >= 0)
-				nextField = &fFields[*nextField].next_field;
-			*nextField = index;
+			field->next_field = fHeader->hash_table[hash];
+			fHeader->hash_table[hash] = index;
+			_DeleteFieldIndex();
 
 			int32 newLength = strlen(newEntry) + 1;
 			result = _ResizeData(field->offset + 1,
@@ -811,6 +835,7 @@ BMessage::Rename(const char* oldEntry, const char* newEntry)
 
 			memcpy(fData + field->offset, newEntry, newLength);
 			field->name_length = newLength;
+			_UpdateFieldIndex();
 			return B_OK;
 		}
 
@@ -1028,8 +1053,9 @@ BMessage::FlattenedSize() const
 	if (fHeader == NULL)
 		return B_NO_INIT;
 
+	// the unused parts of the data are not flattened
 	return sizeof(message_header) + fHeader->field_count * sizeof(field_header)
-		+ fHeader->data_size;
+		+ fHeader->data_size - fDataGarbage;
 }
 
 
@@ -1050,9 +1076,15 @@ BMessage::Flatten(char* buffer, ssize_t size) const
 	fHeader->what = what;
 
 	memcpy(buffer, fHeader, sizeof(message_header));
+	((message_header*)buffer)->data_size -= fDataGarbage;
 	buffer += sizeof(message_header);
 
 	size_t fieldsSize = fHeader->field_count * sizeof(field_header);
+	if (fDataGarbage > 0) {
+		_CopyCompactedData((field_header*)buffer, (uint8*)buffer + fieldsSize);
+		return B_OK;
+	}
+
 	memcpy(buffer, fFields, fieldsSize);
 	buffer += fieldsSize;
 
@@ -1072,6 +1104,26 @@ BMessage::Flatten(BDataIO* stream, ssize_t* size) const
 	if (fHeader == NULL)
 		return B_NO_INIT;
 
+	if (fDataGarbage > 0) {
+		// write a compacted copy, the message itself must not be changed
+		ssize_t flattenedSize = FlattenedSize();
+		char* buffer = (char*)malloc(flattenedSize);
+		if (buffer == NULL)
+			return B_NO_MEMORY;
+
+		status_t result = Flatten(buffer, flattenedSize);
+		if (result == B_OK) {
+			ssize_t written = stream->Write(buffer, flattenedSize);
+			if (written != flattenedSize)
+				result = written < 0 ? written : B_ERROR;
+			else if (size != NULL)
+				*size = flattenedSize;
+		}
+
+		free(buffer);
+		return result;
+	}
+
 	/* we have to sync the what code as it is a public member */
 	fHeader->what = what;
 
@@ -1142,6 +1194,7 @@ BMessage::_FlattenToArea(message_header** _header) const
 		return B_NO_MEMORY;
 
 	memcpy(header, fHeader, sizeof(message_header));
+	header->data_size -= fDataGarbage;
 
 	header->what = what;
 	header->message_area = -1;
@@ -1163,8 +1216,12 @@ BMessage::_FlattenToArea(message_header** _header) const
 		return area;
 	}
 
-	memcpy(address, fFields, fieldsSize);
-	memcpy(address + fieldsSize, fData, fHeader->data_size);
+	if (fDataGarbage > 0)
+		_CopyCompactedData((field_header*)address, (uint8*)address + fieldsSize);
+	else {
+		memcpy(address, fFields, fieldsSize);
+		memcpy(address + fieldsSize, fData, fHeader->data_size);
+	}
 	header->flags |= MESSAGE_FLAG_PASS_BY_AREA;
 	header->message_area = area;
 	return B_OK;
@@ -1192,6 +1249,11 @@ BMessage::_Reference()
 	if (areaInfo.team != BPrivate::current_team())
 		return B_BAD_VALUE;
 
+	if ((uint64)fHeader->field_count * sizeof(field_header)
+			+ fHeader->data_size > areaInfo.size) {
+		return B_BAD_VALUE;
+	}
+
 	set_area_protection(fHeader->message_area, B_READ_AREA);
 
 	uint8* address = (uint8*)areaInfo.address;
@@ -1264,24 +1326,37 @@ BMessage::_ValidateMessage()
 	if (fHeader == NULL)
 		return B_NO_INIT;
 
-	if (fHeader->field_count == 0)
-		return B_OK;
+	uint32 fieldCount = fHeader->field_count;
+	bool valid = fHeader->hash_table_size > 0
+		&& fHeader->hash_table_size <= MESSAGE_BODY_HASH_TABLE_SIZE
+		&& (fieldCount == 0 || (fFields != NULL && fData != NULL));
 
-	if (fFields == NULL)
-		return B_NO_INIT;
+	for (uint32 i = 0; valid && i < fHeader->hash_table_size; i++) {
+		if (fHeader->hash_table[i] >= 0
+			&& (uint32)fHeader->hash_table[i] >= fieldCount) {
+			valid = false;
+		}
+	}
 
-	for (uint32 i = 0; i < fHeader->field_count; i++) {
+	for (uint32 i = 0; valid && i < fieldCount; i++) {
 		field_header* field = &fFields[i];
-		if ((field->next_field >= 0
-				&& (uint32)field->next_field > fHeader->field_count)
-			|| (field->offset + field->name_length + field->data_size
-				> fHeader->data_size)) {
-			// the message is corrupt
-			MakeEmpty();
-			return B_BAD_VALUE;
+		if ((field->next_field >= 0 && (uint32)field->next_field >= fieldCount)
+			|| field->name_length == 0 || field->count == 0
+			|| (uint64)field->offset + field->name_length + field->data_size
+				> fHeader->data_size
+			|| fData[field->offset + field->name_length - 1] != '\0') {
+			valid = false;
 		}
 	}
 
+	if (!valid) {
+		// the message is corrupt
+		MakeEmpty();
+		return B_BAD_VALUE;
+	}
+
+	// Build the field index now, as the const methods only use it
+	_UpdateFieldIndex();
 	return B_OK;
 }
 
@@ -1573,10 +1648,9 @@ BMessage::_ResizeData(uint32 offset, int32 change)
 			if (offset < fHeader->data_size) {
 				memmove(fData + offset + change, fData + offset,
 					fHeader->data_size - offset);
+				_UpdateOffsets(offset, change);
 			}
 
-			_UpdateOffsets(offset, change);
-
 			fDataAvailable -= change;
 			fHeader->data_size += change;
 			return B_OK;
@@ -1596,10 +1670,12 @@ BMessage::_ResizeData(uint32 offset, int32 change)
 		if (offset < fHeader->data_size) {
 			memmove(fData + offset + change, fData + offset,
 				fHeader->data_size - offset);
+			_UpdateOffsets(offset, change);
 		}
 
 		fHeader->data_size += change;
 		fDataAvailable = size - fHeader->data_size;
+		return B_OK;
 	} else {
 		ssize_t length = fHeader->data_size - offset + change;
 		if (length > 0)
@@ -1629,6 +1705,93 @@ BMessage::_ResizeData(uint32 offset, int32 change)
 }
 
 
+/*!	Moves the name and data of \a field to the end of the data, so that it
+	can grow without moving all of the data behind it. The space it used
+	before is accounted as garbage, and is reclaimed by _CompactData().
+	Nothing is done if moving the field would be more expensive than moving
+	the data behind it.
+*/
+status_t
+BMessage::_MoveFieldToEnd(field_header* field)
+{
+	uint32 size = field->name_length + field->data_size;
+	uint32 end = field->offset + size;
+	if (end >= fHeader->data_size || fHeader->data_size - end <= size)
+		return B_OK;
+
+	uint32 offset = field->offset;
+	uint32 newOffset = fHeader->data_size;
+	status_t result = _ResizeData(newOffset, size);
+	if (result != B_OK)
+		return result;
+
+	memcpy(fData + newOffset, fData + offset, size);
+	field->offset = newOffset;
+	fDataGarbage += size;
+
+	if (fDataGarbage > fHeader->data_size / 2)
+		_CompactData();
+
+	return B_OK;
+}
+
+
+/*!	Removes the garbage left behind by _MoveFieldToEnd(), and puts the data
+	of the fields back into field order. Failing to do so is not fatal, the
+	unused parts of the data then just remain in the message.
+*/
+status_t
+BMessage::_CompactData()
+{
+	if (fHeader == NULL || fDataGarbage == 0)
+		return B_OK;
+
+	uint32 size = fHeader->data_size - fDataGarbage;
+	uint8* newData = NULL;
+	if (size > 0) {
+		newData = (uint8*)malloc(size);
+		if (newData == NULL)
+			return B_NO_MEMORY;
+	}
+
+	uint32 offset = 0;
+	field_header* field = fFields;
+	for (uint32 i = 0; i < fHeader->field_count; i++, field++) {
+		uint32 fieldSize = field->name_length + field->data_size;
+		memcpy(newData + offset, fData + field->offset, fieldSize);
+		field->offset = offset;
+		offset += fieldSize;
+	}
+
+	free(fData);
+	fData = newData;
+	fHeader->data_size = size;
+	fDataAvailable = 0;
+	fDataGarbage = 0;
+	return B_OK;
+}
+
+
+/*!	Copies the fields to \a fields, and their names and data without the
+	garbage to \a data, like _CompactData() would leave them. Since the
+	message itself is not changed, it can still be flattened from several
+	threads at once.
+*/
+void
+BMessage::_CopyCompactedData(field_header* fields, uint8* data) const
+{
+	uint32 offset = 0;
+	for (uint32 i = 0; i < fHeader->field_count; i++) {
+		uint32 fieldSize = fFields[i].name_length + fFields[i].data_size;
+		memcpy(data + offset, fData + fFields[i].offset, fieldSize);
+
+		fields[i] = fFields[i];
+		fields[i].offset = offset;
+		offset += fieldSize;
+	}
+}
+
+
 uint32
 BMessage::_HashName(const char* name) const
 {
@@ -1645,6 +1808,91 @@ BMessage::_HashName(const char* name) const
 }
 
 
+status_t
+BMessage::_BuildFieldIndex()
+{
+	uint32 fieldCount = fHeader->field_count;
+	uint32 slotCount = 16;
+	while (slotCount * 3 / 4 <= fieldCount)
+		slotCount *= 2;
+
+	field_index* index = (field_index*)malloc(sizeof(field_index)
+		+ slotCount * sizeof(field_index::slot));
+	if (index == NULL)
+		return B_NO_MEMORY;
+
+	index->mask = slotCount - 1;
+	index->count = 0;
+	for (uint32 i = 0; i < slotCount; i++)
+		index->slots[i].field = -1;
+
+	for (uint32 i = 0; i < fieldCount; i++) {
+		uint32 hash = _HashName((const char*)(fData + fFields[i].offset));
+		uint32 slot = hash & index->mask;
+		while (index->slots[slot].field >= 0)
+			slot = (slot + 1) & index->mask;
+
+		index->slots[slot].hash = hash;
+		index->slots[slot].field = i;
+		index->count++;
+	}
+
+	free(fFieldIndex);
+	fFieldIndex = index;
+	return B_OK;
+}
+
+
+/*!	Builds the field index for messages that have enough fields to need
+	one, and drops it for all others. This must be called whenever the
+	fields change in another way than being added: the const methods only
+	ever read the index, so that a message that isn't changed can be used
+	from several threads at once.
+*/
+void
+BMessage::_UpdateFieldIndex()
+{
+	if (fHeader == NULL || fHeader->field_count < MIN_INDEXED_FIELD_COUNT
+		|| _BuildFieldIndex() != B_OK) {
+		// without an index, the hash table in the header is used
+		_DeleteFieldIndex();
+	}
+}
+
+
+/*!	Adds the field at \a fieldIndex to the field index, or builds the index
+	if the message now has enough fields for one.
+*/
+void
+BMessage::_IndexField(uint32 fieldIndex)
+{
+	field_index* index = fFieldIndex;
+	if (index == NULL || (index->count + 1) * 4 > (index->mask + 1) * 3) {
+		// the message got large enough to need an index, or the index is
+		// too crowded, and needs more slots
+		_UpdateFieldIndex();
+		return;
+	}
+
+	uint32 hash = _HashName((const char*)(fData + fFields[fieldIndex].offset));
+	uint32 slot = hash & index->mask;
+	while (index->slots[slot].field >= 0)
+		slot = (slot + 1) & index->mask;
+
+	index->slots[slot].hash = hash;
+	index->slots[slot].field = fieldIndex;
+	index->count++;
+}
+
+
+void
+BMessage::_DeleteFieldIndex()
+{
+	free(fFieldIndex);
+	fFieldIndex = NULL;
+}
+
+
 status_t
 BMessage::_FindField(const char* name, type_code type, field_header** result)
 	const
@@ -1658,6 +1906,29 @@ BMessage::_FindField(const char* name, type_code type, field_header** result)
 	if (fHeader->field_count == 0 || fFields == NULL || fData == NULL)
 		return B_NAME_NOT_FOUND;
 
+	if (fFieldIndex != NULL) {
+		uint32 hash = _HashName(name);
+		uint32 slot = hash & fFieldIndex->mask;
+
+		while (fFieldIndex->slots[slot].field >= 0) {
+			if (fFieldIndex->slots[slot].hash == hash) {
+				field_header* field = &fFields[fFieldIndex->slots[slot].field];
+				if (strncmp((const char*)(fData + field->offset), name,
+						field->name_length) == 0) {
+					if (type != B_ANY_TYPE && field->type != type)
+						return B_BAD_TYPE;
+
+					*result = field;
+					return B_OK;
+				}
+			}
+
+			slot = (slot + 1) & fFieldIndex->mask;
+		}
+
+		return B_NAME_NOT_FOUND;
+	}
+
 	uint32 hash = _HashName(name) % fHeader->hash_table_size;
 	int32 nextField = fHeader->hash_table[hash];
 
@@ -1702,17 +1973,11 @@ BMessage::_AddField(const char* name, type_code type, bool isFixedSize,
 		fFieldsAvailable = count - fHeader->field_count;
 	}
 
-	uint32 hash = _HashName(name) % fHeader->hash_table_size;
-	int32* nextField = &fHeader->hash_table[hash];
-	while (*nextField >= 0)
-		nextField = &fFields[*nextField].next_field;
-	*nextField = fHeader->field_count;
-
-	field_header* field = &fFields[fHeader->field_count];
+	uint32 index = fHeader->field_count;
+	field_header* field = &fFields[index];
 	field->type = type;
 	field->count = 0;
 	field->data_size = 0;
-	field->next_field = -1;
 	field->offset = fHeader->data_size;
 	field->name_length = strlen(name) + 1;
 	status_t status = _ResizeData(field->offset, field->name_length);
@@ -1724,8 +1989,16 @@ BMessage::_AddField(const char* name, type_code type, bool isFixedSize,
 	if (isFixedSize)
 		field->flags |= FIELD_FLAG_FIXED_SIZE;
 
+	// The order of the fields in a hash chain doesn't matter, so we can just
+	// put the new one in front.
+	uint32 hash = _HashName(name) % fHeader->hash_table_size;
+	field->next_field = fHeader->hash_table[hash];
+	fHeader->hash_table[hash] = index;
+
 	fFieldsAvailable--;
 	fHeader->field_count++;
+	_IndexField(index);
+
 	*result = field;
 	return B_OK;
 }
@@ -1765,6 +2038,9 @@ BMessage::_RemoveField(field_header* field)
 	fHeader->field_count--;
 	fFieldsAvailable++;
 
+	// the indices of all following fields have changed
+	_UpdateFieldIndex();
+
 	if (fFieldsAvailable > MAX_FIELD_PREALLOCATION) {
 		ssize_t available = MAX_FIELD_PREALLOCATION / 2;
 		size = (fHeader->field_count + available) * sizeof(field_header);
@@ -1814,6 +2090,13 @@ BMessage::AddData(const char* name, type_code type, const void* data,
 	if (field == NULL)
 		return B_ERROR;
 
+	if (field->count > 0) {
+		// make sure we only append to the data
+		result = _MoveFieldToEnd(field);
+		if (result != B_OK)
+			return result;
+	}
+
 	uint32 offset = field->offset + field->name_length + field->data_size;
 	if ((field->flags & FIELD_FLAG_FIXED_SIZE) != 0) {
 		if (field->count) {
@@ -2254,8 +2537,9 @@ BMessage::_SendMessage(port_id port, team_id portOwner, int32 token,
 			char(what >> 24), char(what >> 16), char(what >> 8), (char)what);
 
 		// this is a local message transmission
-		direct->AddMessage(copy);
-		if (direct->Queue()->IsNextMessage(copy) && port_count(port) <= 0) {
+		bool wasEmpty;
+		if (direct->AddMessage(copy, &wasEmpty) && wasEmpty
+			&& port_count(port) <= 0) {
 			// there is currently no message waiting, and we need to wakeup the
 			// looper
 			write_port_etc(port, 0, NULL, 0, B_RELATIVE_TIMEOUT, 0);
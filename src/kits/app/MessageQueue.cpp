@@ -9,6 +9,12 @@
 
 
 // Queue for holding BMessages
+//
+// Adding a message does not need the lock: new messages are pushed onto an
+// incoming list with an atomic operation, and are merged into the locked list
+// by whoever needs to look at the queue next. Since the looper thread is the
+// only one that removes messages in practice, posting threads never contend
+// with each other, nor with the looper.
 
 
 #include <MessageQueue.h>
@@ -16,12 +22,39 @@
 #include <Message.h>
 
 
+static inline BMessage*
+atomic_message_test_and_set(BMessage** _pointer, BMessage* set,
+	BMessage* test)
+{
+#if B_HAIKU_64_BIT
+	return (BMessage*)atomic_test_and_set64((int64*)_pointer, (int64)set,
+		(int64)test);
+#else
+	return (BMessage*)atomic_test_and_set((int32*)_pointer, (int32)set,
+		(int32)test);
+#endif
+}
+
+
+static inline BMessage*
+atomic_message_get_and_set(BMessage** _pointer, BMessage* set)
+{
+#if B_HAIKU_64_BIT
+	return (BMessage*)atomic_get_and_set64((int64*)_pointer, (int64)set);
+#else
+	return (BMessage*)atomic_get_and_set((int32*)_pointer, (int32)set);
+#endif
+}
+
+
 BMessageQueue::BMessageQueue()
 	:
 	fHead(NULL),
 	fTail(NULL),
 	fMessageCount(0),
-	fLock("BMessageQueue Lock")
+	fLock("BMessageQueue Lock"),
+	fIncoming(NULL),
+	fIncomingCount(0)
 {
 }
 
@@ -31,6 +64,8 @@ BMessageQueue::~BMessageQueue()
 	if (!Lock())
 		return;
 
+	_MergeIncoming();
+
 	BMessage* message = fHead;
 	while (message != NULL) {
 		BMessage* next = message->fQueueLink;
@@ -47,24 +82,7 @@ BMessageQueue::AddMessage(BMessage* message)
 	if (message == NULL)
 		return;
 
-	BAutolock _(fLock);
-	if (!IsLocked())
-		return;
-
-	// The message passed in will be the last message on the queue so its
-	// link member should be set to null.
-	message->fQueueLink = NULL;
-
-	fMessageCount++;
-
-	if (fTail == NULL) {
-		// there are no messages in the queue yet
-		fHead = fTail = message;
-	} else {
-		// just add it after the tail
-		fTail->fQueueLink = message;
-		fTail = message;
-	}
+	_AddMessage(message);
 }
 
 
@@ -78,6 +96,8 @@ BMessageQueue::RemoveMessage(BMessage* message)
 	if (!IsLocked())
 		return;
 
+	_MergeIncoming();
+
 	BMessage* last = NULL;
 	for (BMessage* entry = fHead; entry != NULL; entry = entry->fQueueLink) {
 		if (entry == message) {
@@ -101,14 +121,14 @@ BMessageQueue::RemoveMessage(BMessage* message)
 int32
 BMessageQueue::CountMessages() const
 {
-    return fMessageCount;
+	return atomic_get(&fMessageCount) + atomic_get((int32*)&fIncomingCount);
 }
 
 
 bool
 BMessageQueue::IsEmpty() const
 {
-    return fMessageCount == 0;
+	return CountMessages() == 0;
 }
 
 
@@ -119,6 +139,8 @@ BMessageQueue::FindMessage(int32 index) const
 	if (!IsLocked())
 		return NULL;
 
+	_MergeIncoming();
+
 	if (index < 0 || index >= fMessageCount)
 		return NULL;
 
@@ -141,6 +163,8 @@ BMessageQueue::FindMessage(uint32 what, int32 index) const
 	if (!IsLocked())
 		return NULL;
 
+	_MergeIncoming();
+
 	if (index < 0 || index >= fMessageCount)
 		return NULL;
 
@@ -188,6 +212,9 @@ BMessageQueue::NextMessage()
 
 	// remove the head of the queue, if any, and return it
 
+	if (fHead == NULL)
+		_MergeIncoming();
+
 	BMessage* head = fHead;
 	if (head == NULL)
 		return NULL;
@@ -210,6 +237,9 @@ bool
 BMessageQueue::IsNextMessage(const BMessage* message) const
 {
 	BAutolock _(fLock);
+	if (fHead == NULL)
+		_MergeIncoming();
+
 	return fHead == message;
 }
 
@@ -223,6 +253,59 @@ BMessageQueue::IsLocked()
 }
 
 
+/*!	Adds \a message to the queue without locking it.
+	Returns whether the queue was empty before, ie. whether the consumer of
+	the queue might have to be woken up.
+*/
+bool
+BMessageQueue::_AddMessage(BMessage* message)
+{
+	atomic_add(&fIncomingCount, 1);
+
+	BMessage* head;
+	do {
+		head = fIncoming;
+		message->fQueueLink = head;
+	} while (atomic_message_test_and_set(&fIncoming, message, head) != head);
+
+	return head == NULL && atomic_get(&fMessageCount) == 0;
+}
+
+
+/*!	Moves all messages that have been added since the last call to the end
+	of the locked list. The queue must be locked.
+*/
+void
+BMessageQueue::_MergeIncoming() const
+{
+	BMessage* message = atomic_message_get_and_set(
+		const_cast<BMessage**>(&fIncoming), NULL);
+	if (message == NULL)
+		return;
+
+	// the incoming list is in reverse order
+	BMessage* first = NULL;
+	BMessage* last = message;
+	int32 count = 0;
+	while (message != NULL) {
+		BMessage* next = message->fQueueLink;
+		message->fQueueLink = first;
+		first = message;
+		message = next;
+		count++;
+	}
+
+	if (fTail == NULL)
+		fHead = first;
+	else
+		fTail->fQueueLink = first;
+	fTail = last;
+
+	atomic_add(&fMessageCount, count);
+	atomic_add(const_cast<int32*>(&fIncomingCount), -count);
+}
+
+
 void BMessageQueue::_ReservedMessageQueue1() {}
 void BMessageQueue::_ReservedMessageQueue2() {}
 void BMessageQueue::_ReservedMessageQueue3() {}
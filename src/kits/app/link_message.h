@@ -17,6 +17,8 @@ static const int32 kLinkCode = '_PTL';
 static const size_t kInitialBufferSize = 2048;
 static const size_t kMaxBufferSize = 65536;
 	// anything beyond that should be sent with a different mechanism
+static const size_t kReceiveBufferSize = 8192;
+	// allows to read several messages from the port at once
 
 struct message_header {
 	int32	size;
@@ -178,6 +178,14 @@ PackageFileHeapAccessorBase::OffsetArray::_AllocateOffsetArray(
 }
 
 
+// #pragma mark - ChunkCache
+
+
+PackageFileHeapAccessorBase::ChunkCache::~ChunkCache()
+{
+}
+
+
 // #pragma mark - PackageFileHeapAccessorBase
 
 
@@ -190,7 +198,8 @@ PackageFileHeapAccessorBase::PackageFileHeapAccessorBase(
 	fHeapOffset(heapOffset),
 	fCompressedHeapSize(0),
 	fUncompressedHeapSize(0),
-	fDecompressionAlgorithm(decompressionAlgorithm)
+	fDecompressionAlgorithm(decompressionAlgorithm),
+	fChunkCache(NULL)
 {
 	if (fDecompressionAlgorithm != NULL)
 		fDecompressionAlgorithm->AcquireReference();
@@ -199,6 +208,9 @@ PackageFileHeapAccessorBase::PackageFileHeapAccessorBase(
 
 PackageFileHeapAccessorBase::~PackageFileHeapAccessorBase()
 {
+	if (fChunkCache != NULL)
+		fChunkCache->RemoveChunks(this);
+
 	if (fDecompressionAlgorithm != NULL)
 		fDecompressionAlgorithm->ReleaseReference();
 }
@@ -207,6 +219,19 @@ PackageFileHeapAccessorBase::~PackageFileHeapAccessorBase()
 status_t
 PackageFileHeapAccessorBase::ReadDataToOutput(off_t offset, size_t size,
 	BDataIO* output)
+{
+	return ReadDataToOutput(offset, size, output, false);
+}
+
+
+/*!	Like ReadDataToOutput(), but if \a useChunkCache is \c true, and a chunk
+	cache has been set, the decompressed chunks are looked up in and added to
+	it. Readers that keep the data in a cache of their own anyway should not
+	use it, or else the data is cached twice.
+*/
+status_t
+PackageFileHeapAccessorBase::ReadDataToOutput(off_t offset, size_t size,
+	BDataIO* output, bool useChunkCache)
 {
 	if (size == 0)
 		return B_OK;
@@ -261,20 +286,38 @@ PackageFileHeapAccessorBase::ReadDataToOutput(off_t offset, size_t size,
 	size_t chunkIndex = size_t(offset / kChunkSize);
 	size_t inChunkOffset = (uint64)offset - (uint64)chunkIndex * kChunkSize;
 	size_t remainingBytes = size;
+	ChunkCache* chunkCache = useChunkCache ? fChunkCache : NULL;
 
 	while (remainingBytes > 0) {
-		status_t error = ReadAndDecompressChunk(chunkIndex,
-			compressedDataBuffer, uncompressedDataBuffer);
-		if (error != B_OK)
-			return error;
+		const void* chunkData = NULL;
+		void* cachedChunk = NULL;
+		if (chunkCache != NULL)
+			cachedChunk = chunkCache->AcquireChunk(this, chunkIndex, chunkData);
+
+		if (cachedChunk == NULL) {
+			status_t error = ReadAndDecompressChunk(chunkIndex,
+				compressedDataBuffer, uncompressedDataBuffer);
+			if (error != B_OK)
+				return error;
+
+			chunkData = uncompressedDataBuffer;
+			if (chunkCache != NULL) {
+				chunkCache->InsertChunk(this, chunkIndex, chunkData,
+					std::min((uint64)kChunkSize,
+						fUncompressedHeapSize - (uint64)chunkIndex * kChunkSize));
+			}
+		}
 
 		size_t toWrite = std::min((size_t)kChunkSize - inChunkOffset,
 			remainingBytes);
 			// The last chunk may be shorter than kChunkSize, but since
 			// size (and thus remainingSize) had been clamped, that doesn't
 			// harm.
-		error = output->WriteExactly(
-			(char*)uncompressedDataBuffer + inChunkOffset, toWrite);
+		status_t error = output->WriteExactly(
+			(const char*)chunkData + inChunkOffset, toWrite);
+
+		if (cachedChunk != NULL)
+			chunkCache->ReleaseChunk(cachedChunk);
 		if (error != B_OK)
 			return error;
 
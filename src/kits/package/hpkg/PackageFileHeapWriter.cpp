@@ -9,6 +9,10 @@
 #include <algorithm>
 #include <new>
 
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
 #include <ByteOrder.h>
 #include <List.h>
 #include <package/hpkg/ErrorOutput.h>
@@ -19,11 +23,18 @@
 #include <package/hpkg/PackageFileHeapReader.h>
 #include <RangeArray.h>
 #include <CompressionAlgorithm.h>
+#include <ScopeExit.h>
 
 
 // minimum length of data we require before trying to compress them
 static const size_t kCompressionSizeThreshold = 64;
 
+// maximum number of threads compressing chunks in parallel
+static const int32 kMaxCompressionThreads = 16;
+
+// number of chunks that may be queued per compression thread
+static const int32 kCompressionJobsPerThread = 2;
+
 
 namespace BPackageKit {
 
@@ -194,6 +205,205 @@ private:
 };
 
 
+struct PackageFileHeapWriter::CompressionJob {
+	void*		data;
+	void*		compressedData;
+	size_t		size;
+	size_t		compressedSize;
+		// equals size, if the data are to be stored uncompressed
+	status_t	status;
+	bool		done;
+};
+
+
+/*!	Compresses full chunks on a pool of worker threads.
+	The writer submits chunks in heap order, and writes them back in the same
+	order once they have been compressed, so that the resulting heap does not
+	depend on the number of threads. The number of jobs, and therefore the
+	memory in flight, is bounded; when all jobs are in use, the writer has to
+	write back the oldest one before it can submit another chunk.
+	Only the writer thread submits and removes jobs.
+*/
+struct PackageFileHeapWriter::CompressionPipeline {
+	CompressionPipeline(CompressionAlgorithmOwner* compressionAlgorithm,
+		int32 threadCount)
+		:
+		fCompressionAlgorithm(compressionAlgorithm),
+		fJobs(NULL),
+		fJobCount(threadCount * kCompressionJobsPerThread),
+		fSubmitted(0),
+		fRemoved(0),
+		fNextToCompress(0),
+		fThreads(NULL),
+		fThreadCount(0),
+		fMaxThreadCount(threadCount),
+		fQuit(false)
+	{
+		pthread_mutex_init(&fLock, NULL);
+		pthread_cond_init(&fWorkCondition, NULL);
+		pthread_cond_init(&fDoneCondition, NULL);
+	}
+
+	~CompressionPipeline()
+	{
+		pthread_mutex_lock(&fLock);
+		fQuit = true;
+		pthread_cond_broadcast(&fWorkCondition);
+		pthread_mutex_unlock(&fLock);
+
+		for (int32 i = 0; i < fThreadCount; i++)
+			pthread_join(fThreads[i], NULL);
+		delete[] fThreads;
+
+		if (fJobs != NULL) {
+			for (int32 i = 0; i < fJobCount; i++) {
+				free(fJobs[i].data);
+				free(fJobs[i].compressedData);
+			}
+			delete[] fJobs;
+		}
+
+		pthread_cond_destroy(&fDoneCondition);
+		pthread_cond_destroy(&fWorkCondition);
+		pthread_mutex_destroy(&fLock);
+	}
+
+	status_t Init()
+	{
+		fJobs = new(std::nothrow) CompressionJob[fJobCount];
+		fThreads = new(std::nothrow) pthread_t[fMaxThreadCount];
+		if (fJobs == NULL || fThreads == NULL)
+			return B_NO_MEMORY;
+
+		memset(fJobs, 0, sizeof(CompressionJob) * fJobCount);
+		for (int32 i = 0; i < fJobCount; i++) {
+			fJobs[i].data = malloc(kChunkSize);
+			fJobs[i].compressedData = malloc(kChunkSize);
+			if (fJobs[i].data == NULL || fJobs[i].compressedData == NULL)
+				return B_NO_MEMORY;
+		}
+
+		for (; fThreadCount < fMaxThreadCount; fThreadCount++) {
+			if (pthread_create(&fThreads[fThreadCount], NULL, &_WorkerThread,
+					this) != 0) {
+				return B_NO_MORE_THREADS;
+			}
+		}
+
+		return B_OK;
+	}
+
+	bool IsEmpty() const
+	{
+		return fSubmitted == fRemoved;
+	}
+
+	bool IsFull() const
+	{
+		return fSubmitted - fRemoved == (uint64)fJobCount;
+	}
+
+	/*!	Queues the \a size bytes in \a data for compression. The buffer is
+		exchanged with the unused one of the job, so that the data don't have
+		to be copied.
+	*/
+	void Submit(void*& data, size_t size)
+	{
+		CompressionJob& job = fJobs[fSubmitted % fJobCount];
+		std::swap(job.data, data);
+		job.size = size;
+		job.compressedSize = size;
+		job.status = B_OK;
+		job.done = false;
+
+		pthread_mutex_lock(&fLock);
+		fSubmitted++;
+		pthread_cond_signal(&fWorkCondition);
+		pthread_mutex_unlock(&fLock);
+	}
+
+	CompressionJob& WaitForOldest()
+	{
+		CompressionJob& job = fJobs[fRemoved % fJobCount];
+
+		pthread_mutex_lock(&fLock);
+		while (!job.done)
+			pthread_cond_wait(&fDoneCondition, &fLock);
+		pthread_mutex_unlock(&fLock);
+
+		return job;
+	}
+
+	void RemoveOldest()
+	{
+		pthread_mutex_lock(&fLock);
+		fRemoved++;
+		pthread_mutex_unlock(&fLock);
+	}
+
+private:
+	static void* _WorkerThread(void* self)
+	{
+		((CompressionPipeline*)self)->_Worker();
+		return NULL;
+	}
+
+	void _Worker()
+	{
+		pthread_mutex_lock(&fLock);
+
+		while (true) {
+			while (!fQuit && fNextToCompress == fSubmitted)
+				pthread_cond_wait(&fWorkCondition, &fLock);
+			if (fQuit)
+				break;
+
+			CompressionJob& job = fJobs[fNextToCompress++ % fJobCount];
+			pthread_mutex_unlock(&fLock);
+
+			_Compress(job);
+
+			pthread_mutex_lock(&fLock);
+			job.done = true;
+			pthread_cond_broadcast(&fDoneCondition);
+		}
+
+		pthread_mutex_unlock(&fLock);
+	}
+
+	void _Compress(CompressionJob& job)
+	{
+		// Try to use compression only for data large enough.
+		if (job.size < kCompressionSizeThreshold)
+			return;
+
+		size_t compressedSize;
+		status_t error = fCompressionAlgorithm->algorithm->CompressBuffer(
+			job.data, job.size, job.compressedData, job.size, compressedSize,
+			fCompressionAlgorithm->parameters);
+		if (error == B_OK)
+			job.compressedSize = compressedSize;
+		else if (error != B_BUFFER_OVERFLOW)
+			job.status = error;
+	}
+
+private:
+	CompressionAlgorithmOwner* fCompressionAlgorithm;
+	CompressionJob*			fJobs;
+	int32					fJobCount;
+	uint64					fSubmitted;
+	uint64					fRemoved;
+	uint64					fNextToCompress;
+	pthread_t*				fThreads;
+	int32					fThreadCount;
+	int32					fMaxThreadCount;
+	bool					fQuit;
+	pthread_mutex_t			fLock;
+	pthread_cond_t			fWorkCondition;
+	pthread_cond_t			fDoneCondition;
+};
+
+
 PackageFileHeapWriter::PackageFileHeapWriter(BErrorOutput* errorOutput,
 	BPositionIO* file, off_t heapOffset,
 	CompressionAlgorithmOwner* compressionAlgorithm,
@@ -205,7 +415,9 @@ PackageFileHeapWriter::PackageFileHeapWriter(BErrorOutput* errorOutput,
 	fCompressedDataBuffer(NULL),
 	fPendingDataSize(0),
 	fOffsets(),
-	fCompressionAlgorithm(compressionAlgorithm)
+	fCompressionAlgorithm(compressionAlgorithm),
+	fCompressionPipeline(NULL),
+	fSynchronousWrites(false)
 {
 	if (fCompressionAlgorithm != NULL)
 		fCompressionAlgorithm->AcquireReference();
@@ -229,6 +441,8 @@ PackageFileHeapWriter::Init()
 	fCompressedDataBuffer = malloc(kChunkSize);
 	if (fPendingDataBuffer == NULL || fCompressedDataBuffer == NULL)
 		throw std::bad_alloc();
+
+	_InitCompressionPipeline();
 }
 
 
@@ -281,7 +495,7 @@ PackageFileHeapWriter::AddData(BDataReader& dataReader, off_t size,
 		readOffset += toCopy;
 
 		if (fPendingDataSize == kChunkSize) {
-			error = _FlushPendingData();
+			error = _QueuePendingData();
 			if (error != B_OK)
 				return error;
 		}
@@ -321,6 +535,13 @@ PackageFileHeapWriter::RemoveDataRanges(
 	if (status != B_OK)
 		throw status_t(status);
 
+	// The chunks are rewritten in place, and the reading end must stay ahead
+	// of the writing end, so we cannot have chunks in flight.
+	fSynchronousWrites = true;
+	ScopeExit synchronousWritesResetter([this]() {
+		fSynchronousWrites = false;
+	});
+
 	// We potentially have to recompress all data from the first affected chunk
 	// to the end (minus the removed ranges, of course). As a basic algorithm we
 	// can use our usual data writing strategy, i.e. read a chunk, decompress it
@@ -481,6 +702,13 @@ status_t
 PackageFileHeapWriter::ReadAndDecompressChunk(size_t chunkIndex,
 	void* compressedDataBuffer, void* uncompressedDataBuffer)
 {
+	if (chunkIndex >= (size_t)fOffsets.Count()) {
+		// The chunk may still be in the compression pipeline.
+		status_t error = _WriteCompressionJobs();
+		if (error != B_OK)
+			return error;
+	}
+
 	if (uint64(chunkIndex + 1) * kChunkSize > fUncompressedHeapSize) {
 		// The chunk has not been written to disk yet. Its data are still in the
 		// pending data buffer.
@@ -503,6 +731,9 @@ PackageFileHeapWriter::ReadAndDecompressChunk(size_t chunkIndex,
 void
 PackageFileHeapWriter::_Uninit()
 {
+	delete fCompressionPipeline;
+	fCompressionPipeline = NULL;
+
 	free(fPendingDataBuffer);
 	free(fCompressedDataBuffer);
 	fPendingDataBuffer = NULL;
@@ -510,13 +741,67 @@ PackageFileHeapWriter::_Uninit()
 }
 
 
+/*!	Starts the threads that compress full chunks, if there is more than one
+	CPU. The number of threads can be overridden with the
+	PACKAGE_COMPRESSION_THREADS environment variable; 1 disables the pipeline.
+*/
+void
+PackageFileHeapWriter::_InitCompressionPipeline()
+{
+	if (fCompressionAlgorithm == NULL)
+		return;
+
+	long threadCount = sysconf(_SC_NPROCESSORS_ONLN);
+	const char* threadCountString = getenv("PACKAGE_COMPRESSION_THREADS");
+	if (threadCountString != NULL)
+		threadCount = strtol(threadCountString, NULL, 10);
+	if (threadCount <= 1)
+		return;
+
+	fCompressionPipeline = new(std::nothrow) CompressionPipeline(
+		fCompressionAlgorithm,
+		std::min(threadCount, (long)kMaxCompressionThreads));
+	if (fCompressionPipeline == NULL || fCompressionPipeline->Init() != B_OK) {
+		// just compress on the calling thread
+		delete fCompressionPipeline;
+		fCompressionPipeline = NULL;
+	}
+}
+
+
+/*!	Hands the full pending data buffer to the compression pipeline, if there
+	is one, or writes it directly otherwise.
+*/
+status_t
+PackageFileHeapWriter::_QueuePendingData()
+{
+	if (fCompressionPipeline == NULL || fSynchronousWrites)
+		return _FlushPendingData();
+
+	if (fCompressionPipeline->IsFull()) {
+		status_t error = _WriteCompressionJob();
+		if (error != B_OK)
+			return error;
+	}
+
+	fCompressionPipeline->Submit(fPendingDataBuffer, fPendingDataSize);
+	fPendingDataSize = 0;
+	return B_OK;
+}
+
+
 status_t
 PackageFileHeapWriter::_FlushPendingData()
 {
+	// chunks in the pipeline precede the pending data
+	status_t error = _WriteCompressionJobs();
+	if (error != B_OK)
+		return error;
+
 	if (fPendingDataSize == 0)
 		return B_OK;
 
-	status_t error = _WriteChunk(fPendingDataBuffer, fPendingDataSize, true);
+	error = _WriteChunk(fPendingDataBuffer, fPendingDataSize, true);
 	if (error == B_OK)
 		fPendingDataSize = 0;
 
@@ -524,6 +809,54 @@ PackageFileHeapWriter::_FlushPendingData()
 }
 
 
+/*!	Waits until the oldest chunk in the compression pipeline has been
+	compressed, and writes it.
+*/
+status_t
+PackageFileHeapWriter::_WriteCompressionJob()
+{
+	CompressionJob& job = fCompressionPipeline->WaitForOldest();
+	status_t error = job.status;
+	if (error != B_OK) {
+		fErrorOutput->PrintError("Failed to compress chunk data: %s\n",
+			strerror(error));
+		return error;
+	}
+
+	if (!fOffsets.Add(fCompressedHeapSize)) {
+		fErrorOutput->PrintError("Out of memory!\n");
+		return B_NO_MEMORY;
+	}
+
+	// only use compressed data when we've actually saved space
+	if (job.compressedSize < job.size)
+		error = _WriteDataUncompressed(job.compressedData, job.compressedSize);
+	else
+		error = _WriteDataUncompressed(job.data, job.size);
+	if (error != B_OK)
+		return error;
+
+	fCompressionPipeline->RemoveOldest();
+	return B_OK;
+}
+
+
+status_t
+PackageFileHeapWriter::_WriteCompressionJobs()
+{
+	if (fCompressionPipeline == NULL)
+		return B_OK;
+
+	while (!fCompressionPipeline->IsEmpty()) {
+		status_t error = _WriteCompressionJob();
+		if (error != B_OK)
+			return error;
+	}
+
+	return B_OK;
+}
+
+
 status_t
 PackageFileHeapWriter::_WriteChunk(const void* data, size_t size,
 	bool mayCompress)
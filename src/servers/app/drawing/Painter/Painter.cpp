@@ -54,6 +54,7 @@
 
 #include "AlphaMask.h"
 #include "BitmapPainter.h"
+#include "BlendSpans.h"
 #include "DrawingMode.h"
 #include "GlobalSubpixelSettings.h"
 #include "PatternHandler.h"
@@ -107,8 +108,26 @@ using std::nothrow;
 
 
 static uint32 detect_simd();
+static const blend_span_functions* select_blend_spans(uint32 simdFlags);
 
 uint32 gSIMDFlags = detect_simd();
+const blend_span_functions* gBlendSpans = select_blend_spans(gSIMDFlags);
+
+
+#if defined(__i386__) || defined(__x86_64__)
+/*!	Returns the OS controlled "XCR0" register, which tells which register
+	states the OS saves on a context switch.
+*/
+static uint64
+read_xcr0()
+{
+	uint32 low;
+	uint32 high;
+	// xgetbv, written out for older assemblers
+	asm volatile(".byte 0x0f, 0x01, 0xd0" : "=a" (low), "=d" (high) : "c" (0));
+	return ((uint64)high << 32) | low;
+}
+#endif
 
 
 /*!	Detect SIMD flags for use in AppServer. Checks all CPUs in the system
@@ -117,7 +136,7 @@ uint32 gSIMDFlags = detect_simd();
 static uint32
 detect_simd()
 {
-#if __i386__
+#if defined(__i386__) || defined(__x86_64__)
 	// Only scan CPUs for which we are certain the SIMD flags are properly
 	// defined.
 	const char* vendorNames[] = {
@@ -157,11 +176,26 @@ detect_simd()
 		uint32 maxStdFunc = cpuInfo.regs.eax;
 		if (vendorFound && maxStdFunc >= 1) {
 			get_cpuid(&cpuInfo, 1, 0);
+			uint32 ecx = cpuInfo.regs.ecx;
 			uint32 edx = cpuInfo.regs.edx;
+#ifdef __i386__
+			// the MMX/SSE code is only available on x86
 			if (edx & (1 << 23))
 				cpuSIMD |= APPSERVER_SIMD_MMX;
 			if (edx & (1 << 25))
 				cpuSIMD |= APPSERVER_SIMD_SSE;
+#endif
+			if (edx & (1 << 26))
+				cpuSIMD |= APPSERVER_SIMD_SSE2;
+
+			// AVX2 also needs the OS to save the YMM registers (OSXSAVE set,
+			// and the SSE and AVX state enabled in XCR0)
+			if (maxStdFunc >= 7 && (ecx & (1 << 27)) != 0
+				&& (read_xcr0() & 0x6) == 0x6) {
+				get_cpuid(&cpuInfo, 7, 0);
+				if (cpuInfo.regs.ebx & (1 << 5))
+					cpuSIMD |= APPSERVER_SIMD_AVX2;
+			}
 		} else {
 			// no flags can be identified
 			cpuSIMD = 0;
@@ -169,12 +203,28 @@ detect_simd()
 		systemSIMD &= cpuSIMD;
 	}
 	return systemSIMD;
-#else	// !__i386__
+#else	// !__i386__ && !__x86_64__
 	return 0;
 #endif
 }
 
 
+/*!	Chooses the fastest span functions for the drawing modes that all CPUs
+	support.
+*/
+static const blend_span_functions*
+select_blend_spans(uint32 simdFlags)
+{
+#if BLEND_SPANS_X86_SIMD
+	if ((simdFlags & APPSERVER_SIMD_AVX2) != 0)
+		return &gBlendSpansAVX2;
+	if ((simdFlags & APPSERVER_SIMD_SSE2) != 0)
+		return &gBlendSpansSSE2;
+#endif
+	return &gBlendSpansC;
+}
+
+
 // Gradients and strings don't use patterns, but we want the special handling
 // we have for solid patterns in certain modes to get the expected results for
 // border antialiasing.
@@ -1741,8 +1791,8 @@ Painter::_BlendRect32(const BRect& r, const rgb_color& c) const
 
 			uint8* offset = dst + x1 * 4 + y1 * bpr;
 			for (; y1 <= y2; y1++) {
-				blend_line32(offset, x2 - x1 + 1, c.red, c.green, c.blue,
-					c.alpha);
+				gBlendSpans->alpha_fill(offset, x2 - x1 + 1, c.red, c.green,
+					c.blue, c.alpha);
 				offset += bpr;
 			}
 		}
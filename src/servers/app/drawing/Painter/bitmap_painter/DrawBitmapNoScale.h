@@ -8,6 +8,7 @@
 #ifndef DRAW_BITMAP_NO_SCALE_H
 #define DRAW_BITMAP_NO_SCALE_H
 
+#include "BlendSpans.h"
 #include "IntPoint.h"
 #include "IntRect.h"
 #include "Painter.h"
@@ -134,14 +135,7 @@ struct Bgr32Over : public DrawBitmapNoScale<Bgr32Over>
 {
 	void BlendRow(uint8* dst, const uint8* src, int32 numPixels)
 	{
-		uint32* d = (uint32*)dst;
-		uint32* s = (uint32*)src;
-		while (numPixels--) {
-			if (*s != B_TRANSPARENT_MAGIC_RGBA32)
-				*(uint32*)d = *(uint32*)s;
-			d++;
-			s++;
-		}
+		gBlendSpans->over_row(dst, src, numPixels);
 	}
 };
 
@@ -150,24 +144,7 @@ struct Bgr32Alpha : public DrawBitmapNoScale<Bgr32Alpha>
 {
 	void BlendRow(uint8* dst, const uint8* src, int32 numPixels)
 	{
-		uint32* d = (uint32*)dst;
-		int32 bytes = numPixels * 4;
-		uint8 buffer[bytes];
-		uint8* b = buffer;
-		while (numPixels--) {
-			if (src[3] == 255) {
-				*(uint32*)b = *(uint32*)src;
-			} else {
-				*(uint32*)b = *d;
-				b[0] = ((src[0] - b[0]) * src[3] + (b[0] << 8)) >> 8;
-				b[1] = ((src[1] - b[1]) * src[3] + (b[1] << 8)) >> 8;
-				b[2] = ((src[2] - b[2]) * src[3] + (b[2] << 8)) >> 8;
-			}
-			d++;
-			b += 4;
-			src += 4;
-		}
-		memcpy(dst, buffer, bytes);
+		gBlendSpans->alpha_row(dst, src, numPixels);
 	}
 };
 
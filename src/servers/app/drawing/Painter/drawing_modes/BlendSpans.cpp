@@ -0,0 +1,182 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Plain C versions of the span functions. They use the same math as the
+	BLEND* macros in DrawingMode.h, and serve as reference for the SIMD
+	versions, which also use them for the pixels that don't fill a whole
+	vector.
+*/
+
+
+#include "BlendSpans.h"
+
+#include <GraphicsDefs.h>
+
+
+static void
+alpha_row_c(uint8* dst, const uint8* src, uint32 count)
+{
+	for (; count > 0; count--, dst += 4, src += 4) {
+		if (src[3] == 255) {
+			*(uint32*)dst = *(const uint32*)src;
+			continue;
+		}
+
+		uint8 alpha = src[3];
+		dst[0] = ((src[0] - dst[0]) * alpha + (dst[0] << 8)) >> 8;
+		dst[1] = ((src[1] - dst[1]) * alpha + (dst[1] << 8)) >> 8;
+		dst[2] = ((src[2] - dst[2]) * alpha + (dst[2] << 8)) >> 8;
+	}
+}
+
+
+static void
+over_row_c(uint8* dst, const uint8* src, uint32 count)
+{
+	uint32* d = (uint32*)dst;
+	const uint32* s = (const uint32*)src;
+	for (; count > 0; count--, d++, s++) {
+		if (*s != B_TRANSPARENT_MAGIC_RGBA32)
+			*d = *s;
+	}
+}
+
+
+static void
+copy_c(uint8* dst, const uint8* colors, uint32 count)
+{
+	for (; count > 0; count--, dst += 4, colors += 4) {
+		dst[0] = colors[2];
+		dst[1] = colors[1];
+		dst[2] = colors[0];
+		dst[3] = colors[3];
+	}
+}
+
+
+static void
+over_c(uint8* dst, const uint8* colors, uint32 count, uint8 cover)
+{
+	for (; count > 0; count--, dst += 4, colors += 4) {
+		if (colors[3] == 0)
+			continue;
+
+		if (cover == 255) {
+			dst[0] = colors[2];
+			dst[1] = colors[1];
+			dst[2] = colors[0];
+		} else {
+			dst[0] = ((colors[2] - dst[0]) * cover + (dst[0] << 8)) >> 8;
+			dst[1] = ((colors[1] - dst[1]) * cover + (dst[1] << 8)) >> 8;
+			dst[2] = ((colors[0] - dst[2]) * cover + (dst[2] << 8)) >> 8;
+		}
+		dst[3] = 255;
+	}
+}
+
+
+static void
+alpha_co_c(uint8* dst, const uint8* colors, uint32 count, uint16 alpha)
+{
+	for (; count > 0; count--, dst += 4, colors += 4) {
+		if (alpha == 255 * 255) {
+			dst[0] = colors[2];
+			dst[1] = colors[1];
+			dst[2] = colors[0];
+		} else {
+			dst[0] = ((colors[2] - dst[0]) * alpha + (dst[0] << 16)) >> 16;
+			dst[1] = ((colors[1] - dst[1]) * alpha + (dst[1] << 16)) >> 16;
+			dst[2] = ((colors[0] - dst[2]) * alpha + (dst[2] << 16)) >> 16;
+		}
+		dst[3] = 255;
+	}
+}
+
+
+static void
+alpha_pc_c(uint8* dst, const uint8* colors, uint32 count, uint16 alpha)
+{
+	uint8 alpha8 = alpha / 255;
+
+	for (; count > 0; count--, dst += 4, colors += 4) {
+		if (alpha == 255 * 255) {
+			dst[0] = colors[2];
+			dst[1] = colors[1];
+			dst[2] = colors[0];
+			dst[3] = 255;
+		} else if (dst[3] == 255) {
+			dst[0] = ((colors[2] - dst[0]) * alpha8 + (dst[0] << 8)) >> 8;
+			dst[1] = ((colors[1] - dst[1]) * alpha8 + (dst[1] << 8)) >> 8;
+			dst[2] = ((colors[0] - dst[2]) * alpha8 + (dst[2] << 8)) >> 8;
+		} else if (dst[3] == 0) {
+			dst[0] = colors[2];
+			dst[1] = colors[1];
+			dst[2] = colors[0];
+			dst[3] = alpha8;
+		} else {
+			uint8 alphaRest = 255 - alpha8;
+			uint32 alphaTemp = 65025 - alphaRest * (255 - dst[3]);
+			uint32 alphaDest = dst[3] * alphaRest;
+			uint32 alphaSrc = 255 * alpha8;
+			dst[0] = (dst[0] * alphaDest + colors[2] * alphaSrc) / alphaTemp;
+			dst[1] = (dst[1] * alphaDest + colors[1] * alphaSrc) / alphaTemp;
+			dst[2] = (dst[2] * alphaDest + colors[0] * alphaSrc) / alphaTemp;
+			dst[3] = alphaTemp / 255;
+		}
+	}
+}
+
+
+static void
+blend_c(uint8* dst, const uint8* colors, uint32 count, uint8 cover)
+{
+	for (; count > 0; count--, dst += 4, colors += 4) {
+		if (cover == 255) {
+			if (colors[3] == 0)
+				continue;
+
+			dst[0] = (dst[0] + colors[2]) >> 1;
+			dst[1] = (dst[1] + colors[1]) >> 1;
+			dst[2] = (dst[2] + colors[0]) >> 1;
+		} else {
+			uint8 b = (dst[0] + colors[2]) >> 1;
+			uint8 g = (dst[1] + colors[1]) >> 1;
+			uint8 r = (dst[2] + colors[0]) >> 1;
+			dst[0] = ((b - dst[0]) * cover + (dst[0] << 8)) >> 8;
+			dst[1] = ((g - dst[1]) * cover + (dst[1] << 8)) >> 8;
+			dst[2] = ((r - dst[2]) * cover + (dst[2] << 8)) >> 8;
+		}
+		dst[3] = 255;
+	}
+}
+
+
+static void
+alpha_fill_c(uint8* dst, uint32 count, uint8 r, uint8 g, uint8 b, uint8 a)
+{
+	r = (r * a) >> 8;
+	g = (g * a) >> 8;
+	b = (b * a) >> 8;
+	a = 255 - a;
+
+	for (; count > 0; count--, dst += 4) {
+		dst[0] = ((dst[0] * a) >> 8) + b;
+		dst[1] = ((dst[1] * a) >> 8) + g;
+		dst[2] = ((dst[2] * a) >> 8) + r;
+	}
+}
+
+
+const blend_span_functions gBlendSpansC = {
+	alpha_row_c,
+	over_row_c,
+	copy_c,
+	over_c,
+	alpha_co_c,
+	alpha_pc_c,
+	blend_c,
+	alpha_fill_c
+};
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ *
+ * Span functions for the most common drawing modes on B_RGBA32 buffers,
+ * with SIMD versions that are chosen at runtime.
+ *
+ */
+
+#ifndef BLEND_SPANS_H
+#define BLEND_SPANS_H
+
+#include <SupportDefs.h>
+
+
+#if (defined(__i386__) || defined(__x86_64__)) && __GNUC__ >= 4
+#	define BLEND_SPANS_X86_SIMD 1
+#endif
+
+
+// All functions blend "count" pixels into the B_RGBA32 row "dst". "src" is
+// a B_RGBA32 row as well, while "colors" is an array of agg::rgba8 (which
+// stores the channels in RGBA order). The SIMD versions produce exactly the
+// same pixels as the plain C ones.
+struct blend_span_functions {
+	// B_OP_ALPHA with B_PIXEL_ALPHA and B_ALPHA_OVERLAY, dst alpha is kept
+	void	(*alpha_row)(uint8* dst, const uint8* src, uint32 count);
+	// B_OP_OVER, skips B_TRANSPARENT_MAGIC_RGBA32 pixels
+	void	(*over_row)(uint8* dst, const uint8* src, uint32 count);
+
+	// B_OP_COPY with full cover
+	void	(*copy)(uint8* dst, const uint8* colors, uint32 count);
+	// B_OP_OVER, skips fully transparent colors, cover is 1..255
+	void	(*over)(uint8* dst, const uint8* colors, uint32 count,
+				uint8 cover);
+	// B_OP_ALPHA with B_CONSTANT_ALPHA and B_ALPHA_OVERLAY, alpha is
+	// 1..255 * 255
+	void	(*alpha_co)(uint8* dst, const uint8* colors, uint32 count,
+				uint16 alpha);
+	// B_OP_ALPHA with B_CONSTANT_ALPHA and B_ALPHA_COMPOSITE, alpha is
+	// 1..255 * 255
+	void	(*alpha_pc)(uint8* dst, const uint8* colors, uint32 count,
+				uint16 alpha);
+	// B_OP_BLEND, cover is 1..255
+	void	(*blend)(uint8* dst, const uint8* colors, uint32 count,
+				uint8 cover);
+
+	// B_OP_ALPHA with a solid color, dst alpha is kept
+	void	(*alpha_fill)(uint8* dst, uint32 count, uint8 r, uint8 g, uint8 b,
+				uint8 a);
+};
+
+
+extern const blend_span_functions gBlendSpansC;
+#if BLEND_SPANS_X86_SIMD
+extern const blend_span_functions gBlendSpansSSE2;
+extern const blend_span_functions gBlendSpansAVX2;
+#endif
+
+// the fastest version the CPUs support, chosen with the SIMD flags
+extern const blend_span_functions* gBlendSpans;
+
+
+#endif // BLEND_SPANS_H
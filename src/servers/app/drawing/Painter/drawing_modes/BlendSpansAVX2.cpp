@@ -0,0 +1,326 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	AVX2 versions of the span functions. They work like the SSE2 versions,
+	but handle eight pixels at a time. Unpacking and packing works within
+	the two 128 bit lanes, so the pixels stay in order.
+
+	This file is compiled with -mavx2, so only call into it when the CPU and
+	the OS support AVX2.
+*/
+
+
+#include "BlendSpans.h"
+
+#include <immintrin.h>
+
+#include <GraphicsDefs.h>
+
+
+static inline __m256i
+load(const uint8* pixels)
+{
+	return _mm256_loadu_si256((const __m256i*)pixels);
+}
+
+
+static inline void
+store(uint8* pixels, __m256i value)
+{
+	_mm256_storeu_si256((__m256i*)pixels, value);
+}
+
+
+static inline __m256i
+select(__m256i mask, __m256i a, __m256i b)
+{
+	return _mm256_or_si256(_mm256_and_si256(mask, a),
+		_mm256_andnot_si256(mask, b));
+}
+
+
+/*!	Converts agg::rgba8 colors into B_RGBA32 pixels by swapping red and blue.
+*/
+static inline __m256i
+swap_red_blue(__m256i colors)
+{
+	const __m256i shuffle = _mm256_setr_epi8(
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+	return _mm256_shuffle_epi8(colors, shuffle);
+}
+
+
+static inline __m256i
+alpha_equals(__m256i pixels, __m256i alpha)
+{
+	const __m256i alphaMask = _mm256_set1_epi32(0xff000000);
+	return _mm256_cmpeq_epi32(_mm256_and_si256(pixels, alphaMask), alpha);
+}
+
+
+// BLEND, see BlendSpansSSE2.cpp
+static inline __m256i
+blend8(__m256i d, __m256i s, __m256i alpha)
+{
+	const __m256i k256 = _mm256_set1_epi16(256);
+
+	__m256i sum = _mm256_add_epi16(_mm256_mullo_epi16(s, alpha),
+		_mm256_mullo_epi16(d, _mm256_sub_epi16(k256, alpha)));
+	return _mm256_srli_epi16(sum, 8);
+}
+
+
+// BLEND16, see BlendSpansSSE2.cpp
+static inline __m256i
+blend16(__m256i d, __m256i s, __m256i alpha, __m256i inverseAlpha)
+{
+	const __m256i one = _mm256_set1_epi16(1);
+
+	__m256i high = _mm256_add_epi16(_mm256_mulhi_epu16(s, alpha),
+		_mm256_mulhi_epu16(d, inverseAlpha));
+	__m256i lowS = _mm256_mullo_epi16(s, alpha);
+	__m256i lowD = _mm256_mullo_epi16(d, inverseAlpha);
+	__m256i carry = _mm256_add_epi16(
+		_mm256_add_epi16(_mm256_srli_epi16(lowS, 1),
+			_mm256_srli_epi16(lowD, 1)),
+		_mm256_and_si256(_mm256_and_si256(lowS, lowD), one));
+	return _mm256_add_epi16(high, _mm256_srli_epi16(carry, 15));
+}
+
+
+static void
+alpha_row_avx2(uint8* dst, const uint8* src, uint32 count)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alphaMask = _mm256_set1_epi32(0xff000000);
+
+	for (; count >= 8; count -= 8, dst += 32, src += 32) {
+		__m256i d = load(dst);
+		__m256i s = load(src);
+
+		__m256i sLow = _mm256_unpacklo_epi8(s, zero);
+		__m256i sHigh = _mm256_unpackhi_epi8(s, zero);
+		__m256i aLow = _mm256_shufflehi_epi16(
+			_mm256_shufflelo_epi16(sLow, 0xff), 0xff);
+		__m256i aHigh = _mm256_shufflehi_epi16(
+			_mm256_shufflelo_epi16(sHigh, 0xff), 0xff);
+
+		__m256i result = _mm256_packus_epi16(
+			blend8(_mm256_unpacklo_epi8(d, zero), sLow, aLow),
+			blend8(_mm256_unpackhi_epi8(d, zero), sHigh, aHigh));
+		result = select(alphaMask, d, result);
+		store(dst, select(alpha_equals(s, alphaMask), s, result));
+	}
+
+	if (count > 0)
+		gBlendSpansC.alpha_row(dst, src, count);
+}
+
+
+static void
+over_row_avx2(uint8* dst, const uint8* src, uint32 count)
+{
+	const __m256i magic = _mm256_set1_epi32(B_TRANSPARENT_MAGIC_RGBA32);
+
+	for (; count >= 8; count -= 8, dst += 32, src += 32) {
+		__m256i s = load(src);
+		store(dst, select(_mm256_cmpeq_epi32(s, magic), load(dst), s));
+	}
+
+	if (count > 0)
+		gBlendSpansC.over_row(dst, src, count);
+}
+
+
+static void
+copy_avx2(uint8* dst, const uint8* colors, uint32 count)
+{
+	for (; count >= 8; count -= 8, dst += 32, colors += 32)
+		store(dst, swap_red_blue(load(colors)));
+
+	if (count > 0)
+		gBlendSpansC.copy(dst, colors, count);
+}
+
+
+static void
+assign_opaque_avx2(uint8* dst, const uint8* colors, uint32 count)
+{
+	const __m256i alphaMask = _mm256_set1_epi32(0xff000000);
+
+	for (; count >= 8; count -= 8, dst += 32, colors += 32)
+		store(dst, _mm256_or_si256(swap_red_blue(load(colors)), alphaMask));
+
+	if (count > 0)
+		gBlendSpansC.alpha_co(dst, colors, count, 255 * 255);
+}
+
+
+static void
+over_avx2(uint8* dst, const uint8* colors, uint32 count, uint8 cover)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alphaMask = _mm256_set1_epi32(0xff000000);
+	// a full cover assigns the color, which blending with 256 does as well
+	const __m256i alpha = _mm256_set1_epi16(cover == 255 ? 256 : cover);
+
+	for (; count >= 8; count -= 8, dst += 32, colors += 32) {
+		__m256i d = load(dst);
+		__m256i s = swap_red_blue(load(colors));
+
+		__m256i result = _mm256_packus_epi16(
+			blend8(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero),
+				alpha),
+			blend8(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero),
+				alpha));
+		result = _mm256_or_si256(result, alphaMask);
+		store(dst, select(alpha_equals(s, zero), d, result));
+	}
+
+	if (count > 0)
+		gBlendSpansC.over(dst, colors, count, cover);
+}
+
+
+static void
+alpha_co_avx2(uint8* dst, const uint8* colors, uint32 count, uint16 alpha)
+{
+	if (alpha == 255 * 255) {
+		assign_opaque_avx2(dst, colors, count);
+		return;
+	}
+
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alphaMask = _mm256_set1_epi32(0xff000000);
+	const __m256i sourceAlpha = _mm256_set1_epi16(alpha);
+	const __m256i inverseAlpha = _mm256_set1_epi16((uint16)(65536 - alpha));
+
+	for (; count >= 8; count -= 8, dst += 32, colors += 32) {
+		__m256i d = load(dst);
+		__m256i s = swap_red_blue(load(colors));
+
+		__m256i result = _mm256_packus_epi16(
+			blend16(_mm256_unpacklo_epi8(d, zero),
+				_mm256_unpacklo_epi8(s, zero), sourceAlpha, inverseAlpha),
+			blend16(_mm256_unpackhi_epi8(d, zero),
+				_mm256_unpackhi_epi8(s, zero), sourceAlpha, inverseAlpha));
+		store(dst, _mm256_or_si256(result, alphaMask));
+	}
+
+	if (count > 0)
+		gBlendSpansC.alpha_co(dst, colors, count, alpha);
+}
+
+
+static void
+alpha_pc_avx2(uint8* dst, const uint8* colors, uint32 count, uint16 alpha)
+{
+	if (alpha == 255 * 255) {
+		assign_opaque_avx2(dst, colors, count);
+		return;
+	}
+
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alphaMask = _mm256_set1_epi32(0xff000000);
+	const __m256i alpha8 = _mm256_set1_epi16(alpha / 255);
+
+	for (; count >= 8; count -= 8, dst += 32, colors += 32) {
+		__m256i d = load(dst);
+		if (_mm256_movemask_epi8(alpha_equals(d, alphaMask)) != -1) {
+			// composing onto a translucent background needs a division
+			gBlendSpansC.alpha_pc(dst, colors, 8, alpha);
+			continue;
+		}
+
+		__m256i s = swap_red_blue(load(colors));
+		__m256i result = _mm256_packus_epi16(
+			blend8(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero),
+				alpha8),
+			blend8(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero),
+				alpha8));
+		store(dst, _mm256_or_si256(result, alphaMask));
+	}
+
+	if (count > 0)
+		gBlendSpansC.alpha_pc(dst, colors, count, alpha);
+}
+
+
+static void
+blend_avx2(uint8* dst, const uint8* colors, uint32 count, uint8 cover)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alphaMask = _mm256_set1_epi32(0xff000000);
+	const __m256i alpha = _mm256_set1_epi16(cover);
+
+	for (; count >= 8; count -= 8, dst += 32, colors += 32) {
+		__m256i d = load(dst);
+		__m256i s = swap_red_blue(load(colors));
+
+		__m256i dLow = _mm256_unpacklo_epi8(d, zero);
+		__m256i dHigh = _mm256_unpackhi_epi8(d, zero);
+		__m256i averageLow = _mm256_srli_epi16(
+			_mm256_add_epi16(dLow, _mm256_unpacklo_epi8(s, zero)), 1);
+		__m256i averageHigh = _mm256_srli_epi16(
+			_mm256_add_epi16(dHigh, _mm256_unpackhi_epi8(s, zero)), 1);
+
+		__m256i result;
+		if (cover == 255) {
+			result = _mm256_or_si256(
+				_mm256_packus_epi16(averageLow, averageHigh), alphaMask);
+			result = select(alpha_equals(s, zero), d, result);
+		} else {
+			result = _mm256_or_si256(_mm256_packus_epi16(
+					blend8(dLow, averageLow, alpha),
+					blend8(dHigh, averageHigh, alpha)),
+				alphaMask);
+		}
+		store(dst, result);
+	}
+
+	if (count > 0)
+		gBlendSpansC.blend(dst, colors, count, cover);
+}
+
+
+static void
+alpha_fill_avx2(uint8* dst, uint32 count, uint8 r, uint8 g, uint8 b,
+	uint8 a)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alphaMask = _mm256_set1_epi32(0xff000000);
+	const __m256i color = _mm256_set1_epi64x((uint64)((b * a) >> 8)
+		| (uint64)((g * a) >> 8) << 16 | (uint64)((r * a) >> 8) << 32);
+	const __m256i inverseAlpha = _mm256_set1_epi16(255 - a);
+
+	for (; count >= 8; count -= 8, dst += 32) {
+		__m256i d = load(dst);
+
+		__m256i low = _mm256_add_epi16(_mm256_srli_epi16(
+			_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), inverseAlpha), 8),
+			color);
+		__m256i high = _mm256_add_epi16(_mm256_srli_epi16(
+			_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), inverseAlpha), 8),
+			color);
+		store(dst, select(alphaMask, d, _mm256_packus_epi16(low, high)));
+	}
+
+	if (count > 0)
+		gBlendSpansC.alpha_fill(dst, count, r, g, b, a);
+}
+
+
+const blend_span_functions gBlendSpansAVX2 = {
+	alpha_row_avx2,
+	over_row_avx2,
+	copy_avx2,
+	over_avx2,
+	alpha_co_avx2,
+	alpha_pc_avx2,
+	blend_avx2,
+	alpha_fill_avx2
+};
@@ -0,0 +1,335 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	SSE2 versions of the span functions. They handle four pixels at a time,
+	and leave the remaining pixels to the plain C versions. All channels are
+	expanded to 16 bit, where the products of the blending fit without loss,
+	so that the results are exactly those of the C versions.
+
+	This file is compiled with -msse2, so only call into it when the CPU
+	supports SSE2.
+*/
+
+
+#include "BlendSpans.h"
+
+#include <emmintrin.h>
+
+#include <GraphicsDefs.h>
+
+
+static inline __m128i
+load(const uint8* pixels)
+{
+	return _mm_loadu_si128((const __m128i*)pixels);
+}
+
+
+static inline void
+store(uint8* pixels, __m128i value)
+{
+	_mm_storeu_si128((__m128i*)pixels, value);
+}
+
+
+static inline __m128i
+select(__m128i mask, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+
+/*!	Converts agg::rgba8 colors into B_RGBA32 pixels by swapping red and blue.
+*/
+static inline __m128i
+swap_red_blue(__m128i colors)
+{
+	const __m128i redBlueMask = _mm_set1_epi32(0x00ff00ff);
+
+	__m128i redBlue = _mm_and_si128(colors, redBlueMask);
+	redBlue = _mm_or_si128(_mm_slli_epi32(redBlue, 16),
+		_mm_srli_epi32(redBlue, 16));
+	return _mm_or_si128(_mm_andnot_si128(redBlueMask, colors), redBlue);
+}
+
+
+/*!	Returns a mask of the pixels whose alpha equals the alpha in "alpha".
+*/
+static inline __m128i
+alpha_equals(__m128i pixels, __m128i alpha)
+{
+	const __m128i alphaMask = _mm_set1_epi32(0xff000000);
+	return _mm_cmpeq_epi32(_mm_and_si128(pixels, alphaMask), alpha);
+}
+
+
+/*!	(s * a + d * (256 - a)) >> 8 on 16 bit channels, which is the BLEND
+	macro. "alpha" must be in the range 0..256, and the sum never exceeds
+	255 * 256.
+*/
+static inline __m128i
+blend8(__m128i d, __m128i s, __m128i alpha)
+{
+	const __m128i k256 = _mm_set1_epi16(256);
+
+	__m128i sum = _mm_add_epi16(_mm_mullo_epi16(s, alpha),
+		_mm_mullo_epi16(d, _mm_sub_epi16(k256, alpha)));
+	return _mm_srli_epi16(sum, 8);
+}
+
+
+/*!	(s * a + d * (65536 - a)) >> 16 on 16 bit channels, which is the BLEND16
+	macro. "alpha" must be in the range 1..65535. The carry of the low words
+	is computed without overflowing them.
+*/
+static inline __m128i
+blend16(__m128i d, __m128i s, __m128i alpha, __m128i inverseAlpha)
+{
+	const __m128i one = _mm_set1_epi16(1);
+
+	__m128i high = _mm_add_epi16(_mm_mulhi_epu16(s, alpha),
+		_mm_mulhi_epu16(d, inverseAlpha));
+	__m128i lowS = _mm_mullo_epi16(s, alpha);
+	__m128i lowD = _mm_mullo_epi16(d, inverseAlpha);
+	__m128i carry = _mm_add_epi16(
+		_mm_add_epi16(_mm_srli_epi16(lowS, 1), _mm_srli_epi16(lowD, 1)),
+		_mm_and_si128(_mm_and_si128(lowS, lowD), one));
+	return _mm_add_epi16(high, _mm_srli_epi16(carry, 15));
+}
+
+
+static void
+alpha_row_sse2(uint8* dst, const uint8* src, uint32 count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set1_epi32(0xff000000);
+
+	for (; count >= 4; count -= 4, dst += 16, src += 16) {
+		__m128i d = load(dst);
+		__m128i s = load(src);
+
+		__m128i sLow = _mm_unpacklo_epi8(s, zero);
+		__m128i sHigh = _mm_unpackhi_epi8(s, zero);
+		__m128i aLow = _mm_shufflehi_epi16(
+			_mm_shufflelo_epi16(sLow, 0xff), 0xff);
+		__m128i aHigh = _mm_shufflehi_epi16(
+			_mm_shufflelo_epi16(sHigh, 0xff), 0xff);
+
+		__m128i result = _mm_packus_epi16(
+			blend8(_mm_unpacklo_epi8(d, zero), sLow, aLow),
+			blend8(_mm_unpackhi_epi8(d, zero), sHigh, aHigh));
+		result = select(alphaMask, d, result);
+		store(dst, select(alpha_equals(s, alphaMask), s, result));
+	}
+
+	if (count > 0)
+		gBlendSpansC.alpha_row(dst, src, count);
+}
+
+
+static void
+over_row_sse2(uint8* dst, const uint8* src, uint32 count)
+{
+	const __m128i magic = _mm_set1_epi32(B_TRANSPARENT_MAGIC_RGBA32);
+
+	for (; count >= 4; count -= 4, dst += 16, src += 16) {
+		__m128i s = load(src);
+		store(dst, select(_mm_cmpeq_epi32(s, magic), load(dst), s));
+	}
+
+	if (count > 0)
+		gBlendSpansC.over_row(dst, src, count);
+}
+
+
+static void
+copy_sse2(uint8* dst, const uint8* colors, uint32 count)
+{
+	for (; count >= 4; count -= 4, dst += 16, colors += 16)
+		store(dst, swap_red_blue(load(colors)));
+
+	if (count > 0)
+		gBlendSpansC.copy(dst, colors, count);
+}
+
+
+static void
+assign_opaque_sse2(uint8* dst, const uint8* colors, uint32 count)
+{
+	const __m128i alphaMask = _mm_set1_epi32(0xff000000);
+
+	for (; count >= 4; count -= 4, dst += 16, colors += 16)
+		store(dst, _mm_or_si128(swap_red_blue(load(colors)), alphaMask));
+
+	if (count > 0)
+		gBlendSpansC.alpha_co(dst, colors, count, 255 * 255);
+}
+
+
+static void
+over_sse2(uint8* dst, const uint8* colors, uint32 count, uint8 cover)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set1_epi32(0xff000000);
+	// a full cover assigns the color, which blending with 256 does as well
+	const __m128i alpha = _mm_set1_epi16(cover == 255 ? 256 : cover);
+
+	for (; count >= 4; count -= 4, dst += 16, colors += 16) {
+		__m128i d = load(dst);
+		__m128i s = swap_red_blue(load(colors));
+
+		__m128i result = _mm_packus_epi16(
+			blend8(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero),
+				alpha),
+			blend8(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero),
+				alpha));
+		result = _mm_or_si128(result, alphaMask);
+		store(dst, select(alpha_equals(s, zero), d, result));
+	}
+
+	if (count > 0)
+		gBlendSpansC.over(dst, colors, count, cover);
+}
+
+
+static void
+alpha_co_sse2(uint8* dst, const uint8* colors, uint32 count, uint16 alpha)
+{
+	if (alpha == 255 * 255) {
+		assign_opaque_sse2(dst, colors, count);
+		return;
+	}
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set1_epi32(0xff000000);
+	const __m128i sourceAlpha = _mm_set1_epi16(alpha);
+	const __m128i inverseAlpha = _mm_set1_epi16((uint16)(65536 - alpha));
+
+	for (; count >= 4; count -= 4, dst += 16, colors += 16) {
+		__m128i d = load(dst);
+		__m128i s = swap_red_blue(load(colors));
+
+		__m128i result = _mm_packus_epi16(
+			blend16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero),
+				sourceAlpha, inverseAlpha),
+			blend16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero),
+				sourceAlpha, inverseAlpha));
+		store(dst, _mm_or_si128(result, alphaMask));
+	}
+
+	if (count > 0)
+		gBlendSpansC.alpha_co(dst, colors, count, alpha);
+}
+
+
+static void
+alpha_pc_sse2(uint8* dst, const uint8* colors, uint32 count, uint16 alpha)
+{
+	if (alpha == 255 * 255) {
+		assign_opaque_sse2(dst, colors, count);
+		return;
+	}
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set1_epi32(0xff000000);
+	const __m128i alpha8 = _mm_set1_epi16(alpha / 255);
+
+	for (; count >= 4; count -= 4, dst += 16, colors += 16) {
+		__m128i d = load(dst);
+		if (_mm_movemask_epi8(alpha_equals(d, alphaMask)) != 0xffff) {
+			// composing onto a translucent background needs a division
+			gBlendSpansC.alpha_pc(dst, colors, 4, alpha);
+			continue;
+		}
+
+		__m128i s = swap_red_blue(load(colors));
+		__m128i result = _mm_packus_epi16(
+			blend8(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero),
+				alpha8),
+			blend8(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero),
+				alpha8));
+		store(dst, _mm_or_si128(result, alphaMask));
+	}
+
+	if (count > 0)
+		gBlendSpansC.alpha_pc(dst, colors, count, alpha);
+}
+
+
+static void
+blend_sse2(uint8* dst, const uint8* colors, uint32 count, uint8 cover)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set1_epi32(0xff000000);
+	const __m128i alpha = _mm_set1_epi16(cover);
+
+	for (; count >= 4; count -= 4, dst += 16, colors += 16) {
+		__m128i d = load(dst);
+		__m128i s = swap_red_blue(load(colors));
+
+		__m128i dLow = _mm_unpacklo_epi8(d, zero);
+		__m128i dHigh = _mm_unpackhi_epi8(d, zero);
+		__m128i averageLow = _mm_srli_epi16(
+			_mm_add_epi16(dLow, _mm_unpacklo_epi8(s, zero)), 1);
+		__m128i averageHigh = _mm_srli_epi16(
+			_mm_add_epi16(dHigh, _mm_unpackhi_epi8(s, zero)), 1);
+
+		__m128i result;
+		if (cover == 255) {
+			result = _mm_or_si128(
+				_mm_packus_epi16(averageLow, averageHigh), alphaMask);
+			result = select(alpha_equals(s, zero), d, result);
+		} else {
+			result = _mm_or_si128(_mm_packus_epi16(
+					blend8(dLow, averageLow, alpha),
+					blend8(dHigh, averageHigh, alpha)),
+				alphaMask);
+		}
+		store(dst, result);
+	}
+
+	if (count > 0)
+		gBlendSpansC.blend(dst, colors, count, cover);
+}
+
+
+static void
+alpha_fill_sse2(uint8* dst, uint32 count, uint8 r, uint8 g, uint8 b,
+	uint8 a)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set1_epi32(0xff000000);
+	const __m128i color = _mm_set_epi16(0, (r * a) >> 8, (g * a) >> 8,
+		(b * a) >> 8, 0, (r * a) >> 8, (g * a) >> 8, (b * a) >> 8);
+	const __m128i inverseAlpha = _mm_set1_epi16(255 - a);
+
+	for (; count >= 4; count -= 4, dst += 16) {
+		__m128i d = load(dst);
+
+		__m128i low = _mm_add_epi16(_mm_srli_epi16(
+			_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inverseAlpha), 8),
+			color);
+		__m128i high = _mm_add_epi16(_mm_srli_epi16(
+			_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inverseAlpha), 8),
+			color);
+		store(dst, select(alphaMask, d, _mm_packus_epi16(low, high)));
+	}
+
+	if (count > 0)
+		gBlendSpansC.alpha_fill(dst, count, r, g, b, a);
+}
+
+
+const blend_span_functions gBlendSpansSSE2 = {
+	alpha_row_sse2,
+	over_row_sse2,
+	copy_sse2,
+	over_sse2,
+	alpha_co_sse2,
+	alpha_pc_sse2,
+	blend_sse2,
+	alpha_fill_sse2
+};
@@ -164,21 +164,10 @@ blend_color_hspan_alpha_co(int x, int y, unsigned len,
 		} while(--len);
 	} else {
 		// solid full opcacity
+		// solid full or partial opacity
 		uint16 alpha = hAlpha * colors->a * cover / 255;
-		if (alpha == 255 * 255) {
-			do {
-				ASSIGN_ALPHA_CO(p, colors->r, colors->g, colors->b);
-				p += 4;
-				++colors;
-			} while(--len);
-		// solid partial opacity
-		} else if (alpha) {
-			do {
-				BLEND_ALPHA_CO(p, colors->r, colors->g, colors->b, alpha);
-				p += 4;
-				++colors;
-			} while(--len);
-		}
+		if (alpha)
+			gBlendSpans->alpha_co(p, (const uint8*)colors, len, alpha);
 	}
 }
 
@@ -57,7 +57,7 @@ blend_hline_alpha_co_solid(int x, int y, unsigned len,
 			} while(--len);
 		} else {
 			alpha = alpha >> 8;
-			blend_line32(p, len, c.r, c.g, c.b, alpha);
+			gBlendSpans->alpha_fill(p, len, c.r, c.g, c.b, alpha);
 		}
 	}
 }
@@ -134,22 +134,10 @@ blend_color_hspan_alpha_pc(int x, int y, unsigned len,
 			++colors;
 		} while(--len);
 	} else {
-		// solid full opcacity
+		// solid full or partial opacity
 		uint16 alpha = colors->a * cover;
-		if (alpha == 255 * 255) {
-			do {
-				ASSIGN_ALPHA_PC(p, colors->r, colors->g, colors->b);
-				p += 4;
-				++colors;
-			} while(--len);
-		// solid partial opacity
-		} else if (alpha) {
-			do {
-				BLEND_ALPHA_PC(p, colors->r, colors->g, colors->b, alpha);
-				p += 4;
-				++colors;
-			} while(--len);
-		}
+		if (alpha)
+			gBlendSpans->alpha_pc(p, (const uint8*)colors, len, alpha);
 	}
 }
 
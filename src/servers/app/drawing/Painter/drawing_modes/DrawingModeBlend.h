@@ -146,23 +146,9 @@ if (*covers && (colors->a & 0xff)) {
 			++colors;
 		} while(--len);
 	} else {
-		// solid full opcacity
-		if (cover == 255) {
-			do {
-if (colors->a & 0xff) {
-				ASSIGN_BLEND(p, colors->r, colors->g, colors->b);
-}
-				p += 4;
-				++colors;
-			} while(--len);
-		// solid partial opacity
-		} else if (cover) {
-			do {
-				BLEND_BLEND(p, colors->r, colors->g, colors->b, cover);
-				p += 4;
-				++colors;
-			} while(--len);
-		}
+		// solid full or partial opacity
+		if (cover)
+			gBlendSpans->blend(p, (const uint8*)colors, len, cover);
 	}
 }
 
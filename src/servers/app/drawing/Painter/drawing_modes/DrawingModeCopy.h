@@ -167,11 +167,7 @@ blend_color_hspan_copy(int x, int y, unsigned len, const color_type* colors,
 	} else {
 		// solid full opcacity
 		if (cover == 255) {
-			do {
-				ASSIGN_COPY(p, colors->r, colors->g, colors->b, colors->a);
-				p += 4;
-				++colors;
-			} while(--len);
+			gBlendSpans->copy(p, (const uint8*)colors, len);
 		// solid partial opacity
 		} else if (cover != 0) {
 			do {
@@ -150,25 +150,9 @@ blend_color_hspan_over(int x, int y, unsigned len,
 			++colors;
 		} while(--len);
 	} else {
-		// solid full opcacity
-		if (cover == 255) {
-			do {
-				if (colors->a > 0) {
-					ASSIGN_OVER(p, colors->r, colors->g, colors->b);
-				}
-				p += 4;
-				++colors;
-			} while(--len);
-		// solid partial opacity
-		} else if (cover) {
-			do {
-				if (colors->a > 0) {
-					BLEND_OVER(p, colors->r, colors->g, colors->b, cover);
-				}
-				p += 4;
-				++colors;
-			} while(--len);
-		}
+		// solid full or partial opacity
+		if (cover)
+			gBlendSpans->over(p, (const uint8*)colors, len, cover);
 	}
 }
 
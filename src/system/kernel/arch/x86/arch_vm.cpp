@@ -15,9 +15,12 @@
 #include <algorithm>
 #include <new>
 
+#include <ACPI.h>
 #include <KernelExport.h>
 
 #include <boot/kernel_args.h>
+#include <cpu.h>
+#include <kscheduler.h>
 #include <smp.h>
 #include <util/AutoLock.h>
 #include <vm/vm.h>
@@ -30,8 +33,11 @@
 #include <arch/int.h>
 #include <arch/cpu.h>
 
+#include <arch/x86/arch_smp.h>
 #include <arch/x86/bios.h>
 
+#include "acpi.h"
+
 
 //#define TRACE_ARCH_VM
 #ifdef TRACE_ARCH_VM
@@ -99,6 +105,7 @@ static MemoryTypeRangeList sMemoryTypeRanges;
 static int32 sMemoryTypeRangeCount = 0;
 
 static const uint32 kMaxMemoryTypeRegisters	= 32;
+static const uint32 kMaxMemoryNodeRanges	= 32;
 static x86_mtrr_info sMemoryTypeRegisters[kMaxMemoryTypeRegisters];
 static uint32 sMemoryTypeRegisterCount;
 static uint32 sMemoryTypeRegistersUsed;
@@ -630,6 +637,178 @@ remove_memory_type_range(area_id areaID)
 }
 
 
+static int32
+memory_node_for_domain(uint32* domains, uint32& nodeCount, uint32 domain)
+{
+	for (uint32 i = 0; i < nodeCount; i++) {
+		if (domains[i] == domain)
+			return i;
+	}
+
+	if (nodeCount == VM_MAX_MEMORY_NODES)
+		return -1;
+
+	domains[nodeCount] = domain;
+	return nodeCount++;
+}
+
+
+static void
+set_cpu_memory_node(uint32 apicID, int32 node)
+{
+	for (int32 i = 0; i < smp_get_num_cpus(); i++) {
+		if (x86_get_cpu_apic_id(i) == apicID) {
+			gCPU[i].node = node;
+			return;
+		}
+	}
+}
+
+
+/*!	Reads the memory (NUMA) topology from the ACPI SRAT and SLIT, and passes
+	it on to the page allocator and the scheduler.
+*/
+static void
+read_memory_nodes(acpi_module_info* acpi)
+{
+	acpi_table_srat* srat;
+	if (acpi->get_table(ACPI_SIG_SRAT, 0, (void**)&srat) != B_OK)
+		return;
+
+	uint32 domains[VM_MAX_MEMORY_NODES];
+	uint32 nodeCount = 0;
+	vm_memory_node_range ranges[kMaxMemoryNodeRanges];
+	uint32 rangeCount = 0;
+
+	uint8* entry = (uint8*)(srat + 1);
+	uint8* end = (uint8*)srat + srat->Header.Length;
+	while (entry + sizeof(ACPI_SUBTABLE_HEADER) <= end) {
+		ACPI_SUBTABLE_HEADER* header = (ACPI_SUBTABLE_HEADER*)entry;
+		if (header->Length < sizeof(ACPI_SUBTABLE_HEADER)
+			|| entry + header->Length > end) {
+			break;
+		}
+
+		int32 node = 0;
+		switch (header->Type) {
+			case ACPI_SRAT_TYPE_CPU_AFFINITY:
+			{
+				acpi_srat_cpu_affinity* cpu = (acpi_srat_cpu_affinity*)entry;
+				if ((cpu->Flags & ACPI_SRAT_CPU_USE_AFFINITY) == 0)
+					break;
+
+				uint32 domain = cpu->ProximityDomainLo
+					| (uint32)cpu->ProximityDomainHi[0] << 8
+					| (uint32)cpu->ProximityDomainHi[1] << 16
+					| (uint32)cpu->ProximityDomainHi[2] << 24;
+				node = memory_node_for_domain(domains, nodeCount, domain);
+				if (node >= 0)
+					set_cpu_memory_node(cpu->ApicId, node);
+				break;
+			}
+
+			case ACPI_SRAT_TYPE_X2APIC_CPU_AFFINITY:
+			{
+				acpi_srat_x2apic_cpu_affinity* cpu
+					= (acpi_srat_x2apic_cpu_affinity*)entry;
+				if ((cpu->Flags & ACPI_SRAT_CPU_ENABLED) == 0)
+					break;
+
+				node = memory_node_for_domain(domains, nodeCount,
+					cpu->ProximityDomain);
+				if (node >= 0)
+					set_cpu_memory_node(cpu->ApicId, node);
+				break;
+			}
+
+			case ACPI_SRAT_TYPE_MEMORY_AFFINITY:
+			{
+				acpi_srat_mem_affinity* memory
+					= (acpi_srat_mem_affinity*)entry;
+				if ((memory->Flags & ACPI_SRAT_MEM_ENABLED) == 0
+					|| memory->Length == 0) {
+					break;
+				}
+
+				node = memory_node_for_domain(domains, nodeCount,
+					memory->ProximityDomain);
+				if (node < 0 || rangeCount == kMaxMemoryNodeRanges) {
+					node = -1;
+					break;
+				}
+
+				ranges[rangeCount].start = memory->BaseAddress;
+				ranges[rangeCount].size = memory->Length;
+				ranges[rangeCount].node = node;
+				rangeCount++;
+				break;
+			}
+		}
+
+		if (node < 0) {
+			dprintf("init_memory_nodes: too many memory nodes or ranges, "
+				"ignoring NUMA topology\n");
+			for (int32 i = 0; i < smp_get_num_cpus(); i++)
+				gCPU[i].node = 0;
+			return;
+		}
+
+		entry += header->Length;
+	}
+
+	if (nodeCount < 2)
+		return;
+
+	// The SLIT is indexed by proximity domain, translate it to our node IDs.
+	uint8 distances[VM_MAX_MEMORY_NODES * VM_MAX_MEMORY_NODES];
+	acpi_table_slit* slit;
+	bool haveDistances = acpi->get_table(ACPI_SIG_SLIT, 0, (void**)&slit)
+		== B_OK;
+	for (uint32 i = 0; haveDistances && i < nodeCount; i++) {
+		for (uint32 j = 0; j < nodeCount; j++) {
+			if (domains[i] >= slit->LocalityCount
+				|| domains[j] >= slit->LocalityCount) {
+				haveDistances = false;
+				break;
+			}
+
+			distances[i * nodeCount + j]
+				= slit->Entry[domains[i] * slit->LocalityCount + domains[j]];
+		}
+	}
+
+	dprintf("init_memory_nodes: %" B_PRIu32 " memory nodes, %" B_PRIu32
+		" ranges%s\n", nodeCount, rangeCount,
+		haveDistances ? "" : ", no distance information");
+
+	if (vm_page_set_memory_nodes(ranges, rangeCount, nodeCount,
+			haveDistances ? distances : NULL) != B_OK) {
+		for (int32 i = 0; i < smp_get_num_cpus(); i++)
+			gCPU[i].node = 0;
+		return;
+	}
+
+	scheduler_update_memory_nodes();
+}
+
+
+static void
+init_memory_nodes()
+{
+	// memory nodes only exist with several CPU packages
+	if (smp_get_num_cpus() < 2)
+		return;
+
+	acpi_module_info* acpi;
+	if (get_module(B_ACPI_MODULE_NAME, (module_info**)&acpi) != B_OK)
+		return;
+
+	read_memory_nodes(acpi);
+
+	put_module(B_ACPI_MODULE_NAME);
+}
+
+
 //	#pragma mark -
 
 
@@ -686,6 +865,9 @@ arch_vm_init_end(kernel_args *args)
 status_t
 arch_vm_init_post_modules(kernel_args *args)
 {
+	// the ACPI module is now accessible
+	init_memory_nodes();
+
 	// the x86 CPU modules are now accessible
 
 	sMemoryTypeRegisterCount = x86_count_mtrrs();
@@ -55,6 +55,13 @@ X86VMTranslationMap64Bit::~X86VMTranslationMap64Bit()
 		phys_addr_t address;
 		vm_page* page;
 
+		// Free the page tables set aside for still mapped large pages. The
+		// large pages themselves belong to their caches.
+		while ((page = fLargePageTables.RemoveHead()) != NULL) {
+			DEBUG_PAGE_ACCESS_START(page);
+			vm_page_set_state(page, PAGE_STATE_FREE);
+		}
+
 		// Free all structures in the bottom half of the PMLTop (user memory).
 		uint64* virtualPML4 = fPagingStructures->VirtualPMLTop();
 		for (uint32 i = 0; i < 256; i++) {
@@ -70,8 +77,10 @@ X86VMTranslationMap64Bit::~X86VMTranslationMap64Bit()
 				uint64* virtualPageDir = (uint64*)fPageMapper->GetPageTableAt(
 					virtualPDPT[j] & X86_64_PDPTE_ADDRESS_MASK);
 				for (uint32 k = 0; k < 512; k++) {
-					if ((virtualPageDir[k] & X86_64_PDE_PRESENT) == 0)
+					if ((virtualPageDir[k] & X86_64_PDE_PRESENT) == 0
+						|| (virtualPageDir[k] & X86_64_PDE_LARGE_PAGE) != 0) {
 						continue;
+					}
 
 					address = virtualPageDir[k] & X86_64_PDE_ADDRESS_MASK;
 					page = vm_lookup_page(address / B_PAGE_SIZE);
@@ -242,6 +251,8 @@ X86VMTranslationMap64Bit::Unmap(addr_t start, addr_t end)
 
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
+	_SplitLargePages(start, end, false);
+
 	do {
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
@@ -292,6 +303,8 @@ X86VMTranslationMap64Bit::DebugMarkRangePresent(addr_t start, addr_t end,
 
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
+	_SplitLargePages(start, end, false);
+
 	do {
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
@@ -342,6 +355,8 @@ X86VMTranslationMap64Bit::UnmapPage(VMArea* area, addr_t address,
 
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
+	_SplitLargePageAt(address);
+
 	// Look up the page table for the virtual address.
 	uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
 		fPagingStructures->VirtualPMLTop(), address, fIsKernelMap,
@@ -409,6 +424,8 @@ X86VMTranslationMap64Bit::UnmapPages(VMArea* area, addr_t base, size_t size,
 	RecursiveLocker locker(fLock);
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
+	_SplitLargePages(start, end, false);
+
 	do {
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
@@ -523,6 +540,8 @@ X86VMTranslationMap64Bit::UnmapArea(VMArea* area, bool deletingAddressSpace,
 	RecursiveLocker locker(fLock);
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
+	_SplitLargePages(area->Base(), area->Base() + (area->Size() - 1), false);
+
 	VMAreaMappings mappings;
 	mappings.MoveFrom(&area->mappings);
 
@@ -690,7 +709,39 @@ X86VMTranslationMap64Bit::Protect(addr_t start, addr_t end, uint32 attributes,
 
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
+	// Large pages only partially covered by the range need to be split. The
+	// others are changed as a whole below.
+	_SplitLargePages(start, end, true);
+
 	do {
+		if (!fLargePageTables.IsEmpty()) {
+			uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+				fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
+				NULL, fPageMapper, fMapCount);
+			if (pde != NULL && (*pde & X86_64_PDE_PRESENT) != 0
+				&& (*pde & X86_64_PDE_LARGE_PAGE) != 0) {
+				uint64 entry = *pde;
+				while (true) {
+					uint64 oldEntry = X86PagingMethod64Bit::TestAndSetTableEntry(
+						pde, (entry & ~(X86_64_PTE_PROTECTION_MASK
+								| X86_64_PTE_MEMORY_TYPE_MASK))
+							| newProtectionFlags
+							| X86PagingMethod64Bit
+								::MemoryTypeToPageTableEntryFlags(memoryType),
+						entry);
+					if (oldEntry == entry)
+						break;
+					entry = oldEntry;
+				}
+
+				if ((entry & X86_64_PDE_ACCESSED) != 0)
+					InvalidatePage(start);
+
+				start += k64BitPageTableRange;
+				continue;
+			}
+		}
+
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
 			NULL, fPageMapper, fMapCount);
@@ -748,6 +799,9 @@ X86VMTranslationMap64Bit::ClearFlags(addr_t address, uint32 flags)
 
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
+	// The flags of a large page apply to all of its pages.
+	_SplitLargePageAt(address);
+
 	uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
 		fPagingStructures->VirtualPMLTop(), address, fIsKernelMap,
 		false, NULL, fPageMapper, fMapCount);
@@ -779,6 +833,37 @@ X86VMTranslationMap64Bit::ClearAccessedAndModified(VMArea* area, addr_t address,
 	RecursiveLocker locker(fLock);
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
+	if (!fLargePageTables.IsEmpty()) {
+		uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+			fPagingStructures->VirtualPMLTop(), address, fIsKernelMap, false,
+			NULL, fPageMapper, fMapCount);
+		if (pde != NULL && (*pde & X86_64_PDE_PRESENT) != 0
+			&& (*pde & X86_64_PDE_LARGE_PAGE) != 0) {
+			// The accessed and dirty flags of a large page are shared by all
+			// of its pages. They are reported for every page, but the accessed
+			// flag is only cleared for the first one, so that all pages age in
+			// lockstep. The dirty flag is kept until the large page is split.
+			// Only when the page daemon wants to unmap an unaccessed page, we
+			// have to split the large page.
+			uint64 oldEntry = *pde;
+			if (!unmapIfUnaccessed || (oldEntry & X86_64_PDE_ACCESSED) != 0) {
+				if (address % k64BitPageTableRange == 0) {
+					oldEntry = X86PagingMethod64Bit::ClearTableEntryFlags(pde,
+						X86_64_PDE_ACCESSED);
+					if ((oldEntry & X86_64_PDE_ACCESSED) != 0) {
+						InvalidatePage(address);
+						Flush();
+					}
+				}
+
+				_modified = (oldEntry & X86_64_PDE_DIRTY) != 0;
+				return (oldEntry & X86_64_PDE_ACCESSED) != 0;
+			}
+
+			_SplitLargePageAt(address);
+		}
+	}
+
 	uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
 		fPagingStructures->VirtualPMLTop(), address, fIsKernelMap,
 		false, NULL, fPageMapper, fMapCount);
@@ -851,3 +936,237 @@ X86VMTranslationMap64Bit::PagingStructures() const
 {
 	return fPagingStructures;
 }
+
+
+// #pragma mark - large pages
+
+
+size_t
+X86VMTranslationMap64Bit::LargePageSize() const
+{
+	// The kernel's large pages (the physical map area) are not managed via
+	// this interface, and kernel areas don't use them.
+	return fIsKernelMap ? 0 : k64BitPageTableRange;
+}
+
+
+status_t
+X86VMTranslationMap64Bit::MapLargePage(addr_t virtualAddress,
+	phys_addr_t physicalAddress, uint32 attributes, uint32 memoryType,
+	vm_page_reservation* reservation)
+{
+	TRACE("X86VMTranslationMap64Bit::MapLargePage(%#" B_PRIxADDR ", %#"
+		B_PRIxPHYSADDR ")\n", virtualAddress, physicalAddress);
+
+	if (fIsKernelMap || virtualAddress % k64BitPageTableRange != 0
+		|| physicalAddress % k64BitPageTableRange != 0) {
+		return B_BAD_VALUE;
+	}
+
+	ThreadCPUPinner pinner(thread_get_current_thread());
+
+	uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+		fPagingStructures->VirtualPMLTop(), virtualAddress, fIsKernelMap,
+		true, reservation, fPageMapper, fMapCount);
+	ASSERT(pde != NULL);
+
+	// We keep a page table for the range around while the large page is
+	// mapped, so that splitting it up again never needs to allocate memory.
+	// An existing page table can be used, if it doesn't map anything.
+	vm_page* pageTable;
+	phys_addr_t physicalPageTable;
+	bool replacesPageTable = (*pde & X86_64_PDE_PRESENT) != 0;
+	if (replacesPageTable) {
+		if ((*pde & X86_64_PDE_LARGE_PAGE) != 0)
+			return B_BUSY;
+
+		physicalPageTable = *pde & X86_64_PDE_ADDRESS_MASK;
+		pageTable = vm_lookup_page(physicalPageTable / B_PAGE_SIZE);
+		ASSERT(pageTable != NULL);
+
+		uint64* virtualPageTable
+			= (uint64*)fPageMapper->GetPageTableAt(physicalPageTable);
+		for (uint32 i = 0; i < k64BitTableEntryCount; i++) {
+			if ((virtualPageTable[i] & X86_64_PTE_PRESENT) != 0)
+				return B_BUSY;
+		}
+	} else {
+		pageTable = vm_page_allocate_page(reservation,
+			PAGE_STATE_WIRED | VM_PAGE_ALLOC_CLEAR);
+		DEBUG_PAGE_ACCESS_END(pageTable);
+
+		physicalPageTable
+			= (phys_addr_t)pageTable->physical_page_number * B_PAGE_SIZE;
+		fMapCount++;
+	}
+
+	// Prepare the page table entries, as they will be needed when the large
+	// page is split.
+	uint64* virtualPageTable
+		= (uint64*)fPageMapper->GetPageTableAt(physicalPageTable);
+	for (uint32 i = 0; i < k64BitTableEntryCount; i++) {
+		X86PagingMethod64Bit::PutPageTableEntryInTable(&virtualPageTable[i],
+			physicalAddress + i * B_PAGE_SIZE, attributes, memoryType, false);
+	}
+
+	pageTable->cache_offset = virtualAddress / k64BitPageTableRange;
+	fLargePageTables.Add(pageTable);
+
+	uint64 entry;
+	X86PagingMethod64Bit::PutPageTableEntryInTable(&entry, physicalAddress,
+		attributes, memoryType, false);
+	X86PagingMethod64Bit::SetTableEntry(pde, entry | X86_64_PDE_LARGE_PAGE);
+
+	// The paging structure caches might still refer to the replaced page
+	// table.
+	if (replacesPageTable)
+		InvalidatePage(virtualAddress);
+
+	fMapCount += k64BitTableEntryCount;
+
+	return B_OK;
+}
+
+
+size_t
+X86VMTranslationMap64Bit::CountLargePages(addr_t start, addr_t end)
+{
+	size_t count = 0;
+
+	PageTableList::Iterator it = fLargePageTables.GetIterator();
+	while (vm_page* pageTable = it.Next()) {
+		addr_t base = pageTable->cache_offset * k64BitPageTableRange;
+		if (base >= start && base + (k64BitPageTableRange - 1) <= end)
+			count++;
+	}
+
+	return count;
+}
+
+
+/*!	Returns the page table set aside for the large page mapped at
+	\a address, or \c NULL, if there is none.
+	The map must be locked.
+*/
+vm_page*
+X86VMTranslationMap64Bit::_LargePageTableFor(addr_t address)
+{
+	page_num_t key = address / k64BitPageTableRange;
+
+	PageTableList::Iterator it = fLargePageTables.GetIterator();
+	while (vm_page* pageTable = it.Next()) {
+		if (pageTable->cache_offset == key)
+			return pageTable;
+	}
+
+	return NULL;
+}
+
+
+/*!	Replaces the large page \a pde maps by the page table that was prepared
+	when it was mapped, carrying over its current protection and its accessed
+	and dirty flags. Afterwards the range can be handled page by page again.
+	The current thread must be pinned.
+*/
+void
+X86VMTranslationMap64Bit::_SplitLargePage(vm_page* pageTable, uint64* pde)
+{
+	RecursiveLocker locker(fLock);
+
+	addr_t base = pageTable->cache_offset * k64BitPageTableRange;
+
+	TRACE("X86VMTranslationMap64Bit::_SplitLargePage(%#" B_PRIxADDR ")\n",
+		base);
+
+	phys_addr_t physicalPageTable
+		= (phys_addr_t)pageTable->physical_page_number * B_PAGE_SIZE;
+	uint64* virtualPageTable
+		= (uint64*)fPageMapper->GetPageTableAt(physicalPageTable);
+
+	const uint64 inheritedFlags = X86_64_PTE_PROTECTION_MASK
+		| X86_64_PTE_MEMORY_TYPE_MASK | X86_64_PTE_ACCESSED | X86_64_PTE_DIRTY;
+
+	uint64 entry = *pde;
+	while (true) {
+		for (uint32 i = 0; i < k64BitTableEntryCount; i++) {
+			X86PagingMethod64Bit::SetTableEntry(&virtualPageTable[i],
+				(virtualPageTable[i] & ~inheritedFlags)
+					| (entry & inheritedFlags));
+		}
+
+		uint64 oldEntry = X86PagingMethod64Bit::TestAndSetTableEntry(pde,
+			(physicalPageTable & X86_64_PDE_ADDRESS_MASK)
+				| X86_64_PDE_PRESENT
+				| X86_64_PDE_WRITABLE
+				| X86_64_PDE_USER,
+			entry);
+		if (oldEntry == entry)
+			break;
+
+		// the accessed or dirty flag has been set in the meantime
+		entry = oldEntry;
+	}
+
+	fLargePageTables.Remove(pageTable);
+
+	InvalidatePage(base);
+	Flush();
+}
+
+
+/*!	Splits the large page mapped at \a address, if there is one.
+	The current thread must be pinned.
+*/
+void
+X86VMTranslationMap64Bit::_SplitLargePageAt(addr_t address)
+{
+	if (fLargePageTables.IsEmpty())
+		return;
+
+	RecursiveLocker locker(fLock);
+
+	uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+		fPagingStructures->VirtualPMLTop(), address, fIsKernelMap, false,
+		NULL, fPageMapper, fMapCount);
+	if (pde == NULL || (*pde & X86_64_PDE_PRESENT) == 0
+		|| (*pde & X86_64_PDE_LARGE_PAGE) == 0) {
+		return;
+	}
+
+	vm_page* pageTable = _LargePageTableFor(address);
+	if (pageTable != NULL)
+		_SplitLargePage(pageTable, pde);
+}
+
+
+/*!	Splits all large pages intersecting with the range from \a start to
+	\a end (inclusive). If \a partialOnly is \c true, large pages completely
+	covered by the range are left alone.
+	The current thread must be pinned.
+*/
+void
+X86VMTranslationMap64Bit::_SplitLargePages(addr_t start, addr_t end,
+	bool partialOnly)
+{
+	if (fLargePageTables.IsEmpty())
+		return;
+
+	RecursiveLocker locker(fLock);
+
+	PageTableList::Iterator it = fLargePageTables.GetIterator();
+	while (vm_page* pageTable = it.Next()) {
+		addr_t base = pageTable->cache_offset * k64BitPageTableRange;
+		addr_t last = base + (k64BitPageTableRange - 1);
+		if (base > end || last < start)
+			continue;
+		if (partialOnly && base >= start && last <= end)
+			continue;
+
+		uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+			fPagingStructures->VirtualPMLTop(), base, fIsKernelMap, false,
+			NULL, fPageMapper, fMapCount);
+		ASSERT(pde != NULL && (*pde & X86_64_PDE_LARGE_PAGE) != 0);
+
+		_SplitLargePage(pageTable, pde);
+	}
+}
@@ -7,6 +7,9 @@
 #define KERNEL_ARCH_X86_PAGING_64BIT_X86_VM_TRANSLATION_MAP_64BIT_H
 
 
+#include <util/DoublyLinkedList.h>
+#include <vm/vm_types.h>
+
 #include "paging/X86VMTranslationMap.h"
 
 
@@ -31,6 +34,13 @@ struct X86VMTranslationMap64Bit final : X86VMTranslationMap {
 	virtual	status_t			DebugMarkRangePresent(addr_t start, addr_t end,
 									bool markPresent);
 
+	virtual	size_t				LargePageSize() const;
+	virtual	status_t			MapLargePage(addr_t virtualAddress,
+									phys_addr_t physicalAddress,
+									uint32 attributes, uint32 memoryType,
+									vm_page_reservation* reservation);
+	virtual	size_t				CountLargePages(addr_t start, addr_t end);
+
 	virtual	status_t			UnmapPage(VMArea* area, addr_t address,
 									bool updatePageQueue);
 	virtual	void				UnmapPages(VMArea* area, addr_t base,
@@ -61,9 +71,24 @@ struct X86VMTranslationMap64Bit final : X86VMTranslationMap {
 	inline	X86PagingStructures64Bit* PagingStructures64Bit() const
 									{ return fPagingStructures; }
 
+private:
+			typedef DoublyLinkedList<vm_page,
+				DoublyLinkedListMemberGetLink<vm_page, &vm_page::queue_link> >
+					PageTableList;
+
+			vm_page*			_LargePageTableFor(addr_t address);
+			void				_SplitLargePage(vm_page* pageTable,
+									uint64* pde);
+			void				_SplitLargePageAt(addr_t address);
+			void				_SplitLargePages(addr_t start, addr_t end,
+									bool partialOnly);
+
 private:
 			X86PagingStructures64Bit* fPagingStructures;
 			bool				fLA57;
+			PageTableList		fLargePageTables;
+				// page tables of the mapped large pages, keyed by their
+				// vm_page::cache_offset
 };
 
 
@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/uio.h>
 
 #include <KernelExport.h>
 #include <fs_cache.h>
@@ -26,6 +27,14 @@
 
 #include "kernel_debug_config.h"
 
+#ifdef _KERNEL_MODE
+#	include <cpu.h>
+#	include <smp.h>
+#	include <vfs.h>
+
+#	include "IORequest.h"
+#endif
+
 
 // TODO: this is a naive but growing implementation to test the API:
 //	block reading/writing is not at all optimized for speed, it will
@@ -54,6 +63,27 @@
 static const bigtime_t kTransactionIdleTime = 2000000LL;
 	// a transaction is considered idle after 2 seconds of inactivity
 
+static const int32 kBlockShardCount = 16;
+	// number of lock-striped parts the block hash is split into
+static const uint32 kReleaseListFlushCount = 32;
+	// number of released blocks a per-CPU list collects before it tries to
+	// move them into the unused list
+static const uint32 kReleaseListForceFlushCount = 4 * kReleaseListFlushCount;
+	// number of released blocks after which the flush will wait for the
+	// cache lock
+static const int32 kNotReleased = -1;
+static const int32 kReleaseFlushing = -2;
+	// special values for cached_block::release_slot
+static const size_t kMaxPrefetchBlocks = 64;
+	// maximum number of blocks a single block_cache_prefetch() call reads
+
+#ifdef _KERNEL_MODE
+#	define BLOCK_CACHE_LINE_ALIGN	CACHE_LINE_ALIGN
+#else
+#	define BLOCK_CACHE_LINE_ALIGN
+static const int32 kUserlandReleaseListCount = 8;
+#endif
+
 
 namespace {
 
@@ -66,6 +96,7 @@ struct cached_block {
 	cached_block*	next;			// next in hash
 	cached_block*	transaction_next;
 	block_link		link;
+	block_link		release_link;
 	off_t			block_number;
 	void*			current_data;
 		// The data that is seen by everyone using the API; this one is always
@@ -85,7 +116,12 @@ struct cached_block {
 	void*			compare;
 #endif
 	int32			ref_count;
+		// Protected by the lock of the block's shard, not the cache lock.
 	int32			last_accessed;
+	int32			release_slot;
+		// The per-CPU release list the block has been queued in after its
+		// last reference was put without holding the cache lock, or
+		// kNotReleased.
 	bool			busy_reading : 1;
 	bool			busy_writing : 1;
 	bool			is_writing : 1;
@@ -117,6 +153,9 @@ struct cached_block {
 typedef DoublyLinkedList<cached_block,
 	DoublyLinkedListMemberGetLink<cached_block,
 		&cached_block::link> > block_list;
+typedef DoublyLinkedList<cached_block,
+	DoublyLinkedListMemberGetLink<cached_block,
+		&cached_block::release_link> > release_list;
 
 struct cache_notification : DoublyLinkedListLinkImpl<cache_notification> {
 	static inline void* operator new(size_t size);
@@ -170,12 +209,13 @@ struct BlockHash {
 
 	size_t HashKey(KeyType key) const
 	{
-		return key;
+		// the lower bits select the shard already
+		return key / kBlockShardCount;
 	}
 
 	size_t Hash(ValueType* block) const
 	{
-		return block->block_number;
+		return HashKey(block->block_number);
 	}
 
 	bool Compare(KeyType key, ValueType* block) const
@@ -192,6 +232,27 @@ struct BlockHash {
 typedef BOpenHashTable<BlockHash> BlockTable;
 
 
+/*!	One part of the lock-striped block hash. Its lock protects the table
+	against concurrent lookups without the cache lock, and the reference
+	count of the blocks in it. Changing the table itself additionally
+	requires the cache lock to be held.
+*/
+struct block_shard {
+	mutex			lock;
+	BlockTable		table;
+} BLOCK_CACHE_LINE_ALIGN;
+
+
+/*!	Collects the blocks whose last reference has been put without holding
+	the cache lock; they are moved into the unused list in batches.
+*/
+struct block_release_list {
+	mutex			lock;
+	release_list	blocks;
+	uint32			count;
+} BLOCK_CACHE_LINE_ALIGN;
+
+
 struct TransactionHash {
 	typedef int32				KeyType;
 	typedef	cache_transaction	ValueType;
@@ -210,7 +271,9 @@ typedef BOpenHashTable<TransactionHash> TransactionTable;
 
 
 struct block_cache : DoublyLinkedListLinkImpl<block_cache> {
-	BlockTable*		hash;
+	block_shard		shards[kBlockShardCount];
+	block_release_list* release_lists;
+	int32			release_list_count;
 	mutex			lock;
 	int				fd;
 	off_t			max_blocks;
@@ -233,6 +296,8 @@ struct block_cache : DoublyLinkedListLinkImpl<block_cache> {
 
 	bigtime_t		last_block_write;
 	bigtime_t		last_block_write_duration;
+	int64			write_requests;
+	int64			written_blocks;
 
 	uint32			num_dirty_blocks;
 	bool			read_only;
@@ -246,20 +311,32 @@ struct block_cache : DoublyLinkedListLinkImpl<block_cache> {
 
 	status_t		Init();
 
+	block_shard&	ShardFor(off_t blockNumber)
+						{ return shards[blockNumber % kBlockShardCount]; }
+	cached_block*	Lookup(off_t blockNumber);
+	void			Insert(cached_block* block);
+	block_release_list& CurrentReleaseList();
+
 	void			Free(void* buffer);
 	void*			Allocate();
 	void			FreeBlock(cached_block* block);
 	cached_block*	NewBlock(off_t blockNumber);
 	void			FreeBlockParentData(cached_block* block);
 
+	void			ReleaseBlock(cached_block* block);
+	void			FlushReleasedBlocks();
+
 	void			RemoveUnusedBlocks(int32 count, int32 minSecondsOld = 0);
 	void			RemoveBlock(cached_block* block);
+	bool			RemoveUnreferencedBlock(cached_block* block);
 	void			DiscardBlock(cached_block* block);
 
 private:
 	static void		_LowMemoryHandler(void* data, uint32 resources,
 						int32 level);
 	cached_block*	_GetUnusedBlock();
+	bool			_UnhashUnreferencedBlock(cached_block* block);
+	void			_DequeueReleasedBlock(cached_block* block);
 };
 
 struct cache_transaction {
@@ -302,6 +379,9 @@ public:
 
 private:
 			void*				_Data(cached_block* block) const;
+			size_t				_RunLength(size_t index) const;
+			status_t			_WriteBlocks(cached_block** blocks,
+									size_t count);
 			status_t			_WriteBlock(cached_block* block);
 			void				_BlockDone(cached_block* block,
 									cache_transaction* transaction);
@@ -312,6 +392,8 @@ private:
 
 private:
 	static	const size_t		kBufferSize = 64;
+	static	const size_t		kMaxWriteVecs = 64;
+	static	const size_t		kMaxWriteSize = 512 * 1024;
 
 			block_cache*		fCache;
 			cached_block*		fBuffer[kBufferSize];
@@ -355,6 +437,45 @@ public:
 
 typedef AutoLocker<block_cache, TransactionLocking> TransactionLocker;
 
+
+/*!	Iterates over the blocks of all shards of a cache. The cache must be
+	locked.
+*/
+class BlockIterator {
+public:
+	BlockIterator(block_cache* cache)
+		:
+		fCache(cache),
+		fShard(0),
+		fIterator(&cache->shards[0].table)
+	{
+		_SkipEmptyShards();
+	}
+
+	bool HasNext() const
+	{
+		return fIterator.HasNext();
+	}
+
+	cached_block* Next()
+	{
+		cached_block* block = fIterator.Next();
+		_SkipEmptyShards();
+		return block;
+	}
+
+private:
+	void _SkipEmptyShards()
+	{
+		while (!fIterator.HasNext() && fShard + 1 < kBlockShardCount)
+			fIterator = BlockTable::Iterator(&fCache->shards[++fShard].table);
+	}
+
+	block_cache*			fCache;
+	int32					fShard;
+	BlockTable::Iterator	fIterator;
+};
+
 } // namespace
 
 
@@ -1205,25 +1326,34 @@ BlockWriter::Write(cache_transaction* transaction, bool canUnlock)
 	if (canUnlock)
 		mutex_unlock(&fCache->lock);
 
-	// Sort blocks in their on-disk order
-	// TODO: ideally, this should be handled by the I/O scheduler
+	// Sort blocks in their on-disk order, so that runs of adjacent blocks
+	// can be written with a single request
 
 	qsort(fBlocks, fCount, sizeof(void*), &_CompareBlocks);
 	fDeletedTransaction = false;
 
 	bigtime_t start = system_time();
 
-	for (uint32 i = 0; i < fCount; i++) {
-		status_t status = _WriteBlock(fBlocks[i]);
-		if (status != B_OK) {
-			// propagate to global error handling
-			if (fStatus == B_OK)
-				fStatus = status;
-
-			_UnmarkWriting(fBlocks[i]);
-			fBlocks[i] = NULL;
-				// This block will not be marked clean
+	for (size_t i = 0; i < fCount;) {
+		size_t count = _RunLength(i);
+		if (count == 1 || _WriteBlocks(fBlocks + i, count) != B_OK) {
+			// Write the blocks one by one, so that we know which of them
+			// could not be written
+			for (size_t j = i; j < i + count; j++) {
+				status_t status = _WriteBlock(fBlocks[j]);
+				if (status != B_OK) {
+					// propagate to global error handling
+					if (fStatus == B_OK)
+						fStatus = status;
+
+					_UnmarkWriting(fBlocks[j]);
+					fBlocks[j] = NULL;
+						// This block will not be marked clean
+				}
+			}
 		}
+
+		i += count;
 	}
 
 	bigtime_t finish = system_time();
@@ -1270,6 +1400,62 @@ BlockWriter::_Data(cached_block* block) const
 }
 
 
+/*!	Returns the number of blocks starting at \a index in the sorted block
+	array that are adjacent on disk, and can be written with a single request.
+*/
+size_t
+BlockWriter::_RunLength(size_t index) const
+{
+	size_t maxCount = min_c(kMaxWriteVecs,
+		max_c(kMaxWriteSize / fCache->block_size, 1));
+	off_t blockNumber = fBlocks[index]->block_number;
+
+	size_t count = 1;
+	while (index + count < fCount && count < maxCount
+		&& fBlocks[index + count]->block_number == blockNumber + (off_t)count)
+		count++;
+
+	return count;
+}
+
+
+/*!	Writes back a run of \a count adjacent blocks with a single vectored
+	write. If that fails, none of the blocks is considered written, and the
+	caller has to retry them individually.
+*/
+status_t
+BlockWriter::_WriteBlocks(cached_block** blocks, size_t count)
+{
+	TRACE(("BlockWriter::_WriteBlocks(block %" B_PRIdOFF ", count %" B_PRIuSIZE
+		")\n", blocks[0]->block_number, count));
+
+	size_t blockSize = fCache->block_size;
+	iovec vecs[kMaxWriteVecs];
+
+	for (size_t i = 0; i < count; i++) {
+		ASSERT(blocks[i]->busy_writing);
+		TB(Write(fCache, blocks[i]));
+		TB2(BlockData(fCache, blocks[i], "before write"));
+
+		vecs[i].iov_base = _Data(blocks[i]);
+		vecs[i].iov_len = blockSize;
+	}
+
+	ssize_t written = writev_pos(fCache->fd,
+		blocks[0]->block_number * blockSize, vecs, count);
+
+	if (written != (ssize_t)(count * blockSize)) {
+		TB(Error(fCache, blocks[0]->block_number, "vectored write failed",
+			written));
+		return written < 0 ? errno : B_IO_ERROR;
+	}
+
+	atomic_add64(&fCache->write_requests, 1);
+	atomic_add64(&fCache->written_blocks, count);
+	return B_OK;
+}
+
+
 status_t
 BlockWriter::_WriteBlock(cached_block* block)
 {
@@ -1294,6 +1480,8 @@ BlockWriter::_WriteBlock(cached_block* block)
 		return B_IO_ERROR;
 	}
 
+	atomic_add64(&fCache->write_requests, 1);
+	atomic_add64(&fCache->written_blocks, 1);
 	return B_OK;
 }
 
@@ -1397,7 +1585,8 @@ BlockWriter::_CompareBlocks(const void* _blockA, const void* _blockB)
 block_cache::block_cache(int _fd, off_t numBlocks, size_t blockSize,
 		bool readOnly)
 	:
-	hash(NULL),
+	release_lists(NULL),
+	release_list_count(0),
 	fd(_fd),
 	max_blocks(numBlocks),
 	block_size(blockSize),
@@ -1412,6 +1601,8 @@ block_cache::block_cache(int _fd, off_t numBlocks, size_t blockSize,
 	busy_writing_waiters(0),
 	last_block_write(0),
 	last_block_write_duration(0),
+	write_requests(0),
+	written_blocks(0),
 	num_dirty_blocks(0),
 	read_only(readOnly)
 {
@@ -1424,7 +1615,13 @@ block_cache::~block_cache()
 	unregister_low_resource_handler(&_LowMemoryHandler, this);
 
 	delete transaction_hash;
-	delete hash;
+
+	for (int32 i = 0; i < release_list_count; i++)
+		mutex_destroy(&release_lists[i].lock);
+	delete[] release_lists;
+
+	for (int32 i = 0; i < kBlockShardCount; i++)
+		mutex_destroy(&shards[i].lock);
 
 	delete_object_cache(buffer_cache);
 
@@ -1440,15 +1637,34 @@ block_cache::Init()
 	condition_variable.Init(this, "cache transaction sync");
 	mutex_init(&lock, "block cache");
 
+	for (int32 i = 0; i < kBlockShardCount; i++)
+		mutex_init(&shards[i].lock, "block cache shard");
+
 	buffer_cache = create_object_cache_etc("block cache buffers", block_size,
 		8, 0, 0, 0, CACHE_LARGE_SLAB, NULL, NULL, NULL, NULL);
 	if (buffer_cache == NULL)
 		return B_NO_MEMORY;
 
-	hash = new BlockTable();
-	if (hash == NULL || hash->Init(1024) != B_OK)
+	for (int32 i = 0; i < kBlockShardCount; i++) {
+		if (shards[i].table.Init(1024 / kBlockShardCount) != B_OK)
+			return B_NO_MEMORY;
+	}
+
+#ifdef _KERNEL_MODE
+	int32 count = smp_get_num_cpus();
+#else
+	int32 count = kUserlandReleaseListCount;
+#endif
+	release_lists = new(std::nothrow) block_release_list[count];
+	if (release_lists == NULL)
 		return B_NO_MEMORY;
 
+	for (int32 i = 0; i < count; i++) {
+		mutex_init(&release_lists[i].lock, "block cache released");
+		release_lists[i].count = 0;
+	}
+	release_list_count = count;
+
 	transaction_hash = new(std::nothrow) TransactionTable();
 	if (transaction_hash == NULL || transaction_hash->Init(16) != B_OK)
 		return B_NO_MEMORY;
@@ -1459,6 +1675,46 @@ block_cache::Init()
 }
 
 
+/*!	Looks up the block in its shard. Since the hash tables are only changed
+	with the cache lock held, the shard lock is not needed for this.
+	The cache must be locked.
+*/
+cached_block*
+block_cache::Lookup(off_t blockNumber)
+{
+	ASSERT_LOCKED_MUTEX(&lock);
+	return ShardFor(blockNumber).table.Lookup(blockNumber);
+}
+
+
+/*!	The cache must be locked. */
+void
+block_cache::Insert(cached_block* block)
+{
+	ASSERT_LOCKED_MUTEX(&lock);
+
+	block_shard& shard = ShardFor(block->block_number);
+	MutexLocker _(shard.lock);
+	shard.table.Insert(block);
+}
+
+
+/*!	Returns the release list of the CPU we're currently running on. Since the
+	lists are protected by a lock, it does not matter if the thread is
+	migrated to another CPU afterwards.
+*/
+block_release_list&
+block_cache::CurrentReleaseList()
+{
+#ifdef _KERNEL_MODE
+	int32 index = smp_get_current_cpu();
+#else
+	int32 index = find_thread(NULL);
+#endif
+	return release_lists[index % release_list_count];
+}
+
+
 void
 block_cache::Free(void* buffer)
 {
@@ -1536,6 +1792,7 @@ block_cache::NewBlock(off_t blockNumber)
 	block->block_number = blockNumber;
 	block->ref_count = 0;
 	block->last_accessed = 0;
+	block->release_slot = kNotReleased;
 	block->transaction_next = NULL;
 	block->transaction = block->previous_transaction = NULL;
 	block->original_data = NULL;
@@ -1566,11 +1823,86 @@ block_cache::FreeBlockParentData(cached_block* block)
 }
 
 
+/*!	Called when the last reference to \a block has been put; moves the block
+	into the unused list, or removes it from the cache if it has been
+	discarded. Nothing happens if the block is part of a transaction, or if
+	it has been acquired again in the mean time.
+	The cache must be locked.
+*/
+void
+block_cache::ReleaseBlock(cached_block* block)
+{
+	ASSERT_LOCKED_MUTEX(&lock);
+
+	MutexLocker shardLocker(ShardFor(block->block_number).lock);
+
+	_DequeueReleasedBlock(block);
+
+	if (block->ref_count != 0 || block->transaction != NULL
+		|| block->previous_transaction != NULL)
+		return;
+
+	// This block is not used anymore, and not part of any transaction
+	block->is_writing = false;
+
+	if (block->discard) {
+		shardLocker.Unlock();
+		RemoveBlock(block);
+		return;
+	}
+
+	ASSERT(block->original_data == NULL && block->parent_data == NULL);
+
+	if (block->unused) {
+		// The block has only been used without the cache lock since it was
+		// put into the unused list; just update its position in there.
+		unused_blocks.Remove(block);
+	} else {
+		block->unused = true;
+		unused_block_count++;
+	}
+	unused_blocks.Add(block);
+}
+
+
+/*!	Moves all blocks from the per-CPU release lists into the unused list.
+	The cache must be locked.
+*/
+void
+block_cache::FlushReleasedBlocks()
+{
+	ASSERT_LOCKED_MUTEX(&lock);
+
+	for (int32 i = 0; i < release_list_count; i++) {
+		block_release_list& list = release_lists[i];
+		if (list.count == 0)
+			continue;
+
+		release_list blocks;
+
+		MutexLocker listLocker(list.lock);
+		blocks.MoveFrom(&list.blocks);
+		list.count = 0;
+
+		for (release_list::Iterator iterator = blocks.GetIterator();
+				cached_block* block = iterator.Next();) {
+			block->release_slot = kReleaseFlushing;
+		}
+		listLocker.Unlock();
+
+		while (cached_block* block = blocks.RemoveHead())
+			ReleaseBlock(block);
+	}
+}
+
+
 void
 block_cache::RemoveUnusedBlocks(int32 count, int32 minSecondsOld)
 {
 	TRACE(("block_cache: remove up to %" B_PRId32 " unused blocks\n", count));
 
+	FlushReleasedBlocks();
+
 	for (block_list::Iterator iterator = unused_blocks.GetIterator();
 			cached_block* block = iterator.Next();) {
 		if (minSecondsOld >= block->LastAccess()) {
@@ -1595,7 +1927,13 @@ block_cache::RemoveUnusedBlocks(int32 count, int32 minSecondsOld)
 		// remove block from lists
 		iterator.Remove();
 		unused_block_count--;
-		RemoveBlock(block);
+		block->unused = false;
+
+		if (!RemoveUnreferencedBlock(block)) {
+			// The block has been acquired again without the cache lock; it
+			// will be put back into the unused list when it's released.
+			continue;
+		}
 
 		if (--count <= 0)
 			break;
@@ -1606,8 +1944,30 @@ block_cache::RemoveUnusedBlocks(int32 count, int32 minSecondsOld)
 void
 block_cache::RemoveBlock(cached_block* block)
 {
-	hash->Remove(block);
+	block_shard& shard = ShardFor(block->block_number);
+
+	mutex_lock(&shard.lock);
+	shard.table.Remove(block);
+	_DequeueReleasedBlock(block);
+	mutex_unlock(&shard.lock);
+
+	FreeBlock(block);
+}
+
+
+/*!	Removes the unused \a block from the cache, unless someone acquired it
+	without holding the cache lock in the mean time.
+	Returns \c false if the block is still in use, and has not been removed.
+	The cache must be locked.
+*/
+bool
+block_cache::RemoveUnreferencedBlock(cached_block* block)
+{
+	if (!_UnhashUnreferencedBlock(block))
+		return false;
+
 	FreeBlock(block);
+	return true;
 }
 
 
@@ -1688,6 +2048,8 @@ block_cache::_GetUnusedBlock()
 {
 	TRACE(("block_cache: get unused block\n"));
 
+	FlushReleasedBlocks();
+
 	for (block_list::Iterator iterator = unused_blocks.GetIterator();
 			cached_block* block = iterator.Next();) {
 		TB(Flush(this, block, true));
@@ -1698,10 +2060,14 @@ block_cache::_GetUnusedBlock()
 		// remove block from lists
 		iterator.Remove();
 		unused_block_count--;
-		hash->Remove(block);
+		block->unused = false;
+
+		if (!_UnhashUnreferencedBlock(block)) {
+			// The block has been acquired again without the cache lock
+			continue;
+		}
 
 		ASSERT(block->original_data == NULL && block->parent_data == NULL);
-		block->unused = false;
 
 		// TODO: see if compare data is handled correctly here!
 #if BLOCK_CACHE_DEBUG_CHANGED
@@ -1715,14 +2081,53 @@ block_cache::_GetUnusedBlock()
 }
 
 
+/*!	Removes \a block from its hash table if it does not have any references.
+	The cache must be locked.
+*/
+bool
+block_cache::_UnhashUnreferencedBlock(cached_block* block)
+{
+	block_shard& shard = ShardFor(block->block_number);
+	MutexLocker _(shard.lock);
+
+	if (block->ref_count != 0)
+		return false;
+
+	shard.table.Remove(block);
+	_DequeueReleasedBlock(block);
+	return true;
+}
+
+
+/*!	Removes \a block from the release list it's queued in, if any.
+	The cache, and the block's shard must be locked.
+*/
+void
+block_cache::_DequeueReleasedBlock(cached_block* block)
+{
+	if (block->release_slot >= 0) {
+		block_release_list& list = release_lists[block->release_slot];
+
+		MutexLocker _(list.lock);
+		list.blocks.Remove(block);
+		list.count--;
+	}
+
+	block->release_slot = kNotReleased;
+}
+
+
 //	#pragma mark - private block functions
 
 
 /*!	Cache must be locked.
+	The flag is changed with the shard locked, too, so that the lockless
+	lookup in get_cached_block_fast() won't return a block that is busy.
 */
 static void
 mark_block_busy_reading(block_cache* cache, cached_block* block)
 {
+	MutexLocker _(cache->ShardFor(block->block_number).lock);
 	block->busy_reading = true;
 	cache->busy_reading_count++;
 }
@@ -1733,7 +2138,10 @@ mark_block_busy_reading(block_cache* cache, cached_block* block)
 static void
 mark_block_unbusy_reading(block_cache* cache, cached_block* block)
 {
+	MutexLocker shardLocker(cache->ShardFor(block->block_number).lock);
 	block->busy_reading = false;
+	shardLocker.Unlock();
+
 	cache->busy_reading_count--;
 
 	if ((cache->busy_reading_waiters && cache->busy_reading_count == 0)
@@ -1854,23 +2262,12 @@ put_cached_block(block_cache* cache, cached_block* block)
 		return;
 	}
 
-	if (--block->ref_count == 0
-		&& block->transaction == NULL && block->previous_transaction == NULL) {
-		// This block is not used anymore, and not part of any transaction
-		block->is_writing = false;
-
-		if (block->discard) {
-			cache->RemoveBlock(block);
-		} else {
-			// put this block in the list of unused blocks
-			ASSERT(!block->unused);
-			block->unused = true;
+	MutexLocker shardLocker(cache->ShardFor(block->block_number).lock);
+	bool released = --block->ref_count == 0;
+	shardLocker.Unlock();
 
-			ASSERT(block->original_data == NULL && block->parent_data == NULL);
-			cache->unused_blocks.Add(block);
-			cache->unused_block_count++;
-		}
-	}
+	if (released)
+		cache->ReleaseBlock(block);
 }
 
 
@@ -1882,7 +2279,7 @@ put_cached_block(block_cache* cache, off_t blockNumber)
 			blockNumber, cache->max_blocks - 1);
 	}
 
-	cached_block* block = cache->hash->Lookup(blockNumber);
+	cached_block* block = cache->Lookup(blockNumber);
 	if (block != NULL)
 		put_cached_block(cache, block);
 	else {
@@ -1891,6 +2288,61 @@ put_cached_block(block_cache* cache, off_t blockNumber)
 }
 
 
+/*!	Tries to remove a reference from the specified block without acquiring
+	the cache lock. If this was the last reference, the block is queued in the
+	current CPU's release list, and will only be moved into the unused list
+	once that list is flushed.
+	Returns \c false if the block could not be put this way, and
+	put_cached_block() has to be used instead.
+*/
+static bool
+put_cached_block_fast(block_cache* cache, off_t blockNumber)
+{
+#if BLOCK_CACHE_DEBUG_CHANGED
+	// the block contents need to be compared with the cache locked
+	return false;
+#endif
+
+	if (blockNumber < 0 || blockNumber >= cache->max_blocks)
+		return false;
+
+	block_shard& shard = cache->ShardFor(blockNumber);
+	MutexLocker shardLocker(shard.lock);
+
+	cached_block* block = shard.table.Lookup(blockNumber);
+	if (block == NULL || block->ref_count < 1)
+		return false;
+
+	TB(Put(cache, block));
+
+	if (--block->ref_count > 0 || block->release_slot != kNotReleased) {
+		// still in use, or already waiting to be released
+		return true;
+	}
+
+	block_release_list& list = cache->CurrentReleaseList();
+
+	MutexLocker listLocker(list.lock);
+	list.blocks.Add(block);
+	block->release_slot = &list - cache->release_lists;
+	uint32 count = ++list.count;
+
+	listLocker.Unlock();
+	shardLocker.Unlock();
+
+	if (count >= kReleaseListForceFlushCount) {
+		MutexLocker locker(cache->lock);
+		cache->FlushReleasedBlocks();
+	} else if (count >= kReleaseListFlushCount
+		&& mutex_trylock(&cache->lock) == B_OK) {
+		cache->FlushReleasedBlocks();
+		mutex_unlock(&cache->lock);
+	}
+
+	return true;
+}
+
+
 /*!	Retrieves the block \a blockNumber from the hash table, if it's already
 	there, or reads it from the disk.
 	You need to have the cache locked when calling this function.
@@ -1898,9 +2350,11 @@ put_cached_block(block_cache* cache, off_t blockNumber)
 	\param _allocated tells you whether or not a new block has been allocated
 		to satisfy your request.
 	\param readBlock if \c false, the block will not be read in case it was
-		not already in the cache. The block you retrieve may contain random
-		data. If \c true, the cache will be temporarily unlocked while the
-		block is read in.
+		not already in the cache, but cleared instead. If \c true, the cache
+		will be temporarily unlocked while the block is read in.
+		Either way, newly allocated blocks are marked busy until their
+		contents are valid, as they can be found by get_cached_block_fast()
+		as soon as they are in the hash.
 */
 static status_t
 get_cached_block(block_cache* cache, off_t blockNumber, bool* _allocated,
@@ -1915,7 +2369,7 @@ get_cached_block(block_cache* cache, off_t blockNumber, bool* _allocated,
 	}
 
 retry:
-	cached_block* block = cache->hash->Lookup(blockNumber);
+	cached_block* block = cache->Lookup(blockNumber);
 	*_allocated = false;
 
 	if (block == NULL) {
@@ -1924,12 +2378,19 @@ retry:
 		if (block == NULL)
 			return B_NO_MEMORY;
 
-		cache->hash->Insert(block);
+		mark_block_busy_reading(cache, block);
+		cache->Insert(block);
 		*_allocated = true;
 	} else if (block->busy_reading) {
 		// The block is currently busy_reading - wait and try again later
 		wait_for_busy_reading_block(cache, block);
 		goto retry;
+	} else if (block->discard && block->ref_count == 0
+		&& block->transaction == NULL && block->previous_transaction == NULL) {
+		// The last reference to this discarded block has been put without
+		// the cache lock, but it has not yet been removed
+		cache->ReleaseBlock(block);
+		goto retry;
 	}
 
 	if (block->unused) {
@@ -1943,7 +2404,6 @@ retry:
 		// read block into cache
 		int32 blockSize = cache->block_size;
 
-		mark_block_busy_reading(cache, block);
 		mutex_unlock(&cache->lock);
 
 		ssize_t bytesRead = read_pos(cache->fd, blockNumber * blockSize,
@@ -1951,6 +2411,7 @@ retry:
 
 		mutex_lock(&cache->lock);
 		if (bytesRead < blockSize) {
+			mark_block_unbusy_reading(cache, block);
 			cache->RemoveBlock(block);
 			TB(Error(cache, blockNumber, "read failed", bytesRead));
 
@@ -1960,17 +2421,59 @@ retry:
 		}
 		TB(Read(cache, block));
 
+		mark_block_unbusy_reading(cache, block);
+	} else if (*_allocated) {
+		mutex_unlock(&cache->lock);
+
+		memset(block->current_data, 0, cache->block_size);
+
+		mutex_lock(&cache->lock);
 		mark_block_unbusy_reading(cache, block);
 	}
 
+	MutexLocker shardLocker(cache->ShardFor(blockNumber).lock);
 	block->ref_count++;
 	block->last_accessed = system_time() / 1000000L;
+	shardLocker.Unlock();
 
 	*_block = block;
 	return B_OK;
 }
 
 
+/*!	Tries to retrieve the block \a blockNumber without acquiring the cache
+	lock. This only works for blocks that are already in the cache, and that
+	are neither busy being read in nor discarded.
+	Returns \c NULL if get_cached_block() has to be used instead.
+*/
+static cached_block*
+get_cached_block_fast(block_cache* cache, off_t blockNumber)
+{
+#if BLOCK_CACHE_DEBUG_CHANGED
+	// the block contents need to be copied with the cache locked
+	return NULL;
+#endif
+
+	if (blockNumber < 0 || blockNumber >= cache->max_blocks)
+		return NULL;
+
+	block_shard& shard = cache->ShardFor(blockNumber);
+	MutexLocker _(shard.lock);
+
+	cached_block* block = shard.table.Lookup(blockNumber);
+	if (block == NULL || block->busy_reading || block->discard)
+		return NULL;
+
+	// If the block is in the unused list, it will just stay there; it's
+	// taken out once it is found to be referenced.
+	block->ref_count++;
+	block->last_accessed = system_time() / 1000000L;
+
+	TB(Get(cache, block));
+	return block;
+}
+
+
 /*!	Returns the writable block data for the requested blockNumber.
 	If \a cleared is true, the block is not read from disk; an empty block
 	is returned.
@@ -2005,7 +2508,7 @@ get_writable_cached_block(block_cache* cache, off_t blockNumber, off_t base,
 
 	// if there is no transaction support, we just return the current block
 	if (transactionID == -1) {
-		if (cleared) {
+		if (cleared && !allocated) {
 			mark_block_busy_reading(cache, block);
 			mutex_unlock(&cache->lock);
 
@@ -2109,7 +2612,8 @@ get_writable_cached_block(block_cache* cache, off_t blockNumber, off_t base,
 		&& block->parent_data == NULL && wasUnchanged)
 		transaction->sub_num_blocks++;
 
-	if (cleared) {
+	if (cleared && !allocated) {
+		// newly allocated blocks have already been cleared
 		mark_block_busy_reading(cache, block);
 		mutex_unlock(&cache->lock);
 
@@ -2243,7 +2747,8 @@ dump_cache(int argc, char** argv)
 	off_t blockNumber = -1;
 	if (i + 1 < argc) {
 		blockNumber = parse_expression(argv[i + 1]);
-		cached_block* block = cache->hash->Lookup(blockNumber);
+		cached_block* block
+			= cache->ShardFor(blockNumber).table.Lookup(blockNumber);
 		if (block != NULL)
 			dump_block_long(block);
 		else
@@ -2262,6 +2767,8 @@ dump_cache(int argc, char** argv)
 		cache->busy_reading_waiters ? "has" : "no");
 	kprintf(" busy_writing: %" B_PRIu32 ", %s waiters\n", cache->busy_writing_count,
 		cache->busy_writing_waiters ? "has" : "no");
+	kprintf(" written:      %" B_PRId64 " blocks in %" B_PRId64 " requests\n",
+		cache->written_blocks, cache->write_requests);
 
 	if (!cache->pending_notifications.IsEmpty()) {
 		kprintf(" pending notifications:\n");
@@ -2303,7 +2810,7 @@ dump_cache(int argc, char** argv)
 	uint32 count = 0;
 	uint32 dirty = 0;
 	uint32 discarded = 0;
-	BlockTable::Iterator iterator(cache->hash);
+	BlockIterator iterator(cache);
 	while (iterator.HasNext()) {
 		cached_block* block = iterator.Next();
 		if (showBlocks)
@@ -2588,6 +3095,8 @@ block_notifier_and_writer(void* /*data*/)
 
 		block_cache* cache = NULL;
 		while ((cache = get_next_locked_block_cache(cache)) != NULL) {
+			cache->FlushReleasedBlocks();
+
 			// Give some breathing room: wait 2x the length of the potential
 			// maximum block count-sized write between writes, and also skip
 			// if there are more than 16 blocks currently being written.
@@ -2611,7 +3120,7 @@ block_notifier_and_writer(void* /*data*/)
 			if (cache->num_dirty_blocks) {
 				// This cache is not using transactions, we'll scan the blocks
 				// directly
-				BlockTable::Iterator iterator(cache->hash);
+				BlockIterator iterator(cache);
 
 				while (iterator.HasNext()) {
 					cached_block* block = iterator.Next();
@@ -3394,13 +3903,169 @@ cache_has_block_in_transaction(void* _cache, int32 id, off_t blockNumber)
 	block_cache* cache = (block_cache*)_cache;
 	TransactionLocker locker(cache);
 
-	cached_block* block = cache->hash->Lookup(blockNumber);
+	cached_block* block = cache->Lookup(blockNumber);
 
 	return (block != NULL && block->transaction != NULL
 		&& block->transaction->id == id);
 }
 
 
+//	#pragma mark - prefetching
+
+
+/*!	Inserts busy blocks into the cache for the range starting at
+	\a blockNumber, up to the first block that is already cached. Returns
+	the number of blocks that have been inserted.
+	The cache must be locked.
+*/
+static size_t
+allocate_prefetch_blocks(block_cache* cache, off_t blockNumber,
+	size_t numBlocks, cached_block** blocks)
+{
+	ASSERT_LOCKED_MUTEX(&cache->lock);
+
+	size_t count = 0;
+	for (; count < numBlocks && blockNumber + (off_t)count < cache->max_blocks;
+			count++) {
+		if (cache->Lookup(blockNumber + count) != NULL)
+			break;
+
+		cached_block* block = cache->NewBlock(blockNumber + count);
+		if (block == NULL)
+			break;
+
+		mark_block_busy_reading(cache, block);
+		cache->Insert(block);
+		blocks[count] = block;
+	}
+
+	return count;
+}
+
+
+/*!	Makes the first \a validBlocks of the prefetched \a blocks available,
+	and removes the rest of them from the cache again, as they could not be
+	read.
+	The cache must be locked.
+*/
+static void
+finish_prefetch_blocks(block_cache* cache, cached_block** blocks,
+	size_t count, size_t validBlocks)
+{
+	ASSERT_LOCKED_MUTEX(&cache->lock);
+
+	for (size_t i = 0; i < count; i++) {
+		cached_block* block = blocks[i];
+		mark_block_unbusy_reading(cache, block);
+
+		if (i < validBlocks) {
+			TB(Read(cache, block));
+
+			// Nobody could have acquired the block while it was busy, so
+			// this moves it into the unused list
+			cache->ReleaseBlock(block);
+		} else
+			cache->RemoveBlock(block);
+	}
+}
+
+
+#ifdef _KERNEL_MODE
+
+
+/*!	Reads prefetched blocks asynchronously; the object deletes itself once
+	the I/O request has finished.
+*/
+class BlockPrefetcher : public AsyncIOCallback {
+public:
+								BlockPrefetcher(block_cache* cache,
+									off_t blockNumber);
+
+			size_t				Allocate(size_t numBlocks);
+			void				ReadAsync();
+
+	virtual	void				IOFinished(status_t status,
+									bool partialTransfer,
+									generic_size_t bytesTransferred);
+
+private:
+			block_cache*		fCache;
+			off_t				fBlockNumber;
+			size_t				fCount;
+			cached_block*		fBlocks[kMaxPrefetchBlocks];
+			generic_io_vec		fVecs[kMaxPrefetchBlocks];
+};
+
+
+BlockPrefetcher::BlockPrefetcher(block_cache* cache, off_t blockNumber)
+	:
+	fCache(cache),
+	fBlockNumber(blockNumber),
+	fCount(0)
+{
+}
+
+
+/*!	The cache must be locked. */
+size_t
+BlockPrefetcher::Allocate(size_t numBlocks)
+{
+	fCount = allocate_prefetch_blocks(fCache, fBlockNumber, numBlocks,
+		fBlocks);
+	return fCount;
+}
+
+
+void
+BlockPrefetcher::ReadAsync()
+{
+	size_t blockSize = fCache->block_size;
+	for (size_t i = 0; i < fCount; i++) {
+		fVecs[i].base = (generic_addr_t)fBlocks[i]->current_data;
+		fVecs[i].length = blockSize;
+	}
+
+	IORequest* request = IORequest::Create(false);
+	if (request == NULL) {
+		IOFinished(B_NO_MEMORY, true, 0);
+		return;
+	}
+
+	status_t status = request->Init(fBlockNumber * blockSize, fVecs, fCount,
+		fCount * blockSize, false, B_DELETE_IO_REQUEST);
+	if (status != B_OK) {
+		delete request;
+		IOFinished(status, true, 0);
+		return;
+	}
+
+	request->SetFinishedCallback(&AsyncIOCallback::IORequestCallback, this);
+
+	// This object is going to be deleted after the I/O request has been
+	// fulfilled
+	do_fd_io(fCache->fd, request);
+}
+
+
+void
+BlockPrefetcher::IOFinished(status_t status, bool partialTransfer,
+	generic_size_t bytesTransferred)
+{
+	size_t validBlocks = 0;
+	if (status == B_OK)
+		validBlocks = bytesTransferred / fCache->block_size;
+
+	MutexLocker locker(&fCache->lock);
+	finish_prefetch_blocks(fCache, fBlocks, fCount, validBlocks);
+	locker.Unlock();
+
+	delete this;
+}
+
+
+#endif	// _KERNEL_MODE
+
+
 //	#pragma mark - public block cache API
 
 
@@ -3424,11 +4089,13 @@ block_cache_delete(void* _cache, bool allowWrites)
 
 	// free all blocks
 
-	cached_block* block = cache->hash->Clear(true);
-	while (block != NULL) {
-		cached_block* next = block->next;
-		cache->FreeBlock(block);
-		block = next;
+	for (int32 i = 0; i < kBlockShardCount; i++) {
+		cached_block* block = cache->shards[i].table.Clear(true);
+		while (block != NULL) {
+			cached_block* next = block->next;
+			cache->FreeBlock(block);
+			block = next;
+		}
 	}
 
 	// free all transactions (they will all be aborted)
@@ -3474,8 +4141,12 @@ block_cache_sync(void* _cache)
 
 	MutexLocker locker(&cache->lock);
 
+	cache->FlushReleasedBlocks();
+		// blocks without transactions cannot be written back before they
+		// have been released
+
 	BlockWriter writer(cache);
-	BlockTable::Iterator iterator(cache->hash);
+	BlockIterator iterator(cache);
 
 	while (iterator.HasNext()) {
 		cached_block* block = iterator.Next();
@@ -3510,10 +4181,12 @@ block_cache_sync_etc(void* _cache, off_t blockNumber, size_t numBlocks)
 	}
 
 	MutexLocker locker(&cache->lock);
+	cache->FlushReleasedBlocks();
+
 	BlockWriter writer(cache);
 
 	for (; numBlocks > 0; numBlocks--, blockNumber++) {
-		cached_block* block = cache->hash->Lookup(blockNumber);
+		cached_block* block = cache->Lookup(blockNumber);
 		if (block == NULL)
 			continue;
 
@@ -3547,7 +4220,7 @@ block_cache_discard(void* _cache, off_t blockNumber, size_t numBlocks)
 	BlockWriter writer(cache);
 
 	for (size_t i = 0; i < numBlocks; i++, blockNumber++) {
-		cached_block* block = cache->hash->Lookup(blockNumber);
+		cached_block* block = cache->Lookup(blockNumber);
 		if (block != NULL && block->previous_transaction != NULL)
 			writer.Add(block);
 	}
@@ -3559,7 +4232,7 @@ block_cache_discard(void* _cache, off_t blockNumber, size_t numBlocks)
 		// reset blockNumber to its original value
 
 	for (size_t i = 0; i < numBlocks; i++, blockNumber++) {
-		cached_block* block = cache->hash->Lookup(blockNumber);
+		cached_block* block = cache->Lookup(blockNumber);
 		if (block == NULL)
 			continue;
 
@@ -3568,17 +4241,23 @@ block_cache_discard(void* _cache, off_t blockNumber, size_t numBlocks)
 		if (block->unused) {
 			cache->unused_blocks.Remove(block);
 			cache->unused_block_count--;
-			cache->RemoveBlock(block);
-		} else {
-			if (block->transaction != NULL && block->parent_data != NULL
-				&& block->parent_data != block->current_data) {
-				panic("Discarded block %" B_PRIdOFF " has already been changed in this "
-					"transaction!", blockNumber);
-			}
+			block->unused = false;
 
-			// mark it as discarded (in the current transaction only, if any)
-			block->discard = true;
+			if (cache->RemoveUnreferencedBlock(block))
+				continue;
+
+			// The block has been acquired again without the cache lock
+		}
+
+		if (block->transaction != NULL && block->parent_data != NULL
+			&& block->parent_data != block->current_data) {
+			panic("Discarded block %" B_PRIdOFF " has already been changed in this "
+				"transaction!", blockNumber);
 		}
+
+		// mark it as discarded (in the current transaction only, if any)
+		MutexLocker _(cache->ShardFor(blockNumber).lock);
+		block->discard = true;
 	}
 }
 
@@ -3661,10 +4340,16 @@ block_cache_get_etc(void* _cache, off_t blockNumber, off_t base, off_t length,
 	const void** _block)
 {
 	block_cache* cache = (block_cache*)_cache;
+
+	cached_block* block = get_cached_block_fast(cache, blockNumber);
+	if (block != NULL) {
+		*_block = block->current_data;
+		return B_OK;
+	}
+
 	MutexLocker locker(&cache->lock);
 	bool allocated;
 
-	cached_block* block;
 	status_t status = get_cached_block(cache, blockNumber, &allocated, true,
 		&block);
 	if (status != B_OK)
@@ -3695,6 +4380,79 @@ block_cache_get(void* _cache, off_t blockNumber)
 }
 
 
+/*!	Starts reading up to \a *_numBlocks blocks beginning at \a blockNumber
+	into the cache, without waiting for them to arrive; in userland, the
+	blocks are read synchronously, but with a single request.
+	Prefetching stops at the first block that is already in the cache, and
+	\a *_numBlocks is set to the number of blocks that are read in.
+	This is only a hint to the cache, and it does nothing when the system
+	is low on memory.
+*/
+status_t
+block_cache_prefetch(void* _cache, off_t blockNumber, size_t* _numBlocks)
+{
+	block_cache* cache = (block_cache*)_cache;
+	size_t numBlocks = min_c(*_numBlocks, kMaxPrefetchBlocks);
+	*_numBlocks = 0;
+
+	if (blockNumber < 0 || blockNumber >= cache->max_blocks)
+		return B_BAD_VALUE;
+
+	if (numBlocks == 0
+		|| low_resource_state(B_KERNEL_RESOURCE_PAGES
+			| B_KERNEL_RESOURCE_MEMORY | B_KERNEL_RESOURCE_ADDRESS_SPACE)
+				!= B_NO_LOW_RESOURCE) {
+		return B_OK;
+	}
+
+#ifdef _KERNEL_MODE
+	BlockPrefetcher* prefetcher = new(std::nothrow) BlockPrefetcher(cache,
+		blockNumber);
+	if (prefetcher == NULL)
+		return B_NO_MEMORY;
+
+	MutexLocker locker(&cache->lock);
+	size_t count = prefetcher->Allocate(numBlocks);
+	locker.Unlock();
+
+	if (count == 0) {
+		delete prefetcher;
+		return B_OK;
+	}
+
+	*_numBlocks = count;
+	prefetcher->ReadAsync();
+	return B_OK;
+#else
+	cached_block* blocks[kMaxPrefetchBlocks];
+
+	MutexLocker locker(&cache->lock);
+	size_t count = allocate_prefetch_blocks(cache, blockNumber, numBlocks,
+		blocks);
+	if (count == 0)
+		return B_OK;
+
+	locker.Unlock();
+
+	iovec vecs[kMaxPrefetchBlocks];
+	for (size_t i = 0; i < count; i++) {
+		vecs[i].iov_base = blocks[i]->current_data;
+		vecs[i].iov_len = cache->block_size;
+	}
+
+	ssize_t bytesRead = readv_pos(cache->fd, blockNumber * cache->block_size,
+		vecs, count);
+	size_t validBlocks = bytesRead > 0 ? bytesRead / cache->block_size : 0;
+
+	locker.Lock();
+	finish_prefetch_blocks(cache, blocks, count, validBlocks);
+
+	*_numBlocks = validBlocks;
+	return validBlocks == count ? B_OK : B_IO_ERROR;
+#endif
+}
+
+
 /*!	Changes the internal status of a writable block to \a dirty. This can be
 	helpful in case you realize you don't need to change that block anymore
 	for whatever reason.
@@ -3709,7 +4467,7 @@ block_cache_set_dirty(void* _cache, off_t blockNumber, bool dirty,
 	block_cache* cache = (block_cache*)_cache;
 	MutexLocker locker(&cache->lock);
 
-	cached_block* block = cache->hash->Lookup(blockNumber);
+	cached_block* block = cache->Lookup(blockNumber);
 	if (block == NULL)
 		return B_BAD_VALUE;
 	if (block->is_dirty == dirty) {
@@ -3729,6 +4487,9 @@ void
 block_cache_put(void* _cache, off_t blockNumber)
 {
 	block_cache* cache = (block_cache*)_cache;
+	if (put_cached_block_fast(cache, blockNumber))
+		return;
+
 	MutexLocker locker(&cache->lock);
 
 	put_cached_block(cache, blockNumber);
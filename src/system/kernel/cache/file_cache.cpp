@@ -41,6 +41,21 @@
 #define BYPASS_IO_SIZE		65536
 #define LAST_ACCESSES		3
 
+// readahead
+#define READAHEAD_STREAMS		4
+#define MIN_READAHEAD_WINDOW	(32 * 1024)
+#define MAX_READAHEAD_WINDOW	(1024 * 1024)
+
+struct readahead_stream {
+	off_t			next_offset;
+		// where the stream is expected to continue
+	off_t			readahead_end;
+		// the end of the readahead issued for this stream
+	uint32			window;
+		// size of the readahead window, 0 if not (yet) sequential
+	uint32			last_used;
+};
+
 struct file_cache_ref {
 	VMCache			*cache;
 	struct vnode	*vnode;
@@ -51,6 +66,13 @@ struct file_cache_ref {
 	int32			last_access_index;
 	uint16			disabled_count;
 
+	// the following fields are protected by the cache lock
+	readahead_stream streams[READAHEAD_STREAMS];
+	uint32			stream_usage;
+	uint64			hits;
+	uint64			misses;
+	uint64			readahead_pages;
+
 	inline void SetLastAccess(int32 index, off_t access, bool isWrite)
 	{
 		// we remember writes as negative offsets
@@ -402,6 +424,8 @@ read_into_cache(file_cache_ref* ref, void* cookie, off_t offset,
 			// TODO: check if the array is large enough (currently panics)!
 	}
 
+	ref->misses += pageIndex;
+
 	push_access(ref, offset, bufferSize, false);
 	cache->Unlock();
 	vm_page_unreserve_pages(reservation);
@@ -470,6 +494,8 @@ read_from_file(file_cache_ref* ref, void* cookie, off_t offset,
 	vec.base = buffer;
 	vec.length = bufferSize;
 
+	ref->misses += (pageOffset + bufferSize + B_PAGE_SIZE - 1) / B_PAGE_SIZE;
+
 	push_access(ref, offset, bufferSize, false);
 	ref->cache->Unlock();
 	vm_page_unreserve_pages(reservation);
@@ -806,6 +832,9 @@ cache_io(void* _cacheRef, void* cookie, off_t offset, addr_t buffer,
 			"= %lu\n", offset, page, bytesLeft, pageOffset));
 
 		if (page != NULL) {
+			if (!doWrite)
+				ref->hits++;
+
 			if (doWrite || useBuffer) {
 				// Since the following user_mem{cpy,set}() might cause a page
 				// fault, which in turn might cause pages to be reserved, we
@@ -897,6 +926,233 @@ cache_io(void* _cacheRef, void* cookie, off_t offset, addr_t buffer,
 }
 
 
+/*!	Asynchronously reads all pages in the given range that are not yet in the
+	cache. \a offset and \a size must be page aligned, and \a reservation
+	must contain enough pages for the whole range.
+	The cache must be locked; it is unlocked temporarily while the I/O is
+	started.
+	Returns the number of pages that are being read.
+*/
+static size_t
+precache_range(file_cache_ref* ref, off_t offset, size_t size,
+	vm_page_reservation* reservation)
+{
+	VMCache* cache = ref->cache;
+	size_t bytesToRead = 0;
+	size_t pagesRead = 0;
+	off_t lastOffset = offset;
+
+	while (true) {
+		// check if this page is already in memory
+		if (size > 0) {
+			vm_page* page = cache->LookupPage(offset);
+
+			offset += B_PAGE_SIZE;
+			size -= B_PAGE_SIZE;
+
+			if (page == NULL) {
+				bytesToRead += B_PAGE_SIZE;
+				continue;
+			}
+		}
+		if (bytesToRead != 0) {
+			// read the part before the current page (or the end of the request)
+			PrecacheIO* io = new(std::nothrow) PrecacheIO(ref, lastOffset,
+				bytesToRead);
+			if (io == NULL || io->Prepare(reservation) != B_OK) {
+				delete io;
+				break;
+			}
+
+			// we must not have the cache locked during I/O
+			cache->Unlock();
+			io->ReadAsync();
+			cache->Lock();
+
+			pagesRead += bytesToRead / B_PAGE_SIZE;
+			bytesToRead = 0;
+		}
+
+		if (size == 0) {
+			// we have reached the end of the request
+			break;
+		}
+
+		lastOffset = offset;
+	}
+
+	return pagesRead;
+}
+
+
+/*!	Returns the readahead stream a read at \a offset continues. If there is
+	none, the least recently used stream is reset and returned.
+	The cache must be locked.
+*/
+static readahead_stream*
+get_readahead_stream(file_cache_ref* ref, off_t offset, bool& _sequential)
+{
+	readahead_stream* leastRecentlyUsed = &ref->streams[0];
+	ref->stream_usage++;
+
+	for (int32 i = 0; i < READAHEAD_STREAMS; i++) {
+		readahead_stream* stream = &ref->streams[i];
+
+		// allow small gaps and overlaps, as reads are often not exactly
+		// adjacent (e.g. because they are aligned to blocks)
+		if (stream->last_used != 0
+			&& offset >= stream->next_offset - B_PAGE_SIZE
+			&& offset <= stream->next_offset + B_PAGE_SIZE) {
+			stream->last_used = ref->stream_usage;
+			_sequential = true;
+			return stream;
+		}
+
+		if (stream->last_used < leastRecentlyUsed->last_used)
+			leastRecentlyUsed = stream;
+	}
+
+	readahead_stream* stream = leastRecentlyUsed;
+	stream->readahead_end = 0;
+	stream->window = 0;
+	stream->last_used = ref->stream_usage;
+	_sequential = false;
+	return stream;
+}
+
+
+/*!	Called after a successful cached read of \a size bytes at \a offset.
+	Tracks up to READAHEAD_STREAMS sequential streams per file, and reads
+	ahead of each of them asynchronously. The readahead window of a stream
+	doubles every time the reader has consumed half of it, up to
+	MAX_READAHEAD_WINDOW; the next chunk is only requested then, so that the
+	I/O happens in reasonably large pieces while the reader works on the
+	previous one.
+*/
+static void
+readahead(file_cache_ref* ref, off_t offset, size_t size)
+{
+	VMCache* cache = ref->cache;
+	AutoLocker<VMCache> locker(cache);
+
+	off_t end = offset + size;
+
+	bool sequential;
+	readahead_stream* stream = get_readahead_stream(ref, offset, sequential);
+	stream->next_offset = end;
+
+	uint32 initialWindow = min_c(max_c(ROUNDUP(size * 4, B_PAGE_SIZE),
+		MIN_READAHEAD_WINDOW), MAX_READAHEAD_WINDOW);
+
+	if (!sequential) {
+		// Reading a file from its start is usually a good sign it will be
+		// read completely.
+		if (offset != 0)
+			return;
+		stream->window = initialWindow;
+	} else if (stream->window == 0) {
+		stream->window = initialWindow;
+	} else if (stream->readahead_end - end < stream->window / 2
+		&& stream->window < MAX_READAHEAD_WINDOW) {
+		// the stream keeps being sequential, open the window further
+		stream->window *= 2;
+	}
+
+	if (low_resource_state(B_KERNEL_RESOURCE_PAGES) != B_NO_LOW_RESOURCE) {
+		// don't put more pressure on the memory, and start over slowly
+		stream->window = max_c(stream->window / 2, MIN_READAHEAD_WINDOW);
+		return;
+	}
+
+	// only read ahead once half of the previous readahead has been consumed
+	if (stream->readahead_end - end >= stream->window / 2)
+		return;
+
+	off_t start = ROUNDDOWN(max_c(stream->readahead_end, end), B_PAGE_SIZE);
+	off_t target = min_c(ROUNDUP(end + stream->window, B_PAGE_SIZE),
+		ROUNDUP(cache->virtual_end, B_PAGE_SIZE));
+	if (start >= target)
+		return;
+
+	size_t pages = (target - start) / B_PAGE_SIZE;
+	vm_page_reservation reservation;
+	if (!vm_page_try_reserve_pages(&reservation, pages, VM_PRIORITY_USER))
+		return;
+
+	stream->readahead_end = target;
+	ref->readahead_pages += precache_range(ref, start, target - start,
+		&reservation);
+
+	locker.Unlock();
+	vm_page_unreserve_pages(&reservation);
+}
+
+
+/*!	Only files the caller has opened can be looked at, so that it can't
+	probe for, or keep alive, vnodes it doesn't have access to.
+*/
+static status_t
+get_file_cache_stats(file_cache_stats_args* userArgs)
+{
+	file_cache_stats_args args;
+	if (!IS_USER_ADDRESS(userArgs)
+		|| user_memcpy(&args, userArgs, sizeof(args)) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	struct vnode* vnode;
+	status_t status = vfs_get_vnode_from_fd(args.fd, false, &vnode);
+	if (status != B_OK)
+		return status;
+
+	VMCache* cache;
+	status = vfs_get_vnode_cache(vnode, &cache, false);
+	if (status == B_OK && cache->type != CACHE_TYPE_VNODE) {
+		cache->ReleaseRef();
+		status = B_BAD_VALUE;
+	}
+	if (status != B_OK) {
+		vfs_put_vnode(vnode);
+		return status;
+	}
+
+	memset(&args.stats, 0, sizeof(args.stats));
+
+	cache->Lock();
+
+	file_cache_ref* ref = ((VMVnodeCache*)cache)->FileCacheRef();
+	if (ref != NULL) {
+		args.stats.hits = ref->hits;
+		args.stats.misses = ref->misses;
+		args.stats.readahead_pages = ref->readahead_pages;
+
+		for (int32 i = 0; i < READAHEAD_STREAMS; i++) {
+			const readahead_stream& stream = ref->streams[i];
+			if (stream.window == 0)
+				continue;
+
+			args.stats.streams++;
+			args.stats.readahead_window = max_c(args.stats.readahead_window,
+				stream.window);
+		}
+	} else
+		status = B_BAD_VALUE;
+
+	cache->ReleaseRefAndUnlock();
+	vfs_put_vnode(vnode);
+
+	if (status != B_OK)
+		return status;
+
+	if (user_memcpy(&userArgs->stats, &args.stats, sizeof(args.stats))
+			!= B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	return B_OK;
+}
+
+
 static status_t
 file_cache_control(const char* subsystem, uint32 function, void* buffer,
 	size_t bufferSize)
@@ -941,6 +1197,12 @@ file_cache_control(const char* subsystem, uint32 function, void* buffer,
 
 			return status;
 		}
+
+		case CACHE_GET_STATS:
+			if (bufferSize != sizeof(file_cache_stats_args))
+				return B_BAD_VALUE;
+
+			return get_file_cache_stats((file_cache_stats_args*)buffer);
 	}
 
 	return B_BAD_HANDLER;
@@ -984,51 +1246,12 @@ cache_prefetch_vnode(struct vnode* vnode, off_t offset, size_t size)
 		return;
 	}
 
-	size_t bytesToRead = 0;
-	off_t lastOffset = offset;
-
 	vm_page_reservation reservation;
 	vm_page_reserve_pages(&reservation, reservePages, VM_PRIORITY_USER);
 
 	cache->Lock();
 
-	while (true) {
-		// check if this page is already in memory
-		if (size > 0) {
-			vm_page* page = cache->LookupPage(offset);
-
-			offset += B_PAGE_SIZE;
-			size -= B_PAGE_SIZE;
-
-			if (page == NULL) {
-				bytesToRead += B_PAGE_SIZE;
-				continue;
-			}
-		}
-		if (bytesToRead != 0) {
-			// read the part before the current page (or the end of the request)
-			PrecacheIO* io = new(std::nothrow) PrecacheIO(ref, lastOffset,
-				bytesToRead);
-			if (io == NULL || io->Prepare(&reservation) != B_OK) {
-				delete io;
-				break;
-			}
-
-			// we must not have the cache locked during I/O
-			cache->Unlock();
-			io->ReadAsync();
-			cache->Lock();
-
-			bytesToRead = 0;
-		}
-
-		if (size == 0) {
-			// we have reached the end of the request
-			break;
-		}
-
-		lastOffset = offset;
-	}
+	precache_range(ref, offset, size, &reservation);
 
 	cache->ReleaseRefAndUnlock();
 	vm_page_unreserve_pages(&reservation);
@@ -1127,7 +1350,7 @@ file_cache_init(void)
 		sZeroVecs[i].length = B_PAGE_SIZE;
 	}
 
-	register_generic_syscall(CACHE_SYSCALLS, file_cache_control, 1, 0);
+	register_generic_syscall(CACHE_SYSCALLS, file_cache_control, 2, 0);
 	return B_OK;
 }
 
@@ -1149,6 +1372,12 @@ file_cache_create(dev_t mountID, ino_t vnodeID, off_t size)
 	ref->last_access_index = 0;
 	ref->disabled_count = 0;
 
+	memset(ref->streams, 0, sizeof(ref->streams));
+	ref->stream_usage = 0;
+	ref->hits = 0;
+	ref->misses = 0;
+	ref->readahead_pages = 0;
+
 	// TODO: delay VMCache creation until data is
 	//	requested/written for the first time? Listing lots of
 	//	files in Tracker (and elsewhere) could be slowed down.
@@ -1325,7 +1554,12 @@ file_cache_read(void* _cacheRef, void* cookie, off_t offset, void* buffer,
 		return error;
 	}
 
-	return cache_io(ref, cookie, offset, (addr_t)buffer, _size, false);
+	status_t status = cache_io(ref, cookie, offset, (addr_t)buffer, _size,
+		false);
+	if (status == B_OK && *_size > 0)
+		readahead(ref, offset, *_size);
+
+	return status;
 }
 
 
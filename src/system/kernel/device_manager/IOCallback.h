@@ -11,6 +11,8 @@
 
 
 typedef status_t (*io_callback)(void* data, io_operation* operation);
+typedef status_t (*io_queue_callback)(void* data, uint32 queue,
+	io_operation* operation);
 
 
 class IOCallback {
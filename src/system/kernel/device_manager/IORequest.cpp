@@ -787,6 +787,8 @@ IORequest::Init(off_t offset, generic_size_t firstVecOffset,
 	fBuffer->SetVecs(firstVecOffset, lastVecSize, vecs, count, length, flags);
 
 	fOwner = NULL;
+	fDeadline = 0;
+	fQueued = false;
 	fOffset = offset;
 	fLength = length;
 	fRelativeParentOffset = 0;
@@ -1446,6 +1448,8 @@ IORequest::Dump() const
 	kprintf("io_request at %p\n", this);
 
 	kprintf("  owner:             %p\n", fOwner);
+	kprintf("  deadline:          %" B_PRIdBIGTIME "\n", fDeadline);
+	kprintf("  queued:            %d\n", fQueued);
 	kprintf("  parent:            %p\n", fParent);
 	kprintf("  status:            %s\n", strerror(fStatus));
 	kprintf("  mutex:             %p\n", &fLock);
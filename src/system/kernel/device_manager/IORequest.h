@@ -232,6 +232,14 @@ struct IORequest : IORequestChunk, DoublyLinkedListLinkImpl<IORequest> {
 									{ fOwner = owner; }
 			IORequestOwner*		Owner() const	{ return fOwner; }
 
+			void				SetDeadline(bigtime_t deadline)
+									{ fDeadline = deadline; }
+			bigtime_t			Deadline() const	{ return fDeadline; }
+			void				SetQueued(bool queued)
+									{ fQueued = queued; }
+			bool				IsQueued() const	{ return fQueued; }
+									// for use by the I/O scheduler
+
 			status_t			CreateSubRequest(off_t parentOffset,
 									off_t offset, generic_size_t length,
 									IORequest*& subRequest);
@@ -326,6 +334,7 @@ private:
 
 			mutex				fLock;
 			IORequestOwner*		fOwner;
+			bigtime_t			fDeadline;
 			IOBuffer*			fBuffer;
 			off_t				fOffset;
 			generic_size_t		fLength;
@@ -346,6 +355,7 @@ private:
 			bool				fPartialTransfer;
 			bool				fSuppressChildNotifications;
 			bool				fIsNotified;
+			bool				fQueued;
 
 			io_request_finished_callback	fFinishedCallback;
 			void*				fFinishedCookie;
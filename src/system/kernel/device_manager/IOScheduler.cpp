@@ -18,6 +18,7 @@ IOScheduler::IOScheduler(DMAResource* resource)
 	fName(NULL),
 	fID(IOSchedulerRoster::Default()->NextID()),
 	fIOCallback(NULL),
+	fIOQueueCallback(NULL),
 	fIOCallbackData(NULL),
 	fSchedulerRegistered(false)
 {
@@ -58,6 +59,16 @@ void
 IOScheduler::SetCallback(io_callback callback, void* data)
 {
 	fIOCallback = callback;
+	fIOQueueCallback = NULL;
+	fIOCallbackData = data;
+}
+
+
+void
+IOScheduler::SetQueueCallback(io_queue_callback callback, void* data)
+{
+	fIOCallback = NULL;
+	fIOQueueCallback = callback;
 	fIOCallbackData = data;
 }
 
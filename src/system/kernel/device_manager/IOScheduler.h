@@ -44,6 +44,13 @@ public:
 
 	virtual	void				SetCallback(IOCallback& callback);
 	virtual	void				SetCallback(io_callback callback, void* data);
+	virtual	void				SetQueueCallback(io_queue_callback callback,
+									void* data);
+									// for devices with several hardware
+									// queues; the callback is told which
+									// queue the operation is meant for
+
+	virtual	uint32				QueueCount() const	{ return 1; }
 
 	virtual	void				SetDeviceCapacity(off_t deviceCapacity);
 	virtual void				MediaChanged();
@@ -61,14 +68,29 @@ public:
 
 	virtual	void				Dump() const = 0;
 
+protected:
+			status_t			CallIOCallback(uint32 queue,
+									IOOperation* operation);
+
 protected:
 			DMAResource*		fDMAResource;
 			char*				fName;
 			int32				fID;
 			io_callback			fIOCallback;
+			io_queue_callback	fIOQueueCallback;
 			void*				fIOCallbackData;
 			bool				fSchedulerRegistered;
 };
 
 
+inline status_t
+IOScheduler::CallIOCallback(uint32 queue, IOOperation* operation)
+{
+	if (fIOQueueCallback != NULL)
+		return fIOQueueCallback(fIOCallbackData, queue, operation);
+
+	return fIOCallback(fIOCallbackData, operation);
+}
+
+
 #endif	// IO_SCHEDULER_H
@@ -0,0 +1,770 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	An I/O scheduler for fast devices, in particular those with several
+	hardware queues.
+
+	Requests are queued in per-CPU submission queues first, so that issuing
+	I/O from different CPUs doesn't contend for a single lock. Every CPU's
+	submission queue is served by one hardware queue (CPU index modulo the
+	number of hardware queues), which has its own dispatcher thread that
+	calls the driver's I/O callback for that queue directly.
+
+	Each hardware queue orders its requests like a deadline elevator: reads
+	and writes are kept in separate FIFOs, and are dispatched in batches in
+	ascending offset order. A batch is cut short when the request at the
+	head of the FIFO has expired, and reads are preferred over writes, as
+	long as the writes have not been passed over too often.
+*/
+
+
+#include "IOSchedulerDeadline.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <smp.h>
+#include <thread.h>
+#include <util/AutoLock.h>
+
+#include "IOSchedulerRoster.h"
+
+
+//#define TRACE_IO_SCHEDULER_DEADLINE
+#ifdef TRACE_IO_SCHEDULER_DEADLINE
+#	define TRACE(x...) dprintf(x)
+#else
+#	define TRACE(x...) ;
+#endif
+
+
+static const bigtime_t kReadExpire = 500000;
+static const bigtime_t kWriteExpire = 5000000;
+static const uint32 kFIFOBatch = 16;
+	// maximum number of requests dispatched in one elevator run
+static const uint32 kWritesStarved = 2;
+	// number of read batches that may pass over pending writes
+
+
+struct IOSchedulerDeadline::SubmissionQueue {
+	spinlock			lock;
+	IORequestList		requests;
+};
+
+
+struct IOSchedulerDeadline::HardwareQueue {
+	IOSchedulerDeadline* scheduler;
+	uint32				index;
+	thread_id			thread;
+
+	spinlock			lock;
+		// protects completedOperations, and is used for the condition
+	ConditionVariable	condition;
+	int32				submissionsPending;
+	IOOperationList		completedOperations;
+
+	mutex				requestLock;
+		// protects the request queue against AbortRequest(); everything
+		// else is only used by the dispatcher thread
+	IORequestList		requests[2];
+		// queued reads and writes, in FIFO order
+	IORequest*			current;
+		// the request that is being translated into operations
+	off_t				lastOffset;
+	int32				batchDirection;
+	uint32				batchCount;
+	uint32				writesStarved;
+
+	IOOperation*		operations;
+	uint32				operationCount;
+	IOOperationList		unusedOperations;
+	IOOperationList		unfinishedOperations;
+	int32				pendingOperations;
+
+	uint64				dispatchedRequests[2];
+	uint64				expiredRequests;
+};
+
+
+static inline int32
+request_direction(const IORequest* request)
+{
+	return request->IsWrite() ? 1 : 0;
+}
+
+
+/*!	Returns the request with the lowest offset not below \a offset, if any.
+*/
+static IORequest*
+find_next_request(IORequestList& list, off_t offset)
+{
+	IORequest* next = NULL;
+	for (IORequestList::Iterator it = list.GetIterator();
+			IORequest* request = it.Next();) {
+		if (request->Offset() >= offset
+			&& (next == NULL || request->Offset() < next->Offset())) {
+			next = request;
+		}
+	}
+
+	return next;
+}
+
+
+// #pragma mark -
+
+
+IOSchedulerDeadline::IOSchedulerDeadline(DMAResource* resource,
+	uint32 queueCount)
+	:
+	IOScheduler(resource),
+	fSubmissionQueues(NULL),
+	fSubmissionQueueCount(0),
+	fHardwareQueues(NULL),
+	fQueueCount(queueCount),
+	fRequestNotifierThread(-1),
+	fBlockSize(0),
+	fReadExpire(kReadExpire),
+	fWriteExpire(kWriteExpire),
+	fTerminating(false)
+{
+	mutex_init(&fLock, "I/O deadline scheduler");
+	fFinishedRequestCondition.Init(this, "I/O finished request");
+}
+
+
+IOSchedulerDeadline::~IOSchedulerDeadline()
+{
+	// shutdown threads
+	fTerminating = true;
+
+	if (fHardwareQueues != NULL) {
+		for (uint32 i = 0; i < fQueueCount; i++) {
+			HardwareQueue& queue = fHardwareQueues[i];
+			InterruptsSpinLocker locker(queue.lock);
+			queue.condition.NotifyAll();
+		}
+	}
+
+	MutexLocker locker(fLock);
+	fFinishedRequestCondition.NotifyAll();
+	locker.Unlock();
+
+	if (fHardwareQueues != NULL) {
+		for (uint32 i = 0; i < fQueueCount; i++) {
+			if (fHardwareQueues[i].thread >= 0)
+				wait_for_thread(fHardwareQueues[i].thread, NULL);
+		}
+	}
+
+	if (fRequestNotifierThread >= 0)
+		wait_for_thread(fRequestNotifierThread, NULL);
+
+	// destroy our belongings
+	if (fHardwareQueues != NULL) {
+		for (uint32 i = 0; i < fQueueCount; i++) {
+			mutex_destroy(&fHardwareQueues[i].requestLock);
+			delete[] fHardwareQueues[i].operations;
+		}
+	}
+
+	delete[] fHardwareQueues;
+	delete[] fSubmissionQueues;
+
+	mutex_lock(&fLock);
+	mutex_destroy(&fLock);
+}
+
+
+status_t
+IOSchedulerDeadline::Init(const char* name)
+{
+	status_t error = IOScheduler::Init(name);
+	if (error != B_OK)
+		return error;
+
+	if (fQueueCount == 0)
+		return B_BAD_VALUE;
+
+	if (fDMAResource != NULL)
+		fBlockSize = fDMAResource->BlockSize();
+	if (fBlockSize == 0)
+		fBlockSize = 512;
+
+	fSubmissionQueueCount = smp_get_num_cpus();
+	fSubmissionQueues
+		= new(std::nothrow) SubmissionQueue[fSubmissionQueueCount];
+	if (fSubmissionQueues == NULL)
+		return B_NO_MEMORY;
+
+	for (int32 i = 0; i < fSubmissionQueueCount; i++)
+		B_INITIALIZE_SPINLOCK(&fSubmissionQueues[i].lock);
+
+	fHardwareQueues = new(std::nothrow) HardwareQueue[fQueueCount];
+	if (fHardwareQueues == NULL)
+		return B_NO_MEMORY;
+
+	for (uint32 i = 0; i < fQueueCount; i++) {
+		HardwareQueue& queue = fHardwareQueues[i];
+		queue.scheduler = this;
+		queue.index = i;
+		queue.thread = -1;
+		B_INITIALIZE_SPINLOCK(&queue.lock);
+		queue.condition.Init(&queue, "I/O queue work");
+		queue.submissionsPending = 0;
+		mutex_init(&queue.requestLock, "I/O queue requests");
+		queue.current = NULL;
+		queue.lastOffset = 0;
+		queue.batchDirection = 0;
+		queue.batchCount = 0;
+		queue.writesStarved = 0;
+		queue.operations = NULL;
+		queue.operationCount = 0;
+		queue.pendingOperations = 0;
+		queue.dispatchedRequests[0] = queue.dispatchedRequests[1] = 0;
+		queue.expiredRequests = 0;
+	}
+
+	// the DMA buffers are shared between all hardware queues
+	size_t operationCount
+		= fDMAResource != NULL ? fDMAResource->BufferCount() : 16;
+	operationCount = std::max(operationCount / fQueueCount, (size_t)1);
+
+	for (uint32 i = 0; i < fQueueCount; i++) {
+		HardwareQueue& queue = fHardwareQueues[i];
+		queue.operations = new(std::nothrow) IOOperation[operationCount];
+		if (queue.operations == NULL)
+			return B_NO_MEMORY;
+
+		queue.operationCount = operationCount;
+		for (size_t j = 0; j < operationCount; j++)
+			queue.unusedOperations.Add(&queue.operations[j]);
+	}
+
+	// start threads
+	char buffer[B_OS_NAME_LENGTH];
+	for (uint32 i = 0; i < fQueueCount; i++) {
+		snprintf(buffer, sizeof(buffer), "%s dispatcher %" B_PRId32 "/%"
+			B_PRIu32, name, fID, i);
+		fHardwareQueues[i].thread = spawn_kernel_thread(&_DispatcherThread,
+			buffer, B_NORMAL_PRIORITY + 2, &fHardwareQueues[i]);
+		if (fHardwareQueues[i].thread < 0)
+			return fHardwareQueues[i].thread;
+	}
+
+	snprintf(buffer, sizeof(buffer), "%s notifier %" B_PRId32, name, fID);
+	fRequestNotifierThread = spawn_kernel_thread(&_RequestNotifierThread,
+		buffer, B_NORMAL_PRIORITY + 2, (void*)this);
+	if (fRequestNotifierThread < 0)
+		return fRequestNotifierThread;
+
+	for (uint32 i = 0; i < fQueueCount; i++)
+		resume_thread(fHardwareQueues[i].thread);
+	resume_thread(fRequestNotifierThread);
+
+	return B_OK;
+}
+
+
+status_t
+IOSchedulerDeadline::ScheduleRequest(IORequest* request)
+{
+	TRACE("%p->IOSchedulerDeadline::ScheduleRequest(%p)\n", this, request);
+
+	IOBuffer* buffer = request->Buffer();
+
+	if (buffer->IsVirtual()) {
+		status_t status = buffer->LockMemory(request->TeamID(),
+			request->IsWrite());
+		if (status != B_OK) {
+			request->SetStatusAndNotify(status);
+			return status;
+		}
+	}
+
+	request->SetDeadline(system_time()
+		+ (request->IsWrite() ? fWriteExpire : fReadExpire));
+
+	IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_REQUEST_SCHEDULED, this,
+		request);
+
+	// queue the request on the current CPU
+	InterruptsLocker interruptsLocker;
+	int32 cpu = smp_get_current_cpu();
+
+	SubmissionQueue& submission = fSubmissionQueues[cpu];
+	acquire_spinlock(&submission.lock);
+	submission.requests.Add(request);
+	release_spinlock(&submission.lock);
+
+	// wake up the dispatcher, unless it has already been told to look
+	HardwareQueue& queue = fHardwareQueues[cpu % fQueueCount];
+	if (atomic_get_and_set(&queue.submissionsPending, 1) == 0) {
+		SpinLocker locker(queue.lock);
+		queue.condition.NotifyAll();
+	}
+
+	return B_OK;
+}
+
+
+/*!	Aborts a request that has not been started yet. Requests that are
+	already being processed are left alone.
+*/
+void
+IOSchedulerDeadline::AbortRequest(IORequest* request, status_t status)
+{
+	bool found = false;
+
+	for (int32 i = 0; i < fSubmissionQueueCount && !found; i++) {
+		SubmissionQueue& submission = fSubmissionQueues[i];
+		InterruptsSpinLocker locker(submission.lock);
+		if (submission.requests.Contains(request)) {
+			submission.requests.Remove(request);
+			found = true;
+		}
+	}
+
+	for (uint32 i = 0; i < fQueueCount && !found; i++) {
+		HardwareQueue& queue = fHardwareQueues[i];
+		MutexLocker locker(queue.requestLock);
+		if (request->IsQueued() && request != queue.current
+			&& queue.requests[request_direction(request)].Contains(request)) {
+			_DequeueRequest(&queue, request);
+			found = true;
+		}
+	}
+
+	if (found)
+		request->SetStatusAndNotify(status);
+}
+
+
+void
+IOSchedulerDeadline::OperationCompleted(IOOperation* operation,
+	status_t status, generic_size_t transferredBytes)
+{
+	HardwareQueue* queue = _QueueForOperation(operation);
+	if (queue == NULL) {
+		panic("IOSchedulerDeadline: unknown operation %p completed",
+			operation);
+		return;
+	}
+
+	InterruptsSpinLocker _(queue->lock);
+
+	// finish operation only once
+	if (operation->Status() <= 0)
+		return;
+
+	operation->SetStatus(status, transferredBytes);
+
+	queue->completedOperations.Add(operation);
+	queue->condition.NotifyAll();
+}
+
+
+void
+IOSchedulerDeadline::Dump() const
+{
+	kprintf("IOSchedulerDeadline at %p\n", this);
+	kprintf("  DMA resource:   %p\n", fDMAResource);
+	kprintf("  read expire:    %" B_PRIdBIGTIME " us\n", fReadExpire);
+	kprintf("  write expire:   %" B_PRIdBIGTIME " us\n", fWriteExpire);
+
+	for (uint32 i = 0; i < fQueueCount; i++) {
+		const HardwareQueue& queue = fHardwareQueues[i];
+		kprintf("  queue %" B_PRIu32 ":\n", i);
+		kprintf("    thread:       %" B_PRId32 "\n", queue.thread);
+		kprintf("    current:      %p\n", queue.current);
+		kprintf("    last offset:  %" B_PRIdOFF "\n", queue.lastOffset);
+		kprintf("    pending:      %" B_PRId32 " operations\n",
+			queue.pendingOperations);
+		kprintf("    reads:        %" B_PRId32 " queued, %" B_PRIu64
+			" dispatched\n", queue.requests[0].Count(),
+			queue.dispatchedRequests[0]);
+		kprintf("    writes:       %" B_PRId32 " queued, %" B_PRIu64
+			" dispatched\n", queue.requests[1].Count(),
+			queue.dispatchedRequests[1]);
+		kprintf("    expired:      %" B_PRIu64 "\n", queue.expiredRequests);
+	}
+}
+
+
+IOSchedulerDeadline::HardwareQueue*
+IOSchedulerDeadline::_QueueForOperation(IOOperation* operation) const
+{
+	for (uint32 i = 0; i < fQueueCount; i++) {
+		HardwareQueue& queue = fHardwareQueues[i];
+		if (operation >= queue.operations
+			&& operation < queue.operations + queue.operationCount) {
+			return &queue;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*!	Moves all requests from the submission queues served by \a queue to its
+	request queue.
+*/
+void
+IOSchedulerDeadline::_CollectSubmissions(HardwareQueue* queue)
+{
+	MutexLocker locker(queue->requestLock);
+
+	for (int32 i = queue->index; i < fSubmissionQueueCount;
+			i += fQueueCount) {
+		SubmissionQueue& submission = fSubmissionQueues[i];
+
+		InterruptsSpinLocker submissionLocker(submission.lock);
+		IORequestList requests;
+		requests.MoveFrom(&submission.requests);
+		submissionLocker.Unlock();
+
+		while (IORequest* request = requests.RemoveHead()) {
+			queue->requests[request_direction(request)].Add(request);
+			request->SetQueued(true);
+		}
+	}
+}
+
+
+/*!	Chooses the request to be dispatched next.
+	Must be called with the queue's request lock held.
+*/
+IORequest*
+IOSchedulerDeadline::_NextRequest(HardwareQueue* queue)
+{
+	bigtime_t now = system_time();
+	IORequestList& reads = queue->requests[0];
+	IORequestList& writes = queue->requests[1];
+
+	// continue the current batch, unless a request has expired meanwhile
+	if (queue->batchCount > 0 && queue->batchCount < kFIFOBatch) {
+		IORequestList& list = queue->requests[queue->batchDirection];
+		IORequest* head = list.Head();
+		if (head != NULL && head->Deadline() > now) {
+			IORequest* request = find_next_request(list, queue->lastOffset);
+			if (request != NULL) {
+				queue->batchCount++;
+				return request;
+			}
+		}
+	}
+
+	// start a new batch -- prefer reads, unless writes have been waiting for
+	// too long already
+	int32 direction;
+	if (!reads.IsEmpty()
+		&& (writes.IsEmpty() || queue->writesStarved < kWritesStarved)) {
+		direction = 0;
+		if (!writes.IsEmpty())
+			queue->writesStarved++;
+	} else if (!writes.IsEmpty()) {
+		direction = 1;
+		queue->writesStarved = 0;
+	} else {
+		queue->batchCount = 0;
+		return NULL;
+	}
+
+	IORequestList& list = queue->requests[direction];
+	IORequest* request = list.Head();
+	if (request->Deadline() > now) {
+		IORequest* next = find_next_request(list, queue->lastOffset);
+		if (next != NULL)
+			request = next;
+	} else
+		queue->expiredRequests++;
+
+	queue->batchDirection = direction;
+	queue->batchCount = 1;
+	return request;
+}
+
+
+/*!	Must be called with the queue's request lock held. */
+void
+IOSchedulerDeadline::_DequeueRequest(HardwareQueue* queue, IORequest* request)
+{
+	if (request->IsQueued()) {
+		queue->requests[request_direction(request)].Remove(request);
+		request->SetQueued(false);
+	}
+
+	if (queue->current == request)
+		queue->current = NULL;
+}
+
+
+/*!	Translates as many queued requests into operations as there are free
+	operations and DMA buffers.
+	Returns \c true, if it had to stop because of the DMA resource being
+	exhausted.
+*/
+bool
+IOSchedulerDeadline::_PrepareOperations(HardwareQueue* queue,
+	IOOperationList& operations)
+{
+	// operations that need another pass go first
+	operations.MoveFrom(&queue->unfinishedOperations);
+
+	MutexLocker locker(queue->requestLock);
+
+	bool busy = false;
+
+	while (!queue->unusedOperations.IsEmpty()) {
+		IORequest* request = queue->current;
+		if (request == NULL) {
+			request = _NextRequest(queue);
+			if (request == NULL)
+				break;
+
+			queue->current = request;
+			queue->dispatchedRequests[request_direction(request)]++;
+		}
+
+		IOOperation* operation = queue->unusedOperations.RemoveHead();
+
+		status_t status;
+		if (fDMAResource != NULL)
+			status = fDMAResource->TranslateNext(request, operation, 0);
+		else {
+			status = operation->Prepare(request);
+			if (status == B_OK) {
+				operation->SetOriginalRange(request->Offset(),
+					request->Length());
+				request->Advance(request->Length());
+			}
+		}
+
+		if (status != B_OK) {
+			operation->SetParent(NULL);
+			queue->unusedOperations.Add(operation);
+
+			// B_BUSY means that the DMA buffers or bounce buffers are
+			// temporarily unavailable, we'll retry later
+			if (status == B_BUSY) {
+				busy = true;
+				break;
+			}
+
+			_DequeueRequest(queue, request);
+
+			bool inProgress = false;
+			for (uint32 i = 0; i < queue->operationCount; i++) {
+				if (queue->operations[i].Parent() == request)
+					inProgress = true;
+			}
+
+			locker.Unlock();
+
+			if (inProgress) {
+				// Let the operations in progress finish first; the finisher
+				// will notice that the request is no longer queued.
+				request->SetTransferredBytes(true,
+					request->Length() - request->RemainingBytes());
+			} else
+				request->SetStatusAndNotify(status);
+
+			locker.Lock();
+			continue;
+		}
+
+		operations.Add(operation);
+
+		if (request->RemainingBytes() == 0) {
+			queue->lastOffset = request->Offset() + request->Length();
+			_DequeueRequest(queue, request);
+		}
+	}
+
+	return busy;
+}
+
+
+/*!	Must not be called with the queue's request lock held. */
+void
+IOSchedulerDeadline::_Finisher(HardwareQueue* queue)
+{
+	while (true) {
+		InterruptsSpinLocker locker(queue->lock);
+		IOOperation* operation = queue->completedOperations.RemoveHead();
+		if (operation == NULL)
+			return;
+
+		locker.Unlock();
+
+		TRACE("IOSchedulerDeadline::_Finisher(): operation: %p\n", operation);
+
+		bool operationFinished = operation->Finish();
+
+		IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_OPERATION_FINISHED,
+			this, operation->Parent(), operation);
+			// Notify for every time the operation is passed to the I/O hook,
+			// not only when it is fully finished.
+
+		queue->pendingOperations--;
+
+		if (!operationFinished) {
+			TRACE("  operation: %p not finished yet\n", operation);
+			queue->unfinishedOperations.Add(operation);
+			continue;
+		}
+
+		// notify request and recycle the operation
+		IORequest* request = operation->Parent();
+
+		request->OperationFinished(operation);
+
+		if (fDMAResource != NULL)
+			fDMAResource->RecycleBuffer(operation->Buffer());
+
+		queue->unusedOperations.Add(operation);
+
+		if (!request->IsFinished())
+			continue;
+
+		if (request->Status() == B_OK && request->RemainingBytes() > 0
+			&& request->IsQueued()) {
+			// The request has been processed OK so far, but it isn't really
+			// finished yet.
+			request->SetUnfinished();
+		} else
+			_RequestFinished(request);
+	}
+}
+
+
+void
+IOSchedulerDeadline::_RequestFinished(IORequest* request)
+{
+	if (request->HasCallbacks()) {
+		// The request has callbacks that may take some time to perform, so
+		// we hand it over to the request notifier.
+		MutexLocker _(fLock);
+		fFinishedRequests.Add(request);
+		fFinishedRequestCondition.NotifyAll();
+		return;
+	}
+
+	// No callbacks -- finish the request right now.
+	IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_REQUEST_FINISHED, this,
+		request);
+	request->NotifyFinished();
+}
+
+
+status_t
+IOSchedulerDeadline::_Dispatcher(HardwareQueue* queue)
+{
+	while (!fTerminating) {
+		_Finisher(queue);
+
+		if (atomic_get_and_set(&queue->submissionsPending, 0) != 0)
+			_CollectSubmissions(queue);
+
+		IOOperationList operations;
+		bool busy = _PrepareOperations(queue, operations);
+
+		if (!operations.IsEmpty()) {
+			while (IOOperation* operation = operations.RemoveHead()) {
+				TRACE("IOSchedulerDeadline::_Dispatcher(): queue %" B_PRIu32
+					": operation %p\n", queue->index, operation);
+
+				IOSchedulerRoster::Default()->Notify(
+					IO_SCHEDULER_OPERATION_STARTED, this, operation->Parent(),
+					operation);
+
+				queue->pendingOperations++;
+				CallIOCallback(queue->index, operation);
+
+				_Finisher(queue);
+			}
+			continue;
+		}
+
+		// wait for new requests or finished operations
+		InterruptsSpinLocker locker(queue->lock);
+		if (fTerminating)
+			break;
+
+		if (!queue->completedOperations.IsEmpty()
+			|| atomic_get(&queue->submissionsPending) != 0) {
+			continue;
+		}
+
+		ConditionVariableEntry entry;
+		queue->condition.Add(&entry);
+		locker.Unlock();
+
+		if (busy) {
+			// The DMA buffers might be returned by another hardware queue,
+			// which won't wake us up.
+			entry.Wait(B_RELATIVE_TIMEOUT, 10000);
+		} else
+			entry.Wait();
+	}
+
+	return B_OK;
+}
+
+
+/*static*/ status_t
+IOSchedulerDeadline::_DispatcherThread(void* _queue)
+{
+	HardwareQueue* queue = (HardwareQueue*)_queue;
+	return queue->scheduler->_Dispatcher(queue);
+}
+
+
+status_t
+IOSchedulerDeadline::_RequestNotifier()
+{
+	while (true) {
+		MutexLocker locker(fLock);
+
+		// get a request
+		IORequest* request = fFinishedRequests.RemoveHead();
+
+		if (request == NULL) {
+			if (fTerminating)
+				return B_OK;
+
+			ConditionVariableEntry entry;
+			fFinishedRequestCondition.Add(&entry);
+
+			locker.Unlock();
+
+			entry.Wait();
+			continue;
+		}
+
+		locker.Unlock();
+
+		IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_REQUEST_FINISHED,
+			this, request);
+
+		// notify the request
+		request->NotifyFinished();
+	}
+
+	// never can get here
+	return B_OK;
+}
+
+
+/*static*/ status_t
+IOSchedulerDeadline::_RequestNotifierThread(void* _self)
+{
+	IOSchedulerDeadline* self = (IOSchedulerDeadline*)_self;
+	return self->_RequestNotifier();
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef IO_SCHEDULER_DEADLINE_H
+#define IO_SCHEDULER_DEADLINE_H
+
+
+#include <KernelExport.h>
+
+#include <condition_variable.h>
+#include <lock.h>
+
+#include "dma_resources.h"
+#include "IOScheduler.h"
+
+
+class IOSchedulerDeadline : public IOScheduler {
+public:
+								IOSchedulerDeadline(DMAResource* resource,
+									uint32 queueCount);
+	virtual						~IOSchedulerDeadline();
+
+	virtual	status_t			Init(const char* name);
+
+	virtual	uint32				QueueCount() const	{ return fQueueCount; }
+
+	virtual	status_t			ScheduleRequest(IORequest* request);
+
+	virtual	void				AbortRequest(IORequest* request,
+									status_t status = B_CANCELED);
+	virtual	void				OperationCompleted(IOOperation* operation,
+									status_t status,
+									generic_size_t transferredBytes);
+									// called by the driver when the operation
+									// has been completed successfully or failed
+									// for some reason
+
+	virtual	void				Dump() const;
+
+private:
+			struct SubmissionQueue;
+			struct HardwareQueue;
+
+			HardwareQueue*		_QueueForOperation(IOOperation* operation)
+									const;
+			void				_CollectSubmissions(HardwareQueue* queue);
+			IORequest*			_NextRequest(HardwareQueue* queue);
+			void				_DequeueRequest(HardwareQueue* queue,
+									IORequest* request);
+			bool				_PrepareOperations(HardwareQueue* queue,
+									IOOperationList& operations);
+			void				_Finisher(HardwareQueue* queue);
+			void				_RequestFinished(IORequest* request);
+			status_t			_Dispatcher(HardwareQueue* queue);
+	static	status_t			_DispatcherThread(void* queue);
+			status_t			_RequestNotifier();
+	static	status_t			_RequestNotifierThread(void* self);
+
+private:
+			SubmissionQueue*	fSubmissionQueues;
+			int32				fSubmissionQueueCount;
+			HardwareQueue*		fHardwareQueues;
+			uint32				fQueueCount;
+			mutex				fLock;
+			thread_id			fRequestNotifierThread;
+			IORequestList		fFinishedRequests;
+			ConditionVariable	fFinishedRequestCondition;
+			generic_size_t		fBlockSize;
+			bigtime_t			fReadExpire;
+			bigtime_t			fWriteExpire;
+	volatile bool				fTerminating;
+};
+
+
+#endif	// IO_SCHEDULER_DEADLINE_H
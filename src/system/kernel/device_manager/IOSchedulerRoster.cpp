@@ -6,8 +6,15 @@
 
 #include "IOSchedulerRoster.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+#include <driver_settings.h>
 #include <util/AutoLock.h>
 
+#include "IOSchedulerDeadline.h"
+#include "IOSchedulerSimple.h"
+
 
 /*static*/ IOSchedulerRoster IOSchedulerRoster::sDefaultInstance;
 
@@ -72,6 +79,64 @@ IOSchedulerRoster::NextID()
 }
 
 
+/*!	Creates and initializes the I/O scheduler for a device.
+	Which scheduler is used can be chosen per device in the "io_scheduler"
+	driver settings file, by mapping the scheduler \a name to either
+	IO_SCHEDULER_SIMPLE or IO_SCHEDULER_DEADLINE, for example:
+		virtio_block/0 deadline
+		default simple
+	Without any setting, devices with more than one hardware queue get the
+	deadline scheduler, all others the simple one.
+*/
+status_t
+IOSchedulerRoster::CreateScheduler(const char* name, DMAResource* resource,
+	uint32 queueCount, IOScheduler*& _scheduler)
+{
+	if (queueCount == 0)
+		return B_BAD_VALUE;
+
+	bool useDeadline = queueCount > 1;
+
+	void* settings = load_driver_settings("io_scheduler");
+	if (settings != NULL) {
+		const char* type = get_driver_parameter(settings, name, NULL, NULL);
+		if (type == NULL)
+			type = get_driver_parameter(settings, "default", NULL, NULL);
+
+		if (type != NULL) {
+			if (strcmp(type, IO_SCHEDULER_DEADLINE) == 0)
+				useDeadline = true;
+			else if (strcmp(type, IO_SCHEDULER_SIMPLE) == 0)
+				useDeadline = false;
+			else {
+				dprintf("I/O scheduler: unknown scheduler \"%s\" for %s\n",
+					type, name);
+			}
+		}
+
+		unload_driver_settings(settings);
+	}
+
+	IOScheduler* scheduler;
+	if (useDeadline) {
+		scheduler = new(std::nothrow) IOSchedulerDeadline(resource,
+			queueCount);
+	} else
+		scheduler = new(std::nothrow) IOSchedulerSimple(resource);
+	if (scheduler == NULL)
+		return B_NO_MEMORY;
+
+	status_t status = scheduler->Init(name);
+	if (status != B_OK) {
+		delete scheduler;
+		return status;
+	}
+
+	_scheduler = scheduler;
+	return B_OK;
+}
+
+
 IOSchedulerRoster::IOSchedulerRoster()
 	:
 	fNextID(1),
@@ -20,6 +20,10 @@
 #define IO_SCHEDULER_OPERATION_STARTED	0x10
 #define IO_SCHEDULER_OPERATION_FINISHED	0x20
 
+// I/O scheduler types
+#define IO_SCHEDULER_SIMPLE				"simple"
+#define IO_SCHEDULER_DEADLINE			"deadline"
+
 
 
 typedef DoublyLinkedList<IOScheduler> IOSchedulerList;
@@ -48,6 +52,10 @@ public:
 
 			int32				NextID();
 
+			status_t			CreateScheduler(const char* name,
+									DMAResource* resource, uint32 queueCount,
+									IOScheduler*& _scheduler);
+
 private:
 								IOSchedulerRoster();
 								~IOSchedulerRoster();
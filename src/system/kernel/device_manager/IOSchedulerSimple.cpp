@@ -691,7 +691,7 @@ panic("no more requests for owner %p (thread %" B_PRId32 ")", owner, owner->thre
 			IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_OPERATION_STARTED,
 				this, operation->Parent(), operation);
 
-			fIOCallback(fIOCallbackData, operation);
+			CallIOCallback(0, operation);
 
 			_Finisher();
 		}
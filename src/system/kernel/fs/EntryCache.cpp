@@ -4,15 +4,65 @@
  */
 
 
+/*!	The entry cache is looked up for every path component that is resolved,
+	so lookups must not write to shared memory in the common case.
+
+	All changes to the hash table are done with \c fLock write locked. Each
+	bucket has a sequence count that is odd while the bucket is being
+	changed; lockless readers walk a bucket without any lock, and only use
+	what they have found when the sequence count of the bucket has not
+	changed in the meantime. When the table is resized, the sequence counts
+	of all buckets of the old table are left odd, so that readers still
+	looking at it retry with the new table.
+
+	Unlinked entries and old tables are not freed immediately, since readers
+	might still be looking at them. Readers keep interrupts disabled while
+	they walk the table, so once every CPU has handled an inter-CPU
+	interrupt, nobody can still see the retired objects, and they can be
+	freed (cf. _FreeRetiredObjects()).
+*/
+
+
 #include "EntryCache.h"
 
 #include <new>
+
+#include <smp.h>
+#include <util/atomic.h>
 #include <vm/vm.h>
 
 
 static const int32 kEntryNotInArray = -1;
 static const int32 kEntryRemoved = -2;
 
+static const size_t kInitialBucketCount = 128;
+static const int32 kMaxRetiredEntries = 64;
+static const int32 kMaxLocklessAttempts = 4;
+
+
+static void
+wait_for_readers(void* /*cookie*/, int /*cpu*/)
+{
+}
+
+
+// #pragma mark - EntryCacheTable
+
+
+/*static*/ EntryCacheTable*
+EntryCacheTable::Create(size_t bucketCount)
+{
+	EntryCacheTable* table = (EntryCacheTable*)malloc(sizeof(EntryCacheTable)
+		+ bucketCount * sizeof(EntryCacheBucket));
+	if (table == NULL)
+		return NULL;
+
+	table->retired_link = NULL;
+	table->bucket_count = bucketCount;
+	memset(table->buckets, 0, bucketCount * sizeof(EntryCacheBucket));
+	return table;
+}
+
 
 // #pragma mark - EntryCacheGeneration
 
@@ -49,25 +99,44 @@ EntryCacheGeneration::Init(int32 entriesSize)
 
 EntryCache::EntryCache()
 	:
+	fTable(NULL),
+	fEntryCount(0),
+	fRetiredEntries(NULL),
+	fRetiredEntryCount(0),
+	fRetiredTables(NULL),
 	fGenerationCount(0),
 	fGenerations(NULL),
 	fCurrentGeneration(0)
 {
 	rw_lock_init(&fLock, "entry cache");
-
-	new(&fEntries) EntryTable;
 }
 
 
 EntryCache::~EntryCache()
 {
 	// delete entries
-	EntryCacheEntry* entry = fEntries.Clear(true);
-	while (entry != NULL) {
-		EntryCacheEntry* next = entry->hash_link;
+	if (fTable != NULL) {
+		for (size_t i = 0; i < fTable->bucket_count; i++) {
+			EntryCacheEntry* entry = fTable->buckets[i].entries;
+			while (entry != NULL) {
+				EntryCacheEntry* next = entry->hash_link;
+				free(entry);
+				entry = next;
+			}
+		}
+		free(fTable);
+	}
+
+	// nobody can look at the retired objects anymore
+	while (EntryCacheEntry* entry = fRetiredEntries) {
+		fRetiredEntries = entry->retired_link;
 		free(entry);
-		entry = next;
 	}
+	while (EntryCacheTable* table = fRetiredTables) {
+		fRetiredTables = table->retired_link;
+		free(table);
+	}
+
 	delete[] fGenerations;
 
 	rw_lock_destroy(&fLock);
@@ -77,9 +146,9 @@ EntryCache::~EntryCache()
 status_t
 EntryCache::Init()
 {
-	status_t error = fEntries.Init();
-	if (error != B_OK)
-		return error;
+	fTable = EntryCacheTable::Create(kInitialBucketCount);
+	if (fTable == NULL)
+		return B_NO_MEMORY;
 
 	int32 entriesSize = 1024;
 	fGenerationCount = 8;
@@ -92,8 +161,13 @@ EntryCache::Init()
 	}
 
 	fGenerations = new(std::nothrow) EntryCacheGeneration[fGenerationCount];
+	if (fGenerations == NULL) {
+		fGenerationCount = 0;
+		return B_NO_MEMORY;
+	}
+
 	for (int32 i = 0; i < fGenerationCount; i++) {
-		error = fGenerations[i].Init(entriesSize);
+		status_t error = fGenerations[i].Init(entriesSize);
 		if (error != B_OK)
 			return error;
 	}
@@ -107,39 +181,49 @@ EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
 {
 	EntryCacheKey key(dirID, name);
 
-	WriteLocker _(fLock);
+	WriteLocker locker(fLock);
 
 	if (fGenerationCount == 0)
 		return B_NO_MEMORY;
 
-	EntryCacheEntry* entry = fEntries.Lookup(key);
+	EntryCacheEntry* entry = _Lookup(key);
 	if (entry != NULL) {
+		EntryCacheBucket& bucket = fTable->BucketFor(entry->hash);
+		atomic_add(&bucket.sequence, 1);
 		entry->node_id = nodeID;
 		entry->missing = missing;
+		atomic_add(&bucket.sequence, 1);
+
 		if (entry->generation != fCurrentGeneration) {
 			if (entry->index >= 0) {
 				fGenerations[entry->generation].entries[entry->index] = NULL;
 				_AddEntryToCurrentGeneration(entry);
 			}
 		}
-		return B_OK;
-	}
+	} else {
+		entry = (EntryCacheEntry*)malloc(sizeof(EntryCacheEntry)
+			+ strlen(name));
+		if (entry == NULL)
+			return B_NO_MEMORY;
 
-	entry = (EntryCacheEntry*)malloc(sizeof(EntryCacheEntry) + strlen(name));
-	if (entry == NULL)
-		return B_NO_MEMORY;
+		entry->hash = key.hash;
+		entry->node_id = nodeID;
+		entry->dir_id = dirID;
+		entry->missing = missing;
+		entry->generation = fCurrentGeneration;
+		entry->index = kEntryNotInArray;
+		strcpy(entry->name, name);
 
-	entry->node_id = nodeID;
-	entry->dir_id = dirID;
-	entry->missing = missing;
-	entry->generation = fCurrentGeneration;
-	entry->index = kEntryNotInArray;
-	strcpy(entry->name, name);
+		_Insert(entry);
 
-	fEntries.Insert(entry);
+		_AddEntryToCurrentGeneration(entry);
+	}
 
-	_AddEntryToCurrentGeneration(entry);
+	RetiredObjects retired;
+	_TakeRetiredObjects(retired);
+	locker.Unlock();
 
+	_FreeRetiredObjects(retired);
 	return B_OK;
 }
 
@@ -151,16 +235,16 @@ EntryCache::Remove(ino_t dirID, const char* name)
 
 	WriteLocker writeLocker(fLock);
 
-	EntryCacheEntry* entry = fEntries.Lookup(key);
+	EntryCacheEntry* entry = _Lookup(key);
 	if (entry == NULL)
 		return B_ENTRY_NOT_FOUND;
 
-	fEntries.Remove(entry);
+	_Remove(entry);
 
 	if (entry->index >= 0) {
 		// remove the entry from its generation and delete it
 		fGenerations[entry->generation].entries[entry->index] = NULL;
-		free(entry);
+		_RetireEntry(entry);
 	} else {
 		// We can't free it, since another thread is about to try to move it
 		// to another generation. We mark it removed and the other thread will
@@ -168,6 +252,11 @@ EntryCache::Remove(ino_t dirID, const char* name)
 		entry->index = kEntryRemoved;
 	}
 
+	RetiredObjects retired;
+	_TakeRetiredObjects(retired);
+	writeLocker.Unlock();
+
+	_FreeRetiredObjects(retired);
 	return B_OK;
 }
 
@@ -178,9 +267,15 @@ EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID,
 {
 	EntryCacheKey key(dirID, name);
 
+	// Most lookups find an entry that is already in the current generation,
+	// or none at all, and don't need to change anything.
+	status_t status = _LookupLockless(key, _nodeID, _missing);
+	if (status != B_BUSY)
+		return status == B_OK;
+
 	ReadLocker readLocker(fLock);
 
-	EntryCacheEntry* entry = fEntries.Lookup(key);
+	EntryCacheEntry* entry = _Lookup(key);
 	if (entry == NULL)
 		return false;
 
@@ -213,29 +308,119 @@ EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID,
 	readLocker.Unlock();
 	WriteLocker writeLocker(fLock);
 
+	bool found = false;
 	if (entry->index == kEntryRemoved) {
 		// the entry has been removed in the meantime
-		free(entry);
-		return false;
+		_RetireEntry(entry);
+	} else {
+		_AddEntryToCurrentGeneration(entry);
+
+		_nodeID = entry->node_id;
+		_missing = entry->missing;
+		found = true;
 	}
 
-	_AddEntryToCurrentGeneration(entry);
+	RetiredObjects retired;
+	_TakeRetiredObjects(retired);
+	writeLocker.Unlock();
 
-	_nodeID = entry->node_id;
-	_missing = entry->missing;
-	return true;
+	_FreeRetiredObjects(retired);
+	return found;
 }
 
 
 const char*
 EntryCache::DebugReverseLookup(ino_t nodeID, ino_t& _dirID)
 {
-	for (EntryTable::Iterator it = fEntries.GetIterator();
-			EntryCacheEntry* entry = it.Next();) {
-		if (nodeID == entry->node_id && strcmp(entry->name, ".") != 0
-				&& strcmp(entry->name, "..") != 0) {
-			_dirID = entry->dir_id;
-			return entry->name;
+	if (fTable == NULL)
+		return NULL;
+
+	for (size_t i = 0; i < fTable->bucket_count; i++) {
+		for (EntryCacheEntry* entry = fTable->buckets[i].entries;
+				entry != NULL; entry = entry->hash_link) {
+			if (nodeID == entry->node_id && strcmp(entry->name, ".") != 0
+					&& strcmp(entry->name, "..") != 0) {
+				_dirID = entry->dir_id;
+				return entry->name;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+
+/*!	Looks up the entry without any locking.
+	Returns \c B_OK if the entry has been found and is in the current
+	generation already, \c B_ENTRY_NOT_FOUND if there is no entry, and
+	\c B_BUSY if the caller has to do the lookup with the lock held.
+*/
+status_t
+EntryCache::_LookupLockless(const EntryCacheKey& key, ino_t& _nodeID,
+	bool& _missing)
+{
+	InterruptsLocker interruptsLocker;
+		// keeps the objects we look at from being freed
+
+	for (int32 attempt = 0; attempt < kMaxLocklessAttempts; attempt++) {
+		EntryCacheTable* table
+			= (EntryCacheTable*)atomic_pointer_get(&fTable);
+		if (table == NULL)
+			return B_ENTRY_NOT_FOUND;
+
+		EntryCacheBucket& bucket = table->BucketFor(key.hash);
+		int32 sequence = atomic_get(&bucket.sequence);
+		if ((sequence & 1) != 0) {
+			cpu_pause();
+			continue;
+		}
+
+		EntryCacheEntry* entry = atomic_pointer_get(&bucket.entries);
+		while (entry != NULL) {
+			if (entry->hash == key.hash && entry->dir_id == key.dir_id
+				&& strcmp(entry->name, key.name) == 0) {
+				break;
+			}
+			entry = atomic_pointer_get(&entry->hash_link);
+		}
+
+		ino_t nodeID = -1;
+		bool missing = false;
+		int32 generation = -1;
+		if (entry != NULL) {
+			nodeID = entry->node_id;
+			missing = entry->missing;
+			generation = atomic_get(&entry->generation);
+		}
+
+		memory_read_barrier();
+		if (atomic_get(&bucket.sequence) != sequence)
+			continue;
+
+		if (entry == NULL)
+			return B_ENTRY_NOT_FOUND;
+
+		// Moving the entry to the current generation needs the lock.
+		if (generation != atomic_get(&fCurrentGeneration))
+			return B_BUSY;
+
+		_nodeID = nodeID;
+		_missing = missing;
+		return B_OK;
+	}
+
+	return B_BUSY;
+}
+
+
+EntryCacheEntry*
+EntryCache::_Lookup(const EntryCacheKey& key) const
+{
+	for (EntryCacheEntry* entry = fTable->BucketFor(key.hash).entries;
+			entry != NULL; entry = entry->hash_link) {
+		if (entry->hash == key.hash && entry->dir_id == key.dir_id
+			&& strcmp(entry->name, key.name) == 0) {
+			return entry;
 		}
 	}
 
@@ -243,6 +428,136 @@ EntryCache::DebugReverseLookup(ino_t nodeID, ino_t& _dirID)
 }
 
 
+void
+EntryCache::_Insert(EntryCacheEntry* entry)
+{
+	ASSERT_WRITE_LOCKED_RW_LOCK(&fLock);
+
+	if (fEntryCount >= fTable->bucket_count)
+		_Resize();
+
+	EntryCacheBucket& bucket = fTable->BucketFor(entry->hash);
+	atomic_add(&bucket.sequence, 1);
+	entry->hash_link = bucket.entries;
+	atomic_pointer_set(&bucket.entries, entry);
+	atomic_add(&bucket.sequence, 1);
+
+	fEntryCount++;
+}
+
+
+/*!	Unlinks the entry from the table. It must not be freed before it has
+	been retired, as lockless readers might still see it.
+*/
+void
+EntryCache::_Remove(EntryCacheEntry* entry)
+{
+	ASSERT_WRITE_LOCKED_RW_LOCK(&fLock);
+
+	EntryCacheBucket& bucket = fTable->BucketFor(entry->hash);
+	EntryCacheEntry** link = &bucket.entries;
+	while (*link != NULL && *link != entry)
+		link = &(*link)->hash_link;
+	if (*link == NULL)
+		return;
+
+	atomic_add(&bucket.sequence, 1);
+	atomic_pointer_set(link, entry->hash_link);
+	atomic_add(&bucket.sequence, 1);
+
+	fEntryCount--;
+}
+
+
+void
+EntryCache::_Resize()
+{
+	EntryCacheTable* oldTable = fTable;
+	EntryCacheTable* table = EntryCacheTable::Create(
+		oldTable->bucket_count * 2);
+	if (table == NULL)
+		return;
+
+	for (size_t i = 0; i < oldTable->bucket_count; i++) {
+		EntryCacheBucket& bucket = oldTable->buckets[i];
+
+		// leave the sequence odd, readers will retry with the new table
+		atomic_add(&bucket.sequence, 1);
+
+		EntryCacheEntry* entry = bucket.entries;
+		while (entry != NULL) {
+			EntryCacheEntry* next = entry->hash_link;
+			EntryCacheBucket& newBucket = table->BucketFor(entry->hash);
+			atomic_pointer_set(&entry->hash_link, newBucket.entries);
+			newBucket.entries = entry;
+			entry = next;
+		}
+	}
+
+	atomic_pointer_set(&fTable, table);
+
+	oldTable->retired_link = fRetiredTables;
+	fRetiredTables = oldTable;
+}
+
+
+void
+EntryCache::_RetireEntry(EntryCacheEntry* entry)
+{
+	ASSERT_WRITE_LOCKED_RW_LOCK(&fLock);
+
+	entry->retired_link = fRetiredEntries;
+	fRetiredEntries = entry;
+	fRetiredEntryCount++;
+}
+
+
+/*!	Hands out the retired objects, if there are enough of them to be worth
+	waiting for the lockless readers.
+*/
+void
+EntryCache::_TakeRetiredObjects(RetiredObjects& retired)
+{
+	ASSERT_WRITE_LOCKED_RW_LOCK(&fLock);
+
+	retired.entries = NULL;
+	retired.tables = NULL;
+
+	if (fRetiredEntryCount < kMaxRetiredEntries && fRetiredTables == NULL)
+		return;
+
+	retired.entries = fRetiredEntries;
+	retired.tables = fRetiredTables;
+	fRetiredEntries = NULL;
+	fRetiredEntryCount = 0;
+	fRetiredTables = NULL;
+}
+
+
+/*!	Frees the objects taken by _TakeRetiredObjects(). Must be called
+	without holding the lock, and with interrupts enabled.
+*/
+/*static*/ void
+EntryCache::_FreeRetiredObjects(RetiredObjects& retired)
+{
+	if (retired.entries == NULL && retired.tables == NULL)
+		return;
+
+	// Lockless readers keep interrupts disabled, so when all CPUs have
+	// executed this call, none of them can still look at the objects.
+	call_all_cpus_sync(&wait_for_readers, NULL);
+
+	while (EntryCacheEntry* entry = retired.entries) {
+		retired.entries = entry->retired_link;
+		free(entry);
+	}
+	while (EntryCacheTable* table = retired.tables) {
+		retired.tables = table->retired_link;
+		free(table);
+	}
+}
+
+
 void
 EntryCache::_AddEntryToCurrentGeneration(EntryCacheEntry* entry)
 {
@@ -265,8 +580,8 @@ EntryCache::_AddEntryToCurrentGeneration(EntryCacheEntry* entry)
 			continue;
 
 		fGenerations[newGeneration].entries[i] = NULL;
-		fEntries.Remove(otherEntry);
-		free(otherEntry);
+		_Remove(otherEntry);
+		_RetireEntry(otherEntry);
 	}
 
 	// set the new generation and add the entry
@@ -9,8 +9,6 @@
 #include <stdlib.h>
 
 #include <util/AutoLock.h>
-#include <util/DoublyLinkedList.h>
-#include <util/OpenHashTable.h>
 #include <util/StringHash.h>
 
 
@@ -33,6 +31,8 @@ struct EntryCacheKey {
 
 struct EntryCacheEntry {
 			EntryCacheEntry*	hash_link;
+			EntryCacheEntry*	retired_link;
+			size_t				hash;
 			ino_t				node_id;
 			ino_t				dir_id;
 			int32				generation;
@@ -54,31 +54,23 @@ struct EntryCacheGeneration {
 };
 
 
-struct EntryCacheHashDefinition {
-	typedef EntryCacheKey	KeyType;
-	typedef EntryCacheEntry	ValueType;
+struct EntryCacheBucket {
+			int32				sequence;
+				// odd while the bucket is being changed
+			EntryCacheEntry*	entries;
+};
 
-	uint32 HashKey(const EntryCacheKey& key) const
-	{
-		return key.hash;
-	}
 
-	size_t Hash(const EntryCacheEntry* value) const
-	{
-		return (uint32)value->dir_id ^ (uint32)(value->dir_id >> 32)
-			^ hash_hash_string(value->name);
-	}
+struct EntryCacheTable {
+			EntryCacheTable*	retired_link;
+			size_t				bucket_count;
+			EntryCacheBucket	buckets[0];
 
-	bool Compare(const EntryCacheKey& key, const EntryCacheEntry* value) const
-	{
-		return value->dir_id == key.dir_id
-			&& strcmp(value->name, key.name) == 0;
-	}
+	static	EntryCacheTable*	Create(size_t bucketCount);
 
-	EntryCacheEntry*& GetLink(EntryCacheEntry* value) const
-	{
-		return value->hash_link;
-	}
+			EntryCacheBucket&	BucketFor(size_t hash)
+									{ return buckets[hash
+										& (bucket_count - 1)]; }
 };
 
 
@@ -100,16 +92,34 @@ public:
 			const char*			DebugReverseLookup(ino_t nodeID, ino_t& _dirID);
 
 private:
-			typedef BOpenHashTable<EntryCacheHashDefinition> EntryTable;
-			typedef DoublyLinkedList<EntryCacheEntry> EntryList;
+			struct RetiredObjects {
+				EntryCacheEntry*	entries;
+				EntryCacheTable*	tables;
+			};
 
 private:
+			status_t			_LookupLockless(const EntryCacheKey& key,
+									ino_t& _nodeID, bool& _missing);
+			EntryCacheEntry*	_Lookup(const EntryCacheKey& key) const;
+			void				_Insert(EntryCacheEntry* entry);
+			void				_Remove(EntryCacheEntry* entry);
+			void				_Resize();
+			void				_RetireEntry(EntryCacheEntry* entry);
+			void				_TakeRetiredObjects(RetiredObjects& retired);
+	static	void				_FreeRetiredObjects(RetiredObjects& retired);
+
 			void				_AddEntryToCurrentGeneration(
 									EntryCacheEntry* entry);
 
 private:
 			rw_lock				fLock;
-			EntryTable			fEntries;
+				// write locked for all changes of the table; readers don't
+				// need it, see _LookupLockless()
+			EntryCacheTable*	fTable;
+			size_t				fEntryCount;
+			EntryCacheEntry*	fRetiredEntries;
+			int32				fRetiredEntryCount;
+			EntryCacheTable*	fRetiredTables;
 			int32				fGenerationCount;
 			EntryCacheGeneration* fGenerations;
 			int32				fCurrentGeneration;
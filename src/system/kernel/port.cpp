@@ -100,6 +100,80 @@ struct port_message : DoublyLinkedListLinkImpl<port_message> {
 
 typedef DoublyLinkedList<port_message> MessageList;
 
+
+/*!	A userland reader blocking in read_port_etc() that has wired its buffer,
+	so that a writer can copy the next message directly into it, instead of
+	into a kernel buffer the reader would have to copy it from again.
+*/
+struct port_direct_reader : DoublyLinkedListLinkImpl<port_direct_reader> {
+	void*				buffer;
+	size_t				buffer_size;
+	physical_entry*		entries;
+	uint32				entry_count;
+	bool				registered;
+	bool				delivered;
+	int32				code;
+	size_t				size;
+
+	port_direct_reader()
+		:
+		buffer(NULL),
+		buffer_size(0),
+		entries(NULL),
+		entry_count(0),
+		registered(false),
+		delivered(false),
+		code(0),
+		size(0)
+	{
+	}
+
+	~port_direct_reader()
+	{
+		if (entries != NULL) {
+			unlock_memory(buffer, buffer_size, B_READ_DEVICE);
+			free(entries);
+		}
+	}
+
+	bool IsPrepared() const
+	{
+		return entries != NULL;
+	}
+
+	status_t Prepare(void* _buffer, size_t bufferSize)
+	{
+		uint32 maxEntries = bufferSize / B_PAGE_SIZE + 2;
+		physical_entry* table
+			= (physical_entry*)malloc(sizeof(physical_entry) * maxEntries);
+		if (table == NULL)
+			return B_NO_MEMORY;
+
+		status_t status = lock_memory(_buffer, bufferSize, B_READ_DEVICE);
+		if (status != B_OK) {
+			free(table);
+			return status;
+		}
+
+		uint32 count = maxEntries;
+		status = get_memory_map_etc(B_CURRENT_TEAM, _buffer, bufferSize, table,
+			&count);
+		if (status != B_OK) {
+			unlock_memory(_buffer, bufferSize, B_READ_DEVICE);
+			free(table);
+			return status;
+		}
+
+		buffer = _buffer;
+		buffer_size = bufferSize;
+		entries = table;
+		entry_count = count;
+		return B_OK;
+	}
+};
+
+typedef DoublyLinkedList<port_direct_reader> DirectReaderList;
+
 } // namespace
 
 
@@ -132,6 +206,8 @@ struct Port : public KernelReferenceable {
 		// messages read from port since creation
 	select_info*		select_infos;
 	MessageList			messages;
+	DirectReaderList	direct_readers;
+	size_t				last_message_size;
 
 	Port(team_id owner, int32 queueLength, const char* name)
 		:
@@ -142,7 +218,8 @@ struct Port : public KernelReferenceable {
 		read_count(0),
 		write_count(queueLength),
 		total_count(0),
-		select_infos(NULL)
+		select_infos(NULL),
+		last_message_size(0)
 	{
 		// id is initialized when the caller adds the port to the hash table
 
@@ -444,6 +521,14 @@ static const size_t kBufferGrowRate = kInitialPortBufferSize;
 #define MAX_QUEUE_LENGTH 4096
 #define PORT_MAX_MESSAGE_SIZE (256 * 1024)
 
+// Readers with a buffer at least this large wire it while they wait, if the
+// previous message on the port was at least this large as well.
+static const size_t kDirectTransferThreshold = 16 * 1024;
+
+// The maximum number of messages read_port_vector_etc() and
+// write_port_vector_etc() move in one call.
+static const size_t kMaxPortVectorCount = 32;
+
 static int32 sMaxPorts = 4096;
 static int32 sUsedPorts;
 
@@ -791,6 +876,58 @@ copy_port_message(port_message* message, int32* _code, void* buffer,
 }
 
 
+/*!	Copies the message directly into the wired buffer of the given reader,
+	and removes the reader from the port's list.
+	The port must be locked.
+*/
+static status_t
+deliver_port_message_directly(Port* port, port_direct_reader* reader,
+	int32 code, const iovec* vecs, size_t vecCount, size_t bufferSize,
+	bool userCopy)
+{
+	const size_t messageSize = bufferSize;
+	uint32 entryIndex = 0;
+	phys_size_t entryOffset = 0;
+
+	for (size_t i = 0; i < vecCount && bufferSize > 0; i++) {
+		const uint8* source = (const uint8*)vecs[i].iov_base;
+		size_t length = std::min(vecs[i].iov_len, bufferSize);
+		bufferSize -= length;
+
+		while (length > 0) {
+			if (entryIndex >= reader->entry_count)
+				return B_BAD_VALUE;
+
+			const physical_entry& entry = reader->entries[entryIndex];
+			size_t bytes = std::min(length,
+				(size_t)(entry.size - entryOffset));
+			status_t status = vm_memcpy_to_physical(
+				entry.address + entryOffset, source, bytes, userCopy);
+			if (status != B_OK)
+				return status;
+
+			source += bytes;
+			length -= bytes;
+			entryOffset += bytes;
+			if (entryOffset == entry.size) {
+				entryIndex++;
+				entryOffset = 0;
+			}
+		}
+	}
+
+	port->direct_readers.Remove(reader);
+	reader->registered = false;
+	reader->delivered = true;
+	reader->code = code;
+	reader->size = messageSize;
+
+	// we don't know which of the waiting readers is ours
+	port->read_condition.NotifyAll();
+	return B_OK;
+}
+
+
 static void
 uninit_port(Port* port)
 {
@@ -1459,19 +1596,65 @@ read_port_etc(port_id id, int32* _code, void* buffer, size_t bufferSize,
 		return B_BAD_PORT_ID;
 	}
 
-	while (portRef->read_count == 0) {
+	port_direct_reader directReader;
+	bool tryDirectRead = userCopy && !peekOnly
+		&& bufferSize >= kDirectTransferThreshold;
+
+	while (portRef->read_count == 0 && !directReader.delivered) {
 		if ((flags & B_RELATIVE_TIMEOUT) != 0 && timeout <= 0)
 			return B_WOULD_BLOCK;
 
+		if (tryDirectRead && !directReader.IsPrepared()
+			&& portRef->last_message_size >= kDirectTransferThreshold) {
+			// Large messages are sent over this port. Since we have to wait
+			// anyway, wire our buffer, so that the next message can be
+			// copied into it directly.
+			tryDirectRead = false;
+			locker.Unlock();
+
+			directReader.Prepare(buffer,
+				std::min(bufferSize, (size_t)PORT_MAX_MESSAGE_SIZE));
+
+			BReference<Port> newPortRef = get_locked_port(id);
+			if (newPortRef == NULL) {
+				T(Read(id, 0, 0, 0, B_BAD_PORT_ID));
+				return B_BAD_PORT_ID;
+			}
+			locker.SetTo(newPortRef->lock, true);
+
+			if (newPortRef != portRef
+				|| (is_port_closed(portRef) && portRef->messages.IsEmpty())) {
+				// the port is no longer there
+				T(Read(id, 0, 0, 0, B_BAD_PORT_ID));
+				return B_BAD_PORT_ID;
+			}
+			continue;
+		}
+
 		// We need to wait for a message to appear
 		ConditionVariableEntry entry;
 		portRef->read_condition.Add(&entry);
 
+		if (directReader.IsPrepared()) {
+			portRef->direct_readers.Add(&directReader);
+			directReader.registered = true;
+		}
+
 		locker.Unlock();
 
 		// block if no message, or, if B_TIMEOUT flag set, block with timeout
 		status_t status = entry.Wait(flags, timeout);
 
+		if (directReader.IsPrepared()) {
+			// The port object stays valid as long as we have a reference, even
+			// if it has been deleted in the meantime.
+			MutexLocker directLocker(portRef->lock);
+			if (directReader.registered) {
+				portRef->direct_readers.Remove(&directReader);
+				directReader.registered = false;
+			}
+		}
+
 		// re-lock
 		BReference<Port> newPortRef = get_locked_port(id);
 		if (newPortRef == NULL) {
@@ -1481,18 +1664,30 @@ read_port_etc(port_id id, int32* _code, void* buffer, size_t bufferSize,
 		locker.SetTo(newPortRef->lock, true);
 
 		if (newPortRef != portRef
-			|| (is_port_closed(portRef) && portRef->messages.IsEmpty())) {
+			|| (is_port_closed(portRef) && portRef->messages.IsEmpty()
+				&& !directReader.delivered)) {
 			// the port is no longer there
 			T(Read(id, 0, 0, 0, B_BAD_PORT_ID));
 			return B_BAD_PORT_ID;
 		}
 
-		if (status != B_OK) {
+		if (status != B_OK && !directReader.delivered) {
 			T(Read(portRef, 0, status));
 			return status;
 		}
 	}
 
+	if (directReader.delivered) {
+		// a writer has already copied the message into our buffer
+		portRef->total_count++;
+
+		T(Read(portRef, directReader.code, directReader.size));
+
+		if (_code != NULL)
+			*_code = directReader.code;
+		return directReader.size;
+	}
+
 	// determine tail & get the length of the message
 	port_message* message = portRef->messages.Head();
 	if (message == NULL) {
@@ -1532,6 +1727,146 @@ read_port_etc(port_id id, int32* _code, void* buffer, size_t bufferSize,
 }
 
 
+/*!	Reads as many of the queued messages as fit into \a buffer, but at most
+	\a entryCount of them, and fills in an entry for each. Only waits for the
+	first message; the others are only read if they are already queued.
+	The messages are stored 8 byte aligned one after the other.
+	Returns the number of messages read, or \c B_BUFFER_OVERFLOW if the first
+	message doesn't fit into the buffer. In that case, the message stays in
+	the queue, and the first entry describes it.
+*/
+ssize_t
+read_port_vector_etc(port_id id, void* buffer, size_t bufferSize,
+	port_message_entry* entries, size_t entryCount, uint32 flags,
+	bigtime_t timeout)
+{
+	if (!sPortsActive || id < 0)
+		return B_BAD_PORT_ID;
+	if ((buffer == NULL && bufferSize > 0) || entries == NULL
+		|| entryCount == 0 || timeout < 0) {
+		return B_BAD_VALUE;
+	}
+
+	bool userCopy = (flags & PORT_FLAG_USE_USER_MEMCPY) != 0;
+
+	flags &= B_CAN_INTERRUPT | B_KILL_CAN_INTERRUPT | B_RELATIVE_TIMEOUT
+		| B_ABSOLUTE_TIMEOUT;
+	entryCount = std::min(entryCount, kMaxPortVectorCount);
+
+	// get the port
+	BReference<Port> portRef = get_locked_port(id);
+	if (portRef == NULL)
+		return B_BAD_PORT_ID;
+	MutexLocker locker(portRef->lock, true);
+
+	if (is_port_closed(portRef) && portRef->messages.IsEmpty()) {
+		T(Read(portRef, 0, B_BAD_PORT_ID));
+		return B_BAD_PORT_ID;
+	}
+
+	while (portRef->read_count == 0) {
+		if ((flags & B_RELATIVE_TIMEOUT) != 0 && timeout <= 0)
+			return B_WOULD_BLOCK;
+
+		// We need to wait for a message to appear
+		ConditionVariableEntry entry;
+		portRef->read_condition.Add(&entry);
+
+		locker.Unlock();
+
+		status_t status = entry.Wait(flags, timeout);
+
+		// re-lock
+		BReference<Port> newPortRef = get_locked_port(id);
+		if (newPortRef == NULL) {
+			T(Read(id, 0, 0, 0, B_BAD_PORT_ID));
+			return B_BAD_PORT_ID;
+		}
+		locker.SetTo(newPortRef->lock, true);
+
+		if (newPortRef != portRef
+			|| (is_port_closed(portRef) && portRef->messages.IsEmpty())) {
+			// the port is no longer there
+			T(Read(id, 0, 0, 0, B_BAD_PORT_ID));
+			return B_BAD_PORT_ID;
+		}
+
+		if (status != B_OK) {
+			T(Read(portRef, 0, status));
+			return status;
+		}
+	}
+
+	// take as many messages out of the queue as fit into the buffer
+	MessageList messages;
+	size_t count = 0;
+	size_t offset = 0;
+
+	while (count < entryCount) {
+		port_message* message = portRef->messages.Head();
+		if (message == NULL)
+			break;
+
+		if (offset > bufferSize || message->size > bufferSize - offset) {
+			if (count > 0)
+				break;
+
+			entries[0].code = message->code;
+			entries[0].size = message->size;
+			entries[0].buffer = NULL;
+
+			T(Read(portRef, message->code, B_BUFFER_OVERFLOW));
+
+			portRef->read_condition.NotifyOne();
+				// we didn't grab the message, someone else might
+			return B_BUFFER_OVERFLOW;
+		}
+
+		portRef->messages.RemoveHead();
+		messages.Add(message);
+
+		entries[count].code = message->code;
+		entries[count].size = message->size;
+		entries[count].buffer = (uint8*)buffer + offset;
+
+		offset += ROUNDUP(message->size, 8);
+		count++;
+	}
+
+	portRef->total_count += count;
+	portRef->write_count += count;
+	portRef->read_count -= count;
+
+	notify_port_select_events(portRef, B_EVENT_WRITE);
+	for (size_t i = 0; i < count; i++) {
+		portRef->write_condition.NotifyOne();
+			// make the spots in the queue available again for write
+	}
+
+	T(Read(portRef, entries[0].code, count));
+
+	locker.Unlock();
+
+	status_t status = B_OK;
+	for (size_t i = 0; i < count; i++) {
+		port_message* message = messages.RemoveHead();
+		if (status == B_OK) {
+			ssize_t size = copy_port_message(message, NULL, entries[i].buffer,
+				message->size, userCopy);
+			if (size < 0)
+				status = size;
+		}
+
+		put_port_message(message);
+	}
+
+	if (status != B_OK)
+		return status;
+
+	return count;
+}
+
+
 status_t
 write_port(port_id id, int32 msgCode, const void* buffer, size_t bufferSize)
 {
@@ -1622,6 +1957,28 @@ writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
 	} else
 		portRef->write_count--;
 
+	portRef->last_message_size = bufferSize;
+
+	if (portRef->read_count == 0 && !portRef->direct_readers.IsEmpty()
+		&& bufferSize <= portRef->direct_readers.Head()->buffer_size) {
+		// A reader is waiting with a wired buffer: the message doesn't need
+		// to be queued.
+		status = deliver_port_message_directly(portRef,
+			portRef->direct_readers.Head(), msgCode, msgVecs, vecCount,
+			bufferSize, userCopy);
+		if (status != B_OK)
+			goto error;
+
+		T(Write(id, portRef->read_count, portRef->write_count, msgCode,
+			bufferSize, B_OK));
+
+		// we haven't used our slot in the queue
+		portRef->write_count++;
+		notify_port_select_events(portRef, B_EVENT_WRITE);
+		portRef->write_condition.NotifyOne();
+		return B_OK;
+	}
+
 	status = get_port_message(msgCode, bufferSize, flags, timeout,
 		&message, *portRef);
 	if (status != B_OK) {
@@ -1686,6 +2043,156 @@ error:
 }
 
 
+/*!	Writes the given messages to the port in order. Only waits for room for
+	the first message; the others are only written as long as there is room
+	for them in the queue right away. The messages are always queued, and
+	never delivered directly to a waiting reader.
+	Returns the number of messages written.
+*/
+ssize_t
+write_port_vector_etc(port_id id, const port_message_entry* entries,
+	size_t entryCount, uint32 flags, bigtime_t timeout)
+{
+	if (!sPortsActive || id < 0)
+		return B_BAD_PORT_ID;
+	if (entries == NULL || entryCount == 0)
+		return B_BAD_VALUE;
+
+	entryCount = std::min(entryCount, kMaxPortVectorCount);
+	for (size_t i = 0; i < entryCount; i++) {
+		if (entries[i].size > PORT_MAX_MESSAGE_SIZE
+			|| (entries[i].buffer == NULL && entries[i].size > 0)) {
+			return B_BAD_VALUE;
+		}
+	}
+
+	bool userCopy = (flags & PORT_FLAG_USE_USER_MEMCPY) != 0;
+
+	// mask irrelevant flags (for acquire_sem() usage)
+	flags &= B_CAN_INTERRUPT | B_KILL_CAN_INTERRUPT | B_RELATIVE_TIMEOUT
+		| B_ABSOLUTE_TIMEOUT;
+	if ((flags & B_RELATIVE_TIMEOUT) != 0
+		&& timeout != B_INFINITE_TIMEOUT && timeout > 0) {
+		// Make the timeout absolute, since we have more than one step where
+		// we might have to wait
+		flags = (flags & ~B_RELATIVE_TIMEOUT) | B_ABSOLUTE_TIMEOUT;
+		timeout += system_time();
+	}
+
+	// get the port
+	BReference<Port> portRef = get_locked_port(id);
+	if (portRef == NULL)
+		return B_BAD_PORT_ID;
+	MutexLocker locker(portRef->lock, true);
+
+	if (is_port_closed(portRef))
+		return B_BAD_PORT_ID;
+
+	status_t status = B_OK;
+
+	if (portRef->write_count <= 0) {
+		if ((flags & B_RELATIVE_TIMEOUT) != 0 && timeout <= 0)
+			return B_WOULD_BLOCK;
+
+		portRef->write_count--;
+
+		// We need to block in order to wait for a free message slot
+		ConditionVariableEntry entry;
+		portRef->write_condition.Add(&entry);
+
+		locker.Unlock();
+
+		status = entry.Wait(flags, timeout);
+
+		// re-lock
+		BReference<Port> newPortRef = get_locked_port(id);
+		if (newPortRef == NULL) {
+			T(Write(id, 0, 0, 0, 0, B_BAD_PORT_ID));
+			return B_BAD_PORT_ID;
+		}
+		locker.SetTo(newPortRef->lock, true);
+
+		if (newPortRef != portRef || is_port_closed(portRef)) {
+			// the port is no longer there
+			T(Write(id, 0, 0, 0, 0, B_BAD_PORT_ID));
+			return B_BAD_PORT_ID;
+		}
+	} else
+		portRef->write_count--;
+
+	// We own a slot in the queue now; we only wait for the first message.
+	size_t count = 0;
+	while (status == B_OK) {
+		const port_message_entry& entry = entries[count];
+
+		port_message* message;
+		if (count == 0) {
+			status = get_port_message(entry.code, entry.size, flags, timeout,
+				&message, *portRef);
+		} else {
+			status = get_port_message(entry.code, entry.size,
+				B_RELATIVE_TIMEOUT, 0, &message, *portRef);
+		}
+		if (status == B_BAD_PORT_ID) {
+			// the port had to be unlocked and is now no longer there
+			T(Write(id, 0, 0, 0, 0, B_BAD_PORT_ID));
+			return B_BAD_PORT_ID;
+		}
+		if (status != B_OK)
+			break;
+
+		// sender credentials
+		message->sender = geteuid();
+		message->sender_group = getegid();
+		message->sender_team = team_get_current_team_id();
+
+		if (entry.size > 0) {
+			if (userCopy) {
+				status = user_memcpy(message->buffer, entry.buffer,
+					entry.size);
+			} else
+				memcpy(message->buffer, entry.buffer, entry.size);
+
+			if (status != B_OK) {
+				put_port_message(message);
+				break;
+			}
+		}
+
+		portRef->messages.Add(message);
+		portRef->read_count++;
+		count++;
+
+		T(Write(id, portRef->read_count, portRef->write_count, message->code,
+			message->size, B_OK));
+
+		if (count == entryCount || portRef->write_count <= 0)
+			break;
+
+		portRef->write_count--;
+	}
+
+	if (status != B_OK) {
+		// Give up our unused slot in the queue again
+		T(Write(id, portRef->read_count, portRef->write_count, 0, 0, status));
+		portRef->write_count++;
+		notify_port_select_events(portRef, B_EVENT_WRITE);
+		portRef->write_condition.NotifyOne();
+
+		if (count == 0)
+			return status;
+	}
+
+	portRef->last_message_size = entries[count - 1].size;
+
+	notify_port_select_events(portRef, B_EVENT_READ);
+	for (size_t i = 0; i < count; i++)
+		portRef->read_condition.NotifyOne();
+
+	return count;
+}
+
+
 status_t
 set_port_owner(port_id id, team_id newTeamID)
 {
@@ -1939,6 +2446,76 @@ _user_writev_port_etc(port_id port, int32 messageCode, const iovec *userVecs,
 }
 
 
+ssize_t
+_user_read_port_vector_etc(port_id port, void* userBuffer, size_t bufferSize,
+	port_message_entry* userEntries, size_t entryCount, uint32 flags,
+	bigtime_t timeout)
+{
+	syscall_restart_handle_timeout_pre(flags, timeout);
+
+	if ((userBuffer == NULL && bufferSize != 0) || userEntries == NULL
+		|| entryCount == 0) {
+		return B_BAD_VALUE;
+	}
+	if (!IS_USER_ADDRESS(userEntries)
+		|| (userBuffer != NULL && !IS_USER_ADDRESS(userBuffer))) {
+		return B_BAD_ADDRESS;
+	}
+
+	port_message_entry entries[kMaxPortVectorCount];
+	entryCount = std::min(entryCount, kMaxPortVectorCount);
+
+	ssize_t count = read_port_vector_etc(port, userBuffer, bufferSize,
+		entries, entryCount,
+		flags | PORT_FLAG_USE_USER_MEMCPY | B_CAN_INTERRUPT, timeout);
+
+	// on overflow, the first entry describes the message that didn't fit
+	size_t copyCount = 0;
+	if (count >= 0)
+		copyCount = count;
+	else if (count == B_BUFFER_OVERFLOW)
+		copyCount = 1;
+	if (copyCount > 0 && user_memcpy(userEntries, entries,
+			sizeof(port_message_entry) * copyCount) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	return syscall_restart_handle_timeout_post(count, timeout);
+}
+
+
+ssize_t
+_user_write_port_vector_etc(port_id port,
+	const port_message_entry* userEntries, size_t entryCount, uint32 flags,
+	bigtime_t timeout)
+{
+	syscall_restart_handle_timeout_pre(flags, timeout);
+
+	if (userEntries == NULL || entryCount == 0)
+		return B_BAD_VALUE;
+	if (!IS_USER_ADDRESS(userEntries))
+		return B_BAD_ADDRESS;
+
+	port_message_entry entries[kMaxPortVectorCount];
+	entryCount = std::min(entryCount, kMaxPortVectorCount);
+
+	if (user_memcpy(entries, userEntries,
+			sizeof(port_message_entry) * entryCount) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	for (size_t i = 0; i < entryCount; i++) {
+		if (entries[i].buffer != NULL && !IS_USER_ADDRESS(entries[i].buffer))
+			return B_BAD_ADDRESS;
+	}
+
+	ssize_t count = write_port_vector_etc(port, entries, entryCount,
+		flags | PORT_FLAG_USE_USER_MEMCPY | B_CAN_INTERRUPT, timeout);
+
+	return syscall_restart_handle_timeout_post(count, timeout);
+}
+
+
 status_t
 _user_get_port_message_info_etc(port_id port, port_message_info *userInfo,
 	size_t infoSize, uint32 flags, bigtime_t timeout)
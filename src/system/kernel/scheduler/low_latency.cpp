@@ -44,15 +44,23 @@ has_cache_expired(const ThreadData* threadData)
 
 
 static CoreEntry*
-choose_core(const ThreadData* /* threadData */)
+choose_core(const ThreadData* threadData)
 {
 	SCHEDULER_ENTER_FUNCTION();
 
+	// stay on the memory node the thread has been running on, if possible
+	int32 node = threadData->HomeNode();
+
 	// wake new package
-	PackageEntry* package = gIdlePackageList.Last();
+	PackageEntry* package = PackageEntry::GetIdlePackage(node);
 	if (package == NULL) {
 		// wake new core
-		package = PackageEntry::GetMostIdlePackage();
+		package = PackageEntry::GetMostIdlePackage(node);
+	}
+	if (package == NULL && node >= 0) {
+		package = gIdlePackageList.Last();
+		if (package == NULL)
+			package = PackageEntry::GetMostIdlePackage();
 	}
 
 	CoreEntry* core = NULL;
@@ -72,6 +80,28 @@ choose_core(const ThreadData* /* threadData */)
 }
 
 
+/*!	Returns whether moving a thread with the given load from \a core to
+	\a other brings both core loads closer to the average, given that
+	they have to differ by at least \a loadDifference.
+*/
+static bool
+should_migrate(CoreEntry* core, CoreEntry* other, int32 threadLoad,
+	int32 loadDifference)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	int32 coreLoad = core->GetLoad();
+	int32 otherLoad = other->GetLoad();
+	if (other == core || otherLoad + loadDifference >= coreLoad)
+		return false;
+
+	int32 difference = coreLoad - otherLoad - loadDifference;
+	ASSERT(difference > 0);
+
+	return difference >= threadLoad;
+}
+
+
 static CoreEntry*
 rebalance(const ThreadData* threadData)
 {
@@ -80,28 +110,44 @@ rebalance(const ThreadData* threadData)
 	CoreEntry* core = threadData->Core();
 	ASSERT(core != NULL);
 
+	int32 threadLoad = threadData->GetLoad() / core->CPUCount();
+
+	// Balance the load between the cores sharing the last level cache first,
+	// the thread doesn't lose much of its cached data there.
+	CoreEntry* other = core->LeastLoadedCacheSibling();
+	if (other != NULL
+		&& should_migrate(core, other, threadLoad, kLoadDifference)) {
+		return other;
+	}
+
 	// Get the least loaded core.
 	ReadSpinLocker coreLocker(gCoreHeapsLock);
-	CoreEntry* other = gCoreLoadHeap.PeekMinimum();
+	other = gCoreLoadHeap.PeekMinimum();
 	if (other == NULL)
 		other = gCoreHighLoadHeap.PeekMinimum();
 	coreLocker.Unlock();
 	ASSERT(other != NULL);
 
-	// Check if the least loaded core is significantly less loaded than
-	// the current one.
-	int32 coreLoad = core->GetLoad();
-	int32 otherLoad = other->GetLoad();
-	if (other == core || otherLoad + kLoadDifference >= coreLoad)
-		return core;
-
-	// Check whether migrating the current thread would result in both core
-	// loads become closer to the average.
-	int32 difference = coreLoad - otherLoad - kLoadDifference;
-	ASSERT(difference > 0);
+	// The further away the other core is, the more expensive the migration,
+	// and the larger the imbalance has to be.
+	// Moving a thread away from its memory node makes all its memory accesses
+	// remote, so require an even larger imbalance for that.
+	int32 loadDifference = kLoadDifference;
+	switch (core->MigrationDistance(other)) {
+		case SCHEDULER_MIGRATION_PACKAGE:
+			loadDifference = kLoadDifference * 3 / 2;
+			break;
+		case SCHEDULER_MIGRATION_REMOTE:
+			loadDifference = kLoadDifference * 2;
+			break;
+	}
+	if (gNodeCount > 1
+		&& other->Package()->NodeID() != core->Package()->NodeID()) {
+		loadDifference *= 2;
+	}
 
-	int32 threadLoad = threadData->GetLoad() / core->CPUCount();
-	return difference >= threadLoad ? other : core;
+	return should_migrate(core, other, threadLoad, loadDifference)
+		? other : core;
 }
 
 
@@ -161,6 +207,8 @@ scheduler_mode_operations gSchedulerLowLatencyMode = {
 
 	5000,
 
+	0,
+
 	switch_to_mode,
 	set_cpu_enabled,
 	has_cache_expired,
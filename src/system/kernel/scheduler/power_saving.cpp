@@ -66,14 +66,20 @@ choose_small_task_core()
 
 
 static CoreEntry*
-choose_idle_core()
+choose_idle_core(int32 node)
 {
 	SCHEDULER_ENTER_FUNCTION();
 
-	PackageEntry* package = PackageEntry::GetLeastIdlePackage();
+	PackageEntry* package = PackageEntry::GetLeastIdlePackage(node);
 
 	if (package == NULL)
-		package = gIdlePackageList.Last();
+		package = PackageEntry::GetIdlePackage(node);
+
+	if (package == NULL && node >= 0) {
+		package = PackageEntry::GetLeastIdlePackage();
+		if (package == NULL)
+			package = gIdlePackageList.Last();
+	}
 
 	if (package != NULL)
 		return package->GetIdleCore();
@@ -100,7 +106,7 @@ choose_core(const ThreadData* threadData)
 		if (core == NULL) {
 			coreLocker.Unlock();
 
-			core = choose_idle_core();
+			core = choose_idle_core(threadData->HomeNode());
 
 			if (core == NULL) {
 				coreLocker.Lock();
@@ -245,6 +251,8 @@ scheduler_mode_operations gSchedulerPowerSavingMode = {
 
 	20000,
 
+	kHighLoad,
+
 	switch_to_mode,
 	set_cpu_enabled,
 	has_cache_expired,
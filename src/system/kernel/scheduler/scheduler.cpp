@@ -429,6 +429,8 @@ reschedule(int32 nextState)
 	ASSERT(nextThreadData->Core() == core);
 	nextThread->state = B_THREAD_RUNNING;
 	nextThreadData->StartCPUTime();
+	if (nextThread != oldThread)
+		nextThreadData->CountMigration(thisCPU);
 
 	// track CPU activity
 	cpu->TrackActivity(oldThreadData, nextThreadData);
@@ -585,6 +587,28 @@ scheduler_set_cpu_enabled(int32 cpuID, bool enabled)
 }
 
 
+void
+scheduler_update_memory_nodes()
+{
+	if (gCPUEntries == NULL)
+		return;
+
+	InterruptsBigSchedulerLocker _;
+
+	int32 nodeCount = 1;
+	int32 cpuCount = smp_get_num_cpus();
+	for (int32 i = 0; i < cpuCount; i++) {
+		int32 node = gCPU[i].node;
+		gCPUEntries[i].Core()->Package()->SetNodeID(node);
+		nodeCount = max_c(nodeCount, node + 1);
+	}
+
+	gNodeCount = nodeCount;
+	dprintf("scheduler: %" B_PRId32 " memory node%s\n", gNodeCount,
+		gNodeCount != 1 ? "s" : "");
+}
+
+
 static void
 traverse_topology_tree(const cpu_topology_node* node, int packageID, int coreID)
 {
@@ -694,9 +718,22 @@ init()
 		core->Init(sCPUToCore[i], package);
 		gCPUEntries[i].Init(i, core);
 
+		// cores with an unknown last level cache are assumed to share it
+		// with the whole package
+		int32 cacheDomain = -1;
+		if (gCPUCacheLevelCount > 0)
+			cacheDomain = gCPU[i].cache_id[gCPUCacheLevelCount - 1];
+		core->SetCacheDomain(cacheDomain);
+
 		core->AddCPU(&gCPUEntries[i]);
 	}
 
+	for (int32 i = 0; i < coreCount; i++) {
+		result = gCoreEntries[i].InitCacheSiblings();
+		if (result != B_OK)
+			return result;
+	}
+
 	packageEntriesDeleter.Detach();
 	coreEntriesDeleter.Detach();
 	cpuEntriesDeleter.Detach();
@@ -12,6 +12,7 @@
 #include <debug.h>
 #include <kscheduler.h>
 #include <load_tracking.h>
+#include <scheduler_defs.h>
 #include <smp.h>
 #include <thread.h>
 #include <user_debugger.h>
@@ -42,11 +43,17 @@ const int kVeryHighLoad = (kMaxLoad + kHighLoad) / 2;
 
 const int kLoadDifference = kMaxLoad * 20 / 100;
 
+// A thread that has just been moved to another core is not moved again for
+// this long, unless its core is overloaded.
+const bigtime_t kMigrationHysteresis = 20 * kLoadMeasureInterval;
+
 extern bool gSingleCore;
 extern bool gTrackCoreLoad;
 extern bool gTrackCPULoad;
 
 
+int32 migration_distance(int32 fromCPU, int32 toCPU);
+
 void init_debug_commands();
 
 
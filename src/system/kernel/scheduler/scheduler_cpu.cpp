@@ -28,6 +28,7 @@ PackageEntry* gPackageEntries;
 IdlePackageList gIdlePackageList;
 rw_spinlock gIdlePackageLock = B_RW_SPINLOCK_INITIALIZER;
 int32 gPackageCount;
+int32 gNodeCount = 1;
 
 
 }	// namespace Scheduler
@@ -55,6 +56,12 @@ private:
 static CPUPriorityHeap sDebugCPUHeap;
 static CoreLoadHeap sDebugCoreHeap;
 
+// An idle CPU only takes over threads from cores at the given migration
+// distance, if at least that many threads are waiting there.
+static const int32 kStealThreadCount[SCHEDULER_MIGRATION_DISTANCES] = {
+	1, 1, 1, 2
+};
+
 
 void
 ThreadRunQueue::Dump() const
@@ -215,7 +222,8 @@ CPUEntry::ComputeLoad()
 
 
 ThreadData*
-CPUEntry::ChooseNextThread(ThreadData* oldThread, bool putAtBack)
+CPUEntry::ChooseNextThread(ThreadData* oldThread, bool putAtBack,
+	bool mayStealThread)
 {
 	SCHEDULER_ENTER_FUNCTION();
 
@@ -240,6 +248,20 @@ CPUEntry::ChooseNextThread(ThreadData* oldThread, bool putAtBack)
 		sharedPriority = sharedThread->GetEffectivePriority();
 
 	int32 rest = std::max(pinnedPriority, sharedPriority);
+
+	if (mayStealThread && !gSingleCore
+		&& std::max(oldPriority, rest) <= B_IDLE_PRIORITY) {
+		// there is nothing to do but idling, look at the other cores first
+		coreLocker.Unlock();
+		cpuLocker.Unlock();
+
+		ThreadData* stolenThread = _StealThread();
+		if (stolenThread != NULL)
+			return stolenThread;
+
+		return ChooseNextThread(oldThread, putAtBack, false);
+	}
+
 	if (oldPriority > rest || (!putAtBack && oldPriority == rest))
 		return oldThread;
 
@@ -347,6 +369,64 @@ CPUEntry::_RequestPerformanceLevel(ThreadData* threadData)
 }
 
 
+/*!	Takes over a thread waiting in the run queue of another core, whose CPUs
+	are all busy. The closer the core is to this one, the better, since the
+	thread's data is more likely to be in a shared cache.
+*/
+ThreadData*
+CPUEntry::_StealThread()
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	CoreEntry* victim = NULL;
+	int32 victimDistance = SCHEDULER_MIGRATION_DISTANCES;
+	int32 victimThreadCount = 0;
+
+	for (int32 i = 0; i < gCoreCount; i++) {
+		CoreEntry* core = &gCoreEntries[i];
+		if (core == fCore || core->CPUCount() == 0
+			|| core->IdleCPUCount() > 0) {
+			continue;
+		}
+
+		int32 threadCount = core->WaitingThreadCount();
+		int32 distance = fCore->MigrationDistance(core);
+		if (threadCount < kStealThreadCount[distance]
+			|| distance > victimDistance
+			|| (distance == victimDistance
+				&& threadCount <= victimThreadCount)) {
+			continue;
+		}
+
+		if (core->GetLoad() < gCurrentMode->steal_load_threshold)
+			continue;
+
+		victim = core;
+		victimDistance = distance;
+		victimThreadCount = threadCount;
+	}
+
+	if (victim == NULL)
+		return NULL;
+
+	CoreRunQueueLocker locker(victim);
+	ThreadData* threadData = victim->PeekThread();
+	if (threadData == NULL)
+		return NULL;
+
+	victim->Remove(threadData);
+	locker.Unlock();
+
+	CoreEntry* targetCore = fCore;
+	CPUEntry* targetCPU = this;
+	threadData->ChooseCoreAndCPU(targetCore, targetCPU);
+
+	TRACE("CPU %ld takes over thread %ld from core %ld\n", fCPUNumber,
+		threadData->GetThread()->id, victim->ID());
+	return threadData;
+}
+
+
 /* static */ int32
 CPUEntry::_RescheduleEvent(timer* /* unused */)
 {
@@ -401,6 +481,9 @@ CPUPriorityHeap::Dump()
 
 CoreEntry::CoreEntry()
 	:
+	fCacheDomain(-1),
+	fCacheSiblings(NULL),
+	fCacheSiblingCount(0),
 	fCPUCount(0),
 	fIdleCPUCount(0),
 	fThreadCount(0),
@@ -426,6 +509,71 @@ CoreEntry::Init(int32 id, PackageEntry* package)
 }
 
 
+/*!	Sets the ID of the last level cache this core uses. The cores of a
+	package which have the same cache domain share that cache.
+*/
+void
+CoreEntry::SetCacheDomain(int32 domain)
+{
+	fCacheDomain = domain;
+}
+
+
+/*!	Collects the other cores sharing the last level cache with this one.
+	Must be called after the cache domains of all cores have been set.
+*/
+status_t
+CoreEntry::InitCacheSiblings()
+{
+	int32 count = 0;
+	for (int32 i = 0; i < gCoreCount; i++) {
+		if (MigrationDistance(&gCoreEntries[i])
+				== SCHEDULER_MIGRATION_SHARED_CACHE) {
+			count++;
+		}
+	}
+
+	if (count == 0)
+		return B_OK;
+
+	fCacheSiblings = new(std::nothrow) CoreEntry*[count];
+	if (fCacheSiblings == NULL)
+		return B_NO_MEMORY;
+
+	for (int32 i = 0; i < gCoreCount; i++) {
+		if (MigrationDistance(&gCoreEntries[i])
+				== SCHEDULER_MIGRATION_SHARED_CACHE) {
+			fCacheSiblings[fCacheSiblingCount++] = &gCoreEntries[i];
+		}
+	}
+
+	return B_OK;
+}
+
+
+CoreEntry*
+CoreEntry::LeastLoadedCacheSibling() const
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	CoreEntry* sibling = NULL;
+	int32 siblingLoad = 0;
+	for (int32 i = 0; i < fCacheSiblingCount; i++) {
+		CoreEntry* core = fCacheSiblings[i];
+		if (core->CPUCount() == 0)
+			continue;
+
+		int32 load = core->GetLoad();
+		if (sibling == NULL || load < siblingLoad) {
+			sibling = core;
+			siblingLoad = load;
+		}
+	}
+
+	return sibling;
+}
+
+
 void
 CoreEntry::PushFront(ThreadData* thread, int32 priority)
 {
@@ -644,6 +792,7 @@ CoreLoadHeap::Dump()
 
 PackageEntry::PackageEntry()
 	:
+	fNodeID(0),
 	fIdleCoreCount(0),
 	fCoreCount(0)
 {
@@ -658,6 +807,13 @@ PackageEntry::Init(int32 id)
 }
 
 
+void
+PackageEntry::SetNodeID(int32 node)
+{
+	fNodeID = node;
+}
+
+
 void
 PackageEntry::AddIdleCore(CoreEntry* core)
 {
@@ -720,7 +876,8 @@ DebugDumper::DumpCoreLoadHeapEntry(CoreEntry* entry)
 /* static */ void
 DebugDumper::DumpIdleCoresInPackage(PackageEntry* package)
 {
-	kprintf("%-7" B_PRId32 " ", package->fPackageID);
+	kprintf("%-7" B_PRId32 " %-4" B_PRId32 " ", package->fPackageID,
+		package->fNodeID);
 
 	DoublyLinkedList<CoreEntry>::ReverseIterator iterator
 		= package->fIdleCores.GetReverseIterator();
@@ -745,6 +902,14 @@ DebugDumper::_AnalyzeCoreThreads(Thread* thread, void* data)
 }
 
 
+int32
+Scheduler::migration_distance(int32 fromCPU, int32 toCPU)
+{
+	return CoreEntry::GetCore(fromCPU)->MigrationDistance(
+		CoreEntry::GetCore(toCPU));
+}
+
+
 static int
 dump_run_queue(int /* argc */, char** /* argv */)
 {
@@ -791,7 +956,7 @@ dump_idle_cores(int /* argc */, char** /* argv */)
 		= gIdlePackageList.GetReverseIterator();
 
 	if (idleIterator.HasNext()) {
-		kprintf("package cores\n");
+		kprintf("package node cores\n");
 
 		while (idleIterator.HasNext())
 			DebugDumper::DumpIdleCoresInPackage(idleIterator.Next());
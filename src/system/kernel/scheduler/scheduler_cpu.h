@@ -77,7 +77,8 @@ public:
 						void			ComputeLoad();
 
 						ThreadData*		ChooseNextThread(ThreadData* oldThread,
-											bool putAtBack);
+											bool putAtBack,
+											bool mayStealThread = true);
 
 						void			TrackActivity(ThreadData* oldThreadData,
 											ThreadData* nextThreadData);
@@ -91,6 +92,8 @@ private:
 						void			_RequestPerformanceLevel(
 											ThreadData* threadData);
 
+						ThreadData*		_StealThread();
+
 	static				int32			_RescheduleEvent(timer* /* unused */);
 	static				int32			_UpdateLoadEvent(timer* /* unused */);
 
@@ -131,6 +134,16 @@ public:
 	inline				PackageEntry*	Package() const	{ return fPackage; }
 	inline				int32			CPUCount() const
 											{ return fCPUCount; }
+	inline				int32			IdleCPUCount() const
+											{ return fIdleCPUCount; }
+
+	inline				int32			CacheDomain() const
+											{ return fCacheDomain; }
+						void			SetCacheDomain(int32 domain);
+						status_t		InitCacheSiblings();
+						CoreEntry*		LeastLoadedCacheSibling() const;
+	inline				int32			MigrationDistance(
+											const CoreEntry* other) const;
 
 	inline				void			LockCPUHeap();
 	inline				void			UnlockCPUHeap();
@@ -138,6 +151,8 @@ public:
 	inline				CPUPriorityHeap*	CPUHeap();
 
 	inline				int32			ThreadCount() const;
+	inline				int32			WaitingThreadCount() const
+											{ return fThreadCount; }
 
 	inline				void			LockRunQueue();
 	inline				void			UnlockRunQueue();
@@ -181,6 +196,10 @@ private:
 						int32			fCoreID;
 						PackageEntry*	fPackage;
 
+						int32			fCacheDomain;
+						CoreEntry**		fCacheSiblings;
+						int32			fCacheSiblingCount;
+
 						int32			fCPUCount;
 						int32			fIdleCPUCount;
 						CPUPriorityHeap	fCPUHeap;
@@ -226,6 +245,11 @@ public:
 
 						void				Init(int32 id);
 
+	inline				int32				ID() const	{ return fPackageID; }
+
+	inline				int32				NodeID() const	{ return fNodeID; }
+						void				SetNodeID(int32 node);
+
 	inline				void				CoreGoesIdle(CoreEntry* core);
 	inline				void				CoreWakesUp(CoreEntry* core);
 
@@ -234,11 +258,15 @@ public:
 						void				AddIdleCore(CoreEntry* core);
 						void				RemoveIdleCore(CoreEntry* core);
 
-	static inline		PackageEntry*		GetMostIdlePackage();
-	static inline		PackageEntry*		GetLeastIdlePackage();
+	static inline		PackageEntry*		GetIdlePackage(int32 node = -1);
+	static inline		PackageEntry*		GetMostIdlePackage(
+												int32 node = -1);
+	static inline		PackageEntry*		GetLeastIdlePackage(
+												int32 node = -1);
 
 private:
 						int32				fPackageID;
+						int32				fNodeID;
 
 						DoublyLinkedList<CoreEntry>	fIdleCores;
 						int32				fIdleCoreCount;
@@ -261,6 +289,7 @@ extern PackageEntry* gPackageEntries;
 extern IdlePackageList gIdlePackageList;
 extern rw_spinlock gIdlePackageLock;
 extern int32 gPackageCount;
+extern int32 gNodeCount;
 
 
 inline void
@@ -351,6 +380,24 @@ CoreEntry::ThreadCount() const
 }
 
 
+/*!	Returns how expensive it is to move a thread from this core to \a other,
+	as one of the \c SCHEDULER_MIGRATION_* distances.
+*/
+inline int32
+CoreEntry::MigrationDistance(const CoreEntry* other) const
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	if (other == this)
+		return SCHEDULER_MIGRATION_SMT;
+	if (other->fPackage != fPackage)
+		return SCHEDULER_MIGRATION_REMOTE;
+	if (other->fCacheDomain != fCacheDomain)
+		return SCHEDULER_MIGRATION_PACKAGE;
+	return SCHEDULER_MIGRATION_SHARED_CACHE;
+}
+
+
 inline void
 CoreEntry::LockRunQueue()
 {
@@ -545,18 +592,47 @@ PackageEntry::GetIdleCore() const
 }
 
 
+/*!	Returns a package all cores of which are idle. If \a node is not negative,
+	only packages belonging to that memory node are considered.
+*/
 /* static */ inline PackageEntry*
-PackageEntry::GetMostIdlePackage()
+PackageEntry::GetIdlePackage(int32 node)
 {
 	SCHEDULER_ENTER_FUNCTION();
 
-	PackageEntry* current = &gPackageEntries[0];
-	for (int32 i = 1; i < gPackageCount; i++) {
-		if (gPackageEntries[i].fIdleCoreCount > current->fIdleCoreCount)
-			current = &gPackageEntries[i];
+	if (node < 0)
+		return gIdlePackageList.Last();
+
+	ReadSpinLocker locker(gIdlePackageLock);
+	IdlePackageList::ReverseIterator iterator
+		= gIdlePackageList.GetReverseIterator();
+	while (PackageEntry* package = iterator.Next()) {
+		if (package->fNodeID == node)
+			return package;
+	}
+
+	return NULL;
+}
+
+
+/* static */ inline PackageEntry*
+PackageEntry::GetMostIdlePackage(int32 node)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	PackageEntry* current = NULL;
+	for (int32 i = 0; i < gPackageCount; i++) {
+		PackageEntry* package = &gPackageEntries[i];
+		if (node >= 0 && package->fNodeID != node)
+			continue;
+
+		if (current == NULL
+			|| package->fIdleCoreCount > current->fIdleCoreCount) {
+			current = package;
+		}
 	}
 
-	if (current->fIdleCoreCount == 0)
+	if (current == NULL || current->fIdleCoreCount == 0)
 		return NULL;
 
 	return current;
@@ -564,7 +640,7 @@ PackageEntry::GetMostIdlePackage()
 
 
 /* static */ inline PackageEntry*
-PackageEntry::GetLeastIdlePackage()
+PackageEntry::GetLeastIdlePackage(int32 node)
 {
 	SCHEDULER_ENTER_FUNCTION();
 
@@ -572,6 +648,8 @@ PackageEntry::GetLeastIdlePackage()
 
 	for (int32 i = 0; i < gPackageCount; i++) {
 		PackageEntry* current = &gPackageEntries[i];
+		if (node >= 0 && current->fNodeID != node)
+			continue;
 
 		int32 currentIdleCoreCount = current->fIdleCoreCount;
 		if (currentIdleCoreCount != 0 && (package == NULL
@@ -19,6 +19,10 @@ struct scheduler_mode_operations {
 
 	bigtime_t				maximum_latency;
 
+	int32					steal_load_threshold;
+		// idle CPUs only take over threads waiting on cores with at least
+		// this load
+
 	void					(*switch_to_mode)();
 	void					(*set_cpu_enabled)(int32 cpu, bool enabled);
 	bool					(*has_cache_expired)(
@@ -39,6 +39,10 @@ ThreadData::_InitBase()
 	fMeasureAvailableActiveTime = 0;
 	fLastMeasureAvailableTime = 0;
 	fMeasureAvailableTime = 0;
+
+	fLastMigration = 0;
+	for (int32 i = 0; i < SCHEDULER_MIGRATION_DISTANCES; i++)
+		fMigrations[i] = 0;
 }
 
 
@@ -144,6 +148,12 @@ ThreadData::Dump() const
 	kprintf("\twent_sleep_active:\t%" B_PRId64 "\n", fWentSleepActive);
 	kprintf("\tcore:\t\t\t%" B_PRId32 "\n",
 		fCore != NULL ? fCore->ID() : -1);
+	kprintf("\tmigrations:\t\t%" B_PRIu32 " smt, %" B_PRIu32 " shared cache, %"
+		B_PRIu32 " package, %" B_PRIu32 " remote\n",
+		fMigrations[SCHEDULER_MIGRATION_SMT],
+		fMigrations[SCHEDULER_MIGRATION_SHARED_CACHE],
+		fMigrations[SCHEDULER_MIGRATION_PACKAGE],
+		fMigrations[SCHEDULER_MIGRATION_REMOTE]);
 	if (fCore != NULL && HasCacheExpired())
 		kprintf("\tcache affinity has expired\n");
 }
@@ -169,6 +179,9 @@ ThreadData::ChooseCoreAndCPU(CoreEntry*& targetCore, CPUEntry*& targetCPU)
 	ASSERT(targetCPU != NULL);
 
 	if (fCore != targetCore) {
+		if (fCore != NULL)
+			fLastMigration = system_time();
+
 		fLoadMeasurementEpoch = targetCore->LoadMeasurementEpoch() - 1;
 		if (fReady) {
 			if (fCore != NULL)
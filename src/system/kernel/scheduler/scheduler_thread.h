@@ -45,6 +45,8 @@ public:
 
 	inline	bool		HasCacheExpired() const;
 	inline	CoreEntry*	Rebalance() const;
+	inline	bigtime_t	LastMigration() const	{ return fLastMigration; }
+	inline	void		CountMigration(int32 cpu);
 
 	inline	int32		GetEffectivePriority() const;
 
@@ -87,6 +89,8 @@ public:
 	inline	CoreEntry*	Core() const	{ return fCore; }
 			void		UnassignCore(bool running = false);
 
+	inline	int32		HomeNode() const;
+
 	static	void		ComputeQuantumLengths();
 
 private:
@@ -129,6 +133,9 @@ private:
 			uint32		fLoadMeasurementEpoch;
 
 			CoreEntry*	fCore;
+
+			bigtime_t	fLastMigration;
+			uint32		fMigrations[SCHEDULER_MIGRATION_DISTANCES];
 };
 
 class ThreadProcessing {
@@ -182,10 +189,47 @@ ThreadData::Rebalance() const
 	SCHEDULER_ENTER_FUNCTION();
 
 	ASSERT(!gSingleCore);
+
+	// Every migration costs refilling the caches, so don't let threads
+	// bounce between cores.
+	if (system_time() - fLastMigration < kMigrationHysteresis
+		&& fCore->GetLoad() < kVeryHighLoad) {
+		return fCore;
+	}
+
 	return gCurrentMode->rebalance(this);
 }
 
 
+/*!	Called when the thread starts running on \a cpu.
+*/
+inline void
+ThreadData::CountMigration(int32 cpu)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	cpu_ent* previousCPU = fThread->previous_cpu;
+	if (previousCPU == NULL || previousCPU->cpu_num == cpu || IsIdle())
+		return;
+
+	fMigrations[migration_distance(previousCPU->cpu_num, cpu)]++;
+}
+
+
+/*!	Returns the memory node of the core the thread last ran on, or -1 if
+	that doesn't matter, e.g. because the system has a single memory node.
+*/
+inline int32
+ThreadData::HomeNode() const
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	if (gNodeCount < 2 || fCore == NULL)
+		return -1;
+	return fCore->Package()->NodeID();
+}
+
+
 inline int32
 ThreadData::GetEffectivePriority() const
 {
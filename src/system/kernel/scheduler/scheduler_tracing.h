@@ -106,6 +106,7 @@ public:
 	virtual const char* Name() const;
 
 	thread_id PreviousThreadID() const		{ return fPreviousID; }
+	int32 CPU() const						{ return fCPU; }
 	uint8 PreviousState() const				{ return fPreviousState; }
 	uint16 PreviousWaitObjectType() const	{ return fPreviousWaitObjectType; }
 	const void* PreviousWaitObject() const	{ return fPreviousWaitObject; }
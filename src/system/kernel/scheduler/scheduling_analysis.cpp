@@ -11,6 +11,7 @@
 #include <tracing.h>
 #include <util/AutoLock.h>
 
+#include "scheduler_common.h"
 #include "scheduler_tracing.h"
 
 
@@ -66,6 +67,7 @@ struct ThreadKey : HashObjectKey {
 struct Thread : HashObject, scheduling_analysis_thread {
 	ScheduleState state;
 	bigtime_t lastTime;
+	int32 lastCPU;
 
 	ThreadWaitObject* waitObject;
 
@@ -73,6 +75,7 @@ struct Thread : HashObject, scheduling_analysis_thread {
 		:
 		state(UNKNOWN),
 		lastTime(0),
+		lastCPU(-1),
 
 		waitObject(NULL)
 	{
@@ -98,6 +101,9 @@ struct Thread : HashObject, scheduling_analysis_thread {
 
 		preemptions = 0;
 
+		memset(migrations, 0, sizeof(migrations));
+		memset(latency_histogram, 0, sizeof(latency_histogram));
+
 		wait_objects = NULL;
 	}
 
@@ -218,6 +224,9 @@ public:
 		fAnalysis.threads = 0;
 		fAnalysis.wait_object_count = 0;
 		fAnalysis.thread_wait_object_count = 0;
+		memset(fAnalysis.migrations, 0, sizeof(fAnalysis.migrations));
+		memset(fAnalysis.latency_histogram, 0,
+			sizeof(fAnalysis.latency_histogram));
 
 		size_t maxObjectSize = max_c(max_c(sizeof(Thread), sizeof(WaitObject)),
 			sizeof(ThreadWaitObject));
@@ -417,6 +426,30 @@ public:
 		return B_OK;
 	}
 
+	void AddLatency(Thread* thread, bigtime_t latency)
+	{
+		int32 bucket = 0;
+		while (bucket < SCHEDULING_ANALYSIS_HISTOGRAM_BUCKETS - 1
+			&& latency >= (bigtime_t)1 << bucket) {
+			bucket++;
+		}
+
+		thread->latency_histogram[bucket]++;
+		fAnalysis.latency_histogram[bucket]++;
+	}
+
+	void AddMigration(Thread* thread, int32 cpu)
+	{
+		if (thread->lastCPU >= 0 && thread->lastCPU != cpu) {
+			int32 distance = Scheduler::migration_distance(thread->lastCPU,
+				cpu);
+			thread->migrations[distance]++;
+			fAnalysis.migrations[distance]++;
+		}
+
+		thread->lastCPU = cpu;
+	}
+
 	int32 MissingWaitObjects() const
 	{
 		// Iterate through the hash table and count the wait objects that don't
@@ -645,8 +678,12 @@ analyze_scheduling(bigtime_t from, bigtime_t until,
 
 			bigtime_t diffTime = entry->Time() - thread->lastTime;
 
+			if (entry->ThreadID() != entry->PreviousThreadID())
+				manager.AddMigration(thread, entry->CPU());
+
 			if (thread->state == READY) {
 				// thread scheduled after having been woken up
+				manager.AddLatency(thread, diffTime);
 				thread->latencies++;
 				thread->total_latency += diffTime;
 				if (thread->min_latency < 0 || diffTime < thread->min_latency)
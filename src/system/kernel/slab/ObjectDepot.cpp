@@ -11,7 +11,9 @@
 
 #include <algorithm>
 
+#include <cpu.h>
 #include <int.h>
+#include <object_cache_defs.h>
 #include <slab/Slab.h>
 #include <smp.h>
 #include <util/AutoLock.h>
@@ -39,12 +41,32 @@ public:
 };
 
 
+// Only ever accessed by its CPU with interrupts disabled (or from an ICI
+// running on that CPU), so it doesn't need any locking.
 struct depot_cpu_store {
 	DepotMagazine*	loaded;
 	DepotMagazine*	previous;
+	uint64			hits;
+	uint64			misses;
+} CACHE_LINE_ALIGN;
+
+
+struct depot_flush_context {
+	object_depot*	depot;
+	DepotMagazine*	magazines;
 };
 
 
+// Magazine capacity adaption: every kAdaptInterval exchanges with the depot,
+// the capacity is increased by half if more than kContentionThreshold of
+// them found the depot lock already held, until kMaxMagazineCapacity is
+// reached. Larger magazines mean less frequent exchanges, at the cost of
+// more objects being cached per CPU.
+static const uint32 kAdaptInterval = 128;
+static const uint32 kContentionThreshold = 8;
+static const size_t kMaxMagazineCapacity = 256;
+
+
 RANGE_MARKER_FUNCTION_BEGIN(SlabObjectDepot)
 
 
@@ -131,16 +153,51 @@ empty_magazine(object_depot* depot, DepotMagazine* magazine, uint32 flags)
 }
 
 
+static inline void
+lock_depot(object_depot* depot)
+{
+	if (try_acquire_spinlock(&depot->inner_lock))
+		return;
+
+	acquire_spinlock(&depot->inner_lock);
+	depot->contention_count++;
+	depot->total_contentions++;
+}
+
+
+/*!	Must be called with the depot's inner lock held for every exchange. */
+static void
+count_exchange(object_depot* depot)
+{
+	depot->total_exchanges++;
+	if (++depot->exchange_count < kAdaptInterval)
+		return;
+
+	if (depot->contention_count > kContentionThreshold
+		&& depot->magazine_capacity < kMaxMagazineCapacity) {
+		depot->magazine_capacity = std::min(
+			depot->magazine_capacity + depot->magazine_capacity / 2 + 1,
+			kMaxMagazineCapacity);
+	}
+
+	depot->exchange_count = 0;
+	depot->contention_count = 0;
+}
+
+
 static bool
 exchange_with_full(object_depot* depot, DepotMagazine*& magazine)
 {
 	ASSERT(magazine->IsEmpty());
 
-	SpinLocker _(depot->inner_lock);
+	lock_depot(depot);
+	SpinLocker _(depot->inner_lock, true);
 
 	if (depot->full == NULL)
 		return false;
 
+	count_exchange(depot);
+
 	depot->full_count--;
 	depot->empty_count++;
 
@@ -152,17 +209,27 @@ exchange_with_full(object_depot* depot, DepotMagazine*& magazine)
 
 static bool
 exchange_with_empty(object_depot* depot, DepotMagazine*& magazine,
-	DepotMagazine*& freeMagazine)
+	DepotMagazine*& freeMagazine, DepotMagazine*& retiredMagazine)
 {
 	ASSERT(magazine == NULL || magazine->IsFull());
 
-	SpinLocker _(depot->inner_lock);
+	lock_depot(depot);
+	SpinLocker _(depot->inner_lock, true);
 
 	if (depot->empty == NULL)
 		return false;
 
 	depot->empty_count--;
 
+	if (depot->empty->round_count < depot->magazine_capacity) {
+		// The capacity has been increased since this magazine has been
+		// allocated -- let the caller replace it with a larger one.
+		retiredMagazine = _pop(depot->empty);
+		return false;
+	}
+
+	count_exchange(depot);
+
 	if (magazine != NULL) {
 		if (depot->full_count < depot->max_count) {
 			_push(depot->full, magazine);
@@ -180,7 +247,8 @@ exchange_with_empty(object_depot* depot, DepotMagazine*& magazine,
 static void
 push_empty_magazine(object_depot* depot, DepotMagazine* magazine)
 {
-	SpinLocker _(depot->inner_lock);
+	lock_depot(depot);
+	SpinLocker _(depot->inner_lock, true);
 
 	_push(depot->empty, magazine);
 	depot->empty_count++;
@@ -194,6 +262,26 @@ object_depot_cpu(object_depot* depot)
 }
 
 
+static void
+flush_cpu_store(void* _context, int cpu)
+{
+	depot_flush_context* context = (depot_flush_context*)_context;
+	depot_cpu_store& store = context->depot->stores[cpu];
+
+	SpinLocker _(context->depot->inner_lock);
+
+	if (store.loaded != NULL) {
+		_push(context->magazines, store.loaded);
+		store.loaded = NULL;
+	}
+
+	if (store.previous != NULL) {
+		_push(context->magazines, store.previous);
+		store.previous = NULL;
+	}
+}
+
+
 // #pragma mark - public API
 
 
@@ -207,21 +295,30 @@ object_depot_init(object_depot* depot, size_t capacity, size_t maxCount,
 	depot->full_count = depot->empty_count = 0;
 	depot->max_count = maxCount;
 	depot->magazine_capacity = capacity;
+	depot->initial_capacity = capacity;
+	depot->exchange_count = 0;
+	depot->contention_count = 0;
+	depot->total_exchanges = 0;
+	depot->total_contentions = 0;
 
-	rw_lock_init(&depot->outer_lock, "object depot");
 	B_INITIALIZE_SPINLOCK(&depot->inner_lock);
 
+	// The stores are cache line aligned, so that the CPUs don't contend for
+	// them.
 	int cpuCount = smp_get_num_cpus();
-	depot->stores = (depot_cpu_store*)slab_internal_alloc(
-		sizeof(depot_cpu_store) * cpuCount, flags);
-	if (depot->stores == NULL) {
-		rw_lock_destroy(&depot->outer_lock);
+	depot->stores_allocation = slab_internal_alloc(
+		sizeof(depot_cpu_store) * cpuCount + CACHE_LINE_SIZE - 1, flags);
+	if (depot->stores_allocation == NULL)
 		return B_NO_MEMORY;
-	}
+
+	depot->stores = (depot_cpu_store*)ROUNDUP(
+		(addr_t)depot->stores_allocation, CACHE_LINE_SIZE);
 
 	for (int i = 0; i < cpuCount; i++) {
 		depot->stores[i].loaded = NULL;
 		depot->stores[i].previous = NULL;
+		depot->stores[i].hits = 0;
+		depot->stores[i].misses = 0;
 	}
 
 	depot->cookie = cookie;
@@ -236,16 +333,13 @@ object_depot_destroy(object_depot* depot, uint32 flags)
 {
 	object_depot_make_empty(depot, flags);
 
-	slab_internal_free(depot->stores, flags);
-
-	rw_lock_destroy(&depot->outer_lock);
+	slab_internal_free(depot->stores_allocation, flags);
 }
 
 
 void*
 object_depot_obtain(object_depot* depot)
 {
-	ReadLocker readLocker(depot->outer_lock);
 	InterruptsLocker interruptsLocker;
 
 	depot_cpu_store* store = object_depot_cpu(depot);
@@ -257,6 +351,15 @@ object_depot_obtain(object_depot* depot)
 	// if it's not empty, or from the previous magazine if it's full
 	// and finally from the Slab if the magazine depot has no full magazines.
 
+	// The per-CPU store is only used with interrupts disabled, so the common
+	// case of the loaded magazine not being empty doesn't need any locking.
+	if (store->loaded != NULL && !store->loaded->IsEmpty()) {
+		store->hits++;
+		return store->loaded->Pop();
+	}
+
+	store->misses++;
+
 	if (store->loaded == NULL)
 		return NULL;
 
@@ -277,7 +380,6 @@ object_depot_obtain(object_depot* depot)
 void
 object_depot_store(object_depot* depot, void* object, uint32 flags)
 {
-	ReadLocker readLocker(depot->outer_lock);
 	InterruptsLocker interruptsLocker;
 
 	depot_cpu_store* store = object_depot_cpu(depot);
@@ -287,31 +389,46 @@ object_depot_store(object_depot* depot, void* object, uint32 flags)
 	// the magazine depot doesn't provide us with a new empty magazine
 	// we return the object directly to the slab.
 
+	if (store->loaded != NULL && store->loaded->Push(object)) {
+		store->hits++;
+		return;
+	}
+
+	store->misses++;
+
 	while (true) {
 		if (store->loaded != NULL && store->loaded->Push(object))
 			return;
 
 		DepotMagazine* freeMagazine = NULL;
+		DepotMagazine* retiredMagazine = NULL;
 		if ((store->previous != NULL && store->previous->IsEmpty())
-			|| exchange_with_empty(depot, store->previous, freeMagazine)) {
+			|| exchange_with_empty(depot, store->previous, freeMagazine,
+				retiredMagazine)) {
 			std::swap(store->loaded, store->previous);
 
 			if (freeMagazine != NULL) {
 				// Free the magazine that didn't have space in the list
 				interruptsLocker.Unlock();
-				readLocker.Unlock();
 
 				empty_magazine(depot, freeMagazine, flags);
 
-				readLocker.Lock();
 				interruptsLocker.Lock();
 
 				store = object_depot_cpu(depot);
 			}
+		} else if (retiredMagazine != NULL) {
+			// free the outgrown magazine, and try again
+			interruptsLocker.Unlock();
+
+			free_magazine(retiredMagazine, flags);
+
+			interruptsLocker.Lock();
+
+			store = object_depot_cpu(depot);
 		} else {
 			// allocate a new empty magazine
 			interruptsLocker.Unlock();
-			readLocker.Unlock();
 
 			DepotMagazine* magazine = alloc_magazine(depot, flags);
 			if (magazine == NULL) {
@@ -319,7 +436,6 @@ object_depot_store(object_depot* depot, void* object, uint32 flags)
 				return;
 			}
 
-			readLocker.Lock();
 			interruptsLocker.Lock();
 
 			push_empty_magazine(depot, magazine);
@@ -332,36 +448,30 @@ object_depot_store(object_depot* depot, void* object, uint32 flags)
 void
 object_depot_make_empty(object_depot* depot, uint32 flags)
 {
-	WriteLocker writeLocker(depot->outer_lock);
+	// collect the store magazines -- since the stores are accessed without
+	// locking, every CPU has to do that for its own store
 
-	// collect the store magazines
+	depot_flush_context context;
+	context.depot = depot;
+	context.magazines = NULL;
 
-	DepotMagazine* storeMagazines = NULL;
+	call_all_cpus_sync(&flush_cpu_store, &context);
 
-	int cpuCount = smp_get_num_cpus();
-	for (int i = 0; i < cpuCount; i++) {
-		depot_cpu_store& store = depot->stores[i];
-
-		if (store.loaded) {
-			_push(storeMagazines, store.loaded);
-			store.loaded = NULL;
-		}
-
-		if (store.previous) {
-			_push(storeMagazines, store.previous);
-			store.previous = NULL;
-		}
-	}
+	DepotMagazine* storeMagazines = context.magazines;
 
 	// detach the depot's full and empty magazines
 
+	SpinLocker locker(depot->inner_lock);
+
 	DepotMagazine* fullMagazines = depot->full;
 	depot->full = NULL;
+	depot->full_count = 0;
 
 	DepotMagazine* emptyMagazines = depot->empty;
 	depot->empty = NULL;
+	depot->empty_count = 0;
 
-	writeLocker.Unlock();
+	locker.Unlock();
 
 	// free all magazines
 
@@ -378,25 +488,40 @@ object_depot_make_empty(object_depot* depot, uint32 flags)
 
 #if PARANOID_KERNEL_FREE
 
+struct depot_search_context {
+	object_depot*	depot;
+	void*			object;
+	bool			found;
+};
+
+
+static void
+search_cpu_store(void* _context, int cpu)
+{
+	depot_search_context* context = (depot_search_context*)_context;
+	depot_cpu_store& store = context->depot->stores[cpu];
+
+	if ((store.loaded != NULL && store.loaded->ContainsObject(context->object))
+		|| (store.previous != NULL
+			&& store.previous->ContainsObject(context->object))) {
+		context->found = true;
+	}
+}
+
+
 bool
 object_depot_contains_object(object_depot* depot, void* object)
 {
-	WriteLocker writeLocker(depot->outer_lock);
+	depot_search_context context;
+	context.depot = depot;
+	context.object = object;
+	context.found = false;
 
-	int cpuCount = smp_get_num_cpus();
-	for (int i = 0; i < cpuCount; i++) {
-		depot_cpu_store& store = depot->stores[i];
+	call_all_cpus_sync(&search_cpu_store, &context);
+	if (context.found)
+		return true;
 
-		if (store.loaded != NULL && !store.loaded->IsEmpty()) {
-			if (store.loaded->ContainsObject(object))
-				return true;
-		}
-
-		if (store.previous != NULL && !store.previous->IsEmpty()) {
-			if (store.previous->ContainsObject(object))
-				return true;
-		}
-	}
+	SpinLocker _(depot->inner_lock);
 
 	for (DepotMagazine* magazine = depot->full; magazine != NULL;
 			magazine = magazine->next) {
@@ -410,6 +535,29 @@ object_depot_contains_object(object_depot* depot, void* object)
 #endif // PARANOID_KERNEL_FREE
 
 
+/*!	Doesn't lock anything, so it can also be used from the kernel debugger.
+	The values are only statistics, after all.
+*/
+void
+object_depot_get_stats(object_depot* depot, object_cache_stats* stats)
+{
+	stats->depot_hits = 0;
+	stats->depot_misses = 0;
+
+	int cpuCount = smp_get_num_cpus();
+	for (int i = 0; i < cpuCount; i++) {
+		stats->depot_hits += depot->stores[i].hits;
+		stats->depot_misses += depot->stores[i].misses;
+	}
+
+	stats->magazine_capacity = depot->magazine_capacity;
+	stats->initial_magazine_capacity = depot->initial_capacity;
+	stats->full_magazines = depot->full_count;
+	stats->exchanges = depot->total_exchanges;
+	stats->contentions = depot->total_contentions;
+}
+
+
 // #pragma mark - private kernel API
 
 
@@ -419,7 +567,10 @@ dump_object_depot(object_depot* depot)
 	kprintf("  full:     %p, count %lu\n", depot->full, depot->full_count);
 	kprintf("  empty:    %p, count %lu\n", depot->empty, depot->empty_count);
 	kprintf("  max full: %lu\n", depot->max_count);
-	kprintf("  capacity: %lu\n", depot->magazine_capacity);
+	kprintf("  capacity: %lu (initially %lu)\n", depot->magazine_capacity,
+		depot->initial_capacity);
+	kprintf("  exchanges: %" B_PRIu64 ", contended %" B_PRIu64 "\n",
+		depot->total_exchanges, depot->total_contentions);
 	kprintf("  stores:\n");
 
 	int cpuCount = smp_get_num_cpus();
@@ -427,6 +578,8 @@ dump_object_depot(object_depot* depot)
 	for (int i = 0; i < cpuCount; i++) {
 		kprintf("  [%d] loaded:   %p\n", i, depot->stores[i].loaded);
 		kprintf("      previous: %p\n", depot->stores[i].previous);
+		kprintf("      hits:     %" B_PRIu64 ", misses %" B_PRIu64 "\n",
+			depot->stores[i].hits, depot->stores[i].misses);
 	}
 }
 
@@ -20,6 +20,7 @@
 #include <elf.h>
 #include <kernel.h>
 #include <low_resource_manager.h>
+#include <object_cache_defs.h>
 #include <slab/ObjectDepot.h>
 #include <smp.h>
 #include <tracing.h>
@@ -255,9 +256,45 @@ dump_slab(::slab* slab)
 }
 
 
+static void
+dump_depot_stats()
+{
+	kprintf("%*s %22s %7s %12s %12s %10s %10s\n",
+		B_PRINTF_POINTER_WIDTH + 2, "address", "name", "magcap", "hits",
+		"misses", "exchanges", "contended");
+
+	ObjectCacheList::Iterator it = sObjectCaches.GetIterator();
+
+	while (it.HasNext()) {
+		ObjectCache* cache = it.Next();
+		if ((cache->flags & CACHE_NO_DEPOT) != 0)
+			continue;
+
+		object_cache_stats stats;
+		object_depot_get_stats(&cache->depot, &stats);
+
+		kprintf("%p %22s %3" B_PRIu32 "/%-3" B_PRIu32 " %12" B_PRIu64
+			" %12" B_PRIu64 " %10" B_PRIu64 " %10" B_PRIu64 "\n", cache,
+			cache->name, stats.magazine_capacity,
+			stats.initial_magazine_capacity, stats.depot_hits,
+			stats.depot_misses, stats.exchanges, stats.contentions);
+	}
+}
+
+
 static int
 dump_slabs(int argc, char* argv[])
 {
+	if (argc > 1) {
+		if (argc == 2 && strcmp(argv[1], "-d") == 0) {
+			dump_depot_stats();
+			return 0;
+		}
+
+		print_debugger_command_usage(argv[0]);
+		return 0;
+	}
+
 	kprintf("%*s %22s %8s %8s %8s %6s %8s %8s %8s\n",
 		B_PRINTF_POINTER_WIDTH + 2, "address", "name", "objsize", "align",
 		"usage", "empty", "usedobj", "total", "flags");
@@ -1331,6 +1368,56 @@ object_cache_get_usage(object_cache* cache, size_t* _allocatedMemory)
 }
 
 
+status_t
+_user_get_next_object_cache_stats(int32* _cookie, object_cache_stats* _stats)
+{
+	int32 cookie;
+	if (_cookie == NULL || _stats == NULL || !IS_USER_ADDRESS(_cookie)
+		|| !IS_USER_ADDRESS(_stats)
+		|| user_memcpy(&cookie, _cookie, sizeof(cookie)) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	if (cookie < 0)
+		return B_BAD_VALUE;
+
+	object_cache_stats stats;
+	memset(&stats, 0, sizeof(stats));
+
+	MutexLocker cacheListLocker(sObjectCacheListLock);
+
+	ObjectCache* cache = sObjectCaches.Head();
+	for (int32 i = 0; cache != NULL && i < cookie; i++)
+		cache = sObjectCaches.GetNext(cache);
+
+	if (cache == NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	strlcpy(stats.name, cache->name, sizeof(stats.name));
+	stats.object_size = cache->object_size;
+	stats.flags = cache->flags;
+
+	MutexLocker cacheLocker(cache->lock);
+	stats.usage = cache->usage;
+	stats.used_objects = cache->used_count;
+	stats.total_objects = cache->total_objects;
+	cacheLocker.Unlock();
+
+	if ((cache->flags & CACHE_NO_DEPOT) == 0)
+		object_depot_get_stats(&cache->depot, &stats);
+
+	cacheListLocker.Unlock();
+
+	cookie++;
+	if (user_memcpy(_stats, &stats, sizeof(stats)) != B_OK
+		|| user_memcpy(_cookie, &cookie, sizeof(cookie)) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	return B_OK;
+}
+
+
 void
 slab_init(kernel_args* args)
 {
@@ -1347,7 +1434,13 @@ slab_init_post_area()
 {
 	MemoryManager::InitPostArea();
 
-	add_debugger_command("slabs", dump_slabs, "list all object caches");
+	add_debugger_command_etc("slabs", dump_slabs, "list all object caches",
+		"[ -d ]\n"
+		"Lists all object caches. If \"-d\" is given, the statistics of their\n"
+		"object depots are printed instead: the current and initial magazine\n"
+		"capacity, how many allocations and frees could (not) be served by\n"
+		"the per-CPU magazines, the number of magazine exchanges with the\n"
+		"depot, and how often its lock was contended.\n", 0);
 	add_debugger_command("slab_cache", dump_cache_info,
 		"dump information about a specific object cache");
 	add_debugger_command("slab_depot", dump_object_depot,
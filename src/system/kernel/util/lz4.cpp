@@ -0,0 +1,257 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	A simple greedy compressor for the LZ4 block format, and a decompressor
+	that checks all lengths and offsets, so that it is safe to use with
+	corrupted input.
+
+	A block is a sequence of (literals, match) pairs. Each starts with a
+	token byte, whose upper nibble is the number of literals and lower
+	nibble the match length minus 4; a nibble of 15 is continued by bytes
+	that are added to it until one is not 255. The literals follow, then
+	the little endian 16 bit offset of the match. The last sequence only
+	consists of literals, and covers at least the last 5 bytes.
+*/
+
+
+#include <util/lz4.h>
+
+#include <string.h>
+
+
+static const size_t kMinMatch = 4;
+static const size_t kLastLiterals = 5;
+static const size_t kMatchFindLimit = 12;
+	// a match must not start within the last 12 bytes
+static const size_t kMaxOffset = 65535;
+static const uint32 kHashBits = 12;
+
+
+static inline uint32
+read32(const uint8* buffer)
+{
+	uint32 value;
+	memcpy(&value, buffer, sizeof(value));
+	return value;
+}
+
+
+static inline uint32
+hash_sequence(uint32 sequence)
+{
+	return (sequence * 2654435761U) >> (32 - kHashBits);
+}
+
+
+/*!	Writes a length that didn't fit into its token nibble. Returns \c NULL
+	if the output buffer is too small.
+*/
+static inline uint8*
+write_length(uint8* output, const uint8* outputEnd, size_t length)
+{
+	while (length >= 255) {
+		if (output >= outputEnd)
+			return NULL;
+		*output++ = 255;
+		length -= 255;
+	}
+
+	if (output >= outputEnd)
+		return NULL;
+	*output++ = (uint8)length;
+	return output;
+}
+
+
+static inline bool
+read_length(const uint8*& input, const uint8* inputEnd, size_t& length)
+{
+	uint8 byte;
+	do {
+		if (input >= inputEnd)
+			return false;
+		byte = *input++;
+		length += byte;
+	} while (byte == 255);
+
+	return true;
+}
+
+
+/*!	Writes one sequence. The match is omitted if \a matchLength is 0.
+*/
+static uint8*
+write_sequence(uint8* output, const uint8* outputEnd, const uint8* literals,
+	size_t literalLength, size_t offset, size_t matchLength)
+{
+	if (output >= outputEnd)
+		return NULL;
+
+	uint8* token = output++;
+	size_t matchCode = matchLength > 0 ? matchLength - kMinMatch : 0;
+
+	*token = (uint8)((literalLength >= 15 ? 15 : literalLength) << 4);
+	if (literalLength >= 15) {
+		output = write_length(output, outputEnd, literalLength - 15);
+		if (output == NULL)
+			return NULL;
+	}
+
+	if ((size_t)(outputEnd - output) < literalLength)
+		return NULL;
+	memcpy(output, literals, literalLength);
+	output += literalLength;
+
+	if (matchLength == 0)
+		return output;
+
+	if (outputEnd - output < 2)
+		return NULL;
+	*output++ = (uint8)offset;
+	*output++ = (uint8)(offset >> 8);
+
+	*token |= (uint8)(matchCode >= 15 ? 15 : matchCode);
+	if (matchCode >= 15)
+		output = write_length(output, outputEnd, matchCode - 15);
+
+	return output;
+}
+
+
+// #pragma mark -
+
+
+/*!	Compresses \a source into \a dest.
+	\a workMemory must point to \c LZ4_WORK_MEMORY_SIZE bytes.
+	Returns the size of the compressed data, or \c B_BUFFER_OVERFLOW if it
+	doesn't fit into \a destSize bytes.
+*/
+ssize_t
+lz4_compress(const void* _source, size_t sourceSize, void* _dest,
+	size_t destSize, void* workMemory)
+{
+	if (sourceSize > LZ4_MAX_INPUT_SIZE)
+		return B_BAD_VALUE;
+
+	const uint8* source = (const uint8*)_source;
+	const uint8* sourceEnd = source + sourceSize;
+	uint8* dest = (uint8*)_dest;
+	uint8* output = dest;
+	const uint8* outputEnd = dest + destSize;
+
+	uint16* table = (uint16*)workMemory;
+	memset(table, 0, LZ4_WORK_MEMORY_SIZE);
+
+	const uint8* anchor = source;
+	if (sourceSize > kMatchFindLimit) {
+		const uint8* matchLimit = sourceEnd - kMatchFindLimit;
+		const uint8* input = source + 1;
+
+		while (input < matchLimit) {
+			uint32 sequence = read32(input);
+			uint32 hash = hash_sequence(sequence);
+			const uint8* match = source + table[hash];
+			table[hash] = (uint16)(input - source);
+
+			if (match >= input || (size_t)(input - match) > kMaxOffset
+				|| read32(match) != sequence) {
+				input++;
+				continue;
+			}
+
+			// extend the match backwards and forwards
+			while (input > anchor && match > source && input[-1] == match[-1]) {
+				input--;
+				match--;
+			}
+
+			const uint8* matchEnd = input + kMinMatch;
+			const uint8* reference = match + kMinMatch;
+			while (matchEnd < sourceEnd - kLastLiterals
+				&& *matchEnd == *reference) {
+				matchEnd++;
+				reference++;
+			}
+
+			output = write_sequence(output, outputEnd, anchor, input - anchor,
+				input - match, matchEnd - input);
+			if (output == NULL)
+				return B_BUFFER_OVERFLOW;
+
+			anchor = input = matchEnd;
+		}
+	}
+
+	output = write_sequence(output, outputEnd, anchor, sourceEnd - anchor, 0,
+		0);
+	if (output == NULL)
+		return B_BUFFER_OVERFLOW;
+
+	return output - dest;
+}
+
+
+/*!	Decompresses \a source into \a dest.
+	Returns the size of the decompressed data, \c B_BUFFER_OVERFLOW if it
+	doesn't fit into \a destSize bytes, or \c B_BAD_DATA if \a source is not
+	a valid LZ4 block.
+*/
+ssize_t
+lz4_decompress(const void* _source, size_t sourceSize, void* _dest,
+	size_t destSize)
+{
+	const uint8* input = (const uint8*)_source;
+	const uint8* inputEnd = input + sourceSize;
+	uint8* dest = (uint8*)_dest;
+	uint8* output = dest;
+	const uint8* outputEnd = dest + destSize;
+
+	while (input < inputEnd) {
+		uint8 token = *input++;
+
+		// literals
+		size_t length = token >> 4;
+		if (length == 15 && !read_length(input, inputEnd, length))
+			return B_BAD_DATA;
+
+		if ((size_t)(inputEnd - input) < length)
+			return B_BAD_DATA;
+		if ((size_t)(outputEnd - output) < length)
+			return B_BUFFER_OVERFLOW;
+
+		memcpy(output, input, length);
+		input += length;
+		output += length;
+
+		if (input == inputEnd) {
+			// the last sequence doesn't have a match
+			break;
+		}
+
+		// match
+		if (inputEnd - input < 2)
+			return B_BAD_DATA;
+		size_t offset = input[0] | ((size_t)input[1] << 8);
+		input += 2;
+		if (offset == 0 || offset > (size_t)(output - dest))
+			return B_BAD_DATA;
+
+		length = token & 0xf;
+		if (length == 15 && !read_length(input, inputEnd, length))
+			return B_BAD_DATA;
+		length += kMinMatch;
+
+		if ((size_t)(outputEnd - output) < length)
+			return B_BUFFER_OVERFLOW;
+
+		// the match may overlap the output, so copy it byte by byte
+		const uint8* match = output - offset;
+		while (length-- > 0)
+			*output++ = *match++;
+	}
+
+	return output - dest;
+}
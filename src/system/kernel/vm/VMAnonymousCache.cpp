@@ -30,6 +30,7 @@
 
 #include <arch_config.h>
 #include <boot_device.h>
+#include <condition_variable.h>
 #include <disk_device_manager/KDiskDevice.h>
 #include <disk_device_manager/KDiskDeviceManager.h>
 #include <disk_device_manager/KDiskSystem.h>
@@ -51,6 +52,7 @@
 #include <util/DoublyLinkedList.h>
 #include <util/OpenHashTable.h>
 #include <util/RadixBitmap.h>
+#include <util/lz4.h>
 #include <vfs.h>
 #include <vm/vm.h>
 #include <vm/vm_page.h>
@@ -85,6 +87,16 @@
 #define SWAP_BLOCK_SHIFT 5		/* 1 << SWAP_BLOCK_SHIFT == SWAP_BLOCK_PAGES */
 #define SWAP_BLOCK_MASK  (SWAP_BLOCK_PAGES - 1)
 
+// Compressed swap pages are kept in memory; their swap slots start here,
+// above the slots of all swap files.
+#define COMPRESSED_SWAP_FIRST_SLOT		0x80000000
+
+// number of compressed swap slots per page of compressed swap memory
+#define COMPRESSED_SWAP_SLOTS_PER_PAGE	4
+
+// pages that don't compress to this size are written to the swap file
+#define COMPRESSED_SWAP_MAX_PAGE_SIZE	(B_PAGE_SIZE * 3 / 4)
+
 
 static const char* const kDefaultSwapPath = "/var/swap";
 
@@ -159,6 +171,77 @@ static mutex sAvailSwapSpaceLock;
 static object_cache* sSwapBlockCache;
 
 
+struct compressed_page : DoublyLinkedListLinkImpl<compressed_page> {
+	VMAnonymousCache*	cache;
+	off_t				page_index;
+	swap_addr_t			slot;
+	uint16				size;
+		// of the compressed data, 0 if the page is filled with "fill"
+	bool				writing_back;
+	bool				freed;
+	uint32				fill;
+	uint8				data[0];
+
+	size_t AllocationSize() const
+	{
+		return sizeof(compressed_page) + size;
+	}
+};
+
+typedef DoublyLinkedList<compressed_page> CompressedPageList;
+
+/*!	The compressed swap is an in-memory tier in front of the swap files.
+	Pages that are written out go there first, as long as they compress
+	well, and the memory limit isn't reached. The writer thread writes the
+	least recently stored pages back to the swap file when the memory use
+	gets close to the limit.
+	The compressed pages use swap slots of their own, so that they can be
+	managed in the swap blocks just like the pages in the swap files.
+*/
+struct compressed_swap {
+	mutex				lock;
+		// protects everything but the buffers and the statistics
+	radix_bitmap*		bmp;
+	compressed_page**	pages;
+	swap_addr_t			slot_count;
+	CompressedPageList	lru;
+		// least recently stored first
+	size_t				max_size;
+	size_t				used_size;
+	size_t				write_back_size;
+		// the writer starts when more than this is used
+	size_t				low_size;
+		// and writes back until no more than this is used
+	ConditionVariable	writer_condition;
+	thread_id			writer_thread;
+
+	mutex				store_lock;
+		// protects store_buffer, compression_buffer, and work_memory
+	uint8*				store_buffer;
+	uint8*				compression_buffer;
+	void*				work_memory;
+	mutex				load_lock;
+		// protects load_buffer
+	uint8*				load_buffer;
+	uint8*				writer_buffer;
+
+	// statistics
+	uint32				stored_pages;
+	uint32				same_filled_pages;
+	int64				stores;
+	int64				rejected_stores;
+	int64				full_stores;
+	int64				loads;
+	int64				load_time;
+	int64				written_back_pages;
+	int64				swap_file_reads;
+	int64				swap_file_read_time;
+};
+
+static compressed_swap sCompressedSwap;
+static bool sCompressedSwapEnabled = false;
+
+
 #if SWAP_TRACING
 namespace SwapTracing {
 
@@ -257,6 +340,36 @@ dump_swap_info(int argc, char** argv)
 	kprintf("used:      %9" B_PRIu32 "\n", totalSwapPages - freeSwapPages);
 	kprintf("free:      %9" B_PRIu32 "\n", freeSwapPages);
 
+	const compressed_swap& compressed = sCompressedSwap;
+	kprintf("\n");
+	kprintf("swap file reads:  %9" B_PRId64 ", average latency %" B_PRId64
+		" us\n", compressed.swap_file_reads, compressed.swap_file_reads > 0
+			? compressed.swap_file_read_time / compressed.swap_file_reads : 0);
+
+	if (!sCompressedSwapEnabled)
+		return 0;
+
+	uint64 uncompressedSize = (uint64)compressed.stored_pages * B_PAGE_SIZE;
+	uint64 ratio = compressed.used_size > 0
+		? uncompressedSize * 100 / compressed.used_size : 0;
+
+	kprintf("\ncompressed swap:\n");
+	kprintf("pages:            %9" B_PRIu32 " (%" B_PRIu32 " same filled), %"
+		B_PRIu32 " slots\n", compressed.stored_pages,
+		compressed.same_filled_pages, compressed.slot_count);
+	kprintf("memory:           %9" B_PRIuSIZE " KB of %" B_PRIuSIZE " KB\n",
+		compressed.used_size / 1024, compressed.max_size / 1024);
+	kprintf("ratio:            %6" B_PRIu64 ".%02" B_PRIu64 "\n", ratio / 100,
+		ratio % 100);
+	kprintf("stores:           %9" B_PRId64 " (%" B_PRId64 " incompressible, %"
+		B_PRId64 " when full)\n", compressed.stores,
+		compressed.rejected_stores, compressed.full_stores);
+	kprintf("loads:            %9" B_PRId64 ", average latency %" B_PRId64
+		" us\n", compressed.loads, compressed.loads > 0
+			? compressed.load_time / compressed.loads : 0);
+	kprintf("written back:     %9" B_PRId64 "\n",
+		compressed.written_back_pages);
+
 	return 0;
 }
 
@@ -330,12 +443,28 @@ find_swap_file(swap_addr_t slotIndex)
 }
 
 
+static inline bool
+is_compressed_swap_slot(swap_addr_t slotIndex)
+{
+	return slotIndex != SWAP_SLOT_NONE
+		&& slotIndex >= COMPRESSED_SWAP_FIRST_SLOT;
+}
+
+
+static void compressed_swap_free(swap_addr_t slotIndex, uint32 count);
+
+
 static void
 swap_slot_dealloc(swap_addr_t slotIndex, uint32 count)
 {
 	if (slotIndex == SWAP_SLOT_NONE)
 		return;
 
+	if (is_compressed_swap_slot(slotIndex)) {
+		compressed_swap_free(slotIndex, count);
+		return;
+	}
+
 	mutex_lock(&sSwapFileListLock);
 	swap_file* swapFile = find_swap_file(slotIndex);
 	slotIndex -= swapFile->first_slot;
@@ -394,6 +523,381 @@ swap_hash_resizer(void*, int)
 }
 
 
+// #pragma mark - compressed swap
+
+
+static void
+compressed_swap_release(compressed_page* page)
+{
+	sCompressedSwap.used_size -= page->AllocationSize();
+	sCompressedSwap.stored_pages--;
+	if (page->size == 0)
+		sCompressedSwap.same_filled_pages--;
+
+	free_etc(page, HEAP_DONT_WAIT_FOR_MEMORY | HEAP_DONT_LOCK_KERNEL_SPACE);
+}
+
+
+/*!	Tries to store the page in compressed swap. Returns its new swap slot,
+	or \c SWAP_SLOT_NONE, if it has to go to the swap file instead.
+*/
+static swap_addr_t
+compressed_swap_store(VMAnonymousCache* cache, off_t pageIndex,
+	const generic_io_vec& vec, uint32 flags)
+{
+	if (!sCompressedSwapEnabled || vec.length != B_PAGE_SIZE)
+		return SWAP_SLOT_NONE;
+
+	MutexLocker bufferLocker(sCompressedSwap.store_lock);
+
+	uint8* buffer = sCompressedSwap.store_buffer;
+	if ((flags & B_PHYSICAL_IO_REQUEST) != 0) {
+		if (vm_memcpy_from_physical(buffer, vec.base, B_PAGE_SIZE, false)
+				!= B_OK) {
+			return SWAP_SLOT_NONE;
+		}
+	} else
+		memcpy(buffer, (void*)(addr_t)vec.base, B_PAGE_SIZE);
+
+	// pages filled with the same value don't need to be compressed
+	const uint32* words = (const uint32*)buffer;
+	uint32 fill = words[0];
+	bool sameFilled = true;
+	for (size_t i = 1; i < B_PAGE_SIZE / sizeof(uint32); i++) {
+		if (words[i] != fill) {
+			sameFilled = false;
+			break;
+		}
+	}
+
+	ssize_t size = 0;
+	if (!sameFilled) {
+		size = lz4_compress(buffer, B_PAGE_SIZE,
+			sCompressedSwap.compression_buffer, COMPRESSED_SWAP_MAX_PAGE_SIZE,
+			sCompressedSwap.work_memory);
+		if (size <= 0) {
+			atomic_add64(&sCompressedSwap.rejected_stores, 1);
+			return SWAP_SLOT_NONE;
+		}
+	}
+
+	compressed_page* page = (compressed_page*)malloc_etc(
+		sizeof(compressed_page) + size,
+		HEAP_DONT_WAIT_FOR_MEMORY | HEAP_DONT_LOCK_KERNEL_SPACE);
+	if (page == NULL)
+		return SWAP_SLOT_NONE;
+
+	page->cache = cache;
+	page->page_index = pageIndex;
+	page->size = size;
+	page->writing_back = false;
+	page->freed = false;
+	page->fill = fill;
+	memcpy(page->data, sCompressedSwap.compression_buffer, size);
+
+	bufferLocker.Unlock();
+
+	MutexLocker locker(sCompressedSwap.lock);
+
+	swap_addr_t slotIndex = SWAP_SLOT_NONE;
+	if (sCompressedSwap.used_size + page->AllocationSize()
+			<= sCompressedSwap.max_size) {
+		slotIndex = radix_bitmap_alloc(sCompressedSwap.bmp, 1);
+	}
+
+	if (slotIndex == SWAP_SLOT_NONE) {
+		// we're full, make room for the next pages
+		sCompressedSwap.full_stores++;
+		sCompressedSwap.writer_condition.NotifyAll();
+		locker.Unlock();
+
+		free_etc(page, HEAP_DONT_WAIT_FOR_MEMORY | HEAP_DONT_LOCK_KERNEL_SPACE);
+		return SWAP_SLOT_NONE;
+	}
+
+	page->slot = slotIndex + COMPRESSED_SWAP_FIRST_SLOT;
+	sCompressedSwap.pages[slotIndex] = page;
+	sCompressedSwap.lru.Add(page);
+	sCompressedSwap.used_size += page->AllocationSize();
+	sCompressedSwap.stored_pages++;
+	if (page->size == 0)
+		sCompressedSwap.same_filled_pages++;
+	sCompressedSwap.stores++;
+
+	if (sCompressedSwap.used_size > sCompressedSwap.write_back_size)
+		sCompressedSwap.writer_condition.NotifyAll();
+
+	return page->slot;
+}
+
+
+/*!	Reads the page from compressed swap.
+	Returns \c B_ENTRY_NOT_FOUND if the page is not at the given slot
+	anymore, as it has been written back to the swap file in the meantime.
+*/
+static status_t
+compressed_swap_load(VMAnonymousCache* cache, off_t pageIndex,
+	swap_addr_t slotIndex, const generic_io_vec& vec, uint32 flags)
+{
+	if (vec.length != B_PAGE_SIZE)
+		return B_BAD_VALUE;
+
+	bigtime_t startTime = system_time();
+
+	MutexLocker bufferLocker(sCompressedSwap.load_lock);
+	MutexLocker locker(sCompressedSwap.lock);
+
+	compressed_page* page
+		= sCompressedSwap.pages[slotIndex - COMPRESSED_SWAP_FIRST_SLOT];
+	if (page == NULL || page->cache != cache || page->page_index != pageIndex)
+		return B_ENTRY_NOT_FOUND;
+
+	uint8* buffer = sCompressedSwap.load_buffer;
+	if (page->size == 0) {
+		uint32* words = (uint32*)buffer;
+		for (size_t i = 0; i < B_PAGE_SIZE / sizeof(uint32); i++)
+			words[i] = page->fill;
+	} else if (lz4_decompress(page->data, page->size, buffer, B_PAGE_SIZE)
+			!= B_PAGE_SIZE) {
+		panic("compressed_swap_load(): corrupt page %p at slot %#" B_PRIx32
+			"\n", page, slotIndex);
+		return B_BAD_DATA;
+	}
+
+	locker.Unlock();
+
+	status_t status = B_OK;
+	if ((flags & B_PHYSICAL_IO_REQUEST) != 0)
+		status = vm_memcpy_to_physical(vec.base, buffer, B_PAGE_SIZE, false);
+	else
+		memcpy((void*)(addr_t)vec.base, buffer, B_PAGE_SIZE);
+
+	bufferLocker.Unlock();
+
+	atomic_add64(&sCompressedSwap.loads, 1);
+	atomic_add64(&sCompressedSwap.load_time, system_time() - startTime);
+	return status;
+}
+
+
+static void
+compressed_swap_free(swap_addr_t slotIndex, uint32 count)
+{
+	MutexLocker locker(sCompressedSwap.lock);
+
+	for (uint32 i = 0; i < count; i++) {
+		swap_addr_t index = slotIndex + i - COMPRESSED_SWAP_FIRST_SLOT;
+		compressed_page* page = sCompressedSwap.pages[index];
+		if (page == NULL) {
+			panic("compressed_swap_free(): slot %#" B_PRIx32 " is not used\n",
+				slotIndex + i);
+			continue;
+		}
+
+		sCompressedSwap.pages[index] = NULL;
+		radix_bitmap_dealloc(sCompressedSwap.bmp, index, 1);
+
+		if (page->writing_back) {
+			// the writer will free it
+			page->freed = true;
+			continue;
+		}
+
+		sCompressedSwap.lru.Remove(page);
+		compressed_swap_release(page);
+	}
+}
+
+
+/*!	Called when the page stored at the slot moves to another cache or page
+	index.
+*/
+static void
+compressed_swap_set_owner(swap_addr_t slotIndex, VMAnonymousCache* cache,
+	off_t pageIndex)
+{
+	if (!is_compressed_swap_slot(slotIndex))
+		return;
+
+	MutexLocker locker(sCompressedSwap.lock);
+
+	compressed_page* page
+		= sCompressedSwap.pages[slotIndex - COMPRESSED_SWAP_FIRST_SLOT];
+	if (page != NULL) {
+		page->cache = cache;
+		page->page_index = pageIndex;
+	}
+}
+
+
+/*!	Writes the least recently stored page back to the swap file, and
+	replaces its slot in the swap block of its cache.
+	Returns \c B_BUSY if the page is being moved to another cache, and
+	\c B_ENTRY_NOT_FOUND if there is no page to write back; in both cases
+	the caller should just try again later. A page that can't be
+	decompressed is not written back, and \c B_BAD_DATA is returned.
+*/
+static status_t
+compressed_swap_write_back()
+{
+	MutexLocker locker(sCompressedSwap.lock);
+
+	compressed_page* page = sCompressedSwap.lru.RemoveHead();
+	if (page == NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	page->writing_back = true;
+	swap_addr_t compressedSlot = page->slot;
+
+	uint8* buffer = sCompressedSwap.writer_buffer;
+	if (page->size == 0) {
+		uint32* words = (uint32*)buffer;
+		for (size_t i = 0; i < B_PAGE_SIZE / sizeof(uint32); i++)
+			words[i] = page->fill;
+	} else if (lz4_decompress(page->data, page->size, buffer, B_PAGE_SIZE)
+			!= B_PAGE_SIZE) {
+		// don't write garbage to the swap file; the page stays where it is
+		page->writing_back = false;
+		sCompressedSwap.lru.Add(page);
+		return B_BAD_DATA;
+	}
+
+	locker.Unlock();
+
+	// The swap file always has room for the page, since compressed pages
+	// count against the same swap space reservation.
+	swap_addr_t slotIndex = swap_slot_alloc(1);
+	status_t status = B_NO_MEMORY;
+	if (slotIndex != SWAP_SLOT_NONE) {
+		swap_file* swapFile = find_swap_file(slotIndex);
+		off_t pos = (off_t)(slotIndex - swapFile->first_slot) * B_PAGE_SIZE;
+
+		generic_io_vec vec;
+		vec.base = (generic_addr_t)buffer;
+		vec.length = B_PAGE_SIZE;
+		generic_size_t length = B_PAGE_SIZE;
+		status = vfs_write_pages(swapFile->vnode, swapFile->cookie, pos, &vec,
+			1, 0, &length);
+	}
+
+	WriteLocker hashLocker(sSwapHashLock);
+	locker.Lock();
+
+	page->writing_back = false;
+
+	if (page->freed) {
+		// the page has been freed in the meantime
+		compressed_swap_release(page);
+		status = B_OK;
+	} else if (status == B_OK) {
+		swap_hash_key key = { page->cache, page->page_index };
+		swap_block* swapBlock = sSwapHashTable.Lookup(key);
+		swap_addr_t blockIndex = page->page_index & SWAP_BLOCK_MASK;
+		if (swapBlock != NULL
+			&& swapBlock->swap_slots[blockIndex] == compressedSlot) {
+			swapBlock->swap_slots[blockIndex] = slotIndex;
+
+			swap_addr_t index = compressedSlot - COMPRESSED_SWAP_FIRST_SLOT;
+			sCompressedSwap.pages[index] = NULL;
+			radix_bitmap_dealloc(sCompressedSwap.bmp, index, 1);
+			compressed_swap_release(page);
+			sCompressedSwap.written_back_pages++;
+			return B_OK;
+		}
+
+		// the page is just being moved to another cache, try again later
+		sCompressedSwap.lru.Add(page);
+		status = B_BUSY;
+	} else
+		sCompressedSwap.lru.Add(page);
+
+	locker.Unlock();
+	hashLocker.Unlock();
+
+	swap_slot_dealloc(slotIndex, 1);
+	return status;
+}
+
+
+static status_t
+compressed_swap_writer(void*)
+{
+	while (true) {
+		MutexLocker locker(sCompressedSwap.lock);
+
+		if (sCompressedSwap.used_size <= sCompressedSwap.low_size) {
+			ConditionVariableEntry entry;
+			sCompressedSwap.writer_condition.Add(&entry);
+			locker.Unlock();
+
+			entry.Wait();
+			continue;
+		}
+
+		locker.Unlock();
+
+		status_t status = compressed_swap_write_back();
+		if (status != B_OK) {
+			// neither a page being moved nor an empty list is an error
+			if (status != B_BUSY && status != B_ENTRY_NOT_FOUND) {
+				dprintf("compressed swap: writing back failed: %s\n",
+					strerror(status));
+			}
+			snooze(100000);
+		}
+	}
+
+	return B_OK;
+}
+
+
+static status_t
+compressed_swap_init(size_t maxSize)
+{
+	compressed_swap& swap = sCompressedSwap;
+
+	mutex_init(&swap.lock, "compressed swap");
+	mutex_init(&swap.store_lock, "compressed swap store");
+	mutex_init(&swap.load_lock, "compressed swap load");
+	swap.writer_condition.Init(&swap, "compressed swap writer");
+
+	swap.slot_count = min_c(maxSize / B_PAGE_SIZE
+		* COMPRESSED_SWAP_SLOTS_PER_PAGE, swap_total_swap_pages());
+	if (swap.slot_count == 0)
+		return B_BAD_VALUE;
+
+	swap.max_size = maxSize;
+	swap.write_back_size = maxSize / 8 * 7;
+	swap.low_size = maxSize / 4 * 3;
+
+	swap.bmp = radix_bitmap_create(swap.slot_count);
+	swap.pages = (compressed_page**)malloc(
+		swap.slot_count * sizeof(compressed_page*));
+	swap.store_buffer = (uint8*)malloc(B_PAGE_SIZE);
+	swap.compression_buffer = (uint8*)malloc(COMPRESSED_SWAP_MAX_PAGE_SIZE);
+	swap.work_memory = malloc(LZ4_WORK_MEMORY_SIZE);
+	swap.writer_buffer = (uint8*)malloc(B_PAGE_SIZE);
+	swap.load_buffer = (uint8*)malloc(B_PAGE_SIZE);
+	if (swap.bmp == NULL || swap.pages == NULL || swap.store_buffer == NULL
+		|| swap.compression_buffer == NULL || swap.work_memory == NULL
+		|| swap.load_buffer == NULL || swap.writer_buffer == NULL) {
+		return B_NO_MEMORY;
+	}
+
+	memset(swap.pages, 0, swap.slot_count * sizeof(compressed_page*));
+
+	swap.writer_thread = spawn_kernel_thread(&compressed_swap_writer,
+		"compressed swap writer", B_NORMAL_PRIORITY, NULL);
+	if (swap.writer_thread < 0)
+		return swap.writer_thread;
+
+	resume_thread(swap.writer_thread);
+
+	sCompressedSwapEnabled = true;
+	return B_OK;
+}
+
+
 // #pragma mark -
 
 
@@ -686,6 +1190,7 @@ VMAnonymousCache::Adopt(VMCache* _source, off_t offset, off_t size,
 			swapBlock->swap_slots[blockIndex] = slotIndex;
 			swapBlock->used++;
 			fAllocatedSwapSize += B_PAGE_SIZE;
+			compressed_swap_set_owner(slotIndex, this, pageIndex);
 
 			sourceSwapBlock->swap_slots[sourceBlockIndex] = SWAP_SLOT_NONE;
 			sourceSwapBlock->used--;
@@ -769,6 +1274,23 @@ VMAnonymousCache::Read(off_t offset, const generic_io_vec* vecs, size_t count,
 
 	for (uint32 i = 0, j = 0; i < count; i = j) {
 		swap_addr_t startSlotIndex = _SwapBlockGetAddress(pageIndex + i);
+		if (is_compressed_swap_slot(startSlotIndex)) {
+			T(ReadPage(this, pageIndex + i, startSlotIndex));
+
+			status_t status = compressed_swap_load(this, pageIndex + i,
+				startSlotIndex, vecs[i], flags);
+			if (status == B_ENTRY_NOT_FOUND) {
+				// it has been written back to the swap file in the meantime
+				j = i;
+				continue;
+			}
+			if (status != B_OK)
+				return status;
+
+			j = i + 1;
+			continue;
+		}
+
 		for (j = i + 1; j < count; j++) {
 			swap_addr_t slotIndex = _SwapBlockGetAddress(pageIndex + j);
 			if (slotIndex != startSlotIndex + j - i)
@@ -783,10 +1305,16 @@ VMAnonymousCache::Read(off_t offset, const generic_io_vec* vecs, size_t count,
 		off_t pos = (off_t)(startSlotIndex - swapFile->first_slot)
 			* B_PAGE_SIZE;
 
+		bigtime_t startTime = system_time();
+
 		status_t status = vfs_read_pages(swapFile->vnode, swapFile->cookie, pos,
 			vecs + i, j - i, flags, _numBytes);
 		if (status != B_OK)
 			return status;
+
+		atomic_add64(&sCompressedSwap.swap_file_reads, 1);
+		atomic_add64(&sCompressedSwap.swap_file_read_time,
+			system_time() - startTime);
 	}
 
 	return B_OK;
@@ -804,14 +1332,17 @@ VMAnonymousCache::Write(off_t offset, const generic_io_vec* vecs, size_t count,
 	page_num_t totalPages = 0;
 	for (uint32 i = 0; i < count; i++) {
 		page_num_t pageCount = (vecs[i].length + B_PAGE_SIZE - 1) >> PAGE_SHIFT;
-		swap_addr_t slotIndex = _SwapBlockGetAddress(pageIndex + totalPages);
-		if (slotIndex != SWAP_SLOT_NONE) {
-			swap_slot_dealloc(slotIndex, pageCount);
-			_SwapBlockFree(pageIndex + totalPages, pageCount);
-			fAllocatedSwapSize -= pageCount * B_PAGE_SIZE;
-		}
 
-		totalPages += pageCount;
+		// The pages of a vector don't necessarily have contiguous slots, as
+		// some of them may be in compressed swap.
+		for (page_num_t j = 0; j < pageCount; j++, totalPages++) {
+			swap_addr_t slotIndex = _SwapBlockGetAddress(pageIndex + totalPages);
+			if (slotIndex != SWAP_SLOT_NONE) {
+				swap_slot_dealloc(slotIndex, 1);
+				_SwapBlockFree(pageIndex + totalPages, 1);
+				fAllocatedSwapSize -= B_PAGE_SIZE;
+			}
+		}
 	}
 
 	off_t totalSize = totalPages * B_PAGE_SIZE;
@@ -904,10 +1435,34 @@ VMAnonymousCache::WriteAsync(off_t offset, const generic_io_vec* vecs,
 		}
 
 		fAllocatedSwapSize += B_PAGE_SIZE;
+	}
 
-		slotIndex = swap_slot_alloc(1);
+	// Try to store the page in compressed swap first. It only goes to the
+	// swap file, if it doesn't compress well, or the compressed swap is full.
+	swap_addr_t compressedSlotIndex
+		= compressed_swap_store(this, pageIndex, vecs[0], flags);
+	if (compressedSlotIndex != SWAP_SLOT_NONE
+		|| is_compressed_swap_slot(slotIndex)) {
+		// The page moves to a new slot, as pages in compressed swap cannot be
+		// overwritten in place.
+		if (!newSlot) {
+			swap_slot_dealloc(slotIndex, 1);
+			_SwapBlockFree(pageIndex, 1);
+			newSlot = true;
+		}
+
+		if (compressedSlotIndex != SWAP_SLOT_NONE) {
+			T(WritePage(this, pageIndex, compressedSlotIndex));
+
+			_SwapBlockBuild(pageIndex, compressedSlotIndex, 1);
+			_callback->IOFinished(B_OK, false, numBytes);
+			return B_OK;
+		}
 	}
 
+	if (newSlot)
+		slotIndex = swap_slot_alloc(1);
+
 	// create our callback
 	WriteCallback* callback = (flags & B_VIP_IO_REQUEST) != 0
 		? new(malloc_flags(HEAP_PRIORITY_VIP)) WriteCallback(this, _callback)
@@ -1332,6 +1887,11 @@ VMAnonymousCache::_MergeSwapPages(VMAnonymousCache* source)
 		// the consumer.
 		fAllocatedSwapSize += B_PAGE_SIZE * (off_t)sourceSwapBlock->used;
 
+		for (uint32 i = 0; i < SWAP_BLOCK_PAGES; i++) {
+			compressed_swap_set_owner(sourceSwapBlock->swap_slots[i], this,
+				swapBlockPageIndex + i);
+		}
+
 		if (sourceSwapBlock->used == 0) {
 			// All swap pages have been freed -- we can discard the source swap
 			// block.
@@ -1523,6 +2083,10 @@ swap_file_delete(const char* path)
 	if (swapFile->bmp->free_slots < swapFile->last_slot - swapFile->first_slot)
 		return B_ERROR;
 
+	// the pages in compressed swap might still have to be written back
+	if (sSwapFileCount == 1 && sCompressedSwap.stored_pages > 0)
+		return B_ERROR;
+
 	sSwapFileList.Remove(swapFile);
 	sSwapFileCount--;
 	locker.Unlock();
@@ -1594,6 +2158,8 @@ swap_init_post_modules()
 	bool swapEnabled = true;
 	bool swapAutomatic = true;
 	off_t swapSize = 0;
+	bool compressedSwapEnabled = true;
+	off_t compressedSwapSize = 0;
 
 	dev_t swapDeviceID = -1;
 	VolumeInfo selectedVolume = {};
@@ -1645,6 +2211,14 @@ swap_init_post_modules()
 				}
 			}
 		}
+
+		compressedSwapEnabled = get_driver_boolean_parameter(settings,
+			"compressed_swap", true, true);
+		const char* compressedSize = get_driver_parameter(settings,
+			"compressed_swap_size", NULL, NULL);
+		if (compressedSize != NULL)
+			compressedSwapSize = atoll(compressedSize);
+
 		unload_driver_settings(settings);
 	}
 
@@ -1757,6 +2331,23 @@ swap_init_post_modules()
 	if (error != B_OK) {
 		dprintf("%s: Failed to add swap file %s: %s\n", __func__, swapPath,
 			strerror(error));
+		return;
+	}
+
+	// The compressed swap is put in front of the swap file, which always has
+	// room for the pages it needs to write back.
+	if (compressedSwapEnabled) {
+		// by default, use up to a quarter of the memory
+		if (compressedSwapSize <= 0)
+			compressedSwapSize = (off_t)vm_page_num_pages() * B_PAGE_SIZE / 4;
+		compressedSwapSize = min_c(compressedSwapSize,
+			(off_t)vm_page_num_pages() * B_PAGE_SIZE / 2);
+
+		error = compressed_swap_init(compressedSwapSize);
+		if (error != B_OK) {
+			dprintf("%s: Failed to initialize compressed swap: %s\n",
+				__func__, strerror(error));
+		}
 	}
 }
 
@@ -36,7 +36,11 @@ VMArea::VMArea(VMAddressSpace* addressSpace, uint32 wiring, uint32 protection)
 	page_protections(NULL),
 	address_space(addressSpace),
 	cache_next(NULL),
-	cache_prev(NULL)
+	cache_prev(NULL),
+	large_page_faults(0),
+	large_page_fallbacks(0),
+	memory_node_policy(B_AREA_NODE_LOCAL),
+	memory_node(0)
 {
 	new (&mappings) VMAreaMappings;
 }
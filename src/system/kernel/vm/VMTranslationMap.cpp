@@ -39,6 +39,47 @@ VMTranslationMap::DebugMarkRangePresent(addr_t start, addr_t end,
 }
 
 
+/*!	Returns the size of the large pages the map can use for anonymous
+	memory, or \c 0, if the map doesn't support them.
+*/
+size_t
+VMTranslationMap::LargePageSize() const
+{
+	return 0;
+}
+
+
+/*!	Maps a physically contiguous, suitably aligned run of pages of
+	LargePageSize() bytes using a single large page.
+
+	The caller must hold the map's lock and must have reserved the pages
+	needed to map \a virtualAddress. The mapping behaves like the respective
+	individual page mappings would; the implementation splits it up again
+	whenever only a part of the range is unmapped, protected, or otherwise
+	modified.
+
+	\return \c B_OK on success, \c B_BUSY when there are already pages mapped
+		in the range, another error code, if large pages are not supported.
+*/
+status_t
+VMTranslationMap::MapLargePage(addr_t virtualAddress,
+	phys_addr_t physicalAddress, uint32 attributes, uint32 memoryType,
+	vm_page_reservation* reservation)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
+/*!	Returns the number of large pages currently mapped in the given range.
+	The caller must hold the map's lock.
+*/
+size_t
+VMTranslationMap::CountLargePages(addr_t start, addr_t end)
+{
+	return 0;
+}
+
+
 /*!	Unmaps a range of pages of an area.
 
 	The default implementation just iterates over all virtual pages of the
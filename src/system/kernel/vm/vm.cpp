@@ -253,6 +253,12 @@ static off_t sNeededMemory;
 static mutex sAvailableMemoryLock = MUTEX_INITIALIZER("available memory lock");
 static uint32 sPageFaults;
 
+// After a failed large page allocation, don't try again for a while, since
+// physical memory is likely too fragmented anyway.
+static const bigtime_t kLargePageBackOffInterval = 100000;
+static int64 sLargePageBackOffUntil;
+	// accessed atomically
+
 static VMPhysicalPageMapper* sPhysicalPageMapper;
 
 #if DEBUG_CACHE_LIST
@@ -1563,6 +1569,15 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 			return B_BAD_VALUE;
 	}
 
+	// Large pages are only used for lazily mapped areas, which need to be
+	// committed upfront, since a large page fault commits a whole large page.
+	if ((protection & B_LARGE_PAGE_AREA) != 0) {
+		if (isStack || wiring != B_NO_LOCK)
+			protection &= ~B_LARGE_PAGE_AREA;
+		else
+			canOvercommit = false;
+	}
+
 	// Optimization: For a single-page contiguous allocation without low/high
 	// memory restriction B_FULL_LOCK wiring suffices.
 	if (wiring == B_CONTIGUOUS && size == B_PAGE_SIZE
@@ -1659,6 +1674,21 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 		&& wait_if_address_range_is_wired(addressSpace,
 			(addr_t)virtualAddressRestrictions->address, size, &locker));
 
+	// align large page areas, so that as much of them as possible can be
+	// mapped using large pages
+	virtual_address_restrictions largePageRestrictions;
+	if ((protection & B_LARGE_PAGE_AREA) != 0
+		&& virtualAddressRestrictions->address_specification
+			!= B_EXACT_ADDRESS) {
+		size_t largePageSize = addressSpace->TranslationMap()->LargePageSize();
+		if (largePageSize != 0 && size >= largePageSize
+			&& virtualAddressRestrictions->alignment < largePageSize) {
+			largePageRestrictions = *virtualAddressRestrictions;
+			largePageRestrictions.alignment = largePageSize;
+			virtualAddressRestrictions = &largePageRestrictions;
+		}
+	}
+
 	// create an anonymous cache
 	// if it's a stack, make sure that two pages are available at least
 	status = VMCacheFactory::CreateAnonymousCache(cache, canOvercommit,
@@ -2844,6 +2874,9 @@ vm_copy_area(team_id team, const char* name, void** _address,
 	if (targetPageProtections != NULL)
 		target->page_protections = targetPageProtections;
 
+	target->memory_node_policy = source->memory_node_policy;
+	target->memory_node = source->memory_node;
+
 	if (sharedArea) {
 		// The new area uses the old area's cache, but map_backing_store()
 		// hasn't acquired a ref. So we have to do that now.
@@ -2867,6 +2900,49 @@ vm_copy_area(team_id team, const char* name, void** _address,
 }
 
 
+/*!	Sets where the pages of the area will be allocated from now on. Pages
+	that are already allocated are not migrated.
+*/
+status_t
+vm_set_area_memory_node_policy(team_id team, area_id areaID, uint32 policy,
+	int32 node, bool kernel)
+{
+	switch (policy) {
+		case B_AREA_NODE_LOCAL:
+		case B_AREA_NODE_INTERLEAVE:
+			node = 0;
+			break;
+
+		case B_AREA_NODE_PREFERRED:
+			if (node < 0 || (uint32)node >= vm_page_memory_node_count())
+				return B_BAD_VALUE;
+			break;
+
+		default:
+			return B_BAD_VALUE;
+	}
+
+	AddressSpaceWriteLocker locker;
+	VMArea* area;
+	status_t status = locker.SetFromArea(areaID, area);
+	if (status != B_OK)
+		return status;
+
+	if (!kernel && (area->address_space == VMAddressSpace::Kernel()
+			|| (area->protection & B_KERNEL_AREA) != 0)) {
+		return B_NOT_ALLOWED;
+	}
+	if (team != VMAddressSpace::KernelID()
+		&& area->address_space->ID() != team) {
+		return B_NOT_ALLOWED;
+	}
+
+	area->memory_node_policy = policy;
+	area->memory_node = node;
+	return B_OK;
+}
+
+
 status_t
 vm_set_area_protection(team_id team, area_id areaID, uint32 newProtection,
 	bool kernel)
@@ -3638,6 +3714,21 @@ dump_area_struct(VMArea* area, bool mappings)
 	kprintf("cache_offset:\t0x%" B_PRIx64 "\n", area->cache_offset);
 	kprintf("cache_next:\t%p\n", area->cache_next);
 	kprintf("cache_prev:\t%p\n", area->cache_prev);
+	if ((area->protection & B_LARGE_PAGE_AREA) != 0) {
+		kprintf("large pages:\t%" B_PRIuSIZE " mapped, %" B_PRId32 " faults, %"
+			B_PRId32 " fallbacks\n",
+			area->address_space->TranslationMap()->CountLargePages(
+				area->Base(), area->Base() + (area->Size() - 1)),
+			area->large_page_faults, area->large_page_fallbacks);
+	}
+	if (area->memory_node_policy != B_AREA_NODE_LOCAL) {
+		kprintf("node policy:\t%s",
+			area->memory_node_policy == B_AREA_NODE_PREFERRED
+				? "preferred" : "interleave");
+		if (area->memory_node_policy == B_AREA_NODE_PREFERRED)
+			kprintf(" (node %u)", area->memory_node);
+		kprintf("\n");
+	}
 
 	VMAreaMappings::Iterator iterator = area->mappings.GetIterator();
 	if (mappings) {
@@ -4657,6 +4748,8 @@ struct PageFaultContext {
 	VMCache*				topCache;
 	off_t					cacheOffset;
 	vm_page_reservation		reservation;
+	uint32					nodeFlags;
+		// memory node selection for vm_page_allocate_page()
 	bool					isWrite;
 
 	// return values
@@ -4679,10 +4772,11 @@ struct PageFaultContext {
 		vm_page_unreserve_pages(&reservation);
 	}
 
-	void Prepare(VMCache* topCache, off_t cacheOffset)
+	void Prepare(VMCache* topCache, off_t cacheOffset, uint32 nodeFlags)
 	{
 		this->topCache = topCache;
 		this->cacheOffset = cacheOffset;
+		this->nodeFlags = nodeFlags;
 		page = NULL;
 		restart = false;
 		pageAllocated = false;
@@ -4699,6 +4793,32 @@ struct PageFaultContext {
 };
 
 
+/*!	Returns the vm_page_allocate_page() flags that select the memory node for
+	the page at \a address of \a area according to the area's node policy.
+*/
+static uint32
+area_page_node_flags(VMArea* area, addr_t address)
+{
+	switch (area->memory_node_policy) {
+		case B_AREA_NODE_PREFERRED:
+			return VM_PAGE_ALLOC_NODE(area->memory_node);
+
+		case B_AREA_NODE_INTERLEAVE:
+		{
+			uint32 nodeCount = vm_page_memory_node_count();
+			if (nodeCount < 2)
+				return 0;
+			return VM_PAGE_ALLOC_NODE(
+				(address - area->Base()) / B_PAGE_SIZE % nodeCount);
+		}
+
+		case B_AREA_NODE_LOCAL:
+		default:
+			return 0;
+	}
+}
+
+
 /*!	Gets the page that should be mapped into the area.
 	Returns an error code other than \c B_OK, if the page couldn't be found or
 	paged in. The locking state of the address space and the caches is undefined
@@ -4744,7 +4864,7 @@ fault_get_page(PageFaultContext& context)
 		if (cache->HasPage(context.cacheOffset)) {
 			// insert a fresh page and mark it busy -- we're going to read it in
 			page = vm_page_allocate_page(&context.reservation,
-				PAGE_STATE_ACTIVE | VM_PAGE_ALLOC_BUSY);
+				PAGE_STATE_ACTIVE | VM_PAGE_ALLOC_BUSY | context.nodeFlags);
 			cache->InsertPage(page, context.cacheOffset);
 
 			// We need to unlock all caches and the address space while reading
@@ -4799,7 +4919,7 @@ fault_get_page(PageFaultContext& context)
 
 		// allocate a clean page
 		page = vm_page_allocate_page(&context.reservation,
-			PAGE_STATE_ACTIVE | VM_PAGE_ALLOC_CLEAR);
+			PAGE_STATE_ACTIVE | VM_PAGE_ALLOC_CLEAR | context.nodeFlags);
 		FTRACE(("vm_soft_fault: just allocated page 0x%" B_PRIxPHYSADDR "\n",
 			page->physical_page_number));
 
@@ -4814,7 +4934,8 @@ fault_get_page(PageFaultContext& context)
 		// TODO: If memory is low, it might be a good idea to steal the page
 		// from our source cache -- if possible, that is.
 		FTRACE(("get new page, copy it, and put it into the topmost cache\n"));
-		page = vm_page_allocate_page(&context.reservation, PAGE_STATE_ACTIVE);
+		page = vm_page_allocate_page(&context.reservation,
+			PAGE_STATE_ACTIVE | context.nodeFlags);
 
 		// To not needlessly kill concurrency we unlock all caches but the top
 		// one while copying the page. Lacking another mechanism to ensure that
@@ -4840,6 +4961,133 @@ fault_get_page(PageFaultContext& context)
 }
 
 
+/*!	Tries to resolve a page fault in a B_LARGE_PAGE_AREA by allocating and
+	mapping the complete large page containing \a address.
+	The address space must be read-locked and the area's top cache must be
+	locked (as done by PageFaultContext::Prepare()).
+	\return \c true, if the large page has been mapped, \c false, if the fault
+		must be resolved the regular way.
+*/
+static bool
+fault_map_large_page(PageFaultContext& context, VMArea* area, addr_t address,
+	uint32 protection)
+{
+	size_t largePageSize = context.map->LargePageSize();
+	if (largePageSize == 0)
+		return false;
+
+	// The large page must lie within the area and the area's cache must be
+	// a committed, anonymous cache without a source. Otherwise pages might
+	// have to come from elsewhere.
+	VMCache* cache = context.topCache;
+	addr_t base = ROUNDDOWN(address, largePageSize);
+	if (area->wiring != B_NO_LOCK || base < area->Base()
+		|| base + (largePageSize - 1) > area->Base() + (area->Size() - 1)
+		|| cache->type != CACHE_TYPE_RAM || !cache->temporary
+		|| cache->source != NULL
+		|| cache->committed_size < cache->virtual_end - cache->virtual_base
+		|| area->IsWired(base, largePageSize)) {
+		return false;
+	}
+
+	// All pages need to have the same protection.
+	if (area->page_protections != NULL) {
+		for (addr_t pageAddress = base; pageAddress < base + largePageSize;
+				pageAddress += B_PAGE_SIZE) {
+			if (get_area_page_protection(area, pageAddress) != protection)
+				return false;
+		}
+	}
+
+	// The cache must not contain any of the pages yet, neither in memory nor
+	// in swap.
+	off_t cacheOffset = base - area->Base() + area->cache_offset;
+	page_num_t pageCount = largePageSize / B_PAGE_SIZE;
+	page_num_t firstPage = cacheOffset / B_PAGE_SIZE;
+
+	VMCachePagesTree::Iterator it = cache->pages.GetIterator(firstPage, true,
+		true);
+	vm_page* page = it.Next();
+	if (page != NULL && page->cache_offset < firstPage + pageCount)
+		return false;
+
+	for (page_num_t i = 0; i < pageCount; i++) {
+		if (cache->HasPage(cacheOffset + i * B_PAGE_SIZE))
+			return false;
+	}
+
+	if (system_time() < atomic_get64(&sLargePageBackOffUntil))
+		return false;
+
+	// Allocate the mapping objects upfront, so that we can easily back out.
+	VMAreaMappings mappings;
+	page_num_t mappingCount = 0;
+	for (; mappingCount < pageCount; mappingCount++) {
+		vm_page_mapping* mapping = (vm_page_mapping*)object_cache_alloc(
+			gPageMappingsObjectCache, CACHE_DONT_WAIT_FOR_MEMORY);
+		if (mapping == NULL)
+			break;
+		mappings.Add(mapping);
+	}
+
+	vm_page* pages = NULL;
+	if (mappingCount == pageCount) {
+		physical_address_restrictions restrictions = {};
+		restrictions.alignment = largePageSize;
+		pages = vm_page_allocate_page_run(PAGE_STATE_ACTIVE
+				| VM_PAGE_ALLOC_CLEAR | VM_PAGE_ALLOC_DONT_WAIT,
+			pageCount, &restrictions, VM_PRIORITY_USER);
+	}
+
+	status_t status = B_NO_MEMORY;
+	if (pages != NULL) {
+		context.map->Lock();
+
+		status = context.map->MapLargePage(base,
+			pages->physical_page_number * B_PAGE_SIZE, protection,
+			area->MemoryType(), &context.reservation);
+		if (status == B_OK) {
+			for (page_num_t i = 0; i < pageCount; i++) {
+				page = &pages[i];
+				cache->InsertPage(page, cacheOffset + i * B_PAGE_SIZE);
+
+				vm_page_mapping* mapping = mappings.RemoveHead();
+				mapping->page = page;
+				mapping->area = area;
+				page->mappings.Add(mapping);
+				area->mappings.Add(mapping);
+
+				DEBUG_PAGE_ACCESS_END(page);
+			}
+
+			atomic_add(&gMappedPagesCount, pageCount);
+		}
+
+		context.map->Unlock();
+
+		if (status != B_OK) {
+			for (page_num_t i = 0; i < pageCount; i++)
+				vm_page_set_state(&pages[i], PAGE_STATE_FREE);
+		}
+	} else if (mappingCount == pageCount)
+		atomic_set64(&sLargePageBackOffUntil,
+			system_time() + kLargePageBackOffInterval);
+
+	while (vm_page_mapping* mapping = mappings.RemoveHead()) {
+		object_cache_free(gPageMappingsObjectCache, mapping,
+			CACHE_DONT_WAIT_FOR_MEMORY);
+	}
+
+	if (status != B_OK) {
+		atomic_add(&area->large_page_fallbacks, 1);
+		return false;
+	}
+
+	atomic_add(&area->large_page_faults, 1);
+	return true;
+}
+
+
 /*!	Makes sure the address in the given address space is mapped.
 
 	\param addressSpace The address space.
@@ -4932,7 +5180,8 @@ vm_soft_fault(VMAddressSpace* addressSpace, addr_t originalAddress,
 		// At first, the top most cache from the area is investigated.
 
 		context.Prepare(vm_area_get_locked_cache(area),
-			address - area->Base() + area->cache_offset);
+			address - area->Base() + area->cache_offset,
+			area_page_node_flags(area, address));
 
 		// See if this cache has a fault handler -- this will do all the work
 		// for us.
@@ -4945,6 +5194,13 @@ vm_soft_fault(VMAddressSpace* addressSpace, addr_t originalAddress,
 				break;
 		}
 
+		// In large page areas, try to map the whole large page at once.
+		if ((area->protection & B_LARGE_PAGE_AREA) != 0 && wirePage == NULL
+			&& fault_map_large_page(context, area, address, protection)) {
+			status = B_OK;
+			break;
+		}
+
 		// The top most cache has no fault handler, so let's see if the cache or
 		// its sources already have the page we're searching for (we're going
 		// from top to bottom).
@@ -6522,6 +6778,47 @@ _user_get_area_info(area_id area, area_info* userInfo)
 }
 
 
+status_t
+_user_get_area_large_page_info(area_id id, area_large_page_info* userInfo)
+{
+	if (!IS_USER_ADDRESS(userInfo))
+		return B_BAD_ADDRESS;
+
+	AddressSpaceReadLocker locker;
+	VMArea* area;
+	status_t status = locker.SetFromArea(id, area);
+	if (status != B_OK)
+		return status;
+
+	VMTranslationMap* map = area->address_space->TranslationMap();
+
+	area_large_page_info info;
+	info.page_size = map->LargePageSize();
+	info.faults = area->large_page_faults;
+	info.fallbacks = area->large_page_fallbacks;
+
+	map->Lock();
+	info.mapped_pages = map->CountLargePages(area->Base(),
+		area->Base() + (area->Size() - 1));
+	map->Unlock();
+
+	locker.Unlock();
+
+	if (user_memcpy(userInfo, &info, sizeof(info)) < B_OK)
+		return B_BAD_ADDRESS;
+
+	return B_OK;
+}
+
+
+status_t
+_user_set_area_memory_node_policy(area_id area, uint32 policy, int32 node)
+{
+	return vm_set_area_memory_node_policy(VMAddressSpace::CurrentID(), area,
+		policy, node, false);
+}
+
+
 status_t
 _user_get_next_area_info(team_id team, ssize_t* userCookie, area_info* userInfo)
 {
@@ -23,6 +23,7 @@
 #include <block_cache.h>
 #include <boot/kernel_args.h>
 #include <condition_variable.h>
+#include <cpu.h>
 #include <elf.h>
 #include <heap.h>
 #include <kernel.h>
@@ -104,6 +105,16 @@ int32 gMappedPagesCount;
 
 static VMPageQueue sPageQueues[PAGE_STATE_COUNT];
 
+// Every memory node has its own free and clear page queues; node 0 uses the
+// ones in sPageQueues. A page's node is stored in vm_page::node.
+static VMPageQueue sNodePageQueues[VM_MAX_MEMORY_NODES - 1][2];
+static VMPageQueue* sFreePageQueues[VM_MAX_MEMORY_NODES];
+static VMPageQueue* sClearPageQueues[VM_MAX_MEMORY_NODES];
+static uint32 sMemoryNodeCount = 1;
+static uint8 sMemoryNodeDistances[VM_MAX_MEMORY_NODES][VM_MAX_MEMORY_NODES];
+static uint8 sMemoryNodeOrder[VM_MAX_MEMORY_NODES][VM_MAX_MEMORY_NODES];
+	// for each node all nodes, sorted by increasing distance
+
 static VMPageQueue& sFreePageQueue = sPageQueues[PAGE_STATE_FREE];
 static VMPageQueue& sClearPageQueue = sPageQueues[PAGE_STATE_CLEAR];
 static VMPageQueue& sModifiedPageQueue = sPageQueues[PAGE_STATE_MODIFIED];
@@ -129,7 +140,8 @@ static mutex sPageDeficitLock = MUTEX_INITIALIZER("page deficit");
 // This lock must be used whenever the free or clear page queues are changed.
 // If you need to work on both queues at the same time, you need to hold a write
 // lock, otherwise, a read lock suffices (each queue still has a spinlock to
-// guard against concurrent changes).
+// guard against concurrent changes). The memory node layout must only be
+// changed with the write lock held.
 static rw_lock sFreePageQueuesLock
 	= RW_LOCK_INITIALIZER("free/clear page queues");
 
@@ -817,6 +829,28 @@ dump_page_list(int argc, char **argv)
 }
 
 
+/*!	Returns the number of pages in the free queues of all memory nodes. */
+static page_num_t
+free_page_queues_count()
+{
+	page_num_t count = 0;
+	for (uint32 i = 0; i < sMemoryNodeCount; i++)
+		count += sFreePageQueues[i]->Count();
+	return count;
+}
+
+
+/*!	Returns the number of pages in the clear queues of all memory nodes. */
+static page_num_t
+clear_page_queues_count()
+{
+	page_num_t count = 0;
+	for (uint32 i = 0; i < sMemoryNodeCount; i++)
+		count += sClearPageQueues[i]->Count();
+	return count;
+}
+
+
 static int
 find_page(int argc, char **argv)
 {
@@ -860,6 +894,21 @@ find_page(int argc, char **argv)
 		}
 	}
 
+	for (uint32 node = 1; node < sMemoryNodeCount; node++) {
+		for (i = 0; i < 2; i++) {
+			VMPageQueue* queue = i == 0
+				? sFreePageQueues[node] : sClearPageQueues[node];
+			VMPageQueue::Iterator it = queue->GetIterator();
+			while (vm_page* p = it.Next()) {
+				if (p == page) {
+					kprintf("found page %p in queue %p (%s, node %" B_PRIu32
+						")\n", page, queue, i == 0 ? "free" : "clear", node);
+					return 0;
+				}
+			}
+		}
+	}
+
 	kprintf("page %p isn't in any queue\n", page);
 
 	return 0;
@@ -1022,10 +1071,32 @@ dump_page_long(int argc, char **argv)
 }
 
 
+static void
+dump_page_queue(VMPageQueue* queue, bool list)
+{
+	kprintf("queue = %p, queue->head = %p, queue->tail = %p, queue->count = %"
+		B_PRIuPHYSADDR "\n", queue, queue->Head(), queue->Tail(),
+		queue->Count());
+
+	if (list) {
+		struct vm_page *page = queue->Head();
+
+		kprintf("page        cache       type       state  wired  usage\n");
+		for (page_num_t i = 0; page; i++, page = queue->Next(page)) {
+			kprintf("%p  %p  %-7s %8s  %5d  %5d\n", page, page->Cache(),
+				vm_cache_type_to_string(page->Cache()->type),
+				page_state_to_string(page->State()),
+				page->WiredCount(), page->usage_count);
+		}
+	}
+}
+
+
 static int
 dump_page_queue(int argc, char **argv)
 {
-	struct VMPageQueue *queue;
+	struct VMPageQueue *queue = NULL;
+	VMPageQueue** nodeQueues = NULL;
 
 	if (argc < 2) {
 		kprintf("usage: page_queue <address/name> [list]\n");
@@ -1035,9 +1106,9 @@ dump_page_queue(int argc, char **argv)
 	if (strlen(argv[1]) >= 2 && argv[1][0] == '0' && argv[1][1] == 'x')
 		queue = (VMPageQueue*)strtoul(argv[1], NULL, 16);
 	else if (!strcmp(argv[1], "free"))
-		queue = &sFreePageQueue;
+		nodeQueues = sFreePageQueues;
 	else if (!strcmp(argv[1], "clear"))
-		queue = &sClearPageQueue;
+		nodeQueues = sClearPageQueues;
 	else if (!strcmp(argv[1], "modified"))
 		queue = &sModifiedPageQueue;
 	else if (!strcmp(argv[1], "active"))
@@ -1051,20 +1122,16 @@ dump_page_queue(int argc, char **argv)
 		return 0;
 	}
 
-	kprintf("queue = %p, queue->head = %p, queue->tail = %p, queue->count = %"
-		B_PRIuPHYSADDR "\n", queue, queue->Head(), queue->Tail(),
-		queue->Count());
-
-	if (argc == 3) {
-		struct vm_page *page = queue->Head();
+	if (nodeQueues == NULL) {
+		dump_page_queue(queue, argc == 3);
+		return 0;
+	}
 
-		kprintf("page        cache       type       state  wired  usage\n");
-		for (page_num_t i = 0; page; i++, page = queue->Next(page)) {
-			kprintf("%p  %p  %-7s %8s  %5d  %5d\n", page, page->Cache(),
-				vm_cache_type_to_string(page->Cache()->type),
-				page_state_to_string(page->State()),
-				page->WiredCount(), page->usage_count);
-		}
+	// the free and clear pages are kept per memory node
+	for (uint32 node = 0; node < sMemoryNodeCount; node++) {
+		if (sMemoryNodeCount > 1)
+			kprintf("node %" B_PRIu32 ": ", node);
+		dump_page_queue(nodeQueues[node], argc == 3);
 	}
 	return 0;
 }
@@ -1170,10 +1237,17 @@ dump_page_stats(int argc, char **argv)
 			waiter->missing, waiter->dontTouch);
 	}
 
-	kprintf("\nfree queue: %p, count = %" B_PRIuPHYSADDR "\n", &sFreePageQueue,
-		sFreePageQueue.Count());
-	kprintf("clear queue: %p, count = %" B_PRIuPHYSADDR "\n", &sClearPageQueue,
-		sClearPageQueue.Count());
+	kprintf("\n");
+	for (uint32 node = 0; node < sMemoryNodeCount; node++) {
+		if (sMemoryNodeCount > 1)
+			kprintf("node %" B_PRIu32 " ", node);
+		kprintf("free queue: %p, count = %" B_PRIuPHYSADDR "\n",
+			sFreePageQueues[node], sFreePageQueues[node]->Count());
+		if (sMemoryNodeCount > 1)
+			kprintf("node %" B_PRIu32 " ", node);
+		kprintf("clear queue: %p, count = %" B_PRIuPHYSADDR "\n",
+			sClearPageQueues[node], sClearPageQueues[node]->Count());
+	}
 	kprintf("modified queue: %p, count = %" B_PRIuPHYSADDR " (%" B_PRId32
 		" temporary, %" B_PRIuPHYSADDR " swappable, " "inactive: %"
 		B_PRIuPHYSADDR ")\n", &sModifiedPageQueue, sModifiedPageQueue.Count(),
@@ -1574,10 +1648,10 @@ free_page(vm_page* page, bool clear)
 
 	if (clear) {
 		page->SetState(PAGE_STATE_CLEAR);
-		sClearPageQueue.PrependUnlocked(page);
+		sClearPageQueues[page->node]->PrependUnlocked(page);
 	} else {
 		page->SetState(PAGE_STATE_FREE);
-		sFreePageQueue.PrependUnlocked(page);
+		sFreePageQueues[page->node]->PrependUnlocked(page);
 		sFreePageCondition.NotifyAll();
 	}
 
@@ -1755,9 +1829,10 @@ mark_page_range_in_use(page_num_t startPage, page_num_t length, bool wired)
 // the free/clear queues without having reserved them before. This should happen
 // in the early boot process only, though.
 				DEBUG_PAGE_ACCESS_START(page);
-				VMPageQueue& queue = page->State() == PAGE_STATE_FREE
-					? sFreePageQueue : sClearPageQueue;
-				queue.Remove(page);
+				VMPageQueue* queue = page->State() == PAGE_STATE_FREE
+					? sFreePageQueues[page->node]
+					: sClearPageQueues[page->node];
+				queue->Remove(page);
 				page->SetState(wired ? PAGE_STATE_WIRED : PAGE_STATE_UNUSED);
 				page->busy = false;
 				atomic_add(&sUnreservedFreePages, -1);
@@ -1796,9 +1871,11 @@ page_scrubber(void *unused)
 
 	TRACE(("page_scrubber starting...\n"));
 
+	uint32 node = 0;
+
 	ConditionVariableEntry entry;
 	for (;;) {
-		while (sFreePageQueue.Count() == 0
+		while (free_page_queues_count() == 0
 				|| atomic_get(&sUnreservedFreePages)
 					< (int32)sFreePagesTarget) {
 			sFreePageCondition.Add(&entry);
@@ -1815,21 +1892,27 @@ page_scrubber(void *unused)
 		if (reserved == 0)
 			continue;
 
-		// get some pages from the free queue, mostly sorted
+		// get some pages from the free queue, mostly sorted; the memory nodes
+		// are scrubbed in turn
 		ReadLocker locker(sFreePageQueuesLock);
 
 		vm_page *page[SCRUB_SIZE];
 		int32 scrubCount = 0;
-		for (int32 i = 0; i < reserved; i++) {
-			page[i] = sFreePageQueue.RemoveHeadUnlocked();
-			if (page[i] == NULL)
-				break;
+		for (uint32 tries = 0; tries < sMemoryNodeCount && scrubCount == 0;
+				tries++) {
+			node = (node + 1) % sMemoryNodeCount;
+
+			for (int32 i = 0; i < reserved; i++) {
+				page[i] = sFreePageQueues[node]->RemoveHeadUnlocked();
+				if (page[i] == NULL)
+					break;
 
-			DEBUG_PAGE_ACCESS_START(page[i]);
+				DEBUG_PAGE_ACCESS_START(page[i]);
 
-			page[i]->SetState(PAGE_STATE_ACTIVE);
-			page[i]->busy = true;
-			scrubCount++;
+				page[i]->SetState(PAGE_STATE_ACTIVE);
+				page[i]->busy = true;
+				scrubCount++;
+			}
 		}
 
 		locker.Unlock();
@@ -1853,7 +1936,7 @@ page_scrubber(void *unused)
 			page[i]->SetState(PAGE_STATE_CLEAR);
 			page[i]->busy = false;
 			DEBUG_PAGE_ACCESS_END(page[i]);
-			sClearPageQueue.PrependUnlocked(page[i]);
+			sClearPageQueues[page[i]->node]->PrependUnlocked(page[i]);
 		}
 
 		locker.Unlock();
@@ -2635,7 +2718,7 @@ free_cached_pages(uint32 pagesToFree, bool dontWait)
 			ReadLocker locker(sFreePageQueuesLock);
 			page->SetState(PAGE_STATE_FREE);
 			DEBUG_PAGE_ACCESS_END(page);
-			sFreePageQueue.PrependUnlocked(page);
+			sFreePageQueues[page->node]->PrependUnlocked(page);
 			locker.Unlock();
 
 			TA(StolenPage());
@@ -3327,6 +3410,14 @@ vm_page_init(kernel_args *args)
 	sCachedPageQueue.Init("cached pages queue");
 	sFreePageQueue.Init("free pages queue");
 	sClearPageQueue.Init("clear pages queue");
+	sFreePageQueues[0] = &sFreePageQueue;
+	sClearPageQueues[0] = &sClearPageQueue;
+	for (uint32 i = 1; i < VM_MAX_MEMORY_NODES; i++) {
+		sFreePageQueues[i] = &sNodePageQueues[i - 1][0];
+		sFreePageQueues[i]->Init("node free pages queue");
+		sClearPageQueues[i] = &sNodePageQueues[i - 1][1];
+		sClearPageQueues[i]->Init("node clear pages queue");
+	}
 
 	new (&sPageReservationWaiters) PageReservationWaiterList;
 
@@ -3578,44 +3669,61 @@ vm_page_allocate_page(vm_page_reservation* reservation, uint32 flags)
 	ASSERT(reservation->count > 0);
 	reservation->count--;
 
-	VMPageQueue* queue;
-	VMPageQueue* otherQueue;
+	VMPageQueue** queues;
+	VMPageQueue** otherQueues;
 
 	if ((flags & VM_PAGE_ALLOC_CLEAR) != 0) {
-		queue = &sClearPageQueue;
-		otherQueue = &sFreePageQueue;
+		queues = sClearPageQueues;
+		otherQueues = sFreePageQueues;
 	} else {
-		queue = &sFreePageQueue;
-		otherQueue = &sClearPageQueue;
+		queues = sFreePageQueues;
+		otherQueues = sClearPageQueues;
 	}
 
+	// Prefer the memory node the caller asked for, or else the one of the
+	// current CPU, and fall back to the nearest other nodes.
+	uint32 node;
+	if ((flags & VM_PAGE_ALLOC_NODE_SET) != 0)
+		node = (flags & VM_PAGE_ALLOC_NODE_MASK) >> VM_PAGE_ALLOC_NODE_SHIFT;
+	else
+		node = gCPU[smp_get_current_cpu()].node;
+
 	ReadLocker locker(sFreePageQueuesLock);
 
-	vm_page* page = queue->RemoveHeadUnlocked();
-	if (page == NULL) {
-		// if the primary queue was empty, grab the page from the
-		// secondary queue
-		page = otherQueue->RemoveHeadUnlocked();
+	if (node >= sMemoryNodeCount)
+		node = 0;
 
+	vm_page* page = NULL;
+	for (uint32 i = 0; i < sMemoryNodeCount && page == NULL; i++) {
+		uint32 candidate = sMemoryNodeOrder[node][i];
+		page = queues[candidate]->RemoveHeadUnlocked();
 		if (page == NULL) {
-			// Unlikely, but possible: the page we have reserved has moved
-			// between the queues after we checked the first queue. Grab the
-			// write locker to make sure this doesn't happen again.
-			locker.Unlock();
-			WriteLocker writeLocker(sFreePageQueuesLock);
+			// if the primary queue was empty, grab the page from the
+			// secondary queue
+			page = otherQueues[candidate]->RemoveHeadUnlocked();
+		}
+	}
 
-			page = queue->RemoveHead();
-			if (page == NULL)
-				otherQueue->RemoveHead();
+	if (page == NULL) {
+		// Unlikely, but possible: the page we have reserved has moved
+		// between the queues after we checked them. Grab the write locker to
+		// make sure this doesn't happen again.
+		locker.Unlock();
+		WriteLocker writeLocker(sFreePageQueuesLock);
 
-			if (page == NULL) {
-				panic("Had reserved page, but there is none!");
-				return NULL;
-			}
+		for (uint32 i = 0; i < sMemoryNodeCount && page == NULL; i++) {
+			page = queues[i]->RemoveHead();
+			if (page == NULL)
+				page = otherQueues[i]->RemoveHead();
+		}
 
-			// downgrade to read lock
-			locker.Lock();
+		if (page == NULL) {
+			panic("Had reserved page, but there is none!");
+			return NULL;
 		}
+
+		// downgrade to read lock
+		locker.Lock();
 	}
 
 	if (page->CacheRef() != NULL)
@@ -3661,14 +3769,14 @@ allocate_page_run_cleanup(VMPageQueue::PageList& freePages,
 		page->busy = false;
 		page->SetState(PAGE_STATE_FREE);
 		DEBUG_PAGE_ACCESS_END(page);
-		sFreePageQueue.PrependUnlocked(page);
+		sFreePageQueues[page->node]->PrependUnlocked(page);
 	}
 
 	while (vm_page* page = clearPages.RemoveTail()) {
 		page->busy = false;
 		page->SetState(PAGE_STATE_CLEAR);
 		DEBUG_PAGE_ACCESS_END(page);
-		sClearPageQueue.PrependUnlocked(page);
+		sClearPageQueues[page->node]->PrependUnlocked(page);
 	}
 
 	sFreePageCondition.NotifyAll();
@@ -3717,12 +3825,12 @@ allocate_page_run(page_num_t start, page_num_t length, uint32 flags,
 		switch (page.State()) {
 			case PAGE_STATE_CLEAR:
 				DEBUG_PAGE_ACCESS_START(&page);
-				sClearPageQueue.Remove(&page);
+				sClearPageQueues[page.node]->Remove(&page);
 				clearPages.Add(&page);
 				break;
 			case PAGE_STATE_FREE:
 				DEBUG_PAGE_ACCESS_START(&page);
-				sFreePageQueue.Remove(&page);
+				sFreePageQueues[page.node]->Remove(&page);
 				freePages.Add(&page);
 				break;
 			case PAGE_STATE_CACHED:
@@ -3847,7 +3955,9 @@ allocate_page_run(page_num_t start, page_num_t length, uint32 flags,
 	\param flags Page allocation flags. Encodes the state the function shall
 		set the allocated pages to, whether the pages shall be marked busy
 		(VM_PAGE_ALLOC_BUSY), and whether the pages shall be cleared
-		(VM_PAGE_ALLOC_CLEAR).
+		(VM_PAGE_ALLOC_CLEAR). With VM_PAGE_ALLOC_DONT_WAIT the function
+		fails instead of waiting for enough pages to become available, which
+		is meant for opportunistic allocations.
 	\param length The number of contiguous pages to allocate.
 	\param restrictions Restrictions to the physical addresses of the page run
 		to allocate, including \c low_address, the first acceptable physical
@@ -3900,7 +4010,11 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 	}
 
 	vm_page_reservation reservation;
-	vm_page_reserve_pages(&reservation, length, priority);
+	if ((flags & VM_PAGE_ALLOC_DONT_WAIT) != 0) {
+		if (!vm_page_try_reserve_pages(&reservation, length, priority))
+			return NULL;
+	} else
+		vm_page_reserve_pages(&reservation, length, priority);
 
 	WriteLocker freeClearQueueLocker(sFreePageQueuesLock);
 
@@ -3937,11 +4051,14 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 				continue;
 			}
 
-			dprintf("vm_page_allocate_page_run(): Failed to allocate run of "
-				"length %" B_PRIuPHYSADDR " (%" B_PRIuPHYSADDR " %"
-				B_PRIuPHYSADDR ") in second iteration (align: %" B_PRIuPHYSADDR
-				" boundary: %" B_PRIuPHYSADDR ")!\n", length, requestedStart,
-				end, restrictions->alignment, restrictions->boundary);
+			if ((flags & VM_PAGE_ALLOC_DONT_WAIT) == 0) {
+				dprintf("vm_page_allocate_page_run(): Failed to allocate run "
+					"of length %" B_PRIuPHYSADDR " (%" B_PRIuPHYSADDR " %"
+					B_PRIuPHYSADDR ") in second iteration (align: %"
+					B_PRIuPHYSADDR " boundary: %" B_PRIuPHYSADDR ")!\n",
+					length, requestedStart, end, restrictions->alignment,
+					restrictions->boundary);
+			}
 
 			freeClearQueueLocker.Unlock();
 			vm_page_unreserve_pages(&reservation);
@@ -3982,6 +4099,101 @@ vm_page_at_index(int32 index)
 }
 
 
+/*!	Tells the page allocator which physical memory belongs to which memory
+	(NUMA) node. Memory not covered by any of the \a ranges belongs to node 0.
+	\a distances is the \a nodeCount x \a nodeCount distance matrix as found
+	in the ACPI SLIT; if it is \c NULL, all remote nodes are considered to be
+	equally far away.
+	All free and clear pages are moved to the queues of their node.
+*/
+status_t
+vm_page_set_memory_nodes(const vm_memory_node_range* ranges, uint32 rangeCount,
+	uint32 nodeCount, const uint8* distances)
+{
+	if (nodeCount == 0 || nodeCount > VM_MAX_MEMORY_NODES)
+		return B_BAD_VALUE;
+
+	for (uint32 i = 0; i < rangeCount; i++) {
+		if (ranges[i].node >= nodeCount)
+			return B_BAD_VALUE;
+	}
+
+	WriteLocker locker(sFreePageQueuesLock);
+
+	// assign the pages to their nodes
+	for (page_num_t i = 0; i < sNumPages; i++)
+		sPages[i].node = 0;
+
+	for (uint32 i = 0; i < rangeCount; i++) {
+		page_num_t start = std::max(ranges[i].start / B_PAGE_SIZE,
+			(phys_addr_t)sPhysicalPageOffset);
+		page_num_t end = std::min(
+			(ranges[i].start + ranges[i].size) / B_PAGE_SIZE,
+			(phys_addr_t)(sPhysicalPageOffset + sNumPages));
+		for (page_num_t page = start; page < end; page++)
+			sPages[page - sPhysicalPageOffset].node = ranges[i].node;
+	}
+
+	// order the nodes by distance as seen from each node, the node itself
+	// always coming first
+	for (uint32 i = 0; i < nodeCount; i++) {
+		for (uint32 j = 0; j < nodeCount; j++) {
+			if (distances != NULL)
+				sMemoryNodeDistances[i][j] = distances[i * nodeCount + j];
+			else
+				sMemoryNodeDistances[i][j] = i == j ? 10 : 20;
+		}
+
+		uint8* order = sMemoryNodeOrder[i];
+		for (uint32 j = 0; j < nodeCount; j++) {
+			uint32 distance = j == i ? 0 : sMemoryNodeDistances[i][j];
+			uint32 k = j;
+			for (; k > 0; k--) {
+				uint32 other = order[k - 1];
+				if ((other == i ? 0 : sMemoryNodeDistances[i][other])
+						<= distance) {
+					break;
+				}
+				order[k] = other;
+			}
+			order[k] = j;
+		}
+	}
+
+	// move the free and clear pages to the queues of their nodes
+	VMPageQueue::PageList freePages;
+	VMPageQueue::PageList clearPages;
+	for (uint32 i = 0; i < sMemoryNodeCount; i++) {
+		while (vm_page* page = sFreePageQueues[i]->RemoveHead())
+			freePages.Add(page);
+		while (vm_page* page = sClearPageQueues[i]->RemoveHead())
+			clearPages.Add(page);
+	}
+
+	sMemoryNodeCount = nodeCount;
+
+	while (vm_page* page = freePages.RemoveHead())
+		sFreePageQueues[page->node]->Append(page);
+	while (vm_page* page = clearPages.RemoveHead())
+		sClearPageQueues[page->node]->Append(page);
+
+	for (uint32 i = 0; i < nodeCount; i++) {
+		dprintf("memory node %" B_PRIu32 ": %" B_PRIuPHYSADDR " free, %"
+			B_PRIuPHYSADDR " clear pages\n", i, sFreePageQueues[i]->Count(),
+			sClearPageQueues[i]->Count());
+	}
+
+	return B_OK;
+}
+
+
+uint32
+vm_page_memory_node_count(void)
+{
+	return sMemoryNodeCount;
+}
+
+
 vm_page *
 vm_lookup_page(page_num_t pageNumber)
 {
@@ -4163,8 +4375,8 @@ vm_page_get_stats(system_info *info)
 	//	active + inactive + unused + wired + modified + cached + free + clear
 	// So taking out the cached (including modified non-temporary), free and
 	// clear ones leaves us with all used pages.
-	uint32 subtractPages = info->cached_pages + sFreePageQueue.Count()
-		+ sClearPageQueue.Count();
+	uint32 subtractPages = info->cached_pages + free_page_queues_count()
+		+ clear_page_queues_count();
 	info->used_pages = subtractPages > info->max_pages
 		? 0 : info->max_pages - subtractPages;
 
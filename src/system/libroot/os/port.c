@@ -118,3 +118,22 @@ _get_port_message_info_etc(port_id port, port_message_info *info,
 	return _kern_get_port_message_info_etc(port, info, infoSize, flags,
 		timeout);
 }
+
+
+ssize_t
+read_port_vector_etc(port_id port, void *buffer, size_t bufferSize,
+	port_message_entry *entries, size_t entryCount, uint32 flags,
+	bigtime_t timeout)
+{
+	return _kern_read_port_vector_etc(port, buffer, bufferSize, entries,
+		entryCount, flags, timeout);
+}
+
+
+ssize_t
+write_port_vector_etc(port_id port, const port_message_entry *entries,
+	size_t entryCount, uint32 flags, bigtime_t timeout)
+{
+	return _kern_write_port_vector_etc(port, entries, entryCount, flags,
+		timeout);
+}
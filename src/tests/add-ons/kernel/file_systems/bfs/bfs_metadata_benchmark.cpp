@@ -0,0 +1,266 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures how metadata heavy workloads (like unpacking an archive, or
+	compiling) scale with the number of threads. Every thread works in its
+	own directory, and creates, writes, stats, renames, and removes small
+	files.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+extern const char* __progname;
+static const char* kProgramName = __progname;
+
+static const int32 kMaxThreads = 64;
+
+enum {
+	PHASE_CREATE = 0,
+	PHASE_STAT,
+	PHASE_RENAME,
+	PHASE_REMOVE,
+	PHASE_COUNT
+};
+
+static const char* kPhaseNames[PHASE_COUNT] = {
+	"create", "stat", "rename", "remove"
+};
+
+struct benchmark_thread {
+	const char*	base;
+	int32		index;
+	int32		files;
+	size_t		fileSize;
+	sem_id		start;
+	sem_id		done;
+	status_t	status;
+};
+
+
+static void
+usage()
+{
+	fprintf(stderr, "Usage: %s [-t <max-threads>] [-f <files-per-thread>] "
+		"[-s <file-size>] <directory>\n"
+		"The directory must be on the volume to test, and will be used for "
+		"temporary files.\n", kProgramName);
+	exit(1);
+}
+
+
+static status_t
+run_phase(benchmark_thread& thread, int32 phase, const char* directory)
+{
+	char buffer[4096];
+	memset(buffer, thread.index, sizeof(buffer));
+
+	for (int32 i = 0; i < thread.files; i++) {
+		char path[B_PATH_NAME_LENGTH];
+		snprintf(path, sizeof(path), "%s/file-%" B_PRId32, directory, i);
+		char renamed[B_PATH_NAME_LENGTH];
+		snprintf(renamed, sizeof(renamed), "%s/renamed-%" B_PRId32, directory,
+			i);
+
+		switch (phase) {
+			case PHASE_CREATE:
+			{
+				int fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+				if (fd < 0)
+					return errno;
+
+				size_t left = thread.fileSize;
+				while (left > 0) {
+					size_t toWrite = left < sizeof(buffer)
+						? left : sizeof(buffer);
+					if (write(fd, buffer, toWrite) != (ssize_t)toWrite) {
+						close(fd);
+						return errno;
+					}
+					left -= toWrite;
+				}
+				close(fd);
+				break;
+			}
+			case PHASE_STAT:
+			{
+				struct stat st;
+				if (stat(path, &st) != 0)
+					return errno;
+				if ((size_t)st.st_size != thread.fileSize)
+					return B_BAD_DATA;
+				break;
+			}
+			case PHASE_RENAME:
+				if (rename(path, renamed) != 0)
+					return errno;
+				break;
+			case PHASE_REMOVE:
+				if (unlink(renamed) != 0)
+					return errno;
+				break;
+		}
+	}
+
+	return B_OK;
+}
+
+
+static status_t
+benchmark_thread_entry(void* data)
+{
+	benchmark_thread& thread = *(benchmark_thread*)data;
+
+	char directory[B_PATH_NAME_LENGTH];
+	snprintf(directory, sizeof(directory), "%s/bfs_metadata_benchmark-%"
+		B_PRId32, thread.base, thread.index);
+
+	thread.status = B_OK;
+	if (mkdir(directory, 0755) != 0 && errno != EEXIST)
+		thread.status = errno;
+
+	release_sem(thread.done);
+
+	for (int32 phase = 0; phase < PHASE_COUNT; phase++) {
+		// all threads start each phase at the same time
+		acquire_sem(thread.start);
+
+		if (thread.status == B_OK)
+			thread.status = run_phase(thread, phase, directory);
+
+		release_sem(thread.done);
+	}
+
+	rmdir(directory);
+	return thread.status;
+}
+
+
+static status_t
+run_benchmark(const char* base, int32 threadCount, int32 files,
+	size_t fileSize, bigtime_t phaseTimes[PHASE_COUNT])
+{
+	benchmark_thread threads[kMaxThreads];
+	thread_id ids[kMaxThreads];
+
+	sem_id start = create_sem(0, "benchmark start");
+	sem_id done = create_sem(0, "benchmark done");
+	if (start < 0 || done < 0)
+		return B_NO_MORE_SEMS;
+
+	for (int32 i = 0; i < threadCount; i++) {
+		benchmark_thread& thread = threads[i];
+		thread.base = base;
+		thread.index = i;
+		thread.files = files;
+		thread.fileSize = fileSize;
+		thread.start = start;
+		thread.done = done;
+		thread.status = B_OK;
+
+		ids[i] = spawn_thread(&benchmark_thread_entry, "benchmark thread",
+			B_NORMAL_PRIORITY, &thread);
+		if (ids[i] < 0) {
+			fprintf(stderr, "%s: could not spawn thread: %s\n", kProgramName,
+				strerror(ids[i]));
+			exit(1);
+		}
+		resume_thread(ids[i]);
+	}
+
+	// wait until all threads are ready
+	acquire_sem_etc(done, threadCount, 0, 0);
+
+	for (int32 phase = 0; phase < PHASE_COUNT; phase++) {
+		sync();
+
+		bigtime_t startTime = system_time();
+		release_sem_etc(start, threadCount, 0);
+
+		// the threads report back once they are done with the phase
+		acquire_sem_etc(done, threadCount, 0, 0);
+		phaseTimes[phase] = system_time() - startTime;
+	}
+
+	status_t result = B_OK;
+	for (int32 i = 0; i < threadCount; i++) {
+		status_t status;
+		wait_for_thread(ids[i], &status);
+		if (threads[i].status != B_OK && result == B_OK)
+			result = threads[i].status;
+	}
+
+	delete_sem(start);
+	delete_sem(done);
+	return result;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 maxThreads = 8;
+	int32 files = 1000;
+	size_t fileSize = 1024;
+
+	int option;
+	while ((option = getopt(argc, argv, "t:f:s:h")) != -1) {
+		switch (option) {
+			case 't':
+				maxThreads = strtol(optarg, NULL, 0);
+				break;
+			case 'f':
+				files = strtol(optarg, NULL, 0);
+				break;
+			case 's':
+				fileSize = strtoul(optarg, NULL, 0);
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (optind + 1 != argc || maxThreads < 1 || maxThreads > kMaxThreads
+		|| files < 1) {
+		usage();
+	}
+
+	const char* base = argv[optind];
+
+	printf("%" B_PRId32 " files of %zu bytes per thread\n\n", files, fileSize);
+	printf("threads");
+	for (int32 phase = 0; phase < PHASE_COUNT; phase++)
+		printf("  %10s/s", kPhaseNames[phase]);
+	putchar('\n');
+
+	for (int32 threads = 1; threads <= maxThreads; threads *= 2) {
+		bigtime_t times[PHASE_COUNT];
+		status_t status = run_benchmark(base, threads, files, fileSize, times);
+		if (status != B_OK) {
+			fprintf(stderr, "%s: benchmark failed: %s\n", kProgramName,
+				strerror(status));
+			return 1;
+		}
+
+		printf("%7" B_PRId32, threads);
+		for (int32 phase = 0; phase < PHASE_COUNT; phase++) {
+			printf("  %12.0f", 1000000.0 * threads * files
+				/ (times[phase] > 0 ? times[phase] : 1));
+		}
+		putchar('\n');
+	}
+
+	return 0;
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Stress test for the ring transport of the userlandfs Port: one thread
+	sends a long stream of messages with pauses of varying length, so that
+	the receiver frequently goes through the spin/announce/block path. A lost
+	doorbell makes Receive() time out.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include "Port.h"
+
+
+extern const char* __progname;
+static const char* kProgramName = __progname;
+
+static const int32 kPortSize = 4096;
+static const int32 kMessageCount = 500000;
+static const bigtime_t kReceiveTimeout = 5000000;
+
+struct sender_data {
+	Port*		port;
+	status_t	status;
+};
+
+
+static uint32
+random_value(uint32& seed)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+
+static status_t
+sender_thread(void* _data)
+{
+	sender_data& data = *(sender_data*)_data;
+	uint32 seed = 42;
+
+	uint8 buffer[kPortSize];
+	for (int32 i = 0; i < kMessageCount; i++) {
+		int32 size = 4 + random_value(seed) % 256;
+		memset(buffer, i & 0xff, size);
+		*(int32*)buffer = i;
+
+		data.status = data.port->Send(buffer, size);
+		if (data.status != B_OK)
+			return data.status;
+
+		// vary the timing, so that the receiver sometimes spins, sometimes
+		// races with the doorbell, and sometimes really blocks
+		switch (random_value(seed) % 16) {
+			case 0:
+				snooze(random_value(seed) % 100);
+				break;
+			case 1:
+			case 2:
+			{
+				// about as long as the receiver spins before blocking
+				bigtime_t until = system_time() + random_value(seed) % 40;
+				while (system_time() < until)
+					;
+				break;
+			}
+			default:
+				break;
+		}
+	}
+
+	return B_OK;
+}
+
+
+int
+main()
+{
+	Port owner(kPortSize);
+	if (owner.InitCheck() != B_OK) {
+		fprintf(stderr, "%s: creating the port failed: %s\n", kProgramName,
+			strerror(owner.InitCheck()));
+		return 1;
+	}
+
+	Port client(owner.GetInfo());
+	if (client.InitCheck() != B_OK || !client.UsesRing()
+		|| !owner.UsesRing()) {
+		fprintf(stderr, "%s: the ring transport is not available\n",
+			kProgramName);
+		return 1;
+	}
+
+	sender_data data;
+	data.port = &client;
+	data.status = B_OK;
+
+	thread_id sender = spawn_thread(&sender_thread, "sender",
+		B_NORMAL_PRIORITY, &data);
+	if (sender < 0) {
+		fprintf(stderr, "%s: spawning the sender failed\n", kProgramName);
+		return 1;
+	}
+	resume_thread(sender);
+
+	bigtime_t startTime = system_time();
+	status_t status = B_OK;
+	for (int32 i = 0; i < kMessageCount; i++) {
+		void* message;
+		size_t size;
+		status = owner.Receive(&message, &size, kReceiveTimeout);
+		if (status != B_OK) {
+			fprintf(stderr, "%s: receiving message %" B_PRId32 " failed: "
+				"%s\n", kProgramName, i, strerror(status));
+			break;
+		}
+
+		bool valid = size >= 4 && *(int32*)message == i;
+		for (size_t k = 4; valid && k < size; k++)
+			valid = ((uint8*)message)[k] == (uint8)i;
+		free(message);
+
+		if (!valid) {
+			fprintf(stderr, "%s: message %" B_PRId32 " is corrupt\n",
+				kProgramName, i);
+			status = B_BAD_DATA;
+			break;
+		}
+	}
+	bigtime_t time = system_time() - startTime;
+
+	if (status != B_OK) {
+		// unblock the sender, if it waits for room in the ring
+		owner.Close();
+		kill_thread(sender);
+		return 1;
+	}
+
+	status_t senderStatus;
+	wait_for_thread(sender, &senderStatus);
+	if (data.status != B_OK) {
+		fprintf(stderr, "%s: sending failed: %s\n", kProgramName,
+			strerror(data.status));
+		return 1;
+	}
+
+	const Port::Statistics& statistics = client.GetStatistics();
+	printf("%" B_PRId32 " messages in %" B_PRId64 " ms, %" B_PRId64
+		" doorbells\n", kMessageCount, time / 1000, statistics.doorbells);
+	return 0;
+}
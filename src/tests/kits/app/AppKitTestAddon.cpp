@@ -7,6 +7,7 @@
 #include "bcursor/CursorTest.h"
 #include "bhandler/HandlerTest.h"
 #include "blooper/LooperTest.h"
+#include "bmessage/MessageFieldIndexTest.h"
 #include "bmessage/MessageTest.h"
 #include "bmessagequeue/MessageQueueTest.h"
 #include "bmessagerunner/MessageRunnerTest.h"
@@ -25,6 +26,7 @@ BTestSuite* getTestSuite2() {
 	suite->addTest("BHandler", HandlerTestSuite());
 	suite->addTest("BLooper", LooperTestSuite());
 //	suite->addTest("BMessage", MessageTestSuite());
+	suite->addTest("BMessageFieldIndex", TMessageFieldIndexTest::Suite());
 	suite->addTest("BMessageQueue", MessageQueueTestSuite());
 	suite->addTest("BMessageRunner", MessageRunnerTestSuite());
 	suite->addTest("BMessenger", MessengerTestSuite());
@@ -0,0 +1,204 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures the cost of the common BMessage field operations for messages
+	with few and with many fields: adding fields, finding them by name,
+	appending to several fields in turns, flattening, and unflattening.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <Message.h>
+#include <OS.h>
+
+
+extern const char* __progname;
+static const char* kProgramName = __progname;
+
+static const int32 kInterleavedFieldCount = 8;
+
+enum {
+	BENCHMARK_ADD = 0,
+	BENCHMARK_FIND,
+	BENCHMARK_APPEND,
+	BENCHMARK_FLATTEN,
+	BENCHMARK_UNFLATTEN,
+	BENCHMARK_COUNT
+};
+
+static const char* kBenchmarkNames[BENCHMARK_COUNT] = {
+	"add", "find", "append", "flatten", "unflatten"
+};
+
+
+static void
+usage()
+{
+	fprintf(stderr, "Usage: %s [-f <max-fields>] [-r <rounds>]\n",
+		kProgramName);
+	exit(1);
+}
+
+
+static void
+field_name(char* buffer, size_t size, int32 index)
+{
+	snprintf(buffer, size, "field-%" B_PRId32, index);
+}
+
+
+static status_t
+fill_message(BMessage& message, int32 fieldCount)
+{
+	for (int32 i = 0; i < fieldCount; i++) {
+		char name[32];
+		field_name(name, sizeof(name), i);
+		status_t status = message.AddInt32(name, i);
+		if (status != B_OK)
+			return status;
+	}
+
+	return B_OK;
+}
+
+
+static status_t
+run_benchmark(int32 benchmark, int32 fieldCount, bigtime_t& _time)
+{
+	BMessage message('bnch');
+	status_t status = B_OK;
+
+	if (benchmark != BENCHMARK_ADD && benchmark != BENCHMARK_APPEND) {
+		status = fill_message(message, fieldCount);
+		if (status != B_OK)
+			return status;
+	}
+
+	ssize_t flatSize = message.FlattenedSize();
+	char* buffer = NULL;
+	if (benchmark == BENCHMARK_FLATTEN || benchmark == BENCHMARK_UNFLATTEN) {
+		buffer = (char*)malloc(flatSize);
+		if (buffer == NULL)
+			return B_NO_MEMORY;
+
+		status = message.Flatten(buffer, flatSize);
+		if (status != B_OK) {
+			free(buffer);
+			return status;
+		}
+	}
+
+	bigtime_t startTime = system_time();
+
+	switch (benchmark) {
+		case BENCHMARK_ADD:
+			status = fill_message(message, fieldCount);
+			break;
+
+		case BENCHMARK_FIND:
+			for (int32 i = 0; i < fieldCount && status == B_OK; i++) {
+				char name[32];
+				field_name(name, sizeof(name), i);
+				int32 value;
+				status = message.FindInt32(name, &value);
+				if (status == B_OK && value != i)
+					status = B_BAD_DATA;
+			}
+			break;
+
+		case BENCHMARK_APPEND:
+			// every field grows in turn, as when building a list of records
+			for (int32 i = 0; i < fieldCount && status == B_OK; i++) {
+				char name[32];
+				field_name(name, sizeof(name), i % kInterleavedFieldCount);
+				status = message.AddString(name, "some record data");
+			}
+			break;
+
+		case BENCHMARK_FLATTEN:
+			status = message.Flatten(buffer, flatSize);
+			break;
+
+		case BENCHMARK_UNFLATTEN:
+		{
+			BMessage unflattened;
+			status = unflattened.Unflatten(buffer);
+			if (status == B_OK && unflattened.CountNames(B_ANY_TYPE)
+					!= fieldCount) {
+				status = B_BAD_DATA;
+			}
+			break;
+		}
+	}
+
+	_time = system_time() - startTime;
+
+	free(buffer);
+	return status;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 maxFields = 4096;
+	int32 rounds = 10;
+
+	int option;
+	while ((option = getopt(argc, argv, "f:r:h")) != -1) {
+		switch (option) {
+			case 'f':
+				maxFields = strtol(optarg, NULL, 0);
+				break;
+			case 'r':
+				rounds = strtol(optarg, NULL, 0);
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (optind != argc || maxFields < 1 || rounds < 1)
+		usage();
+
+	printf("microseconds per operation, best of %" B_PRId32 " rounds\n\n",
+		rounds);
+	printf("%7s", "fields");
+	for (int32 benchmark = 0; benchmark < BENCHMARK_COUNT; benchmark++)
+		printf("  %10s", kBenchmarkNames[benchmark]);
+	putchar('\n');
+
+	for (int32 fields = 4; fields <= maxFields; fields *= 4) {
+		printf("%7" B_PRId32, fields);
+
+		for (int32 benchmark = 0; benchmark < BENCHMARK_COUNT; benchmark++) {
+			bigtime_t best = B_INFINITE_TIMEOUT;
+			for (int32 round = 0; round < rounds; round++) {
+				bigtime_t time;
+				status_t status = run_benchmark(benchmark, fields, time);
+				if (status != B_OK) {
+					fprintf(stderr, "\n%s: %s failed: %s\n", kProgramName,
+						kBenchmarkNames[benchmark], strerror(status));
+					return 1;
+				}
+				if (time < best)
+					best = time;
+			}
+
+			// flattening and unflattening handle the whole message at once
+			double operations = benchmark == BENCHMARK_FLATTEN
+				|| benchmark == BENCHMARK_UNFLATTEN ? 1 : fields;
+			printf("  %10.3f", best / operations);
+		}
+		putchar('\n');
+	}
+
+	return 0;
+}
@@ -0,0 +1,303 @@
+//------------------------------------------------------------------------------
+//	MessageFieldIndexTest.cpp
+//
+//	Tests messages with enough fields to get a field index, whose fields are
+//	appended to in turn, so that their data is moved around and compacted.
+//------------------------------------------------------------------------------
+
+// Standard Includes -----------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+
+// System Includes -------------------------------------------------------------
+#include <DataIO.h>
+#include <Message.h>
+#include <String.h>
+
+// Project Includes ------------------------------------------------------------
+#include <MessagePrivate.h>
+
+// Local Includes --------------------------------------------------------------
+#include "MessageFieldIndexTest.h"
+
+// Local Defines ---------------------------------------------------------------
+
+// Globals ---------------------------------------------------------------------
+
+static const int32 kRounds = 64;
+
+
+static BString
+field_name(int32 field)
+{
+	BString name;
+	name.SetToFormat("field %" B_PRId32, field);
+	return name;
+}
+
+
+static int32
+int32_value(int32 field, int32 index)
+{
+	return field * 100000 + index;
+}
+
+
+// The strings have different lengths, so that the data of the fields grows
+// by different amounts.
+static BString
+string_value(int32 field, int32 index)
+{
+	BString value;
+	value.SetToFormat("%" B_PRId32 ":%" B_PRId32 ":", field, index);
+	value.Append('x', (field + index) % 13);
+	return value;
+}
+
+
+// Even fields get int32 values, odd fields strings.
+static status_t
+add_value(BMessage& message, const char* name, int32 field, int32 index)
+{
+	if (field % 2 == 0)
+		return message.AddInt32(name, int32_value(field, index));
+
+	return message.AddString(name, string_value(field, index));
+}
+
+
+//	Checks that the field \a name has the \a valueCount values of \a field.
+static bool
+check_field(const BMessage& message, const char* name, int32 field,
+	int32 valueCount)
+{
+	type_code type;
+	int32 count;
+	if (message.GetInfo(name, &type, &count) != B_OK || count != valueCount
+		|| type != (field % 2 == 0 ? B_INT32_TYPE : B_STRING_TYPE)) {
+		return false;
+	}
+
+	for (int32 index = 0; index < valueCount; index++) {
+		if (field % 2 == 0) {
+			int32 value;
+			if (message.FindInt32(name, index, &value) != B_OK
+				|| value != int32_value(field, index)) {
+				return false;
+			}
+		} else {
+			const char* value;
+			if (message.FindString(name, index, &value) != B_OK
+				|| string_value(field, index) != value) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+//------------------------------------------------------------------------------
+void TMessageFieldIndexTest::CheckFields(const BMessage& message,
+	int32 fieldCount, int32 valueCount)
+{
+	CPPUNIT_ASSERT(message.CountNames(B_ANY_TYPE) == fieldCount);
+
+	for (int32 field = 0; field < fieldCount; field++) {
+		CPPUNIT_ASSERT(check_field(message, field_name(field), field,
+			valueCount));
+	}
+}
+//------------------------------------------------------------------------------
+void TMessageFieldIndexTest::CheckFlatten(const BMessage& message,
+	int32 fieldCount, int32 valueCount)
+{
+	ssize_t size = message.FlattenedSize();
+	CPPUNIT_ASSERT(size > 0);
+
+	char* buffer = new char[size];
+	CPPUNIT_ASSERT(message.Flatten(buffer, size) == B_OK);
+
+	// both ways of flattening produce the same bytes
+	BMallocIO stream;
+	ssize_t streamSize;
+	CPPUNIT_ASSERT(message.Flatten(&stream, &streamSize) == B_OK);
+	CPPUNIT_ASSERT(streamSize == size);
+	CPPUNIT_ASSERT((ssize_t)stream.BufferLength() == size);
+	CPPUNIT_ASSERT(memcmp(stream.Buffer(), buffer, size) == 0);
+
+	// flattening doesn't change the message
+	CheckFields(message, fieldCount, valueCount);
+	CPPUNIT_ASSERT(message.FlattenedSize() == size);
+
+	BMessage copy;
+	CPPUNIT_ASSERT(copy.Unflatten(buffer) == B_OK);
+	CheckFields(copy, fieldCount, valueCount);
+
+	stream.Seek(0, SEEK_SET);
+	BMessage streamCopy;
+	CPPUNIT_ASSERT(streamCopy.Unflatten(&stream) == B_OK);
+	CheckFields(streamCopy, fieldCount, valueCount);
+
+	BMessage assigned;
+	assigned = message;
+	CheckFields(assigned, fieldCount, valueCount);
+
+	delete[] buffer;
+}
+//------------------------------------------------------------------------------
+/*
+	Appends to all fields of a message in turn. Every append to a field that
+	is not the last one in the data moves the field to the end, and the
+	garbage left behind is compacted once it gets too large.
+ */
+void TMessageFieldIndexTest::MessageFieldIndexTest1()
+{
+	const int32 fieldCount = 2 * MIN_INDEXED_FIELD_COUNT + 3;
+	BMessage message('tFIx');
+
+	for (int32 round = 0; round < kRounds; round++) {
+		for (int32 field = 0; field < fieldCount; field++) {
+			CPPUNIT_ASSERT(add_value(message, field_name(field), field, round)
+				== B_OK);
+		}
+
+		CheckFields(message, fieldCount, round + 1);
+	}
+
+	CheckFlatten(message, fieldCount, kRounds);
+
+	// the unflattened copy can be appended to as well
+	BMessage copy;
+	ssize_t size = message.FlattenedSize();
+	char* buffer = new char[size];
+	CPPUNIT_ASSERT(message.Flatten(buffer, size) == B_OK);
+	CPPUNIT_ASSERT(copy.Unflatten(buffer) == B_OK);
+	delete[] buffer;
+
+	for (int32 round = kRounds; round < 2 * kRounds; round++) {
+		for (int32 field = fieldCount; field-- > 0;) {
+			CPPUNIT_ASSERT(add_value(copy, field_name(field), field, round)
+				== B_OK);
+		}
+	}
+
+	CheckFields(copy, fieldCount, 2 * kRounds);
+	CheckFlatten(copy, fieldCount, 2 * kRounds);
+}
+//------------------------------------------------------------------------------
+/*
+	Renames and removes fields of a message that has a field index, and
+	checks that all other fields can still be found.
+ */
+void TMessageFieldIndexTest::MessageFieldIndexTest2()
+{
+	const int32 fieldCount = MIN_INDEXED_FIELD_COUNT + 4;
+	const int32 valueCount = 5;
+	BMessage message('tFIx');
+
+	for (int32 index = 0; index < valueCount; index++) {
+		for (int32 field = 0; field < fieldCount; field++) {
+			CPPUNIT_ASSERT(add_value(message, field_name(field), field, index)
+				== B_OK);
+		}
+	}
+	CheckFields(message, fieldCount, valueCount);
+
+	// rename a field, its data moves with it
+	CPPUNIT_ASSERT(message.Rename("field 2", "a much longer name for field 2")
+		== B_OK);
+	CPPUNIT_ASSERT(!message.HasInt32("field 2"));
+	CPPUNIT_ASSERT(check_field(message, "a much longer name for field 2", 2,
+		valueCount));
+	CPPUNIT_ASSERT(message.Rename("a much longer name for field 2", "field 2")
+		== B_OK);
+	CheckFields(message, fieldCount, valueCount);
+
+	// remove fields, until there are too few for an index
+	int32 removed = 0;
+	for (int32 field = 0; field < fieldCount; field += 2) {
+		CPPUNIT_ASSERT(message.RemoveName(field_name(field)) == B_OK);
+		removed++;
+
+		CPPUNIT_ASSERT(message.CountNames(B_ANY_TYPE) == fieldCount - removed);
+		for (int32 other = 0; other < fieldCount; other++) {
+			if (other % 2 == 0 && other <= field) {
+				CPPUNIT_ASSERT(!message.HasData(field_name(other),
+					B_ANY_TYPE));
+			} else {
+				CPPUNIT_ASSERT(check_field(message, field_name(other), other,
+					valueCount));
+			}
+		}
+	}
+
+	// and add them again
+	for (int32 index = 0; index < valueCount; index++) {
+		for (int32 field = 0; field < fieldCount; field += 2) {
+			CPPUNIT_ASSERT(add_value(message, field_name(field), field, index)
+				== B_OK);
+		}
+	}
+	CheckFields(message, fieldCount, valueCount);
+	CheckFlatten(message, fieldCount, valueCount);
+
+	// removing single values keeps the other fields intact
+	for (int32 field = 0; field < fieldCount; field++) {
+		CPPUNIT_ASSERT(message.RemoveData(field_name(field), valueCount - 1)
+			== B_OK);
+	}
+	CheckFields(message, fieldCount, valueCount - 1);
+	CheckFlatten(message, fieldCount, valueCount - 1);
+}
+//------------------------------------------------------------------------------
+/*
+	Messages are validated when they are unflattened; a corrupt one is
+	rejected, and appears to be empty.
+ */
+void TMessageFieldIndexTest::MessageFieldIndexTest3()
+{
+	const int32 fieldCount = MIN_INDEXED_FIELD_COUNT + 1;
+	BMessage message('tFIx');
+	for (int32 field = 0; field < fieldCount; field++) {
+		CPPUNIT_ASSERT(add_value(message, field_name(field), field, 0)
+			== B_OK);
+	}
+
+	ssize_t size = message.FlattenedSize();
+	char* buffer = new char[size];
+	CPPUNIT_ASSERT(message.Flatten(buffer, size) == B_OK);
+
+	// let the data of the last field point behind the end of the data
+	BMessage::field_header* fields = (BMessage::field_header*)
+		(buffer + sizeof(BMessage::message_header));
+	fields[fieldCount - 1].offset += size;
+
+	BMessage copy;
+	CPPUNIT_ASSERT(copy.Unflatten(buffer) == B_BAD_VALUE);
+	CPPUNIT_ASSERT(copy.CountNames(B_ANY_TYPE) == 0);
+	CPPUNIT_ASSERT(!copy.HasInt32("field 0"));
+
+	delete[] buffer;
+}
+//------------------------------------------------------------------------------
+TestSuite* TMessageFieldIndexTest::Suite()
+{
+	TestSuite* suite = new TestSuite("BMessage::FieldIndex");
+
+	ADD_TEST4(BMessage, suite, TMessageFieldIndexTest, MessageFieldIndexTest1);
+	ADD_TEST4(BMessage, suite, TMessageFieldIndexTest, MessageFieldIndexTest2);
+	ADD_TEST4(BMessage, suite, TMessageFieldIndexTest, MessageFieldIndexTest3);
+
+	return suite;
+}
+//------------------------------------------------------------------------------
+
+/*
+ * $Log $
+ *
+ * $Id  $
+ *
+ */
+
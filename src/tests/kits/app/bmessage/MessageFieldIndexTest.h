@@ -0,0 +1,51 @@
+//------------------------------------------------------------------------------
+//	MessageFieldIndexTest.h
+//
+//------------------------------------------------------------------------------
+
+#ifndef MESSAGEFIELDINDEXTEST_H
+#define MESSAGEFIELDINDEXTEST_H
+
+// Standard Includes -----------------------------------------------------------
+
+// System Includes -------------------------------------------------------------
+
+// Project Includes ------------------------------------------------------------
+
+// Local Includes --------------------------------------------------------------
+#include "../common.h"
+
+// Local Defines ---------------------------------------------------------------
+
+// Globals ---------------------------------------------------------------------
+
+class BMessage;
+
+class TMessageFieldIndexTest : public TestCase
+{
+	public:
+		TMessageFieldIndexTest() {;}
+		TMessageFieldIndexTest(std::string name) : TestCase(name) {;}
+
+		void MessageFieldIndexTest1();
+		void MessageFieldIndexTest2();
+		void MessageFieldIndexTest3();
+
+		static TestSuite* Suite();
+
+	private:
+		void CheckFields(const BMessage& message, int32 fieldCount,
+			int32 valueCount);
+		void CheckFlatten(const BMessage& message, int32 fieldCount,
+			int32 valueCount);
+};
+
+#endif	// MESSAGEFIELDINDEXTEST_H
+
+/*
+ * $Log $
+ *
+ * $Id  $
+ *
+ */
+
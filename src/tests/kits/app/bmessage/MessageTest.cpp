@@ -5,6 +5,7 @@
 #include "MessageDestructTest.h"
 #include "MessageOpAssignTest.h"
 #include "MessageEasyFindTest.h"
+#include "MessageFieldIndexTest.h"
 #include "MessageBoolItemTest.h"
 #include "MessageInt8ItemTest.h"
 #include "MessageInt16ItemTest.h"
@@ -31,6 +32,7 @@ Test* MessageTestSuite()
 	tests->addTest(TMessageDestructTest::Suite());
 	tests->addTest(TMessageOpAssignTest::Suite());
 	tests->addTest(TMessageEasyFindTest::Suite());
+	tests->addTest(TMessageFieldIndexTest::Suite());
 	tests->addTest(TMessageBoolItemTest::Suite());
 	tests->addTest(TMessageInt8ItemTest::Suite());
 	tests->addTest(TMessageInt16ItemTest::Suite());
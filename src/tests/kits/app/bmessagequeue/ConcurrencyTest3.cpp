@@ -0,0 +1,148 @@
+/*
+	This file implements a test class for testing BMessageQueue functionality.
+	It tests use cases Add Message 1, Count Messages and Next Message 1 with
+	several threads adding messages at the same time, which don't need to
+	lock the queue for that.
+
+	The test works like the following:
+		- It starts three threads that each add numProducerMessages messages
+		  to the queue. The what field of every message encodes the thread
+		  and the sequence number of the message.
+		- A fourth thread removes messages with NextMessage() until it has
+		  seen all of them.
+		- It checks that no message was lost or returned twice, and that the
+		  messages of every thread are returned in the order they were added.
+		- It checks that the queue is empty afterwards.
+
+	*/
+
+
+#include "ThreadedTestCaller.h"
+#include "ConcurrencyTest3.h"
+#include <MessageQueue.h>
+
+
+// This constant indicates how many messages every producer adds.
+const uint32 numProducerMessages = 20000;
+
+// This constant indicates how many producers there are.
+const uint32 numProducers = 3;
+
+
+/*
+ *  Method:  ConcurrencyTest3::ConcurrencyTest3()
+ *   Descr:  This is the constructor for this test.
+ */
+
+
+	ConcurrencyTest3::ConcurrencyTest3(std::string name) :
+		MessageQueueTestCase(name)
+{
+	}
+
+
+/*
+ *  Method:  ConcurrencyTest3::~ConcurrencyTest3()
+ *   Descr:  This is the destructor for this test.
+ */
+
+
+	ConcurrencyTest3::~ConcurrencyTest3()
+{
+	}
+
+
+/*
+ *  Method:  ConcurrencyTest3::AddMessages()
+ *   Descr:  This member function adds numProducerMessages messages to the
+ *           queue, without locking it.
+ */
+
+ void ConcurrencyTest3::AddMessages(uint32 producer)
+{
+	for (uint32 i = 0; i < numProducerMessages; i++) {
+		if (i % (numProducerMessages / 10) == 0)
+			NextSubTest();
+
+		theMessageQueue->AddMessage(new BMessage((producer << 24) | i));
+	}
+}
+
+
+ void ConcurrencyTest3::ProducerThread1(void)
+{
+	AddMessages(0);
+}
+
+
+ void ConcurrencyTest3::ProducerThread2(void)
+{
+	AddMessages(1);
+}
+
+
+ void ConcurrencyTest3::ProducerThread3(void)
+{
+	AddMessages(2);
+}
+
+
+/*
+ *  Method:  ConcurrencyTest3::ConsumerThread()
+ *   Descr:  This member function removes messages from the queue until it
+ *           has received all messages of all producers. It checks that
+ *           the messages of every producer arrive in order.
+ */
+
+ void ConcurrencyTest3::ConsumerThread(void)
+{
+	uint32 nextMessage[numProducers] = { 0 };
+	uint32 received = 0;
+	bigtime_t timeout = system_time() + 60000000LL;
+
+	while (received < numProducers * numProducerMessages) {
+		BMessage *theMessage = theMessageQueue->NextMessage();
+		if (theMessage == NULL) {
+			CPPUNIT_ASSERT(system_time() < timeout);
+			snooze(100);
+			continue;
+		}
+
+		uint32 producer = theMessage->what >> 24;
+		uint32 sequence = theMessage->what & 0xffffff;
+		delete theMessage;
+
+		CPPUNIT_ASSERT(producer < numProducers);
+		CPPUNIT_ASSERT(sequence == nextMessage[producer]);
+		nextMessage[producer]++;
+		received++;
+	}
+
+	NextSubTest();
+	CPPUNIT_ASSERT(theMessageQueue->NextMessage() == NULL);
+	CPPUNIT_ASSERT(theMessageQueue->IsEmpty());
+	CPPUNIT_ASSERT(theMessageQueue->CountMessages() == 0);
+}
+
+
+/*
+ *  Method:  ConcurrencyTest3::suite()
+ *   Descr:  This static member function returns a test caller for performing
+ *           the "ConcurrencyTest3" test with three producer threads and one
+ *           consumer thread.
+ */
+
+ Test *ConcurrencyTest3::suite(void)
+{
+	typedef BThreadedTestCaller<ConcurrencyTest3>
+		ConcurrencyTest3Caller;
+	ConcurrencyTest3 *theTest = new ConcurrencyTest3("");
+	ConcurrencyTest3Caller *testCaller = new ConcurrencyTest3Caller(
+		"BMessageQueue::Concurrency Test #3", theTest);
+	testCaller->addThread("A", &ConcurrencyTest3::ProducerThread1);
+	testCaller->addThread("B", &ConcurrencyTest3::ProducerThread2);
+	testCaller->addThread("C", &ConcurrencyTest3::ProducerThread3);
+	testCaller->addThread("D", &ConcurrencyTest3::ConsumerThread);
+
+	return(testCaller);
+	}
@@ -0,0 +1,32 @@
+/*
+	This file defines a class for testing that BMessageQueue keeps all
+	messages, and their order, when many threads add messages at once.
+
+	*/
+
+
+#ifndef ConcurrencyTest3_H
+#define ConcurrencyTest3_H
+
+
+#include "MessageQueueTestCase.h"
+#include "../common.h"
+
+
+ class ConcurrencyTest3 :
+	public MessageQueueTestCase {
+
+private:
+	void AddMessages(uint32 producer);
+
+public:
+	static Test *suite(void);
+	void ProducerThread1(void);
+	void ProducerThread2(void);
+	void ProducerThread3(void);
+	void ConsumerThread(void);
+	ConcurrencyTest3(std::string);
+	virtual ~ConcurrencyTest3();
+	};
+
+#endif
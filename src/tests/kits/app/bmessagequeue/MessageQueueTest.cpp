@@ -3,6 +3,7 @@
 #include "AddMessageTest2.h"
 #include "ConcurrencyTest1.h"
 #include "ConcurrencyTest2.h"
+#include "ConcurrencyTest3.h"
 #include "FindMessageTest1.h"
 
 Test *MessageQueueTestSuite()
@@ -13,6 +14,7 @@ Test *MessageQueueTestSuite()
 	testSuite->addTest(AddMessageTest2::suite());
 	testSuite->addTest(ConcurrencyTest1::suite());
 //	testSuite->addTest(ConcurrencyTest2::suite());	// Causes an "Abort" for some reason...
+	testSuite->addTest(ConcurrencyTest3::suite());
 	testSuite->addTest(FindMessageTest1::suite());
 	
 	return(testSuite);
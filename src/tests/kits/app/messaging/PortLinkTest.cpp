@@ -95,6 +95,25 @@ main()
 	get_next_message(receiver, 'tst4');
 	get_next_message(receiver, 'tst5');
 
+	// more port messages than the receiver reads at once
+	for (int32 i = 0; i < 40; i++) {
+		sender.StartMessage('tst6');
+		sender.Attach<int32>(i);
+		if (sender.Flush() != B_OK) {
+			fprintf(stderr, "flushing message %ld failed!\n", i);
+			return -1;
+		}
+	}
+
+	for (int32 i = 0; i < 40; i++) {
+		get_next_message(receiver, 'tst6');
+
+		if (receiver.Read<int32>(&value) != B_OK || value != i) {
+			fprintf(stderr, "batched message %ld is wrong!\n", i);
+			return -1;
+		}
+	}
+
 	int32 code;
 	status = receiver.GetNextMessage(code, 0);
 	if (status != B_WOULD_BLOCK) {
@@ -0,0 +1,104 @@
+#!/bin/sh
+
+# Measures how fast the package tool compresses the heap with an increasing
+# number of compression threads, and verifies that the resulting packages
+# are identical.
+#
+# usage: package_compression_bench.sh <package tool> [ <content directory> ]
+#
+# The package tool can be the build tool, e.g.
+# generated/objects/linux/x86_64/release/tools/package/package
+# If no content directory is given, some compressible and some incompressible
+# files are generated.
+
+if [ $# -lt 1 ] || [ $# -gt 2 ]; then
+	echo "usage: $0 <package tool> [ <content directory> ]"
+	exit 1
+fi
+
+packageTool=$(realpath "$1")
+testDir=/tmp/package_compression_bench
+contentDir=$testDir/content
+
+rm -rf $testDir
+mkdir -p $contentDir
+
+if [ $# -eq 2 ]; then
+	cp -a "$2"/. $contentDir
+else
+	for i in $(seq 16); do
+		seq $((i * 100000)) > $contentDir/text$i
+		head -c 2097152 /dev/urandom > $contentDir/random$i
+	done
+fi
+
+cat << EOF > $contentDir/.PackageInfo
+name			compression_bench
+version			1.0-1
+architecture	any
+summary			"Package compression benchmark"
+description		"Contents for measuring package compression throughput."
+packager		"Haiku <build@haiku-os.org>"
+vendor			"Haiku Project"
+copyrights		"2026 Haiku, Inc."
+licenses		"MIT"
+provides {
+	compression_bench = 1.0-1
+}
+EOF
+
+contentSize=$(du -sk $contentDir | cut -f1)
+cpuCount=$(getconf _NPROCESSORS_ONLN)
+echo "content: $contentSize KiB, $cpuCount CPUs"
+
+# prints the seconds the given command takes
+measure()
+{
+	start=$(date +%s.%N)
+	"$@" > /dev/null || exit 1
+	end=$(date +%s.%N)
+	echo "$end - $start" | bc
+}
+
+printf "%-8s %-10s %10s %10s %10s\n" threads command seconds "KiB/s" speedup
+
+threads=1
+while true; do
+	for command in create recompress; do
+		output=$testDir/$command-$threads.hpkg
+		if [ $command = create ]; then
+			seconds=$(cd $contentDir && measure \
+				env PACKAGE_COMPRESSION_THREADS=$threads \
+				$packageTool create -q $output)
+		else
+			seconds=$(measure env PACKAGE_COMPRESSION_THREADS=$threads \
+				$packageTool recompress -q $testDir/create-1.hpkg $output)
+		fi
+		if [ -z "$seconds" ]; then
+			echo "$command with $threads threads failed!"
+			exit 1
+		fi
+
+		if [ $threads -eq 1 ]; then
+			eval single_$command=$seconds
+		elif ! cmp -s $output $testDir/$command-1.hpkg; then
+			echo "$command with $threads threads created a different package!"
+			exit 1
+		fi
+
+		eval single=\$single_$command
+		printf "%-8s %-10s %10.2f %10.0f %10.2f\n" $threads $command $seconds \
+			$(echo "$contentSize / $seconds" | bc -l) \
+			$(echo "$single / $seconds" | bc -l)
+	done
+
+	if [ $threads -ge $cpuCount ]; then
+		break
+	fi
+	threads=$((threads * 2))
+	if [ $threads -gt $cpuCount ]; then
+		threads=$cpuCount
+	fi
+done
+
+rm -rf $testDir
@@ -0,0 +1,305 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Compares the SIMD versions of the app_server span functions against the
+	plain C versions pixel by pixel, and measures how fast each of them is.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <GraphicsDefs.h>
+#include <OS.h>
+
+#include "BlendSpans.h"
+
+
+extern const char* __progname;
+static const char* kProgramName = __progname;
+
+static const uint32 kMaxPixels = 1024;
+static const uint32 kBenchmarkPixels = 1920;
+static const int32 kBenchmarkRuns = 2000;
+
+static const uint8 kCovers[] = { 1, 2, 127, 128, 129, 254, 255 };
+static const uint16 kAlphas[] = { 1, 254, 255, 256, 32767, 32768, 65024,
+	65025 };
+
+enum {
+	kAlphaRow,
+	kOverRow,
+	kCopy,
+	kOver,
+	kAlphaCO,
+	kAlphaPC,
+	kBlend,
+	kAlphaFill,
+
+	kFunctionCount
+};
+
+static const char* kFunctionNames[] = {
+	"alpha row",
+	"over row",
+	"copy",
+	"over",
+	"alpha CO",
+	"alpha PC",
+	"blend",
+	"alpha fill"
+};
+
+struct implementation {
+	const char*					name;
+	const blend_span_functions*	functions;
+	bool						supported;
+};
+
+static uint32 sRandomSeed = 1;
+static int32 sFailures = 0;
+
+
+static uint32
+random_value()
+{
+	sRandomSeed = sRandomSeed * 1103515245 + 12345;
+	return sRandomSeed >> 8;
+}
+
+
+/*!	Fills the pixels with random values, but makes sure that the alpha
+	values that are handled specially show up often.
+*/
+static void
+fill_random(uint8* pixels, uint32 count)
+{
+	for (uint32 i = 0; i < count; i++, pixels += 4) {
+		uint32 value = random_value();
+		pixels[0] = value;
+		pixels[1] = value >> 8;
+		pixels[2] = value >> 16;
+
+		switch (random_value() % 4) {
+			case 0:
+				pixels[3] = 0;
+				break;
+			case 1:
+			case 2:
+				pixels[3] = 255;
+				break;
+			default:
+				pixels[3] = random_value();
+				break;
+		}
+	}
+}
+
+
+static void
+call(const blend_span_functions& functions, int32 function, uint8* dst,
+	const uint8* src, uint32 count, uint32 parameter)
+{
+	switch (function) {
+		case kAlphaRow:
+			functions.alpha_row(dst, src, count);
+			break;
+		case kOverRow:
+			functions.over_row(dst, src, count);
+			break;
+		case kCopy:
+			functions.copy(dst, src, count);
+			break;
+		case kOver:
+			functions.over(dst, src, count, parameter);
+			break;
+		case kAlphaCO:
+			functions.alpha_co(dst, src, count, parameter);
+			break;
+		case kAlphaPC:
+			functions.alpha_pc(dst, src, count, parameter);
+			break;
+		case kBlend:
+			functions.blend(dst, src, count, parameter);
+			break;
+		case kAlphaFill:
+			functions.alpha_fill(dst, count, src[0], src[1], src[2],
+				parameter);
+			break;
+	}
+}
+
+
+static void
+compare(const implementation& implementation, int32 function, uint32 count,
+	uint32 parameter)
+{
+	uint8 src[kMaxPixels * 4];
+	uint8 dst[kMaxPixels * 4 + 4];
+	uint8 expected[kMaxPixels * 4 + 4];
+
+	fill_random(src, count);
+	fill_random(dst, count + 1);
+
+	// some rows must be fully opaque for the fast path of alpha PC
+	if (random_value() % 2 == 0) {
+		for (uint32 i = 0; i < count; i++)
+			dst[i * 4 + 3] = 255;
+	}
+
+	// some colors should be transparent magic for over row
+	if (function == kOverRow) {
+		for (uint32 i = 0; i < count; i += 3)
+			*(uint32*)(src + i * 4) = B_TRANSPARENT_MAGIC_RGBA32;
+	}
+
+	memcpy(expected, dst, sizeof(dst));
+	call(gBlendSpansC, function, expected, src, count, parameter);
+	call(*implementation.functions, function, dst, src, count, parameter);
+
+	if (memcmp(dst, expected, count * 4 + 4) == 0)
+		return;
+
+	for (uint32 i = 0; i <= count; i++) {
+		if (memcmp(dst + i * 4, expected + i * 4, 4) == 0)
+			continue;
+
+		if (sFailures++ < 20) {
+			const uint8* pixel = dst + i * 4;
+			const uint8* expectedPixel = expected + i * 4;
+			fprintf(stderr, "%s: %s %s differs, %" B_PRIu32 " pixels, "
+				"parameter %" B_PRIu32 ", pixel %" B_PRIu32 ": "
+				"%02x%02x%02x%02x instead of %02x%02x%02x%02x\n",
+				kProgramName, implementation.name, kFunctionNames[function],
+				count, parameter, i, pixel[0], pixel[1], pixel[2], pixel[3],
+				expectedPixel[0], expectedPixel[1], expectedPixel[2],
+				expectedPixel[3]);
+		}
+		break;
+	}
+}
+
+
+static void
+test(const implementation& implementation)
+{
+	for (int32 function = 0; function < kFunctionCount; function++) {
+		for (uint32 count = 0; count <= kMaxPixels;
+				count += count < 40 ? 1 : 97) {
+			switch (function) {
+				case kOver:
+				case kBlend:
+					for (uint32 i = 0; i < B_COUNT_OF(kCovers); i++)
+						compare(implementation, function, count, kCovers[i]);
+					compare(implementation, function, count,
+						1 + random_value() % 255);
+					break;
+
+				case kAlphaCO:
+				case kAlphaPC:
+				{
+					for (uint32 i = 0; i < B_COUNT_OF(kAlphas); i++)
+						compare(implementation, function, count, kAlphas[i]);
+
+					uint32 alpha = (1 + random_value() % 255)
+						* (1 + random_value() % 255);
+					compare(implementation, function, count, alpha);
+					break;
+				}
+
+				case kAlphaFill:
+					for (uint32 i = 0; i < B_COUNT_OF(kCovers); i++)
+						compare(implementation, function, count, kCovers[i]);
+					compare(implementation, function, count, 0);
+					break;
+
+				default:
+					compare(implementation, function, count, 0);
+					break;
+			}
+		}
+	}
+}
+
+
+static void
+benchmark(const implementation& implementation)
+{
+	uint8* src = (uint8*)malloc(kBenchmarkPixels * 4);
+	uint8* dst = (uint8*)malloc(kBenchmarkPixels * 4);
+	if (src == NULL || dst == NULL) {
+		fprintf(stderr, "%s: out of memory\n", kProgramName);
+		exit(1);
+	}
+
+	fill_random(src, kBenchmarkPixels);
+	fill_random(dst, kBenchmarkPixels);
+	for (uint32 i = 0; i < kBenchmarkPixels; i++)
+		dst[i * 4 + 3] = 255;
+
+	printf("%-6s", implementation.name);
+	for (int32 function = 0; function < kFunctionCount; function++) {
+		uint32 parameter = 128;
+		if (function == kAlphaCO || function == kAlphaPC)
+			parameter = 128 * 255;
+
+		bigtime_t startTime = system_time();
+		for (int32 run = 0; run < kBenchmarkRuns; run++) {
+			call(*implementation.functions, function, dst, src,
+				kBenchmarkPixels, parameter);
+		}
+		bigtime_t time = system_time() - startTime;
+		if (time <= 0)
+			time = 1;
+
+		printf(" %7.0f", 1.0 * kBenchmarkRuns * kBenchmarkPixels / time);
+	}
+	printf("\n");
+
+	free(src);
+	free(dst);
+}
+
+
+int
+main()
+{
+	implementation implementations[] = {
+		{ "C", &gBlendSpansC, true },
+#if BLEND_SPANS_X86_SIMD
+		{ "SSE2", &gBlendSpansSSE2, __builtin_cpu_supports("sse2") != 0 },
+		{ "AVX2", &gBlendSpansAVX2, __builtin_cpu_supports("avx2") != 0 },
+#endif
+	};
+
+	for (uint32 i = 1; i < B_COUNT_OF(implementations); i++) {
+		if (implementations[i].supported)
+			test(implementations[i]);
+		else
+			printf("%s is not supported by this CPU.\n",
+				implementations[i].name);
+	}
+
+	if (sFailures > 0) {
+		fprintf(stderr, "%s: %" B_PRId32 " mismatches!\n", kProgramName,
+			sFailures);
+		return 1;
+	}
+
+	// pixels per microsecond for each function
+	printf("%-6s", "");
+	for (int32 function = 0; function < kFunctionCount; function++)
+		printf(" %7.7s", kFunctionNames[function]);
+	printf("\n");
+
+	for (uint32 i = 0; i < B_COUNT_OF(implementations); i++) {
+		if (implementations[i].supported)
+			benchmark(implementations[i]);
+	}
+
+	return 0;
+}
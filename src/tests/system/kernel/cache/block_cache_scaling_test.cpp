@@ -0,0 +1,189 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures how block_cache_get()/block_cache_put() scale when a single
+	block cache is used from an increasing number of threads.
+*/
+
+
+#include "block_cache_test_io.h"
+
+#define write_pos	block_cache_write_pos
+#define writev_pos	block_cache_writev_pos
+#define read_pos	block_cache_read_pos
+
+#include "block_cache.cpp"
+
+#undef write_pos
+#undef writev_pos
+#undef read_pos
+
+#include <stdio.h>
+
+
+static const size_t kBlockSize = 2048;
+static const int32 kMaxThreads = 256;
+
+static void* sCache;
+static off_t sBlockCount = 4096;
+static bigtime_t sDuration = 2000000;
+static int32 sMaxThreads;
+
+static int32 sStart;
+static int32 sStop;
+static int32 sErrors;
+
+
+ssize_t
+block_cache_write_pos(int fd, off_t offset, const void* buffer, size_t size)
+{
+	return size;
+}
+
+
+ssize_t
+block_cache_read_pos(int fd, off_t offset, void* buffer, size_t size)
+{
+	memset(buffer, 0, size);
+	*(off_t*)buffer = offset / kBlockSize;
+	return size;
+}
+
+
+static status_t
+hammer_thread(void* _count)
+{
+	uint64* _operations = (uint64*)_count;
+	uint32 seed = find_thread(NULL) * 2654435761U;
+	uint64 operations = 0;
+
+	while (atomic_get(&sStart) == 0)
+		snooze(100);
+
+	while (atomic_get(&sStop) == 0) {
+		for (int32 i = 0; i < 256; i++) {
+			seed = seed * 1103515245 + 12345;
+			off_t blockNumber = (seed >> 8) % sBlockCount;
+
+			const void* block = block_cache_get(sCache, blockNumber);
+			if (block == NULL || *(off_t*)block != blockNumber)
+				atomic_add(&sErrors, 1);
+			if (block != NULL)
+				block_cache_put(sCache, blockNumber);
+		}
+		operations += 256;
+	}
+
+	*_operations = operations;
+	return B_OK;
+}
+
+
+static uint64
+run(int32 threadCount)
+{
+	thread_id threads[kMaxThreads];
+	uint64 operations[kMaxThreads];
+
+	atomic_set(&sStart, 0);
+	atomic_set(&sStop, 0);
+
+	for (int32 i = 0; i < threadCount; i++) {
+		operations[i] = 0;
+		threads[i] = spawn_thread(&hammer_thread, "block cache hammer",
+			B_NORMAL_PRIORITY, &operations[i]);
+		resume_thread(threads[i]);
+	}
+
+	atomic_set(&sStart, 1);
+	snooze(sDuration);
+	atomic_set(&sStop, 1);
+
+	uint64 total = 0;
+	for (int32 i = 0; i < threadCount; i++) {
+		status_t returnValue;
+		wait_for_thread(threads[i], &returnValue);
+		total += operations[i];
+	}
+
+	return total;
+}
+
+
+static void
+usage()
+{
+	fprintf(stderr, "usage: block_cache_scaling_test [-b <blocks>] "
+		"[-t <max-threads>] [-s <seconds>]\n");
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	system_info info;
+	get_system_info(&info);
+	sMaxThreads = info.cpu_count;
+
+	for (int i = 1; i < argc; i++) {
+		if (i + 1 >= argc)
+			usage();
+
+		if (!strcmp(argv[i], "-b"))
+			sBlockCount = strtoll(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-t"))
+			sMaxThreads = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-s"))
+			sDuration = strtol(argv[++i], NULL, 0) * 1000000LL;
+		else
+			usage();
+	}
+	if (sBlockCount < 1 || sMaxThreads < 1 || sMaxThreads > kMaxThreads
+		|| sDuration <= 0)
+		usage();
+
+	block_cache_init();
+
+	sCache = block_cache_create(-1, sBlockCount, kBlockSize, true);
+	if (sCache == NULL) {
+		fprintf(stderr, "Could not create block cache!\n");
+		return 1;
+	}
+
+	// read in all blocks once, so that only cache hits are measured
+	for (off_t i = 0; i < sBlockCount; i++) {
+		if (block_cache_get(sCache, i) != NULL)
+			block_cache_put(sCache, i);
+	}
+
+	printf("%" B_PRIdOFF " blocks, %" B_PRId64 " seconds per run\n",
+		sBlockCount, sDuration / 1000000);
+	printf("threads     ops/sec  ops/sec/thread  speedup\n");
+
+	double single = 0;
+	for (int32 threads = 1;; threads = min_c(threads * 2, sMaxThreads)) {
+		double perSecond = run(threads) * 1000000.0 / sDuration;
+		if (threads == 1)
+			single = perSecond;
+
+		printf("%7" B_PRId32 " %11.0f %15.0f %8.2f\n", threads, perSecond,
+			perSecond / threads, single > 0 ? perSecond / single : 0);
+
+		if (threads == sMaxThreads)
+			break;
+	}
+
+	block_cache_delete(sCache, false);
+
+	if (sErrors != 0) {
+		fprintf(stderr, "%" B_PRId32 " blocks had the wrong contents!\n",
+			sErrors);
+		return 1;
+	}
+
+	return 0;
+}
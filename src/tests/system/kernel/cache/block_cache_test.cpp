@@ -4,12 +4,16 @@
  */
 
 
+#include "block_cache_test_io.h"
+
 #define write_pos	block_cache_write_pos
+#define writev_pos	block_cache_writev_pos
 #define read_pos	block_cache_read_pos
 
 #include "block_cache.cpp"
 
 #undef write_pos
+#undef writev_pos
 #undef read_pos
 
 
@@ -189,7 +193,7 @@ test_blocks(off_t number, int32 count, int32 line)
 	for (int32 i = 0; i < count; i++, number++) {
 		MutexLocker locker(&gCache->lock);
 
-		cached_block* block = (cached_block*)hash_lookup(gCache->hash, &number);
+		cached_block* block = gCache->Lookup(number);
 		if (block == NULL) {
 			if (gBlocks[number].present)
 				error(line, "Block %lld not found!", number);
@@ -0,0 +1,31 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "block_cache_test_io.h"
+
+
+ssize_t (*gBlockCacheWritev)(int fd, off_t offset, const iovec* vecs,
+	int count) = NULL;
+
+
+ssize_t
+block_cache_writev_pos(int fd, off_t offset, const iovec* vecs, int count)
+{
+	if (gBlockCacheWritev != NULL)
+		return gBlockCacheWritev(fd, offset, vecs, count);
+
+	ssize_t total = 0;
+	for (int i = 0; i < count; i++) {
+		ssize_t written = block_cache_write_pos(fd, offset + total,
+			vecs[i].iov_base, vecs[i].iov_len);
+		if (written < 0)
+			return written;
+
+		total += written;
+	}
+
+	return total;
+}
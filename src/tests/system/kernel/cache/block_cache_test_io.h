@@ -0,0 +1,29 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef BLOCK_CACHE_TEST_IO_H
+#define BLOCK_CACHE_TEST_IO_H
+
+
+#include <sys/uio.h>
+
+#include <SupportDefs.h>
+
+
+// The tests compile the block cache with these in place of write_pos(),
+// writev_pos(), and read_pos(). Each test implements the first and the last
+// one; block_cache_writev_pos() is implemented in block_cache_test_io.cpp.
+ssize_t block_cache_write_pos(int fd, off_t offset, const void* buffer,
+	size_t size);
+ssize_t block_cache_writev_pos(int fd, off_t offset, const iovec* vecs,
+	int count);
+ssize_t block_cache_read_pos(int fd, off_t offset, void* buffer, size_t size);
+
+// If set, vectored writes are passed on to this function, otherwise they are
+// split into one block_cache_write_pos() call per vector.
+extern ssize_t (*gBlockCacheWritev)(int fd, off_t offset, const iovec* vecs,
+	int count);
+
+
+#endif	// BLOCK_CACHE_TEST_IO_H
@@ -0,0 +1,215 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures how fast the block cache writes back transactions to a file.
+	Every transaction changes a number of runs of adjacent blocks at random
+	positions, and is then flushed with block_cache_sync().
+	With -1, the vectored writes of the block cache are split into one request
+	per block again, for comparison.
+*/
+
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+
+// The block cache uses these to access the file, so that its requests can be
+// counted
+#include "block_cache_test_io.h"
+
+#define write_pos	block_cache_write_pos
+#define writev_pos	block_cache_writev_pos
+#define read_pos	block_cache_read_pos
+
+#include "block_cache.cpp"
+
+#undef write_pos
+#undef writev_pos
+#undef read_pos
+
+
+static const char* sFile = "/tmp/block_cache_writeback_test";
+static size_t sBlockSize = 2048;
+static off_t sBlockCount = 16384;
+static int32 sRunCount = 64;
+static int32 sRunLength = 8;
+static int32 sTransactions = 200;
+static bool sSingleBlockWrites = false;
+
+static int64 sRequests;
+static int64 sBytesWritten;
+
+
+ssize_t
+block_cache_write_pos(int fd, off_t offset, const void* buffer, size_t size)
+{
+	ssize_t written = write_pos(fd, offset, buffer, size);
+	if (written > 0) {
+		atomic_add64(&sRequests, 1);
+		atomic_add64(&sBytesWritten, written);
+	}
+	return written;
+}
+
+
+static ssize_t
+vectored_write_pos(int fd, off_t offset, const iovec* vecs, int count)
+{
+	ssize_t written = writev_pos(fd, offset, vecs, count);
+	if (written > 0) {
+		atomic_add64(&sRequests, 1);
+		atomic_add64(&sBytesWritten, written);
+	}
+	return written;
+}
+
+
+ssize_t
+block_cache_read_pos(int fd, off_t offset, void* buffer, size_t size)
+{
+	return read_pos(fd, offset, buffer, size);
+}
+
+
+static status_t
+write_transaction(void* cache, uint32& seed)
+{
+	int32 id = cache_start_transaction(cache);
+	if (id < B_OK)
+		return id;
+
+	for (int32 run = 0; run < sRunCount; run++) {
+		seed = seed * 1103515245 + 12345;
+		off_t start = (seed >> 8) % (sBlockCount - sRunLength + 1);
+
+		for (int32 i = 0; i < sRunLength; i++) {
+			void* block = block_cache_get_writable(cache, start + i, id);
+			if (block == NULL) {
+				cache_abort_transaction(cache, id);
+				return B_NO_MEMORY;
+			}
+
+			memset(block, (uint8)seed, sBlockSize);
+			block_cache_put(cache, start + i);
+		}
+	}
+
+	status_t status = cache_end_transaction(cache, id, NULL, NULL);
+	if (status != B_OK)
+		return status;
+
+	return block_cache_sync(cache);
+}
+
+
+static void
+usage()
+{
+	fprintf(stderr, "usage: block_cache_writeback_test [-1] [-f <file>] "
+		"[-s <block-size>] [-b <blocks>] [-r <runs>] [-l <run-length>] "
+		"[-t <transactions>]\n");
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-1")) {
+			sSingleBlockWrites = true;
+			continue;
+		}
+		if (i + 1 >= argc)
+			usage();
+
+		if (!strcmp(argv[i], "-f"))
+			sFile = argv[++i];
+		else if (!strcmp(argv[i], "-s"))
+			sBlockSize = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-b"))
+			sBlockCount = strtoll(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-r"))
+			sRunCount = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-l"))
+			sRunLength = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-t"))
+			sTransactions = strtol(argv[++i], NULL, 0);
+		else
+			usage();
+	}
+	if (sBlockSize < 512 || sBlockCount < 1 || sRunCount < 1
+		|| sRunLength < 1 || sRunLength > sBlockCount || sTransactions < 1)
+		usage();
+
+	if (!sSingleBlockWrites)
+		gBlockCacheWritev = &vectored_write_pos;
+
+	int fd = open(sFile, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "Could not create \"%s\": %s\n", sFile,
+			strerror(errno));
+		return 1;
+	}
+
+	if (ftruncate(fd, sBlockCount * sBlockSize) != 0) {
+		fprintf(stderr, "Could not resize \"%s\": %s\n", sFile,
+			strerror(errno));
+		close(fd);
+		unlink(sFile);
+		return 1;
+	}
+
+	block_cache_init();
+
+	void* cache = block_cache_create(fd, sBlockCount, sBlockSize, false);
+	if (cache == NULL) {
+		fprintf(stderr, "Could not create block cache!\n");
+		close(fd);
+		unlink(sFile);
+		return 1;
+	}
+
+	printf("%" B_PRIdOFF " blocks of %" B_PRIuSIZE " bytes, %" B_PRId32
+		" runs of %" B_PRId32 " blocks per transaction, %s\n", sBlockCount,
+		sBlockSize, sRunCount, sRunLength,
+		sSingleBlockWrites ? "single block writes" : "vectored writes");
+
+	uint32 seed = 42;
+	status_t status = B_OK;
+	bigtime_t start = system_time();
+
+	for (int32 i = 0; i < sTransactions; i++) {
+		status = write_transaction(cache, seed);
+		if (status != B_OK) {
+			fprintf(stderr, "Transaction %" B_PRId32 " failed: %s\n", i,
+				strerror(status));
+			break;
+		}
+	}
+
+	bigtime_t duration = max_c(system_time() - start, 1);
+
+	block_cache_delete(cache, true);
+	close(fd);
+	unlink(sFile);
+
+	if (status != B_OK)
+		return 1;
+
+	double seconds = duration / 1000000.0;
+	printf("transactions/sec:  %10.1f\n", sTransactions / seconds);
+	printf("MB/sec:            %10.2f\n",
+		sBytesWritten / seconds / (1024 * 1024));
+	printf("write requests:    %10" B_PRId64 " (%.0f IOPS)\n", sRequests,
+		sRequests / seconds);
+	printf("bytes per request: %10.0f\n",
+		sRequests > 0 ? (double)sBytesWritten / sRequests : 0.0);
+
+	return 0;
+}
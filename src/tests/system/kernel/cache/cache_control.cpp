@@ -10,8 +10,12 @@
 
 #include <file_cache.h>
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 
 extern const char *__progname;
@@ -20,7 +24,7 @@ extern const char *__progname;
 void
 usage()
 {
-	fprintf(stderr, "usage: %s [clear | unset | set <module-name>]\n", __progname);
+	fprintf(stderr, "usage: %s [clear | unset | set <module-name> | stats <file>]\n", __progname);
 	exit(0);
 }
 
@@ -50,6 +54,27 @@ main(int argc, char **argv)
 		status = _kern_generic_syscall(CACHE_SYSCALLS, CACHE_SET_MODULE, argv[2], strlen(argv[2]));
 		if (status != B_OK)
 			fprintf(stderr, "%s: setting the module failed: %s\n", __progname, strerror(status));
+	} else if (!strcmp(argv[1], "stats") && argc > 2) {
+		int fd = open(argv[2], O_RDONLY);
+		if (fd < 0) {
+			fprintf(stderr, "%s: could not open \"%s\": %s\n", __progname, argv[2], strerror(errno));
+			return 1;
+		}
+
+		file_cache_stats_args args;
+		args.fd = fd;
+		status = _kern_generic_syscall(CACHE_SYSCALLS, CACHE_GET_STATS, &args, sizeof(args));
+		close(fd);
+		if (status != B_OK) {
+			fprintf(stderr, "%s: getting the cache statistics failed: %s\n", __progname, strerror(status));
+			return 1;
+		}
+
+		printf("hits:             %" B_PRIu64 " pages\n", args.stats.hits);
+		printf("misses:           %" B_PRIu64 " pages\n", args.stats.misses);
+		printf("read ahead:       %" B_PRIu64 " pages\n", args.stats.readahead_pages);
+		printf("streams:          %" B_PRIu32 "\n", args.stats.streams);
+		printf("readahead window: %" B_PRIu32 " KB\n", args.stats.readahead_window / 1024);
 	} else
 		usage();
 
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Creates a B_LARGE_PAGE_AREA, checks whether it is mapped using large
+	pages, and that its contents survive splitting the large pages up again.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <syscalls.h>
+#include <vm_defs.h>
+
+
+static const size_t kAreaSize = 16 * 1024 * 1024;
+
+
+static bool
+get_large_page_info(area_id area, area_large_page_info& info)
+{
+	status_t status = _kern_get_area_large_page_info(area, &info);
+	if (status != B_OK) {
+		fprintf(stderr, "Failed to get large page info: %s\n",
+			strerror(status));
+		return false;
+	}
+
+	printf("large pages: size %#zx, %zu mapped, %" B_PRIu32 " faults, %"
+		B_PRIu32 " fallbacks\n", info.page_size, info.mapped_pages,
+		info.faults, info.fallbacks);
+	return true;
+}
+
+
+int
+main()
+{
+	uint8* address;
+	area_id area = create_area("large page area", (void**)&address,
+		B_ANY_ADDRESS, kAreaSize, B_NO_LOCK,
+		B_READ_AREA | B_WRITE_AREA | B_LARGE_PAGE_AREA);
+	if (area < 0) {
+		fprintf(stderr, "Failed to create area: %s\n", strerror(area));
+		return 1;
+	}
+
+	// touch all pages
+	for (size_t offset = 0; offset < kAreaSize; offset += B_PAGE_SIZE)
+		*(uint32*)(address + offset) = offset / B_PAGE_SIZE;
+
+	area_large_page_info info;
+	if (!get_large_page_info(area, info))
+		return 1;
+
+	if (info.page_size == 0) {
+		printf("Large pages are not supported on this platform.\n");
+		delete_area(area);
+		return 0;
+	}
+
+	if (info.mapped_pages == 0 && info.fallbacks == 0) {
+		fprintf(stderr, "No large pages have been used!\n");
+		return 1;
+	}
+
+	// write protect a single page, which splits its large page
+	size_t mappedPages = info.mapped_pages;
+	if (mappedPages > 0) {
+		if (_kern_set_memory_protection(address + B_PAGE_SIZE, B_PAGE_SIZE,
+				B_READ_AREA) != B_OK) {
+			fprintf(stderr, "Failed to set memory protection!\n");
+			return 1;
+		}
+
+		if (!get_large_page_info(area, info))
+			return 1;
+
+		if (info.mapped_pages != mappedPages - 1) {
+			fprintf(stderr, "Large page has not been split!\n");
+			return 1;
+		}
+	}
+
+	// verify the contents
+	for (size_t offset = 0; offset < kAreaSize; offset += B_PAGE_SIZE) {
+		if (*(uint32*)(address + offset) != offset / B_PAGE_SIZE) {
+			fprintf(stderr, "Page %zu has wrong contents!\n",
+				offset / B_PAGE_SIZE);
+			return 1;
+		}
+	}
+
+	delete_area(area);
+
+	printf("All tests passed.\n");
+	return 0;
+}
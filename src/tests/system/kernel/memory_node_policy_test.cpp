@@ -0,0 +1,92 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Sets the memory node policies of an area, and checks that invalid
+	policies are refused. Run it in QEMU with several "-numa node" options,
+	and compare the free pages per node in the "page_stats" KDL command.
+*/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <syscalls.h>
+#include <vm_defs.h>
+
+
+static const size_t kAreaSize = 4 * 1024 * 1024;
+
+
+static bool
+set_policy(area_id area, uint32 policy, int32 node, status_t expected)
+{
+	status_t status = _kern_set_area_memory_node_policy(area, policy, node);
+	if (status != expected) {
+		fprintf(stderr, "Setting policy %" B_PRIu32 ", node %" B_PRId32
+			" returned \"%s\" instead of \"%s\"!\n", policy, node,
+			strerror(status), strerror(expected));
+		return false;
+	}
+	return true;
+}
+
+
+static bool
+touch_area(uint8* address, size_t size)
+{
+	for (size_t offset = 0; offset < size; offset += B_PAGE_SIZE)
+		address[offset] = offset / B_PAGE_SIZE;
+
+	for (size_t offset = 0; offset < size; offset += B_PAGE_SIZE) {
+		if (address[offset] != (uint8)(offset / B_PAGE_SIZE)) {
+			fprintf(stderr, "Page %zu has wrong contents!\n",
+				offset / B_PAGE_SIZE);
+			return false;
+		}
+	}
+	return true;
+}
+
+
+int
+main()
+{
+	uint8* address;
+	area_id area = create_area("memory node area", (void**)&address,
+		B_ANY_ADDRESS, kAreaSize, B_NO_LOCK, B_READ_AREA | B_WRITE_AREA);
+	if (area < 0) {
+		fprintf(stderr, "Failed to create area: %s\n", strerror(area));
+		return 1;
+	}
+
+	if (!set_policy(area, 42, 0, B_BAD_VALUE)
+		|| !set_policy(area, B_AREA_NODE_PREFERRED, -1, B_BAD_VALUE)
+		|| !set_policy(area, B_AREA_NODE_PREFERRED, 255, B_BAD_VALUE)
+		|| !set_policy(-1, B_AREA_NODE_LOCAL, 0, B_BAD_VALUE)) {
+		return 1;
+	}
+
+	// node 0 always exists
+	if (!set_policy(area, B_AREA_NODE_PREFERRED, 0, B_OK)
+		|| !touch_area(address, kAreaSize / 2)) {
+		return 1;
+	}
+
+	if (!set_policy(area, B_AREA_NODE_INTERLEAVE, 0, B_OK)
+		|| !touch_area(address + kAreaSize / 2, kAreaSize / 2)) {
+		return 1;
+	}
+
+	if (!set_policy(area, B_AREA_NODE_LOCAL, 0, B_OK))
+		return 1;
+
+	delete_area(area);
+
+	printf("All tests passed.\n");
+	return 0;
+}
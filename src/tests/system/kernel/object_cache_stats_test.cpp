@@ -0,0 +1,64 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Lists the kernel's object caches and the statistics of their depots,
+	and checks that they are sane.
+*/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <object_cache_defs.h>
+#include <syscalls.h>
+
+
+int
+main()
+{
+	printf("%-32s %7s %12s %12s %10s %10s\n", "name", "magcap", "hits",
+		"misses", "exchanges", "contended");
+
+	int32 cookie = 0;
+	int32 count = 0;
+	object_cache_stats stats;
+	status_t status;
+	while ((status = _kern_get_next_object_cache_stats(&cookie, &stats))
+			== B_OK) {
+		count++;
+
+		if (stats.magazine_capacity == 0)
+			continue;
+
+		printf("%-32s %3" B_PRIu32 "/%-3" B_PRIu32 " %12" B_PRIu64 " %12"
+			B_PRIu64 " %10" B_PRIu64 " %10" B_PRIu64 "\n", stats.name,
+			stats.magazine_capacity, stats.initial_magazine_capacity,
+			stats.depot_hits, stats.depot_misses, stats.exchanges,
+			stats.contentions);
+
+		if (stats.magazine_capacity < stats.initial_magazine_capacity
+			|| stats.used_objects > stats.total_objects) {
+			fprintf(stderr, "Object cache \"%s\" has invalid statistics!\n",
+				stats.name);
+			return 1;
+		}
+	}
+
+	if (status != B_ENTRY_NOT_FOUND) {
+		fprintf(stderr, "Failed to get object cache statistics: %s\n",
+			strerror(status));
+		return 1;
+	}
+	if (count == 0) {
+		fprintf(stderr, "No object caches found!\n");
+		return 1;
+	}
+
+	printf("%" B_PRId32 " object caches.\n", count);
+	return 0;
+}
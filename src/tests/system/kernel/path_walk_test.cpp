@@ -0,0 +1,219 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures how path resolution scales when the same deep path is resolved
+	from an increasing number of threads. All components are in the entry
+	cache after the first run, so this mostly exercises the entry cache
+	lookups of the VFS.
+*/
+
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+static const char* sBaseDirectory = "/tmp";
+static int32 sDepth = 16;
+static int32 sLookups = 100000;
+static int32 sMaxThreads;
+
+static char sPath[B_PATH_NAME_LENGTH];
+static char sMissingPath[B_PATH_NAME_LENGTH];
+
+
+struct walk_thread_args {
+	thread_id	thread;
+	const char*	path;
+	bool		exists;
+	int32		errors;
+};
+
+
+static status_t
+walk_thread(void* _args)
+{
+	walk_thread_args* args = (walk_thread_args*)_args;
+
+	for (int32 i = 0; i < sLookups; i++) {
+		struct stat st;
+		bool exists = lstat(args->path, &st) == 0;
+		if (exists != args->exists)
+			args->errors++;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Lets  threadCount threads resolve  path, and returns the number of
+	lookups per second, or -1 on error.
+*/
+static double
+run(int32 threadCount, const char* path, bool exists)
+{
+	walk_thread_args* args = new walk_thread_args[threadCount];
+
+	int32 spawned = 0;
+	for (; spawned < threadCount; spawned++) {
+		walk_thread_args& threadArgs = args[spawned];
+		threadArgs.path = path;
+		threadArgs.exists = exists;
+		threadArgs.errors = 0;
+		threadArgs.thread = spawn_thread(&walk_thread, "path walker",
+			B_NORMAL_PRIORITY, &threadArgs);
+		if (threadArgs.thread < 0) {
+			fprintf(stderr, "Could not spawn thread: %s\n",
+				strerror(threadArgs.thread));
+			break;
+		}
+	}
+
+	bigtime_t start = system_time();
+	for (int32 i = 0; i < spawned; i++)
+		resume_thread(args[i].thread);
+
+	int32 errors = 0;
+	for (int32 i = 0; i < spawned; i++) {
+		status_t returnValue;
+		wait_for_thread(args[i].thread, &returnValue);
+		errors += args[i].errors;
+	}
+	bigtime_t duration = max_c(system_time() - start, 1);
+
+	delete[] args;
+
+	if (spawned < threadCount)
+		return -1;
+	if (errors != 0) {
+		fprintf(stderr, "%" B_PRId32 " lookups had the wrong result!\n",
+			errors);
+		return -1;
+	}
+
+	return 1000000.0 * threadCount * sLookups / duration;
+}
+
+
+static bool
+run_all(const char* title, const char* path, bool exists)
+{
+	printf("\n%s: %s\n", title, path);
+	printf("threads    walks/sec\n");
+
+	for (int32 threads = 1;; threads = min_c(threads * 2, sMaxThreads)) {
+		double perSecond = run(threads, path, exists);
+		if (perSecond < 0)
+			return false;
+
+		printf("%7" B_PRId32 " %12.0f\n", threads, perSecond);
+
+		if (threads == sMaxThreads)
+			return true;
+	}
+}
+
+
+static bool
+create_tree()
+{
+	snprintf(sPath, sizeof(sPath), "%s/path_walk_test-%" B_PRId32,
+		sBaseDirectory, getpid());
+
+	size_t length = strlen(sPath);
+	for (int32 i = 0; i <= sDepth; i++) {
+		if (mkdir(sPath, 0755) != 0 && errno != EEXIST) {
+			fprintf(stderr, "Could not create \"%s\": %s\n", sPath,
+				strerror(errno));
+			return false;
+		}
+
+		if (i == sDepth)
+			break;
+
+		length += snprintf(sPath + length, sizeof(sPath) - length,
+			"/dir%" B_PRId32, i);
+		if (length >= sizeof(sPath)) {
+			fprintf(stderr, "Path too long, use a smaller depth.\n");
+			return false;
+		}
+	}
+
+	snprintf(sMissingPath, sizeof(sMissingPath), "%s/missing", sPath);
+	return true;
+}
+
+
+static void
+remove_tree()
+{
+	char path[B_PATH_NAME_LENGTH];
+	strlcpy(path, sPath, sizeof(path));
+
+	for (int32 i = 0; i <= sDepth; i++) {
+		rmdir(path);
+		char* slash = strrchr(path, '/');
+		if (slash == NULL)
+			break;
+		*slash = '\0';
+	}
+}
+
+
+static void
+usage()
+{
+	fprintf(stderr, "usage: path_walk_test [-d <depth>] [-t <max-threads>] "
+		"[-n <lookups-per-thread>] [-b <base-directory>]\n");
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	system_info info;
+	get_system_info(&info);
+	sMaxThreads = info.cpu_count;
+
+	for (int i = 1; i < argc; i++) {
+		if (i + 1 >= argc)
+			usage();
+
+		if (!strcmp(argv[i], "-d"))
+			sDepth = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-t"))
+			sMaxThreads = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-n"))
+			sLookups = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-b"))
+			sBaseDirectory = argv[++i];
+		else
+			usage();
+	}
+	if (sDepth < 1 || sMaxThreads < 1 || sLookups < 1)
+		usage();
+
+	if (!create_tree()) {
+		remove_tree();
+		return 1;
+	}
+
+	printf("depth %" B_PRId32 ", %" B_PRId32 " lookups per thread\n",
+		sDepth, sLookups);
+
+	bool success = run_all("existing entry", sPath, true)
+		&& run_all("missing entry", sMissingPath, false);
+
+	remove_tree();
+
+	return success ? 0 : 1;
+}
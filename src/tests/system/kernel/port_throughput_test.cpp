@@ -0,0 +1,216 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures the throughput of ports for message sizes from 64 bytes to
+	4 MB. Messages larger than the maximum port message size are sent in
+	chunks of that size.
+
+	The reader either reads with a buffer large enough for any message
+	(which allows the kernel to copy large messages directly into it), or
+	first asks for the size of the next message, like BLooper does.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+extern const char* __progname;
+static const char* kProgramName = __progname;
+
+static const size_t kMinMessageSize = 64;
+static const size_t kMaxMessageSize = 4 * 1024 * 1024;
+static const size_t kMaxPortMessageSize = 256 * 1024;
+	// the kernel's limit
+static const size_t kBytesPerRun = 256 * 1024 * 1024;
+static const int32 kMaxMessagesPerRun = 200000;
+static const int32 kPortQueueLength = 16;
+
+enum {
+	READ_DIRECT = 0,
+	READ_SIZED,
+	READ_MODE_COUNT
+};
+
+static const char* kReadModeNames[READ_MODE_COUNT] = {
+	"direct", "sized"
+};
+
+struct reader_data {
+	port_id		port;
+	int32		mode;
+	int32		messages;
+	size_t		bufferSize;
+	status_t	status;
+};
+
+
+static void
+usage()
+{
+	fprintf(stderr, "Usage: %s [-m <max-message-size>]\n", kProgramName);
+	exit(1);
+}
+
+
+static status_t
+reader_thread(void* _data)
+{
+	reader_data& data = *(reader_data*)_data;
+
+	uint8* buffer = (uint8*)malloc(data.bufferSize);
+	if (buffer == NULL) {
+		data.status = B_NO_MEMORY;
+		return data.status;
+	}
+
+	data.status = B_OK;
+	for (int32 i = 0; i < data.messages; i++) {
+		size_t size = data.bufferSize;
+		if (data.mode == READ_SIZED) {
+			ssize_t bufferSize = port_buffer_size(data.port);
+			if (bufferSize < 0) {
+				data.status = bufferSize;
+				break;
+			}
+			size = bufferSize;
+		}
+
+		int32 code;
+		ssize_t bytesRead = read_port(data.port, &code, buffer, size);
+		if (bytesRead < 0) {
+			data.status = bytesRead;
+			break;
+		}
+		if (code != i) {
+			data.status = B_BAD_DATA;
+			break;
+		}
+	}
+
+	free(buffer);
+	return data.status;
+}
+
+
+static status_t
+run_benchmark(size_t messageSize, int32 mode, bigtime_t& _time,
+	int32& _messages)
+{
+	size_t chunkSize = messageSize < kMaxPortMessageSize
+		? messageSize : kMaxPortMessageSize;
+	int32 chunksPerMessage = (messageSize + chunkSize - 1) / chunkSize;
+
+	int32 messages = kBytesPerRun / messageSize;
+	if (messages > kMaxMessagesPerRun)
+		messages = kMaxMessagesPerRun;
+	if (messages < 16)
+		messages = 16;
+
+	uint8* buffer = (uint8*)malloc(messageSize);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+	memset(buffer, 0x55, messageSize);
+
+	port_id port = create_port(kPortQueueLength, "throughput test");
+	if (port < 0) {
+		free(buffer);
+		return port;
+	}
+
+	reader_data data;
+	data.port = port;
+	data.mode = mode;
+	data.messages = messages * chunksPerMessage;
+	data.bufferSize = chunkSize;
+	data.status = B_OK;
+
+	thread_id reader = spawn_thread(&reader_thread, "reader",
+		B_NORMAL_PRIORITY, &data);
+	if (reader < 0) {
+		delete_port(port);
+		free(buffer);
+		return reader;
+	}
+	resume_thread(reader);
+
+	status_t status = B_OK;
+	bigtime_t startTime = system_time();
+
+	int32 code = 0;
+	for (int32 i = 0; i < messages && status == B_OK; i++) {
+		for (size_t offset = 0; offset < messageSize; offset += chunkSize) {
+			status = write_port(port, code++, buffer + offset, chunkSize);
+			if (status != B_OK)
+				break;
+		}
+	}
+
+	status_t readerStatus;
+	wait_for_thread(reader, &readerStatus);
+	_time = system_time() - startTime;
+	_messages = messages;
+
+	delete_port(port);
+	free(buffer);
+
+	if (status != B_OK)
+		return status;
+	return data.status;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	size_t maxMessageSize = kMaxMessageSize;
+
+	int option;
+	while ((option = getopt(argc, argv, "m:h")) != -1) {
+		switch (option) {
+			case 'm':
+				maxMessageSize = strtoul(optarg, NULL, 0);
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (optind != argc || maxMessageSize < kMinMessageSize)
+		usage();
+
+	printf("%10s", "size");
+	for (int32 mode = 0; mode < READ_MODE_COUNT; mode++)
+		printf("  %8s msg/s  %8s MB/s", kReadModeNames[mode],
+			kReadModeNames[mode]);
+	putchar('\n');
+
+	for (size_t size = kMinMessageSize; size <= maxMessageSize; size *= 2) {
+		printf("%10zu", size);
+		for (int32 mode = 0; mode < READ_MODE_COUNT; mode++) {
+			bigtime_t time;
+			int32 messages;
+			status_t status = run_benchmark(size, mode, time, messages);
+			if (status != B_OK) {
+				fprintf(stderr, "\n%s: benchmark failed: %s\n", kProgramName,
+					strerror(status));
+				return 1;
+			}
+
+			if (time <= 0)
+				time = 1;
+			printf("  %14.0f  %13.1f", 1000000.0 * messages / time,
+				(double)messages * size / time);
+		}
+		putchar('\n');
+	}
+
+	return 0;
+}
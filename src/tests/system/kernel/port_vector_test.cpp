@@ -0,0 +1,241 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Tests read_port_vector_etc() and write_port_vector_etc(), and compares
+	the throughput of small messages when they are read and written one at
+	a time, and several at once.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+
+extern const char* __progname;
+static const char* kProgramName = __progname;
+
+static const int32 kMessageCount = 200000;
+static const size_t kMessageSize = 64;
+static const int32 kVectorCount = 16;
+static const int32 kPortQueueLength = 64;
+
+struct thread_data {
+	port_id		port;
+	bool		vector;
+	status_t	status;
+};
+
+
+static void
+check(bool condition, const char* what)
+{
+	if (!condition) {
+		fprintf(stderr, "%s: %s failed!\n", kProgramName, what);
+		exit(1);
+	}
+}
+
+
+static void
+test_semantics()
+{
+	port_id port = create_port(3, "vector test");
+	check(port >= 0, "create_port()");
+
+	char data[5][kMessageSize];
+	port_message_entry entries[5];
+	for (int32 i = 0; i < 5; i++) {
+		memset(data[i], 'a' + i, sizeof(data[i]));
+		entries[i].code = i;
+		entries[i].size = 10 + i;
+		entries[i].buffer = data[i];
+	}
+
+	// only as many messages as the queue can hold are written
+	ssize_t count = write_port_vector_etc(port, entries, 5, B_RELATIVE_TIMEOUT,
+		0);
+	check(count == 3, "writing into a port that can't hold all messages");
+	check(port_count(port) == 3, "port_count() after vector write");
+
+	count = write_port_vector_etc(port, entries, 5, B_RELATIVE_TIMEOUT, 0);
+	check(count == B_WOULD_BLOCK, "writing into a full port");
+
+	// a buffer too small for the first message leaves it in the queue
+	char buffer[4096];
+	port_message_entry readEntries[5];
+	count = read_port_vector_etc(port, buffer, 4, readEntries, 5,
+		B_RELATIVE_TIMEOUT, 0);
+	check(count == B_BUFFER_OVERFLOW, "reading into a too small buffer");
+	check(readEntries[0].code == 0 && readEntries[0].size == 10,
+		"entry of the message that didn't fit");
+	check(port_count(port) == 3, "port_count() after overflow");
+
+	// only the messages that fit into the buffer are read
+	count = read_port_vector_etc(port, buffer, 20, readEntries, 5,
+		B_RELATIVE_TIMEOUT, 0);
+	check(count == 1, "reading into a buffer that fits one message");
+
+	count = read_port_vector_etc(port, buffer, sizeof(buffer), readEntries, 5,
+		B_RELATIVE_TIMEOUT, 0);
+	check(count == 2, "reading the remaining messages");
+
+	for (int32 i = 0; i < count; i++) {
+		const port_message_entry& entry = readEntries[i];
+		check(entry.code == i + 1 && entry.size == (size_t)(11 + i),
+			"message entry");
+		check(((addr_t)entry.buffer & 7) == 0, "message alignment");
+		check(memcmp(entry.buffer, data[i + 1], entry.size) == 0,
+			"message contents");
+	}
+
+	count = read_port_vector_etc(port, buffer, sizeof(buffer), readEntries, 5,
+		B_RELATIVE_TIMEOUT, 0);
+	check(count == B_WOULD_BLOCK, "reading from an empty port");
+
+	delete_port(port);
+	count = read_port_vector_etc(port, buffer, sizeof(buffer), readEntries, 5,
+		0, 0);
+	check(count == B_BAD_PORT_ID, "reading from a deleted port");
+}
+
+
+static status_t
+writer_thread(void* _data)
+{
+	thread_data& data = *(thread_data*)_data;
+
+	char buffer[kVectorCount][kMessageSize];
+	memset(buffer, 0x55, sizeof(buffer));
+
+	port_message_entry entries[kVectorCount];
+	for (int32 i = 0; i < kVectorCount; i++) {
+		entries[i].size = kMessageSize;
+		entries[i].buffer = buffer[i];
+	}
+
+	data.status = B_OK;
+	for (int32 sent = 0; sent < kMessageCount;) {
+		if (!data.vector) {
+			data.status = write_port(data.port, sent, buffer[0], kMessageSize);
+			if (data.status != B_OK)
+				break;
+			sent++;
+			continue;
+		}
+
+		int32 count = kMessageCount - sent;
+		if (count > kVectorCount)
+			count = kVectorCount;
+		for (int32 i = 0; i < count; i++)
+			entries[i].code = sent + i;
+
+		ssize_t written = write_port_vector_etc(data.port, entries, count, 0,
+			0);
+		if (written < 0) {
+			data.status = written;
+			break;
+		}
+		sent += written;
+	}
+
+	return data.status;
+}
+
+
+static status_t
+read_messages(port_id port, bool vector)
+{
+	char buffer[kVectorCount * kMessageSize];
+	port_message_entry entries[kVectorCount];
+
+	for (int32 received = 0; received < kMessageCount;) {
+		if (!vector) {
+			int32 code;
+			ssize_t bytesRead = read_port(port, &code, buffer, kMessageSize);
+			if (bytesRead < 0)
+				return bytesRead;
+			if (code != received)
+				return B_BAD_DATA;
+			received++;
+			continue;
+		}
+
+		ssize_t count = read_port_vector_etc(port, buffer, sizeof(buffer),
+			entries, kVectorCount, 0, 0);
+		if (count < 0)
+			return count;
+
+		for (int32 i = 0; i < count; i++) {
+			if (entries[i].code != received++)
+				return B_BAD_DATA;
+		}
+	}
+
+	return B_OK;
+}
+
+
+static status_t
+run_benchmark(bool vector, bigtime_t& _time)
+{
+	port_id port = create_port(kPortQueueLength, "vector benchmark");
+	if (port < 0)
+		return port;
+
+	thread_data data;
+	data.port = port;
+	data.vector = vector;
+	data.status = B_OK;
+
+	thread_id writer = spawn_thread(&writer_thread, "writer",
+		B_NORMAL_PRIORITY, &data);
+	if (writer < 0) {
+		delete_port(port);
+		return writer;
+	}
+
+	bigtime_t startTime = system_time();
+	resume_thread(writer);
+
+	status_t status = read_messages(port, vector);
+
+	status_t writerStatus;
+	wait_for_thread(writer, &writerStatus);
+	_time = system_time() - startTime;
+
+	delete_port(port);
+
+	if (status != B_OK)
+		return status;
+	return data.status;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	test_semantics();
+
+	for (int32 vector = 0; vector < 2; vector++) {
+		bigtime_t time;
+		status_t status = run_benchmark(vector != 0, time);
+		if (status != B_OK) {
+			fprintf(stderr, "%s: benchmark failed: %s\n", kProgramName,
+				strerror(status));
+			return 1;
+		}
+
+		if (time <= 0)
+			time = 1;
+		printf("%-8s %10.0f msg/s\n", vector != 0 ? "vector" : "single",
+			1000000.0 * kMessageCount / time);
+	}
+
+	return 0;
+}
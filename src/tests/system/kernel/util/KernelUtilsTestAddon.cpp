@@ -5,6 +5,7 @@
 #include "BOpenHashTableTest.h"
 #include "BitmapTest.h"
 #include "DoublyLinkedListTest.h"
+#include "LZ4Test.h"
 #include "SinglyLinkedListTest.h"
 #include "VectorMapTest.h"
 #include "VectorSetTest.h"
@@ -16,6 +17,7 @@ BTestSuite* getTestSuite() {
 //	suite->addTest("AVLTreeMap", AVLTreeMapTest::Suite());
 	suite->addTest("BOpenHashTable", BOpenHashTableTest::Suite());
 	suite->addTest("Bitmap", BitmapTest::Suite());
+	suite->addTest("LZ4", LZ4Test::Suite());
 	suite->addTest("SinglyLinkedList", SinglyLinkedListTest::Suite());
 	suite->addTest("DoublyLinkedList", DoublyLinkedListTest::Suite());
 	suite->addTest("VectorMap", VectorMapTest::Suite());
@@ -0,0 +1,138 @@
+#include <cppunit/Test.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestSuite.h>
+#include <stdlib.h>
+#include <string.h>
+#include <TestUtils.h>
+
+#include "LZ4Test.h"
+#include "lz4.h"
+
+
+static const size_t kPageSize = 4096;
+
+
+LZ4Test::LZ4Test(std::string name)
+	: BTestCase(name)
+{
+}
+
+CppUnit::Test*
+LZ4Test::Suite()
+{
+	CppUnit::TestSuite *suite = new CppUnit::TestSuite("LZ4");
+
+	suite->addTest(new CppUnit::TestCaller<LZ4Test>("LZ4::RoundTrip test",
+		&LZ4Test::RoundTripTest));
+	suite->addTest(new CppUnit::TestCaller<LZ4Test>("LZ4::Incompressible test",
+		&LZ4Test::IncompressibleTest));
+	suite->addTest(new CppUnit::TestCaller<LZ4Test>("LZ4::CorruptData test",
+		&LZ4Test::CorruptDataTest));
+
+	return suite;
+}
+
+static void
+round_trip(const uint8* page, size_t size, ssize_t* _compressedSize = NULL)
+{
+	uint16 workMemory[LZ4_WORK_MEMORY_SIZE / sizeof(uint16)];
+	uint8 compressed[kPageSize * 2];
+	uint8 decompressed[kPageSize];
+
+	ssize_t compressedSize = lz4_compress(page, size, compressed,
+		sizeof(compressed), workMemory);
+	CPPUNIT_ASSERT(compressedSize > 0);
+
+	ssize_t decompressedSize = lz4_decompress(compressed, compressedSize,
+		decompressed, sizeof(decompressed));
+	CPPUNIT_ASSERT_EQUAL((ssize_t)size, decompressedSize);
+	CPPUNIT_ASSERT(memcmp(page, decompressed, size) == 0);
+
+	if (_compressedSize != NULL)
+		*_compressedSize = compressedSize;
+}
+
+void
+LZ4Test::RoundTripTest()
+{
+	uint8 page[kPageSize];
+	ssize_t compressedSize;
+
+	// empty and tiny inputs
+	round_trip(page, 0);
+	page[0] = 42;
+	round_trip(page, 1);
+
+	// a zero page compresses very well
+	memset(page, 0, sizeof(page));
+	round_trip(page, sizeof(page), &compressedSize);
+	CPPUNIT_ASSERT(compressedSize < 64);
+
+	// repeating text with long matches and literal runs
+	for (size_t i = 0; i < sizeof(page); i++)
+		page[i] = "Haiku swap page "[i % 16];
+	round_trip(page, sizeof(page), &compressedSize);
+	CPPUNIT_ASSERT(compressedSize < (ssize_t)sizeof(page) / 8);
+
+	// random data with some structure
+	srand(4);
+	for (int32 run = 0; run < 200; run++) {
+		for (size_t i = 0; i < sizeof(page); i++)
+			page[i] = rand() % (run % 8 == 0 ? 256 : 4);
+		round_trip(page, 1 + rand() % sizeof(page));
+	}
+}
+
+void
+LZ4Test::IncompressibleTest()
+{
+	uint16 workMemory[LZ4_WORK_MEMORY_SIZE / sizeof(uint16)];
+	uint8 page[kPageSize];
+	uint8 compressed[kPageSize * 3 / 4];
+
+	srand(8);
+	for (size_t i = 0; i < sizeof(page); i++)
+		page[i] = rand();
+
+	// must not overflow the output buffer
+	CPPUNIT_ASSERT_EQUAL((ssize_t)B_BUFFER_OVERFLOW, lz4_compress(page,
+		sizeof(page), compressed, sizeof(compressed), workMemory));
+	round_trip(page, sizeof(page));
+}
+
+void
+LZ4Test::CorruptDataTest()
+{
+	uint16 workMemory[LZ4_WORK_MEMORY_SIZE / sizeof(uint16)];
+	uint8 page[kPageSize];
+	uint8 compressed[kPageSize * 2];
+	uint8 decompressed[kPageSize];
+
+	for (size_t i = 0; i < sizeof(page); i++)
+		page[i] = "corrupt "[i % 8] + i / 512;
+
+	ssize_t compressedSize = lz4_compress(page, sizeof(page), compressed,
+		sizeof(compressed), workMemory);
+	CPPUNIT_ASSERT(compressedSize > 0);
+
+	// too small output buffer
+	CPPUNIT_ASSERT_EQUAL((ssize_t)B_BUFFER_OVERFLOW,
+		lz4_decompress(compressed, compressedSize, decompressed,
+			sizeof(decompressed) - 1));
+
+	// truncated input
+	CPPUNIT_ASSERT(lz4_decompress(compressed, compressedSize - 1,
+		decompressed, sizeof(decompressed)) != (ssize_t)sizeof(page));
+
+	// random corruption must never crash or overflow
+	srand(15);
+	for (int32 run = 0; run < 1000; run++) {
+		uint8 corrupted[kPageSize * 2];
+		memcpy(corrupted, compressed, compressedSize);
+		corrupted[rand() % compressedSize] = rand();
+
+		ssize_t size = lz4_decompress(corrupted, compressedSize, decompressed,
+			sizeof(decompressed));
+		CPPUNIT_ASSERT(size <= (ssize_t)sizeof(decompressed));
+	}
+}
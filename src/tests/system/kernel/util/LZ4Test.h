@@ -0,0 +1,17 @@
+#ifndef _lz4_test_h_
+#define _lz4_test_h_
+
+#include <TestCase.h>
+
+class LZ4Test : public BTestCase {
+public:
+	LZ4Test(std::string name = "");
+
+	static CppUnit::Test* Suite();
+
+	void RoundTripTest();
+	void IncompressibleTest();
+	void CorruptDataTest();
+};
+
+#endif // _lz4_test_h_
@@ -6,7 +6,9 @@
 
 #include "fssh.h"
 
+#include "command_benchtree.h"
 #include "command_checkfs.h"
+#include "command_explainquery.h"
 #include "command_resizefs.h"
 
 
@@ -20,6 +22,10 @@ register_additional_commands()
 		"check file system");
 	CommandManager::Default()->AddCommand(command_resizefs, "resizefs",
 		"resize file system");
+	CommandManager::Default()->AddCommand(command_explainquery,
+		"explainquery", "show the plan chosen for a query");
+	CommandManager::Default()->AddCommand(command_benchtree, "benchtree",
+		"time rebuilding the indices, and scanning trees");
 }
 
 
@@ -0,0 +1,233 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+//!	Measures rebuilding the indices, and scanning the B+trees afterwards
+
+
+#include "fssh_dirent.h"
+#include "fssh_fcntl.h"
+#include "fssh_stat.h"
+#include "fssh_stdio.h"
+#include "fssh_string.h"
+#include "syscalls.h"
+
+#include "bfs.h"
+#include "bfs_control.h"
+
+
+namespace FSShell {
+
+
+static const char* kBenchmarkDirectory = "/myfs/benchtree";
+
+
+static fssh_status_t
+create_files(uint64 count)
+{
+	fssh_status_t status = _kern_create_dir(-1, kBenchmarkDirectory, 0755);
+	if (status != B_OK && status != B_FILE_EXISTS)
+		return status;
+
+	for (uint64 i = 0; i < count; i++) {
+		char path[B_PATH_NAME_LENGTH];
+		fssh_snprintf(path, sizeof(path), "%s/file-%08" B_PRIx64,
+			kBenchmarkDirectory, i * 2654435761ULL % 0xffffffff);
+			// spread out the names, so that they are not inserted in order
+
+		int fd = _kern_open(-1, path, FSSH_O_CREAT | FSSH_O_WRONLY, 0644);
+		if (fd < 0)
+			return fd;
+
+		_kern_close(fd);
+	}
+
+	return B_OK;
+}
+
+
+static fssh_status_t
+rebuild_indices(bool insert, bigtime_t& _checkTime, bigtime_t& _indexTime)
+{
+	int rootDir = _kern_open_dir(-1, "/myfs");
+	if (rootDir < 0)
+		return rootDir;
+
+	struct check_control result;
+	memset(&result, 0, sizeof(result));
+	result.magic = BFS_IOCTL_CHECK_MAGIC;
+	result.flags = BFS_REBUILD_INDICES;
+	if (insert)
+		result.flags |= BFS_INSERT_INDEX_KEYS;
+
+	bigtime_t startTime = system_time();
+	bigtime_t indexStartTime = 0;
+
+	fssh_status_t status = _kern_ioctl(rootDir, BFS_IOCTL_START_CHECKING,
+		&result, sizeof(result));
+	if (status != B_OK) {
+		_kern_close(rootDir);
+		return status;
+	}
+
+	while (true) {
+		bigtime_t callTime = system_time();
+		if (_kern_ioctl(rootDir, BFS_IOCTL_CHECK_NEXT_NODE, &result,
+				sizeof(result)) != B_OK)
+			break;
+
+		if (result.pass == BFS_CHECK_PASS_INDEX && indexStartTime == 0)
+			indexStartTime = callTime;
+	}
+
+	status = _kern_ioctl(rootDir, BFS_IOCTL_STOP_CHECKING, &result,
+		sizeof(result));
+	_kern_close(rootDir);
+
+	bigtime_t endTime = system_time();
+	_checkTime = endTime - startTime;
+	_indexTime = indexStartTime != 0 ? endTime - indexStartTime : 0;
+
+	if (status != B_OK)
+		return status;
+	if (result.status != B_ENTRY_NOT_FOUND && result.status != B_OK)
+		return result.status;
+
+	return B_OK;
+}
+
+
+static fssh_status_t
+scan(int fd, uint64& _entries)
+{
+	char buffer[sizeof(fssh_dirent) + B_FILE_NAME_LENGTH];
+	fssh_dirent* entry = (fssh_dirent*)buffer;
+
+	_entries = 0;
+
+	fssh_ssize_t entriesRead;
+	while ((entriesRead = _kern_read_dir(fd, entry, sizeof(buffer), 1)) == 1)
+		_entries++;
+
+	_kern_close(fd);
+	return entriesRead < 0 ? (fssh_status_t)entriesRead : B_OK;
+}
+
+
+static void
+print_time(const char* what, bigtime_t time, uint64 count)
+{
+	fssh_dprintf("%-24s %10" B_PRId64 " usecs", what, time);
+	if (count > 0 && time > 0) {
+		fssh_dprintf(", %10.0f/s (%" B_PRIu64 ")", 1000000.0 * count / time,
+			count);
+	}
+	fssh_dprintf("\n");
+}
+
+
+fssh_status_t
+command_benchtree(int argc, const char* const* argv)
+{
+	bool insert = false;
+	uint64 files = 0;
+	const char* query = NULL;
+	const char* directory = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-i"))
+			insert = true;
+		else if (!strcmp(argv[i], "-n") && i + 1 < argc
+			&& fssh_sscanf(argv[i + 1], "%" B_SCNu64, &files) == 1)
+			i++;
+		else if (!strcmp(argv[i], "-q") && i + 1 < argc)
+			query = argv[++i];
+		else if (!strcmp(argv[i], "-d") && i + 1 < argc)
+			directory = argv[++i];
+		else {
+			fssh_dprintf("Usage: %s [-i] [-n <files>] [-q <query>] "
+				"[-d <directory>]\n"
+				"Rebuilds all indices, and reports how long that takes.\n"
+				"  -i  insert the index keys one by one instead of bulk "
+				"loading them\n"
+				"  -n  create the given number of files in %s first\n"
+				"  -q  time iterating over the results of the query "
+				"afterwards\n"
+				"  -d  time listing the directory afterwards\n", argv[0],
+				kBenchmarkDirectory);
+			return B_ERROR;
+		}
+	}
+
+	fssh_status_t status;
+	if (files > 0) {
+		bigtime_t startTime = system_time();
+		status = create_files(files);
+		if (status != B_OK) {
+			fssh_dprintf("Creating the files failed: %s\n",
+				fssh_strerror(status));
+			return status;
+		}
+		_kern_sync();
+		print_time("create files", system_time() - startTime, files);
+	}
+
+	bigtime_t checkTime;
+	bigtime_t indexTime;
+	status = rebuild_indices(insert, checkTime, indexTime);
+	if (status != B_OK) {
+		fssh_dprintf("Rebuilding the indices failed: %s\n",
+			fssh_strerror(status));
+		return status;
+	}
+
+	print_time("check file system", checkTime, 0);
+	print_time(insert ? "rebuild indices (insert)" : "rebuild indices (bulk)",
+		indexTime, 0);
+
+	if (query != NULL) {
+		struct fssh_stat st;
+		status = _kern_read_stat(-1, "/myfs", false, &st, sizeof(st));
+		if (status != B_OK)
+			return status;
+
+		bigtime_t startTime = system_time();
+		int fd = _kern_open_query(st.fssh_st_dev, query, strlen(query), 0, -1,
+			-1);
+		if (fd < 0) {
+			fssh_dprintf("Opening the query failed: %s\n", fssh_strerror(fd));
+			return fd;
+		}
+
+		uint64 entries;
+		status = scan(fd, entries);
+		if (status != B_OK)
+			return status;
+
+		print_time("query", system_time() - startTime, entries);
+	}
+
+	if (directory != NULL) {
+		bigtime_t startTime = system_time();
+		int fd = _kern_open_dir(-1, directory);
+		if (fd < 0) {
+			fssh_dprintf("Opening the directory failed: %s\n",
+				fssh_strerror(fd));
+			return fd;
+		}
+
+		uint64 entries;
+		status = scan(fd, entries);
+		if (status != B_OK)
+			return status;
+
+		print_time("list directory", system_time() - startTime, entries);
+	}
+
+	return B_OK;
+}
+
+
+}	// namespace FSShell
@@ -0,0 +1,21 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef BENCHTREE_H
+#define BENCHTREE_H
+
+
+#include "fssh_types.h"
+
+
+namespace FSShell {
+
+
+fssh_status_t command_benchtree(int argc, const char* const* argv);
+
+
+}	// namespace FSShell
+
+
+#endif	// BENCHTREE_H
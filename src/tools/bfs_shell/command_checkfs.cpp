@@ -131,6 +131,21 @@ command_checkfs(int argc, const char* const* argv)
 		result.stats.double_indirect_array_blocks,
 		result.stats.blocks_in_double_indirect * result.stats.block_size);
 
+	fssh_dprintf("\n\tdata streams\t\t\t%" FSSH_B_PRIu64 " (%" FSSH_B_PRIu64
+		" fragmented)\n", result.stats.data_streams,
+		result.stats.fragmented_streams);
+	fssh_dprintf("\textents per stream\t\t%.2f (at most %" FSSH_B_PRIu64
+		", inode %" FSSH_B_PRIdINO ")\n", result.stats.data_streams > 0
+			? 1.0 * result.stats.data_extents / result.stats.data_streams : 0.0,
+		result.stats.max_stream_extents,
+		result.stats.most_fragmented_inode);
+	fssh_dprintf("\tfree extents\t\t\t%" FSSH_B_PRIu64 " (largest %"
+		FSSH_B_PRIu64 " blocks)\n", result.stats.free_extents,
+		result.stats.largest_free_extent);
+
+	if ((result.errors & BFS_INDEX_NOT_REBUILT) != 0)
+		fssh_dprintf("\nSome indices could not be rebuilt, and may be incomplete!\n");
+
 	if (result.status == B_ENTRY_NOT_FOUND)
 		result.status = B_OK;
 
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "fssh_stdio.h"
+#include "fssh_string.h"
+#include "syscalls.h"
+
+#include "bfs.h"
+#include "bfs_control.h"
+
+
+namespace FSShell {
+
+
+fssh_status_t
+command_explainquery(int argc, const char* const* argv)
+{
+	uint32 flags = 0;
+	int argi = 1;
+	if (argc == 3 && !fssh_strcmp(argv[1], "-a")) {
+		flags |= B_QUERY_NON_INDEXED;
+		argi++;
+	}
+
+	if (argi + 1 != argc) {
+		fssh_dprintf("Usage: %s [-a] <query string>\n"
+			"  -a  plan for a query that includes non-indexed attributes\n",
+			argv[0]);
+		return B_ERROR;
+	}
+
+	int rootDir = _kern_open_dir(-1, "/myfs");
+	if (rootDir < 0) {
+		fssh_dprintf("Error: Couldn't open root directory\n");
+		return rootDir;
+	}
+
+	char plan[16384];
+
+	explain_query explain;
+	explain.query = argv[argi];
+	explain.flags = flags;
+	explain.plan = plan;
+	explain.plan_size = sizeof(plan);
+	explain.plan_length = 0;
+
+	status_t status = _kern_ioctl(rootDir, BFS_IOCTL_EXPLAIN_QUERY,
+		&explain, sizeof(explain));
+
+	_kern_close(rootDir);
+
+	if (status != B_OK) {
+		fssh_dprintf("Explaining the query failed: %s\n",
+			fssh_strerror(status));
+		return status;
+	}
+
+	fssh_dprintf("%s", plan);
+	if (explain.plan_length >= sizeof(plan))
+		fssh_dprintf("...\n");
+
+	return B_OK;
+}
+
+
+}	// namespace FSShell
@@ -0,0 +1,21 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef EXPLAINQUERY_H
+#define EXPLAINQUERY_H
+
+
+#include "fssh_types.h"
+
+
+namespace FSShell {
+
+
+fssh_status_t command_explainquery(int argc, const char* const* argv);
+
+
+}	// namespace FSShell
+
+
+#endif	// EXPLAINQUERY_H
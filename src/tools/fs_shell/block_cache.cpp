@@ -14,6 +14,7 @@
 #include "fssh_kernel_export.h"
 #include "fssh_lock.h"
 #include "fssh_string.h"
+#include "fssh_uio.h"
 #include "fssh_unistd.h"
 #include "hash.h"
 #include "vfs.h"
@@ -133,6 +134,7 @@ struct block_cache {
 };
 
 static const int32_t kMaxBlockCount = 1024;
+static const fssh_size_t kMaxPrefetchBlocks = 64;
 
 struct cache_listener;
 typedef DoublyLinkedListLink<cache_listener> listener_link;
@@ -1740,6 +1742,70 @@ fssh_block_cache_get(void* _cache, fssh_off_t blockNumber)
 }
 
 
+/*!	Reads up to \a *_numBlocks blocks beginning at \a blockNumber into the
+	cache with a single request. Prefetching stops at the first block that
+	is already in the cache, and \a *_numBlocks is set to the number of
+	blocks that have been read in.
+	Unlike the kernel version, this one does not return before the blocks
+	have been read.
+*/
+fssh_status_t
+fssh_block_cache_prefetch(void* _cache, fssh_off_t blockNumber,
+	fssh_size_t* _numBlocks)
+{
+	block_cache* cache = (block_cache*)_cache;
+	fssh_size_t numBlocks = *_numBlocks;
+	if (numBlocks > kMaxPrefetchBlocks)
+		numBlocks = kMaxPrefetchBlocks;
+	*_numBlocks = 0;
+
+	if (blockNumber < 0 || blockNumber >= cache->max_blocks)
+		return FSSH_B_BAD_VALUE;
+
+	MutexLocker locker(&cache->lock);
+
+	cached_block* blocks[kMaxPrefetchBlocks];
+	fssh_iovec vecs[kMaxPrefetchBlocks];
+	fssh_size_t count = 0;
+
+	for (; count < numBlocks
+			&& blockNumber + (fssh_off_t)count < cache->max_blocks; count++) {
+		fssh_off_t number = blockNumber + count;
+		if (hash_lookup(cache->hash, &number) != NULL)
+			break;
+
+		cached_block* block = cache->NewBlock(number);
+		if (block == NULL)
+			break;
+
+		hash_insert(cache->hash, block);
+		blocks[count] = block;
+		vecs[count].iov_base = block->current_data;
+		vecs[count].iov_len = cache->block_size;
+	}
+
+	if (count == 0)
+		return FSSH_B_OK;
+
+	fssh_ssize_t bytesRead = fssh_readv_pos(cache->fd,
+		blockNumber * cache->block_size, vecs, count);
+	fssh_size_t validBlocks = bytesRead > 0
+		? bytesRead / cache->block_size : 0;
+
+	for (fssh_size_t i = 0; i < count; i++) {
+		if (i < validBlocks) {
+			// nobody uses the block yet
+			blocks[i]->unused = true;
+			cache->unused_blocks.Add(blocks[i]);
+		} else
+			cache->RemoveBlock(blocks[i]);
+	}
+
+	*_numBlocks = validBlocks;
+	return validBlocks == count ? FSSH_B_OK : FSSH_B_IO_ERROR;
+}
+
+
 /*!	Changes the internal status of a writable block to \a dirty. This can be
 	helpful in case you realize you don't need to change that block anymore
 	for whatever reason.